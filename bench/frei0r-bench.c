@@ -0,0 +1,591 @@
+/* frei0r-bench.c
+ * Copyright (C) 2013 the frei0r project
+ *
+ * Loads frei0r plugins, runs frames through them and reports the
+ * throughput of every effect.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <dlfcn.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "frei0r.h"
+
+#ifndef FREI0R_BENCH_PLUGIN_DIR
+#define FREI0R_BENCH_PLUGIN_DIR "/usr/local/lib/frei0r-1"
+#endif
+
+/* ------------------------------------------------------------------------
+ * allocation counting
+ *
+ * malloc and friends are interposed so that the heap allocations done by
+ * a plugin while it processes frames can be reported. dlsym itself may
+ * allocate before the real functions are known, such requests are served
+ * from a small static arena.
+ */
+
+#if defined(__GLIBC__)
+#define COUNT_ALLOCS 1
+
+static void* (*real_malloc)(size_t);
+static void* (*real_calloc)(size_t, size_t);
+static void* (*real_realloc)(void*, size_t);
+static void (*real_free)(void*);
+
+static char boot_arena[4096];
+static size_t boot_used;
+static volatile int counting;
+static unsigned long alloc_count;
+
+/* Plugins may allocate from their own threads, the count is atomic. */
+#define COUNT_ALLOC() \
+  do { if (counting) __sync_fetch_and_add(&alloc_count, 1); } while (0)
+
+static void* boot_alloc(size_t size)
+{
+  void* p;
+  size = (size + 15) & ~(size_t)15;
+  if (boot_used + size > sizeof(boot_arena))
+    return 0;
+  p = boot_arena + boot_used;
+  boot_used += size;
+  return p;
+}
+
+static int is_boot(void* p)
+{
+  return (char*)p >= boot_arena && (char*)p < boot_arena + sizeof(boot_arena);
+}
+
+static void init_alloc_hooks()
+{
+  real_malloc = dlsym(RTLD_NEXT, "malloc");
+  real_calloc = dlsym(RTLD_NEXT, "calloc");
+  real_realloc = dlsym(RTLD_NEXT, "realloc");
+  real_free = dlsym(RTLD_NEXT, "free");
+}
+
+void* malloc(size_t size)
+{
+  if (!real_malloc)
+    return boot_alloc(size);
+  COUNT_ALLOC();
+  return real_malloc(size);
+}
+
+void* calloc(size_t n, size_t size)
+{
+  if (!real_calloc)
+    return boot_alloc(n * size); /* the arena is zero initialized */
+  COUNT_ALLOC();
+  return real_calloc(n, size);
+}
+
+void* realloc(void* p, size_t size)
+{
+  if (!real_realloc || is_boot(p))
+    {
+      void* q = real_malloc ? real_malloc(size) : boot_alloc(size);
+      if (q && p)
+        {
+          size_t avail = boot_arena + sizeof(boot_arena) - (char*)p;
+          memcpy(q, p, size < avail ? size : avail);
+        }
+      return q;
+    }
+  COUNT_ALLOC();
+  return real_realloc(p, size);
+}
+
+void free(void* p)
+{
+  if (p && !is_boot(p))
+    real_free(p);
+}
+
+#else
+#define COUNT_ALLOCS 0
+static void init_alloc_hooks() {}
+static volatile int counting;
+static unsigned long alloc_count;
+#endif
+
+/* ------------------------------------------------------------------------
+ * plugins
+ */
+
+typedef struct plugin
+{
+  char* path;
+  void* handle;
+  f0r_plugin_info_t info;
+
+  int (*f0r_init)();
+  void (*f0r_deinit)();
+  void (*f0r_get_plugin_info)(f0r_plugin_info_t*);
+  void (*f0r_get_param_info)(f0r_param_info_t*, int);
+  f0r_instance_t (*f0r_construct)(unsigned int, unsigned int);
+  void (*f0r_destruct)(f0r_instance_t);
+  void (*f0r_set_param_value)(f0r_instance_t, f0r_param_t, int);
+  void (*f0r_update)(f0r_instance_t, double, const uint32_t*, uint32_t*);
+  void (*f0r_update2)(f0r_instance_t, double, const uint32_t*,
+                      const uint32_t*, const uint32_t*, uint32_t*);
+} plugin_t;
+
+static int load_plugin(plugin_t* p, const char* path)
+{
+  memset(p, 0, sizeof(*p));
+  p->handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+  if (!p->handle)
+    {
+      fprintf(stderr, "frei0r-bench: %s\n", dlerror());
+      return 0;
+    }
+
+  p->f0r_init = dlsym(p->handle, "f0r_init");
+  p->f0r_deinit = dlsym(p->handle, "f0r_deinit");
+  p->f0r_get_plugin_info = dlsym(p->handle, "f0r_get_plugin_info");
+  p->f0r_get_param_info = dlsym(p->handle, "f0r_get_param_info");
+  p->f0r_construct = dlsym(p->handle, "f0r_construct");
+  p->f0r_destruct = dlsym(p->handle, "f0r_destruct");
+  p->f0r_set_param_value = dlsym(p->handle, "f0r_set_param_value");
+  p->f0r_update = dlsym(p->handle, "f0r_update");
+  p->f0r_update2 = dlsym(p->handle, "f0r_update2");
+
+  if (!p->f0r_init || !p->f0r_get_plugin_info || !p->f0r_construct
+      || !p->f0r_destruct || !(p->f0r_update || p->f0r_update2))
+    {
+      fprintf(stderr, "frei0r-bench: %s is not a frei0r plugin\n", path);
+      dlclose(p->handle);
+      return 0;
+    }
+
+  p->path = strdup(path);
+  p->f0r_init();
+  p->f0r_get_plugin_info(&p->info);
+  return 1;
+}
+
+static void unload_plugin(plugin_t* p)
+{
+  if (p->f0r_deinit)
+    p->f0r_deinit();
+  dlclose(p->handle);
+  free(p->path);
+}
+
+/* ------------------------------------------------------------------------
+ * parameter sets
+ *
+ * Every effect is measured with its default parameters and with all
+ * numeric parameters set to the low, middle and high end of their range.
+ */
+
+typedef struct param_set
+{
+  const char* name;
+  double value; /* < 0 keeps the defaults */
+} param_set_t;
+
+static const param_set_t param_sets[] = {
+  { "default", -1.0 },
+  { "low", 0.0 },
+  { "mid", 0.5 },
+  { "high", 1.0 },
+};
+
+#define NUM_PARAM_SETS (sizeof(param_sets) / sizeof(param_sets[0]))
+
+static void apply_param_set(plugin_t* p, f0r_instance_t inst, double value)
+{
+  int i;
+  if (value < 0.0 || !p->f0r_get_param_info || !p->f0r_set_param_value)
+    return;
+
+  for (i = 0; i < p->info.num_params; ++i)
+    {
+      f0r_param_info_t pinfo;
+      f0r_param_color_t color;
+      f0r_param_position_t pos;
+      double d = value;
+
+      memset(&pinfo, 0, sizeof(pinfo));
+      p->f0r_get_param_info(&pinfo, i);
+      switch (pinfo.type)
+        {
+        case F0R_PARAM_BOOL:
+        case F0R_PARAM_DOUBLE:
+          p->f0r_set_param_value(inst, &d, i);
+          break;
+        case F0R_PARAM_COLOR:
+          color.r = color.g = color.b = (float)value;
+          p->f0r_set_param_value(inst, &color, i);
+          break;
+        case F0R_PARAM_POSITION:
+          pos.x = pos.y = value;
+          p->f0r_set_param_value(inst, &pos, i);
+          break;
+        default:
+          /* strings keep their default */
+          break;
+        }
+    }
+}
+
+/* ------------------------------------------------------------------------
+ * frames
+ */
+
+static uint32_t* alloc_frame(unsigned int width, unsigned int height)
+{
+  void* frame = 0;
+  if (posix_memalign(&frame, 16, (size_t)width * height * 4))
+    return 0;
+  return (uint32_t*)frame;
+}
+
+/* A smooth gradient with some deterministic noise on top, so that neither
+ * flat areas nor random data dominate the measurement. */
+static void fill_frame(uint32_t* frame, unsigned int width,
+                       unsigned int height, unsigned int seed)
+{
+  unsigned int x, y;
+  uint32_t rnd = 2463534242u ^ seed;
+  unsigned char* px = (unsigned char*)frame;
+
+  for (y = 0; y < height; ++y)
+    for (x = 0; x < width; ++x, px += 4)
+      {
+        rnd ^= rnd << 13;
+        rnd ^= rnd >> 17;
+        rnd ^= rnd << 5;
+        px[0] = (unsigned char)(255.0 * x / width) ^ (rnd & 0x0f);
+        px[1] = (unsigned char)(255.0 * y / height) ^ ((rnd >> 8) & 0x0f);
+        px[2] = (unsigned char)(127.5 + 127.5 * sin((x + y + seed) * 0.05));
+        px[3] = (unsigned char)(rnd >> 24);
+      }
+}
+
+/* ------------------------------------------------------------------------
+ * measurement
+ */
+
+typedef struct resolution
+{
+  const char* name;
+  unsigned int width;
+  unsigned int height;
+} resolution_t;
+
+static const resolution_t resolutions[] = {
+  { "sd", 720, 576 },
+  { "hd", 1920, 1080 },
+  { "4k", 3840, 2160 },
+};
+
+#define NUM_RESOLUTIONS (sizeof(resolutions) / sizeof(resolutions[0]))
+
+typedef struct options
+{
+  int resolutions[NUM_RESOLUTIONS];
+  unsigned int frames;
+  unsigned int warmup;
+  int json;
+  FILE* out;
+} options_t;
+
+static double now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void run_frame(plugin_t* p, f0r_instance_t inst, double time,
+                      uint32_t* const* in, uint32_t* out)
+{
+  const uint32_t* in1 = p->info.plugin_type == F0R_PLUGIN_TYPE_SOURCE ? 0 : in[0];
+
+  if (p->info.plugin_type == F0R_PLUGIN_TYPE_MIXER2)
+    p->f0r_update2(inst, time, in1, in[1], 0, out);
+  else if (p->info.plugin_type == F0R_PLUGIN_TYPE_MIXER3)
+    p->f0r_update2(inst, time, in1, in[1], in[2], out);
+  else if (p->f0r_update)
+    p->f0r_update(inst, time, in1, out);
+  else
+    p->f0r_update2(inst, time, in1, 0, 0, out);
+}
+
+static const char* type_name(int type)
+{
+  switch (type)
+    {
+    case F0R_PLUGIN_TYPE_FILTER: return "filter";
+    case F0R_PLUGIN_TYPE_SOURCE: return "source";
+    case F0R_PLUGIN_TYPE_MIXER2: return "mixer2";
+    case F0R_PLUGIN_TYPE_MIXER3: return "mixer3";
+    }
+  return "unknown";
+}
+
+static int num_results;
+
+static void report(const options_t* opt, plugin_t* p, const resolution_t* res,
+                   const char* set, double seconds, unsigned long allocs)
+{
+  double pixels = (double)res->width * res->height * opt->frames;
+  double mpix = pixels / seconds * 1e-6;
+  double ns = seconds * 1e9 / pixels;
+  double allocs_per_frame = COUNT_ALLOCS ? (double)allocs / opt->frames : -1.0;
+  const char* file = strrchr(p->path, '/') ? strrchr(p->path, '/') + 1 : p->path;
+
+  if (opt->json)
+    fprintf(opt->out, "%s\n  {\"plugin\": \"%s\", \"name\": \"%s\", "
+            "\"type\": \"%s\", \"resolution\": \"%s\", \"width\": %u, "
+            "\"height\": %u, \"params\": \"%s\", \"frames\": %u, "
+            "\"mpix_per_s\": %.3f, \"ns_per_pixel\": %.3f, "
+            "\"allocs_per_frame\": %.2f}",
+            num_results ? "," : "", file, p->info.name,
+            type_name(p->info.plugin_type), res->name, res->width,
+            res->height, set, opt->frames, mpix, ns, allocs_per_frame);
+  else
+    fprintf(opt->out, "%s,\"%s\",%s,%s,%u,%u,%s,%u,%.3f,%.3f,%.2f\n",
+            file, p->info.name, type_name(p->info.plugin_type), res->name,
+            res->width, res->height, set, opt->frames, mpix, ns,
+            allocs_per_frame);
+  fflush(opt->out);
+  ++num_results;
+}
+
+static void bench_plugin(const options_t* opt, plugin_t* p)
+{
+  unsigned int r, s, i;
+
+  for (r = 0; r < NUM_RESOLUTIONS; ++r)
+    {
+      const resolution_t* res = &resolutions[r];
+      uint32_t* in[3];
+      uint32_t* out;
+
+      if (!opt->resolutions[r])
+        continue;
+
+      for (i = 0; i < 3; ++i)
+        in[i] = alloc_frame(res->width, res->height);
+      out = alloc_frame(res->width, res->height);
+      if (!in[0] || !in[1] || !in[2] || !out)
+        {
+          fprintf(stderr, "frei0r-bench: %s: out of memory at %ux%u\n",
+                  p->info.name, res->width, res->height);
+          for (i = 0; i < 3; ++i)
+            free(in[i]);
+          free(out);
+          continue;
+        }
+      for (i = 0; i < 3; ++i)
+        fill_frame(in[i], res->width, res->height, i * 7919);
+
+      for (s = 0; s < NUM_PARAM_SETS; ++s)
+        {
+          f0r_instance_t inst = p->f0r_construct(res->width, res->height);
+          double start, time = 0.0;
+          unsigned long allocs;
+
+          if (!inst)
+            {
+              fprintf(stderr, "frei0r-bench: %s: cannot construct at %ux%u\n",
+                      p->info.name, res->width, res->height);
+              break;
+            }
+          apply_param_set(p, inst, param_sets[s].value);
+
+          for (i = 0; i < opt->warmup; ++i, time += 0.04)
+            run_frame(p, inst, time, in, out);
+
+          alloc_count = 0;
+          counting = 1;
+          start = now();
+          for (i = 0; i < opt->frames; ++i, time += 0.04)
+            run_frame(p, inst, time, in, out);
+          start = now() - start;
+          counting = 0;
+          allocs = alloc_count;
+
+          p->f0r_destruct(inst);
+          report(opt, p, res, param_sets[s].name, start, allocs);
+        }
+
+      for (i = 0; i < 3; ++i)
+        free(in[i]);
+      free(out);
+    }
+}
+
+static int is_plugin_file(const char* name)
+{
+  size_t len = strlen(name);
+  return len > 3 && !strcmp(name + len - 3, ".so");
+}
+
+static void bench_path(const options_t* opt, const char* path)
+{
+  struct stat st;
+  plugin_t p;
+
+  if (stat(path, &st))
+    {
+      fprintf(stderr, "frei0r-bench: cannot access %s\n", path);
+      return;
+    }
+
+  if (S_ISDIR(st.st_mode))
+    {
+      struct dirent** entries;
+      int i, n = scandir(path, &entries, 0, alphasort);
+      for (i = 0; i < n; ++i)
+        {
+          const char* name = entries[i]->d_name;
+          if (name[0] != '.')
+            {
+              size_t len = strlen(path) + strlen(name) + 2;
+              char* sub = malloc(len);
+              if (!sub)
+                {
+                  fprintf(stderr, "frei0r-bench: out of memory\n");
+                  free(entries[i]);
+                  continue;
+                }
+              snprintf(sub, len, "%s/%s", path, name);
+              if (stat(sub, &st) == 0
+                  && (S_ISDIR(st.st_mode) || is_plugin_file(name)))
+                bench_path(opt, sub);
+              free(sub);
+            }
+          free(entries[i]);
+        }
+      if (n >= 0)
+        free(entries);
+      return;
+    }
+
+  if (!load_plugin(&p, path))
+    return;
+  if (p.info.frei0r_version != FREI0R_MAJOR_VERSION)
+    fprintf(stderr, "frei0r-bench: %s: unsupported frei0r version %d\n",
+            path, p.info.frei0r_version);
+  else
+    bench_plugin(opt, &p);
+  unload_plugin(&p);
+}
+
+static void usage()
+{
+  fprintf(stderr,
+          "usage: frei0r-bench [options] [plugin or directory ...]\n"
+          "\n"
+          "Runs every frei0r plugin found in the given files or directories\n"
+          "(default: " FREI0R_BENCH_PLUGIN_DIR ") and reports its throughput.\n"
+          "\n"
+          "  -r sd,hd,4k  resolutions to measure (default: sd,hd)\n"
+          "  -n frames    number of measured frames (default: 20)\n"
+          "  -w frames    number of warm up frames (default: 3)\n"
+          "  -j           write json instead of csv\n"
+          "  -o file      write the results to file instead of stdout\n");
+}
+
+static int parse_resolutions(options_t* opt, const char* list)
+{
+  unsigned int r;
+  memset(opt->resolutions, 0, sizeof(opt->resolutions));
+  for (r = 0; r < NUM_RESOLUTIONS; ++r)
+    {
+      const char* found = strstr(list, resolutions[r].name);
+      if (found)
+        opt->resolutions[r] = 1;
+    }
+  for (r = 0; r < NUM_RESOLUTIONS; ++r)
+    if (opt->resolutions[r])
+      return 1;
+  return 0;
+}
+
+int main(int argc, char** argv)
+{
+  options_t opt;
+  int i;
+
+  init_alloc_hooks();
+
+  memset(&opt, 0, sizeof(opt));
+  opt.resolutions[0] = opt.resolutions[1] = 1;
+  opt.frames = 20;
+  opt.warmup = 3;
+  opt.out = stdout;
+
+  for (i = 1; i < argc && argv[i][0] == '-'; ++i)
+    {
+      const char* arg = argv[i];
+      const char* val = i + 1 < argc ? argv[i + 1] : 0;
+
+      if (!strcmp(arg, "-j"))
+        opt.json = 1;
+      else if (!strcmp(arg, "-r") && val && parse_resolutions(&opt, val))
+        ++i;
+      else if (!strcmp(arg, "-n") && val && atoi(val) > 0)
+        opt.frames = atoi(argv[++i]);
+      else if (!strcmp(arg, "-w") && val && atoi(val) >= 0)
+        opt.warmup = atoi(argv[++i]);
+      else if (!strcmp(arg, "-o") && val)
+        {
+          opt.out = fopen(argv[++i], "w");
+          if (!opt.out)
+            {
+              perror(argv[i]);
+              return 1;
+            }
+        }
+      else
+        {
+          usage();
+          return 1;
+        }
+    }
+
+  if (opt.json)
+    fprintf(opt.out, "[");
+  else
+    fprintf(opt.out, "plugin,name,type,resolution,width,height,params,"
+            "frames,mpix_per_s,ns_per_pixel,allocs_per_frame\n");
+
+  if (i == argc)
+    bench_path(&opt, FREI0R_BENCH_PLUGIN_DIR);
+  for (; i < argc; ++i)
+    bench_path(&opt, argv[i]);
+
+  if (opt.json)
+    fprintf(opt.out, "\n]\n");
+  if (opt.out != stdout)
+    fclose(opt.out);
+  return 0;
+}
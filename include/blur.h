@@ -21,11 +21,29 @@
  * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
  */
 
+/*
+ * A box blur over a square of 2 * kernel size + 1 pixels, clipped at the
+ * frame borders. The sums are kept per column for a band of rows: going
+ * down one row adds the row entering the square and subtracts the row
+ * leaving it, and each output row slides a window along the column sums.
+ * Bands of rows are blurred in parallel, each with one row of column
+ * sums, so an instance needs width * 16 bytes per thread instead of a
+ * summed area table of the whole frame. The output frame must not be the
+ * input frame.
+ *
+ * blur_update_slice() blurs a range of rows on the calling thread, for
+ * plugins offering f0r_update_slice().
+ */
+
 #include <stdlib.h>
 #include <assert.h>
 #include <string.h>
+#if defined(_MSC_VER) && !defined(__GNUC__)
+#include <intrin.h>
+#endif
 
 #include "frei0r.h"
+#include "frei0r_thread.h"
 
 #define SIZE_RGBA 4
 
@@ -39,92 +57,158 @@ static inline int MIN(int a, int b)
   return (a < b ? a : b);
 }
 
-static inline void subtract_acc(uint32_t *dst, const uint32_t *src)
+typedef struct squareblur_instance
 {
-  int n=SIZE_RGBA;
-  while (n--)
-    *dst++ -= *src++;
-}
+  unsigned int width;
+  unsigned int height;
+  double kernel; /* the kernel size, as a percentage of the biggest of width and height */
+  unsigned int bands; /* number of bands blurred in parallel */
+  uint32_t *sums; /* column sums of each band (size = bands*width*SIZE_RGBA) */
+  volatile long *taken; /* which rows of sums slices are using (size = bands) */
+} squareblur_instance_t;
 
-static inline void add_acc(uint32_t *dst, const uint32_t *src)
+typedef struct blur_job
 {
-  int n=SIZE_RGBA;
-  while (n--)
-    *dst++ += *src++;
-}
+  squareblur_instance_t *inst;
+  unsigned int kernel_size;
+  const unsigned char *src;
+  unsigned char *dst;
+} blur_job_t;
 
-static inline void divide(unsigned char *dst, const uint32_t *src, const unsigned int val)
+static inline void add_row(uint32_t *sums, const unsigned char *row, unsigned int n)
 {
-  int n=SIZE_RGBA;
-  while (n--)
-    *dst++ = *src++ / val;
+  unsigned int i;
+  for (i=0; i<n; ++i)
+    sums[i] += row[i];
 }
 
-typedef struct squareblur_instance
+static inline void subtract_row(uint32_t *sums, const unsigned char *row, unsigned int n)
 {
-  unsigned int width;
-  unsigned int height;
-  double kernel; /* the kernel size, as a percentage of the biggest of width and height */
-  uint32_t *mem; /* memory accumulation matrix of uint32_t (size = acc_width*acc_height*SIZE_RGBA) */
-  uint32_t **acc; /* accumulation matrix of pointers to SIZE_RGBA consecutive uint32_t in mem (size = acc_width*acc_height) */
-} squareblur_instance_t;
+  unsigned int i;
+  for (i=0; i<n; ++i)
+    sums[i] -= row[i];
+}
 
-/* Updates the summed area table. */
-static void update_summed_area_table(squareblur_instance_t *inst, const uint32_t *src)
+/* Writes one row of means, rows is the number of rows in the column sums. */
+static void blur_row(const uint32_t *sums, unsigned char *dst,
+                     unsigned int width, unsigned int kernel_size,
+                     unsigned int rows)
 {
-  register unsigned char *iter_data;
-  register uint32_t *iter_mem;
-  register unsigned int i, x, y;
+  /* The window sums reach 255 * width * height, more than 32 bits hold
+     for big kernels on 8K frames. */
+  uint64_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+  const uint32_t *add = sums, *sub = sums;
+  unsigned int x, x1, lead, tail;
+  double scale;
 
-  uint32_t acc_buffer[SIZE_RGBA]; /* accumulation buffer */
+  /* The window covers [x - kernel_size, x + kernel_size] clipped to the
+     row. It is only clipped on the left for x < lead and only on the
+     right for x >= tail, in between its area does not change. */
+  lead = MIN(kernel_size, width);
+  tail = width > kernel_size ? width - kernel_size : 0;
 
-  unsigned int row_width;
-  unsigned int width, height;
-  unsigned int cell_size;
-  
-  /* Compute basic params. */
-  width = inst->width+1;
-  height = inst->height+1;
-  row_width = SIZE_RGBA * width;
-  cell_size = SIZE_RGBA * sizeof(uint32_t);
-  
-  /* Init iterators. */
-  iter_data = (unsigned char*) src;
-  iter_mem  = inst->mem;
+  x1 = MIN(kernel_size + 1, width);
+  for (x=0; x<x1; ++x, add += SIZE_RGBA)
+  {
+    s0 += add[0]; s1 += add[1]; s2 += add[2]; s3 += add[3];
+  }
 
-  /* Process first row (all zeros). */
-  memset(iter_mem, 0, row_width * cell_size);
-  iter_mem += row_width;
-  
-  if (height >= 1)
+  /* Taking the mean, adding half a unit keeps the rounding error of the
+     multiplication from ever crossing an integer, so the truncation
+     gives exactly sum / area. */
+#define BLUR_MEAN()                                       \
+  dst[0] = (unsigned char)(((int64_t)s0 + 0.5) * scale);  \
+  dst[1] = (unsigned char)(((int64_t)s1 + 0.5) * scale);  \
+  dst[2] = (unsigned char)(((int64_t)s2 + 0.5) * scale);  \
+  dst[3] = (unsigned char)(((int64_t)s3 + 0.5) * scale);  \
+  dst += SIZE_RGBA
+#define BLUR_ADD()                                                      \
+  s0 += add[0]; s1 += add[1]; s2 += add[2]; s3 += add[3];               \
+  add += SIZE_RGBA
+#define BLUR_SUB()                                                      \
+  s0 -= sub[0]; s1 -= sub[1]; s2 -= sub[2]; s3 -= sub[3];               \
+  sub += SIZE_RGBA
+
+  for (x=0; x<width; ++x)
   {
-    /* Process second row. */
-    memset(acc_buffer, 0, cell_size);
-    memset(iter_mem,   0, cell_size); /* first column is void */
-    iter_mem += SIZE_RGBA;
-    for (x=1; x<width; ++x)
-    {
-      for (i=0; i<SIZE_RGBA; ++i)
-        *iter_mem++ = (acc_buffer[i] += *iter_data++);
-    }
-    
-    /* Process other rows. */
-    for (y=2; y<height; ++y)
+    if (x >= lead && x < tail)
     {
-      /* Copy upper line. */
-      memcpy(iter_mem, iter_mem - row_width, row_width * sizeof(uint32_t));
-      
-      /* Process row. */
-      memset(acc_buffer, 0, cell_size);
-      memset(iter_mem,   0, cell_size); /* first column is void */
-      iter_mem += SIZE_RGBA;
-      for (x=1; x<width; ++x)
+      /* Interior: constant area, both ends of the window move. */
+      scale = 1.0 / ((2*kernel_size + 1)*rows);
+      for (; x+1<tail; ++x)
       {
-        for (i=0; i<SIZE_RGBA; ++i)
-          *iter_mem++ += (acc_buffer[i] += *iter_data++);
+        BLUR_MEAN();
+        BLUR_ADD();
+        BLUR_SUB();
       }
+      BLUR_MEAN();
+      if (x + kernel_size + 1 < width)
+      {
+        BLUR_ADD();
+      }
+      BLUR_SUB();
+      continue;
+    }
+
+    x1 = MIN(x + kernel_size + 1, width);
+    scale = 1.0 / ((x1 - (x > kernel_size ? x - kernel_size : 0))*rows);
+    BLUR_MEAN();
+    if (x1 < width)
+    {
+      BLUR_ADD();
+    }
+    if (x >= kernel_size)
+    {
+      BLUR_SUB();
     }
   }
+
+#undef BLUR_MEAN
+#undef BLUR_ADD
+#undef BLUR_SUB
+}
+
+/* Blurs rows [first, last) of src into dst, streaming one row of
+   column sums down the rows. */
+static void blur_rows(const unsigned char *src, unsigned char *dst,
+                      uint32_t *sums, unsigned int width, unsigned int height,
+                      unsigned int kernel_size,
+                      unsigned int first, unsigned int last)
+{
+  unsigned int row_size = width*SIZE_RGBA;
+  unsigned int y, y0, y1;
+
+  /* Sum the rows of the first square. */
+  y0 = first > kernel_size ? first - kernel_size : 0;
+  y1 = MIN(first + kernel_size + 1, height);
+  memset(sums, 0, row_size*sizeof(uint32_t));
+  for (y=y0; y<y1; ++y)
+    add_row(sums, src + y*row_size, row_size);
+
+  for (y=first; y<last; ++y)
+  {
+    if (y > first)
+    {
+      if (y + kernel_size < height)
+        add_row(sums, src + (y + kernel_size)*row_size, row_size);
+      if (y > kernel_size)
+        subtract_row(sums, src + (y - kernel_size - 1)*row_size, row_size);
+    }
+    y0 = y > kernel_size ? y - kernel_size : 0;
+    y1 = MIN(y + kernel_size + 1, height);
+    blur_row(sums, dst + y*row_size, width, kernel_size, y1-y0);
+  }
+}
+
+/* Blurs rows [first, last) with the column sums of band. */
+static void blur_band(void *arg, unsigned int band,
+                      unsigned int first, unsigned int last)
+{
+  blur_job_t *job = (blur_job_t*)arg;
+  squareblur_instance_t *inst = job->inst;
+
+  blur_rows(job->src, job->dst, inst->sums + band*inst->width*SIZE_RGBA,
+            inst->width, inst->height, job->kernel_size, first, last);
 }
 
 static void blur_get_param_info(f0r_param_info_t* info, int param_index)
@@ -143,25 +227,13 @@ static f0r_instance_t blur_construct(unsigned int width, unsigned int height)
 {
   squareblur_instance_t* inst = 
     (squareblur_instance_t*)malloc(sizeof(squareblur_instance_t));
-  unsigned int i;
-  unsigned int acc_width, acc_height = height+1;
-  uint32_t*  iter_mem;
-  uint32_t** iter_acc;
   /* set params */
   inst->width = width; inst->height = height;
-  acc_width = width+1; acc_height = height+1;
   inst->kernel = 0.0;
-  /* allocate memory for the summed-area-table */
-  inst->mem = (uint32_t*) malloc(acc_width*acc_height*SIZE_RGBA*sizeof(uint32_t));
-  inst->acc = (uint32_t**) malloc(acc_width*acc_height*sizeof(uint32_t*));
-  /* point at the right place */
-  iter_mem = inst->mem;
-  iter_acc = inst->acc;
-  for (i=0; i<acc_width*acc_height; ++i)
-  {
-    *iter_acc++ = iter_mem;
-    iter_mem += SIZE_RGBA;
-  }
+  /* allocate the column sums */
+  inst->bands = MIN(f0r_thread_count(), height);
+  inst->sums = (uint32_t*) malloc(inst->bands*width*SIZE_RGBA*sizeof(uint32_t));
+  inst->taken = (volatile long*) calloc(inst->bands, sizeof(long));
   return (f0r_instance_t)inst;
 }
 
@@ -169,8 +241,8 @@ static void blur_destruct(f0r_instance_t instance)
 {
   squareblur_instance_t* inst = 
     (squareblur_instance_t*)instance;
-  free(inst->acc);
-  free(inst->mem);
+  free(inst->sums);
+  free((void*)inst->taken);
   free(instance);
 }
 
@@ -203,6 +275,12 @@ static void blur_get_param_value(f0r_instance_t instance,
   }
 }
 
+static unsigned int blur_kernel_size(const squareblur_instance_t* inst)
+{
+  unsigned int max = MAX(inst->width, inst->height);
+  return (unsigned int) (inst->kernel * max / 2.0);
+}
+
 static void blur_update(f0r_instance_t instance, double time,
                 const uint32_t* inframe, uint32_t* outframe)
 {
@@ -211,14 +289,8 @@ static void blur_update(f0r_instance_t instance, double time,
   
   unsigned int width = inst->width;
   unsigned int height = inst->height;
-  unsigned int acc_width = width+1; /* width of the summed area table */
-  unsigned int max = MAX(width, height);
-  unsigned int kernel_size = (unsigned int) (inst->kernel * max / 2.0);
+  unsigned int kernel_size = blur_kernel_size(inst);
 
-  unsigned int x, y;
-  unsigned int x0, x1, y0, y1;
-  unsigned int area;
-  
   if (kernel_size <= 0)
   {
     /* No blur, just copy image. */
@@ -226,45 +298,94 @@ static void blur_update(f0r_instance_t instance, double time,
   }
   else
   {
-    assert(inst->acc);
-    unsigned char* dst = (unsigned char*)outframe;
-    uint32_t** acc = inst->acc;
-    uint32_t sum[SIZE_RGBA];
-    unsigned int y0_offset, y1_offset;
-    
-    /* Compute the summed area table. */
-    update_summed_area_table(inst, inframe);
-    
-    /* Loop through the image's pixels. */
-    for (y=0;y<height;y++)
+    blur_job_t job;
+    assert(inst->sums);
+    job.inst = inst;
+    job.kernel_size = kernel_size;
+    job.src = (const unsigned char*)inframe;
+    job.dst = (unsigned char*)outframe;
+    f0r_parallel_bands(0, height, inst->bands, blur_band, &job);
+  }
+}
+
+/* Takes a free row of the column sums for a slice, -1 if all are in use. */
+static inline int blur_take_sums(squareblur_instance_t* inst)
+{
+  unsigned int i;
+  for (i=0; i<inst->bands; ++i)
+  {
+#if defined(__GNUC__)
+    if (__sync_lock_test_and_set(&inst->taken[i], 1) == 0)
+      return i;
+#elif defined(_MSC_VER)
+    if (_InterlockedExchange(&inst->taken[i], 1) == 0)
+      return i;
+#else
+    if (!inst->taken[i])
     {
-      for (x=0;x<width;x++)
-      {
-        /* The kernel's coordinates. */
-        x0 = MAX(x - kernel_size, 0);
-        x1 = MIN(x + kernel_size + 1, width);
-        y0 = MAX(y - kernel_size, 0);
-        y1 = MIN(y + kernel_size + 1, height);
-        
-        /* Get the sum in the current kernel. */
-        area = (x1-x0)*(y1-y0);
-        
-        y0_offset = y0*acc_width;
-        y1_offset = y1*acc_width;
-        
-        /* it is assumed that (x0,y0) <= (x1,y1) */
-        memcpy(sum, acc[y1_offset + x1], SIZE_RGBA*sizeof(uint32_t));
-        subtract_acc(sum, acc[y1_offset + x0]);
-        subtract_acc(sum, acc[y0_offset + x1]);
-        add_acc(sum, acc[y0_offset + x0]);
-        
-        /* Take the mean and copy it to output. */
-        divide(dst, sum, area);
-        
-        /* Increment iterator. */
-        dst += SIZE_RGBA;
-      }
+      inst->taken[i] = 1;
+      return i;
     }
+#endif
   }
+  return -1;
 }
 
+static inline void blur_give_sums(squareblur_instance_t* inst, int i)
+{
+#if defined(__GNUC__)
+  __sync_lock_release(&inst->taken[i]);
+#elif defined(_MSC_VER)
+  _InterlockedExchange(&inst->taken[i], 0);
+#else
+  inst->taken[i] = 0;
+#endif
+}
+
+/*
+ * Blurs only the rows [slice_start, slice_start + slice_height) of
+ * outframe, reading the rows of inframe around them. Slices of one frame
+ * may be blurred concurrently: each call takes its own row of the column
+ * sums of the bands, and only allocates one when the host runs more
+ * slices at once than there are bands.
+ */
+static inline void blur_update_slice(f0r_instance_t instance, double time,
+                                     const uint32_t* inframe,
+                                     uint32_t* outframe,
+                                     unsigned int slice_start,
+                                     unsigned int slice_height)
+{
+  assert(instance);
+  squareblur_instance_t* inst = (squareblur_instance_t*)instance;
+
+  unsigned int width = inst->width;
+  unsigned int kernel_size = blur_kernel_size(inst);
+  uint32_t* sums = NULL;
+  int row = -1;
+
+  if (kernel_size > 0)
+  {
+    row = blur_take_sums(inst);
+    if (row >= 0)
+      sums = inst->sums + row*width*SIZE_RGBA;
+    else
+      sums = (uint32_t*) malloc(width*SIZE_RGBA*sizeof(uint32_t));
+  }
+
+  if (!sums)
+  {
+    /* No blur, or no memory to blur with: copy the slice. */
+    memcpy(outframe + width*slice_start, inframe + width*slice_start,
+           width*slice_height*sizeof(uint32_t));
+    return;
+  }
+
+  blur_rows((const unsigned char*)inframe, (unsigned char*)outframe, sums,
+            width, inst->height, kernel_size,
+            slice_start, slice_start + slice_height);
+
+  if (row >= 0)
+    blur_give_sums(inst, row);
+  else
+    free(sums);
+}
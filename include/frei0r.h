@@ -40,6 +40,22 @@
  *
  * @section sec_changes Changes
  *
+ * @subsection sec_changes_1_2_1_3 From frei0r 1.2 to frei0r 1.3
+ *   - added optional \ref f0r_get_capabilities and \ref CAPABILITIES
+ *   - added optional \ref f0r_update_slice for slice-threaded hosts
+ *   - added RGBA_FLOAT and RGBA64 color models
+ *   - added \ref F0R_CAP_RGBA_FLOAT, \ref F0R_CAP_RGBA64 and optional
+ *     \ref f0r_set_color_model
+ *   - added \ref F0R_CAP_STRIDE and optional \ref f0r_update_stride for
+ *     frames with padded rows
+ *   - added \ref F0R_CAP_IN_PLACE for effects that may write into an
+ *     input frame
+ *   - added \ref F0R_CAP_ROI and optional \ref f0r_update_roi to update
+ *     a region of interest and learn which part of it changed
+ *   - added \ref F0R_CAP_HISTORY, optional \ref f0r_get_history_depth
+ *     and \ref f0r_update_history to hand previous input frames to
+ *     temporal filters
+ *
  * @subsection sec_changes_1_1_1_2 From frei0r 1.1 to frei0r 1.2
  *   - make <vendor> in plugin path optional
  *   - added section on FREI0R_PATH environment variable
@@ -186,18 +202,31 @@
  *
  * - \ref f0r_set_param_value
  * - \ref f0r_get_param_value
+ * - \ref f0r_set_color_model
  * - \ref f0r_update
+ * - \ref f0r_update_stride
+ * - \ref f0r_update_roi
+ * - \ref f0r_get_history_depth
+ * - \ref f0r_update_history
  * - \ref f0r_update2
  *
  * If a thread is in one of these methods its allowed for another thread to
  * enter one of theses methods for a different effect instance. But for one
  * effect instance only one thread is allowed to execute any of these methods. 
+ *
+ *
+ * - \ref f0r_update_slice
+ *
+ * For effects announcing \ref F0R_CAP_SLICE_SAFE, several threads may
+ * call \ref f0r_update_slice concurrently on the same effect instance,
+ * as long as the slices of one frame do not overlap and no other thread
+ * is in any of the methods above for that instance at the same time.
  */
 
 
 
 /** \file
- * \brief This file defines the frei0r api, version 1.2.
+ * \brief This file defines the frei0r api, version 1.3.
  *
  * A conforming plugin must implement and export all functions declared in
  * this header.
@@ -219,7 +248,7 @@
 /**
  * The frei0r API minor version
  */
-#define FREI0R_MINOR_VERSION 2
+#define FREI0R_MINOR_VERSION 3
 
 //---------------------------------------------------------------------------
 
@@ -276,8 +305,9 @@ void f0r_deinit();
  *
  * For each color model, a frame consists of width*height pixels which
  * are stored row-wise and consecutively in memory. The size of a pixel is
- * 4 bytes. There is no extra pitch parameter
- * (i.e. the pitch is simply width*4).
+ * 4 bytes (8 bytes for RGBA64, 16 bytes for RGBA_FLOAT). There is no
+ * extra pitch parameter (i.e. the pitch is simply width times the size
+ * of a pixel).
  *
  * The following additional constraints must be honored:
  *   - The top-most line of a frame is stored first in memory.
@@ -320,6 +350,39 @@ void f0r_deinit();
  * Note that source effects must not use this color model.
  */
 #define F0R_COLOR_MODEL_PACKED32 2
+
+/**
+ * In RGBA_FLOAT, each pixel is represented by 4 consecutive
+ * floats holding the red, green, blue and alpha component of the
+ * pixel, in this order. The values 0.0 and 1.0 correspond to the
+ * byte values 0 and 255 of RGBA8888, with the same (non linear)
+ * transfer. Color values outside of [0, 1] may occur and should be
+ * passed on unclamped by effects that can handle them.
+ *
+ * The frame pointers of the update functions keep their uint32_t*
+ * type and must be cast to float* by both sides; a frame takes
+ * width*height*16 bytes.
+ *
+ * An effect that works on floats internally should keep RGBA8888 in
+ * \ref f0r_plugin_info_t and announce \ref F0R_CAP_RGBA_FLOAT (see
+ * \ref CAPABILITIES). Applications that keep their frames in floats can
+ * then switch the instance with \ref f0r_set_color_model and save two
+ * conversions per update.
+ */
+#define F0R_COLOR_MODEL_RGBA_FLOAT 3
+
+/**
+ * In RGBA64, each pixel is represented by 4 consecutive
+ * unsigned 16 bit values in native byte order, holding the red, green,
+ * blue and alpha component of the pixel, in this order. The value 65535
+ * corresponds to the byte value 255 of RGBA8888, a byte value v is
+ * v*257.
+ *
+ * Like \ref F0R_COLOR_MODEL_RGBA_FLOAT, this model is chosen by the
+ * application with \ref f0r_set_color_model for effects announcing
+ * \ref F0R_CAP_RGBA64; a frame takes width*height*8 bytes.
+ */
+#define F0R_COLOR_MODEL_RGBA64 4
 /*@}*/
 
 /**
@@ -554,7 +617,8 @@ void f0r_get_param_value(f0r_instance_t instance,
  * This is where the core effect processing happens. The application calls it
  * after it has set the necessary parameter values.
  * inframe and outframe must be aligned to an integer multiple of 16 bytes
- * in memory.
+ * in memory. They must be different frames unless the effect announces
+ * \ref F0R_CAP_IN_PLACE.
  *
  * This funcition should not alter the parameters of the effect in any
  * way (\ref f0r_get_param_value should return the same values after a call
@@ -609,4 +673,264 @@ void f0r_update2(f0r_instance_t instance,
 		 uint32_t* outframe);
 //---------------------------------------------------------------------------
 
+/** \addtogroup CAPABILITIES Plugin Capabilities
+ * Flags returned by \ref f0r_get_capabilities. They announce optional
+ * behaviour of an effect that a host may take advantage of.
+ *
+ * Capabilities are not stored in \ref f0r_plugin_info_t because that
+ * structure is allocated by the application: a plugin writing a new field
+ * would overrun the structure of an application built against an older
+ * header. For the same reason the fields keep their 1.2 meaning, e.g.
+ * an effect offering other color models still reports RGBA8888, and
+ * applications that do not know a capability see no change.
+ *  @{
+ */
+
+/**
+ * The effect can be updated slice by slice through
+ * \ref f0r_update_slice, and the slices of one frame may be processed
+ * concurrently (see \ref concurrency).
+ */
+#define F0R_CAP_SLICE_SAFE (1 << 0)
+
+/**
+ * Instances of the effect can be switched to
+ * \ref F0R_COLOR_MODEL_RGBA_FLOAT through \ref f0r_set_color_model.
+ */
+#define F0R_CAP_RGBA_FLOAT (1 << 1)
+
+/**
+ * Instances of the effect can be switched to
+ * \ref F0R_COLOR_MODEL_RGBA64 through \ref f0r_set_color_model.
+ */
+#define F0R_CAP_RGBA64 (1 << 2)
+
+/**
+ * The effect reads and writes frames with padded rows through
+ * \ref f0r_update_stride.
+ */
+#define F0R_CAP_STRIDE (1 << 3)
+
+/**
+ * outframe may be the same frame as inframe (\ref f0r_update) or as
+ * any of the input frames (\ref f0r_update2, \ref f0r_update_slice and
+ * \ref f0r_update_stride, with the same stride). This lets a host run a
+ * chain of such effects on a single frame buffer.
+ */
+#define F0R_CAP_IN_PLACE (1 << 4)
+
+/**
+ * The effect can update a region of interest and report the part of it
+ * it changed, through \ref f0r_update_roi.
+ */
+#define F0R_CAP_ROI (1 << 5)
+
+/**
+ * The filter reads previous input frames, and the application can hand
+ * them over through \ref f0r_update_history instead of the effect
+ * keeping copies of its own.
+ */
+#define F0R_CAP_HISTORY (1 << 6)
+
+/** @} */
+
+/**
+ * Returns the capabilities of the effect as a combination of the
+ * \ref CAPABILITIES flags.
+ *
+ * This method is optional. Applications must assume a value of 0 for
+ * effects that do not export it.
+ *
+ * \returns the capabilities of the effect
+ */
+int f0r_get_capabilities();
+
+/**
+ * Updates only the rows [slice_start, slice_start + slice_height) of
+ * outframe. This allows the application to split a frame into horizontal
+ * bands and to hand them to different threads.
+ *
+ * This method is optional and must only be used with effects announcing
+ * \ref F0R_CAP_SLICE_SAFE. The frame pointers always point to the first
+ * row of the complete frames, so effects may read input rows outside of
+ * the slice. Only the rows inside the slice of outframe are written.
+ *
+ * Calling \ref f0r_update_slice for all slices of a frame, with the same
+ * time and parameters, must give the same result as a single call to
+ * \ref f0r_update2.
+ *
+ * \param instance the effect instance
+ * \param time the application time in seconds (see \ref f0r_update)
+ * \param inframe1 the first incoming video frame (can be zero for sources)
+ * \param inframe2 the second incoming video frame
+ *        (can be zero for sources and filters)
+ * \param inframe3 the third incoming video frame
+ *        (can be zero for sources, filters and mixer2)
+ * \param outframe the resulting video frame
+ * \param slice_start the first row of the slice
+ * \param slice_height the number of rows of the slice
+ *
+ * \see f0r_update2
+ */
+void f0r_update_slice(f0r_instance_t instance,
+		      double time,
+		      const uint32_t* inframe1,
+		      const uint32_t* inframe2,
+		      const uint32_t* inframe3,
+		      uint32_t* outframe,
+		      unsigned int slice_start,
+		      unsigned int slice_height);
+
+/**
+ * Switches an effect instance to a color model other than the one in
+ * \ref f0r_plugin_info_t. After a successful call, the frames of all
+ * update methods of this instance are in that color model.
+ *
+ * This method is optional and must only be used with effects announcing
+ * the capability of the requested color model, i.e.
+ * \ref F0R_CAP_RGBA_FLOAT or \ref F0R_CAP_RGBA64. It must be called before the first update
+ * of the instance.
+ *
+ * \param instance the effect instance
+ * \param color_model the color model (see \ref COLOR_MODEL)
+ *
+ * \returns 1 if the instance now uses color_model, 0 if it keeps
+ *          its color model
+ */
+int f0r_set_color_model(f0r_instance_t instance, int color_model);
+
+/**
+ * Like \ref f0r_update2, for frames whose rows are not packed: row y of
+ * a frame starts y*stride bytes after its first row. This lets the
+ * application pass its own buffers (e.g. with rows aligned to 64 bytes,
+ * or a rectangle cropped out of a larger picture, by pointing to its top
+ * left pixel) instead of copying them into packed frames.
+ *
+ * This method is optional and must only be used with effects announcing
+ * \ref F0R_CAP_STRIDE. Each stride is at least width times the size of
+ * a pixel and a multiple of 16. Effects must not write to the padding
+ * of outframe, which may belong to the picture around a cropped
+ * rectangle. The frame constraints of \ref COLOR_MODEL apply otherwise.
+ *
+ * \param instance the effect instance
+ * \param time the application time in seconds (see \ref f0r_update)
+ * \param inframe1 the first incoming video frame (can be zero for sources)
+ * \param stride1 the row stride of inframe1 in bytes
+ * \param inframe2 the second incoming video frame
+ *        (can be zero for sources and filters)
+ * \param stride2 the row stride of inframe2 in bytes
+ * \param inframe3 the third incoming video frame
+ *        (can be zero for sources, filters and mixer2)
+ * \param stride3 the row stride of inframe3 in bytes
+ * \param outframe the resulting video frame
+ * \param out_stride the row stride of outframe in bytes
+ *
+ * \see f0r_update2
+ */
+void f0r_update_stride(f0r_instance_t instance,
+		       double time,
+		       const uint32_t* inframe1, unsigned int stride1,
+		       const uint32_t* inframe2, unsigned int stride2,
+		       const uint32_t* inframe3, unsigned int stride3,
+		       uint32_t* outframe, unsigned int out_stride);
+
+/**
+ * A rectangle of pixels of a frame. It is empty if width or height is 0.
+ */
+typedef struct f0r_rect
+{
+  unsigned int x; /**< first column */
+  unsigned int y; /**< first row */
+  unsigned int width; /**< number of columns */
+  unsigned int height; /**< number of rows */
+} f0r_rect_t;
+
+/**
+ * Like \ref f0r_update2, for an application which only needs the
+ * pixels of outframe within roi, e.g. because graphics are composited
+ * over most of the frame or because only a part of it is on screen.
+ *
+ * The effect stores in *modified a rectangle within roi and writes only
+ * to the pixels of outframe within it. The result of the other pixels of
+ * roi is the pixel of inframe1 unchanged: the application takes them
+ * from there, or runs the effect in place (see \ref F0R_CAP_IN_PLACE).
+ * An empty *modified means the effect does not change roi at all.
+ * Pixels outside roi are neither written nor needed, so mostly static
+ * graphics only cost the area they cover.
+ *
+ * This method is optional and must only be used with effects announcing
+ * \ref F0R_CAP_ROI. roi lies within the frame.
+ *
+ * \param instance the effect instance
+ * \param time the application time in seconds (see \ref f0r_update)
+ * \param inframe1 the first incoming video frame
+ * \param inframe2 the second incoming video frame
+ *        (can be zero for filters)
+ * \param inframe3 the third incoming video frame
+ *        (can be zero for filters and mixer2)
+ * \param outframe the resulting video frame
+ * \param roi the pixels of outframe the application needs
+ * \param modified receives the pixels of outframe the effect wrote
+ *
+ * \see f0r_update2
+ */
+void f0r_update_roi(f0r_instance_t instance,
+		    double time,
+		    const uint32_t* inframe1,
+		    const uint32_t* inframe2,
+		    const uint32_t* inframe3,
+		    uint32_t* outframe,
+		    const f0r_rect_t* roi, f0r_rect_t* modified);
+
+/**
+ * Returns the number of previous input frames the next update of a
+ * filter reads, which may change with its parameters.
+ *
+ * This method is optional and must only be used with effects announcing
+ * \ref F0R_CAP_HISTORY.
+ *
+ * \param instance the effect instance
+ *
+ * \returns the number of frames \ref f0r_update_history wants
+ */
+unsigned int f0r_get_history_depth(f0r_instance_t instance);
+
+/**
+ * Like \ref f0r_update for a filter, with the input frames of the
+ * previous updates, most recent first. An application which keeps
+ * these frames anyway (e.g. because other effects or the encoder hold
+ * references to them) passes them here, so that temporal filters read
+ * them where they are rather than copying every frame into buffers of
+ * their own. Several instances on the same input then share a single
+ * history.
+ *
+ * This method is optional and must only be used with effects announcing
+ * \ref F0R_CAP_HISTORY. history_count is at most the value of
+ * \ref f0r_get_history_depth; it is smaller at the start of a stream,
+ * and the effect treats the missing frames like it would before its
+ * first frames. The history frames have the size and color model of
+ * inframe and stay unchanged during the call; the effect does not keep
+ * pointers to them. An application uses either this method or the other
+ * update methods for all frames of an instance.
+ *
+ * \param instance the effect instance
+ * \param time the application time in seconds (see \ref f0r_update)
+ * \param inframe the incoming video frame
+ * \param history the previous input frames, history[0] the one of the
+ *        last update
+ * \param history_time the times of the history frames
+ * \param history_count the number of history frames
+ * \param outframe the resulting video frame
+ *
+ * \see f0r_update
+ */
+void f0r_update_history(f0r_instance_t instance,
+			double time,
+			const uint32_t* inframe,
+			const uint32_t* const* history,
+			const double* history_time,
+			unsigned int history_count,
+			uint32_t* outframe);
+//---------------------------------------------------------------------------
+
 #endif
@@ -7,6 +7,11 @@ extern "C"
 #include <vector>
 #include <string>
 #include <iostream>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include "frei0r_thread.h"
 
 
 namespace frei0r
@@ -20,6 +25,7 @@ namespace frei0r
   static std::pair<int,int> s_version;
   static unsigned int s_effect_type;
   static unsigned int s_color_model;
+  static int s_capabilities;
 
   static  fx* (*s_build) (unsigned int, unsigned int);
 
@@ -35,7 +41,144 @@ namespace frei0r
   
   static std::vector<param_info> s_params;
 
-  
+
+  // Calls (*f)(first, last) for a band of parallel_rows().
+  template<class F>
+  void parallel_rows_band(void* f, unsigned int band,
+			  unsigned int first, unsigned int last)
+  {
+    (*static_cast<F*>(f))(first, last);
+  }
+
+
+  // Pixel types, for effects written once against the channels of a
+  // pixel and compiled for several color models (see bit_depths below).
+  // channel holds one of the four channels, wide the product of two.
+  struct rgba8
+  {
+    typedef uint8_t channel;
+    typedef uint32_t wide;
+    enum { bits = 8, max = 255, half = 128 };
+
+    // a * b / max, rounded like INT_MULT of frei0r_math.h
+    static wide mul(wide a, wide b)
+    {
+      wide t = a * b + 0x80;
+      return ((t >> 8) + t) >> 8;
+    }
+  };
+
+  struct rgba64
+  {
+    typedef uint16_t channel;
+    typedef uint64_t wide;
+    enum { bits = 16, max = 65535, half = 32768 };
+
+    static wide mul(wide a, wide b)
+    {
+      wide t = a * b + 0x8000;
+      return ((t >> 16) + t) >> 16;
+    }
+  };
+
+
+  // The previous input frames of a filter announcing F0R_CAP_HISTORY,
+  // most recent first. If the application hands them over through
+  // f0r_update_history they are read where they are, otherwise every
+  // input frame is copied into a ring of depth + 1 frames (the current
+  // one included, so in place updates do not overwrite it). Copied
+  // frames are packed, whatever the stride of the input frame. Frames
+  // from before the start of the stream are missing.
+  class frame_history
+  {
+  public:
+    frame_history() : m_depth(0), m_slots(0), m_words(0), m_next(0),
+		      m_filled(0), m_frames(0), m_times(0), m_count(0) {}
+
+    unsigned int count() const
+    {
+      return m_frames ? m_count : (m_filled ? m_filled - 1 : 0);
+    }
+
+    // The input frame of i + 1 updates ago, 0 if it is missing.
+    const uint32_t* operator[](unsigned int i) const
+    {
+      if (i >= count())
+	return 0;
+      if (m_frames)
+	return m_frames[i];
+      return &m_ring[slot(i) * m_words];
+    }
+
+    double time(unsigned int i) const
+    {
+      return m_frames ? m_times[i] : m_ring_times[slot(i)];
+    }
+
+    // Copies the current input frame, rows of row_bytes every stride
+    // bytes, into the ring, resized to depth frames of that many rows.
+    void push(const uint32_t* frame, unsigned int stride, double time,
+	      unsigned int depth, unsigned int row_bytes, unsigned int rows)
+    {
+      const unsigned int words = row_bytes / 4 * rows;
+      if (depth != m_depth || words != m_words)
+	{
+	  m_depth = depth;
+	  m_slots = depth ? depth + 1 : 0;
+	  m_words = words;
+	  m_ring.assign((size_t)m_slots * words, 0);
+	  m_ring_times.assign(m_slots, 0.0);
+	  m_next = m_filled = 0;
+	}
+      if (!m_slots)
+	return;
+      uint32_t* dst = &m_ring[(size_t)m_next * words];
+      const char* src = reinterpret_cast<const char*>(frame);
+      if (stride == row_bytes)
+	std::memcpy(dst, src, (size_t)words * 4);
+      else
+	for (unsigned int y = 0; y < rows; ++y)
+	  std::memcpy(dst + (size_t)y * (row_bytes / 4),
+		      src + (size_t)y * stride, row_bytes);
+      m_ring_times[m_next] = time;
+      m_next = (m_next + 1) % m_slots;
+      if (m_filled < m_slots)
+	++m_filled;
+    }
+
+    // Uses the frames of the application for one update. The ring is
+    // emptied, so that it restarts if the application stops doing so.
+    void attach(const uint32_t* const* frames, const double* times,
+		unsigned int count)
+    {
+      m_frames = frames;
+      m_times = times;
+      m_count = count;
+      m_next = m_filled = 0;
+    }
+
+    void detach()
+    {
+      m_frames = 0;
+    }
+
+    bool attached() const { return m_frames != 0; }
+
+  private:
+    size_t slot(unsigned int i) const
+    {
+      return (m_next + 2 * m_slots - 2 - i) % m_slots;
+    }
+
+    std::vector<uint32_t> m_ring;
+    std::vector<double> m_ring_times;
+    unsigned int m_depth, m_slots, m_words, m_next, m_filled;
+    const uint32_t* const* m_frames; // of the application, or 0
+    const double* m_times;
+    unsigned int m_count;
+  };
+
+
   class fx
   {
   public:
@@ -45,6 +188,12 @@ namespace frei0r
     unsigned int height;
     unsigned int size; // = width * height
     uint32_t* out;
+    unsigned int color_model; // of the frames, see f0r_set_color_model
+    // Bytes from one row to the next in the frames of the current
+    // update, width * pixel_size() unless the effect announces
+    // F0R_CAP_STRIDE and the host called f0r_update_stride.
+    unsigned int in_stride[3];
+    unsigned int out_stride;
     std::vector<void*> param_ptrs;
 
     fx()
@@ -53,6 +202,13 @@ namespace frei0r
     }
     
     virtual unsigned int effect_type()=0;
+
+    // The CAPABILITIES flags of the effect.
+    virtual int capabilities() { return 0; }
+
+    // The number of previous input frames the effect reads, see
+    // frame_history.
+    virtual unsigned int history_depth() { return 0; }
     
     void register_param(f0r_param_color& p_loc,
 			const std::string& name,
@@ -162,7 +318,114 @@ namespace frei0r
 			  uint32_t* outframe) = 0;
     
     virtual void update() = 0;
+
+    // Updates with the previous input frames of the application (see
+    // f0r_update_history). Only filters read them.
+    virtual void update_history(double time, const uint32_t* inframe,
+				const uint32_t* const* history,
+				const double* history_time,
+				unsigned int history_count,
+				uint32_t* outframe)
+    {
+      update_l(time, inframe, 0, 0, outframe);
+    }
+
+    // Splits the rows [begin, end) into bands and calls fn(first, last)
+    // for each of them on the threads of the pool of frei0r_thread.h,
+    // which the C plugins share. There are four bands per thread, so
+    // threads finishing early pick up the bands of slower ones. fn must
+    // only write to the rows it is given.
+    template<class F>
+    void parallel_rows(unsigned int begin, unsigned int end, F fn)
+    {
+      f0r_parallel_bands(begin, end, 4 * f0r_thread_count(),
+			 parallel_rows_band<F>, &fn);
+    }
     
+    unsigned int pixel_size() const
+    {
+      return color_model == F0R_COLOR_MODEL_RGBA_FLOAT ? 16
+	: color_model == F0R_COLOR_MODEL_RGBA64 ? 8 : 4;
+    }
+
+    void set_packed_strides()
+    {
+      in_stride[0] = in_stride[1] = in_stride[2] = out_stride
+	= width * pixel_size();
+    }
+
+    // Row y of a frame with the given stride.
+    static uint32_t* row(uint32_t* frame, unsigned int stride, unsigned int y)
+    {
+      return reinterpret_cast<uint32_t*>
+	(reinterpret_cast<char*>(frame) + (size_t)y * stride);
+    }
+
+    static const uint32_t* row(const uint32_t* frame, unsigned int stride,
+			       unsigned int y)
+    {
+      return reinterpret_cast<const uint32_t*>
+	(reinterpret_cast<const char*>(frame) + (size_t)y * stride);
+    }
+
+    // The same, as channels of the pixel type P.
+    template<class P>
+    static typename P::channel* row(uint32_t* frame, unsigned int stride,
+				    unsigned int y)
+    {
+      return reinterpret_cast<typename P::channel*>(row(frame, stride, y));
+    }
+
+    template<class P>
+    static const typename P::channel* row(const uint32_t* frame,
+					  unsigned int stride, unsigned int y)
+    {
+      return reinterpret_cast<const typename P::channel*>
+	(row(frame, stride, y));
+    }
+
+    // Updates with frames of the given strides (see f0r_update_stride).
+    // Effects announcing F0R_CAP_STRIDE get them as they are, the frames
+    // of the others are packed into scratch frames and back.
+    void update_l(double time,
+		  const uint32_t* inframe1, unsigned int stride1,
+		  const uint32_t* inframe2, unsigned int stride2,
+		  const uint32_t* inframe3, unsigned int stride3,
+		  uint32_t* outframe, unsigned int stride_out)
+    {
+      const uint32_t* in[3] = { inframe1, inframe2, inframe3 };
+      const unsigned int stride[3] = { stride1, stride2, stride3 };
+
+      if (capabilities() & F0R_CAP_STRIDE)
+	{
+	  for (int i = 0; i < 3; ++i)
+	    in_stride[i] = stride[i];
+	  out_stride = stride_out;
+	  update_l(time, in[0], in[1], in[2], outframe);
+	  return;
+	}
+
+      set_packed_strides();
+      for (int i = 0; i < 4; ++i)
+	m_packed[i].resize(size * pixel_size() / 4);
+      for (int i = 0; i < 3; ++i)
+	if (in[i])
+	  {
+	    for (unsigned int y = 0; y < height; ++y)
+	      std::memcpy(row(&m_packed[i][0], out_stride, y),
+			  row(in[i], stride[i], y), out_stride);
+	    in[i] = &m_packed[i][0];
+	  }
+      update_l(time, in[0], in[1], in[2], &m_packed[3][0]);
+      for (unsigned int y = 0; y < height; ++y)
+	std::memcpy(row(outframe, stride_out, y),
+		    row(&m_packed[3][0], out_stride, y), out_stride);
+    }
+    
+  private:
+    std::vector<uint32_t> m_packed[4]; // scratch frames of update_l
+
+  public:
     virtual ~fx()
     {
       for (int i = 0; i < s_params.size(); i++) {
@@ -196,6 +459,7 @@ namespace frei0r
   {
   protected:
     const uint32_t* in;
+    frame_history history; // the previous frames of in
     filter() {}
     
   public:
@@ -210,8 +474,22 @@ namespace frei0r
       time = time_;
       out = outframe;
       in = inframe1;
+      if (!history.attached())
+	history.push(in, in_stride[0], time, history_depth(),
+		     width * pixel_size(), height);
       update();
     }
+
+    virtual void update_history(double time_, const uint32_t* inframe,
+				const uint32_t* const* frames,
+				const double* frame_time,
+				unsigned int count,
+				uint32_t* outframe)
+    {
+      history.attach(frames, frame_time, std::min(count, history_depth()));
+      update_l(time_, inframe, 0, 0, outframe);
+      history.detach();
+    }
       
   };
 
@@ -222,6 +500,44 @@ namespace frei0r
     const uint32_t* in2;
     
     mixer2() {}
+
+    // Combines the colour channels of the rows [first, last) of in1 and
+    // in2 with op(a, b) into out and sets the alpha of out to the smaller
+    // alpha of the two, like the layer modes of frei0r_simd.h.
+    template<class P, class Op>
+    void blend_rows(unsigned int first, unsigned int last, Op op)
+    {
+      for (unsigned int y = first; y < last; ++y)
+	{
+	  const typename P::channel* a = row<P>(in1, in_stride[0], y);
+	  const typename P::channel* b = row<P>(in2, in_stride[1], y);
+	  typename P::channel* d = row<P>(out, out_stride, y);
+	  for (unsigned int n = width; n; --n, a += 4, b += 4, d += 4)
+	    {
+	      d[0] = op(a[0], b[0]);
+	      d[1] = op(a[1], b[1]);
+	      d[2] = op(a[2], b[2]);
+	      d[3] = std::min(a[3], b[3]);
+	    }
+	}
+    }
+
+    // The same with a RGBA8888 kernel f0r_rgba8_<mode> of frei0r_simd.h,
+    // in a single call while the rows are packed.
+    void blend_rows(unsigned int first, unsigned int last,
+		    void (*kernel)(const uint32_t*, const uint32_t*,
+				   uint32_t*, unsigned int))
+    {
+      unsigned int packed = width * 4;
+      if (in_stride[0] == packed && in_stride[1] == packed
+	  && out_stride == packed)
+	kernel(in1 + first * width, in2 + first * width,
+	       out + first * width, (last - first) * width);
+      else
+	for (unsigned int y = first; y < last; ++y)
+	  kernel(row(in1, in_stride[0], y), row(in2, in_stride[1], y),
+		 row(out, out_stride, y), width);
+    }
       
   public:
     virtual unsigned int effect_type(){ return F0R_PLUGIN_TYPE_MIXER2; }
@@ -269,6 +585,35 @@ namespace frei0r
       
   };
 
+
+  // Base of effects written once against a pixel type:
+  //
+  //   class screen : public frei0r::bit_depths<frei0r::mixer2, screen>
+  //
+  // Derived implements a public template<class P> void update_px(),
+  // which is called with rgba8 or rgba64 depending on the color model
+  // of the instance. The effect keeps RGBA8888 in its plugin info and
+  // announces F0R_CAP_RGBA64, so hosts with 16 bit frames can switch it
+  // with f0r_set_color_model.
+  template<class Base, class Derived>
+  class bit_depths : public Base
+  {
+  public:
+    virtual int capabilities()
+    {
+      return Base::capabilities() | F0R_CAP_RGBA64;
+    }
+
+    virtual void update()
+    {
+      Derived* d = static_cast<Derived*>(this);
+      if (this->color_model == F0R_COLOR_MODEL_RGBA64)
+	d->template update_px<rgba64>();
+      else
+	d->template update_px<rgba8>();
+    }
+  };
+
   
   // register stuff
   template<class T>
@@ -292,6 +637,7 @@ namespace frei0r
       
       s_effect_type=a.effect_type();
       s_color_model=color_model;
+      s_capabilities=a.capabilities();
     }
 
   private:
@@ -340,6 +686,8 @@ f0r_instance_t f0r_construct(unsigned int width, unsigned int height)
   nfx->width=width;
   nfx->height=height;
   nfx->size=width*height;
+  nfx->color_model=frei0r::s_color_model;
+  nfx->set_packed_strides();
   return nfx;
 }
 
@@ -360,17 +708,64 @@ void f0r_get_param_value(f0r_instance_t instance,
   static_cast<frei0r::fx*>(instance)->get_param_value(param, param_index);
 }
 
+int f0r_get_capabilities()
+{
+  return frei0r::s_capabilities;
+}
+
+int f0r_set_color_model(f0r_instance_t instance, int color_model)
+{
+  int cap = color_model == F0R_COLOR_MODEL_RGBA64 ? F0R_CAP_RGBA64
+    : color_model == F0R_COLOR_MODEL_RGBA_FLOAT ? F0R_CAP_RGBA_FLOAT : 0;
+  if (color_model != (int)frei0r::s_color_model
+      && !(cap & frei0r::s_capabilities))
+    return 0;
+  frei0r::fx* fx = static_cast<frei0r::fx*>(instance);
+  fx->color_model = color_model;
+  fx->set_packed_strides();
+  return 1;
+}
+
 void f0r_update2(f0r_instance_t instance, double time,
 		 const uint32_t* inframe1,
 		 const uint32_t* inframe2,
 		 const uint32_t* inframe3,
 		 uint32_t* outframe)
+{
+  frei0r::fx* fx = static_cast<frei0r::fx*>(instance);
+  fx->set_packed_strides();
+  fx->update_l(time, inframe1, inframe2, inframe3, outframe);
+}
+
+void f0r_update_stride(f0r_instance_t instance, double time,
+		       const uint32_t* inframe1, unsigned int stride1,
+		       const uint32_t* inframe2, unsigned int stride2,
+		       const uint32_t* inframe3, unsigned int stride3,
+		       uint32_t* outframe, unsigned int out_stride)
 {
   static_cast<frei0r::fx*>(instance)->update_l(time,
-					       inframe1,
-					       inframe2,
-					       inframe3,
-					       outframe);
+					       inframe1, stride1,
+					       inframe2, stride2,
+					       inframe3, stride3,
+					       outframe, out_stride);
+}
+
+unsigned int f0r_get_history_depth(f0r_instance_t instance)
+{
+  return static_cast<frei0r::fx*>(instance)->history_depth();
+}
+
+void f0r_update_history(f0r_instance_t instance, double time,
+			const uint32_t* inframe,
+			const uint32_t* const* history,
+			const double* history_time,
+			unsigned int history_count,
+			uint32_t* outframe)
+{
+  frei0r::fx* fx = static_cast<frei0r::fx*>(instance);
+  fx->set_packed_strides();
+  fx->update_history(time, inframe, history, history_time, history_count,
+		     outframe);
 }
 
 // compability for frei0r 1.0 
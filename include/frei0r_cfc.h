@@ -25,8 +25,16 @@
 //	of a float value used as table index)
 //	see  http://mysite.verizon.net/spitzak/conversion/
 
+#ifndef INCLUDED_FREI0R_CFC_H
+#define INCLUDED_FREI0R_CFC_H
+
 #include <math.h>
 #include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "frei0r_simd.h"
+#include "frei0r_thread.h"
 
 
 typedef struct
@@ -203,6 +211,157 @@ for (i=0;i<=255;i++)
 	}
 }
 
+//--------------------------------------------------------
+//	the frame conversions below split the frame into
+//	bands converted on threads of their own (see
+//	frei0r_thread.h), the linear ones (*_lin) compute
+//	in double precision with SSE2 where available, so
+//	they give the same result as the plain C expressions
+//	out=(float)(s*in+o) and out=(uint8_t)(s*in)
+
+typedef struct
+	{
+	const uint32_t *in8;
+	uint32_t *out8;
+	const float_rgba *inf;
+	float_rgba *outf;
+	const float *tab, *atab;	//uchar to float tables, 0 = linear
+	const uint8_t *ftab, *fatab;	//float to uchar tables, 0 = linear
+	double s,o;			//linear scale and offset
+	int alpha;			//convert the alpha channel too
+	} cfc_job;
+
+//in the table conversions, we can afford "direct" type punning
+//as the array already exists from well before (I hope :-)
+//
+//#if FREI0R_BYTE_ORDER == FREI0R_BIG_ENDIAN
+//big endian most significant 16 bit word from 32bit float
+//#define MSWF(x) *(uint16_t*)x
+//#endif
+//
+//#if FREI0R_BYTE_ORDER == FREI0R_LITTLE_ENDIAN
+//little endian most significant 16 bit word from 32bit float
+#define MSWF(x) *((uint16_t*)x+1)
+//#endif
+
+//--------------------------------------------------------
+//uchar to float, pixels first...last-1
+static inline void cfc_u2f_band(void *arg, unsigned int band, unsigned int first, unsigned int last)
+{
+cfc_job *j=(cfc_job*)arg;
+const uint8_t *cin=(const uint8_t *)(j->in8+first);
+float_rgba *out=j->outf;
+unsigned int i=first;
+
+if (j->tab!=0)
+	{
+	for (;i<last;i++)
+		{
+		out[i].r=j->tab[*cin++];
+		out[i].g=j->tab[*cin++];
+		out[i].b=j->tab[*cin++];
+		if (j->alpha) out[i].a=j->atab[*cin];
+		cin++;
+		}
+	return;
+	}
+
+#if defined(F0R_HAVE_SSE2)
+	{
+	const __m128i z=_mm_setzero_si128();
+	const __m128d s=_mm_set1_pd(j->s);
+	const __m128d o=_mm_set1_pd(j->o);
+	const __m128 amask=_mm_castsi128_ps(_mm_set_epi32(j->alpha ? -1 : 0,-1,-1,-1));
+	for (;i<last;i++,cin+=4)
+		{
+		int32_t p;
+		__m128i x;
+		__m128d lo,hi;
+		__m128 v;
+		memcpy(&p,cin,4);
+		x=_mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(p),z),z);
+		lo=_mm_add_pd(_mm_mul_pd(_mm_cvtepi32_pd(x),s),o);
+		hi=_mm_add_pd(_mm_mul_pd(_mm_cvtepi32_pd(_mm_srli_si128(x,8)),s),o);
+		v=_mm_movelh_ps(_mm_cvtpd_ps(lo),_mm_cvtpd_ps(hi));
+		if (!j->alpha)	//keep the old alpha
+			v=_mm_or_ps(_mm_and_ps(amask,v),_mm_andnot_ps(amask,_mm_loadu_ps(&out[i].r)));
+		_mm_storeu_ps(&out[i].r,v);
+		}
+	}
+#endif
+for (;i<last;i++)
+	{
+	out[i].r=(float)(j->s*cin[0]+j->o);
+	out[i].g=(float)(j->s*cin[1]+j->o);
+	out[i].b=(float)(j->s*cin[2]+j->o);
+	if (j->alpha) out[i].a=(float)(j->s*cin[3]+j->o);
+	cin+=4;
+	}
+}
+
+//--------------------------------------------------------
+//float to uchar, pixels first...last-1
+static inline void cfc_f2u_band(void *arg, unsigned int band, unsigned int first, unsigned int last)
+{
+cfc_job *j=(cfc_job*)arg;
+const float_rgba *in=j->inf;
+uint8_t *cout=(uint8_t *)(j->out8+first);
+unsigned int i=first;
+
+if (j->ftab!=0)
+	{
+	for (;i<last;i++)
+		{
+		*cout++ = j->ftab[MSWF(&in[i].r)];
+		*cout++ = j->ftab[MSWF(&in[i].g)];
+		*cout++ = j->ftab[MSWF(&in[i].b)];
+		if (j->alpha) *cout = j->fatab[MSWF(&in[i].a)];
+		cout++;
+		}
+	return;
+	}
+
+#if defined(F0R_HAVE_SSE2)
+	{
+	const __m128d s=_mm_set1_pd(j->s);
+	const __m128i ff=_mm_set1_epi32(0xFF);
+	for (;i<last;i++,cout+=4)
+		{
+		__m128 v=_mm_loadu_ps(&in[i].r);
+		__m128i x;
+		int32_t p;
+		x=_mm_unpacklo_epi64(_mm_cvttpd_epi32(_mm_mul_pd(_mm_cvtps_pd(v),s)),
+			_mm_cvttpd_epi32(_mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(v,v)),s)));
+		x=_mm_and_si128(x,ff);
+		x=_mm_packus_epi16(_mm_packs_epi32(x,x),x);
+		p=_mm_cvtsi128_si32(x);
+		if (j->alpha)
+			memcpy(cout,&p,4);
+		else
+			memcpy(cout,&p,3);
+		}
+	}
+#endif
+for (;i<last;i++)
+	{
+	float_rgba v=in[i];
+	*cout++ = (uint8_t)(int32_t)(j->s*v.r);
+	*cout++ = (uint8_t)(int32_t)(j->s*v.g);
+	*cout++ = (uint8_t)(int32_t)(j->s*v.b);
+	if (j->alpha) *cout = (uint8_t)(int32_t)(j->s*v.a);
+	cout++;
+	}
+}
+
+#undef MSWF
+
+//--------------------------------------------------------
+//run a conversion over w*h pixels on all threads
+static inline void cfc_run(cfc_job *j, f0r_band_fn fn, int w, int h)
+{
+f0r_parallel_bands(0, (unsigned int)(w*h), f0r_thread_count(), fn, j);
+}
+
 //--------------------------------------------------------
 //convert from paked uchar RGBA to packed float RGBA
 //w,h are width and height of the image
@@ -210,16 +369,10 @@ for (i=0;i<=255;i++)
 //atab = table used for alpha converion (usually linear)
 static inline void RGBA8_2_float(const uint32_t *in, float_rgba *out, int w, int h, float *tab, float *atab)
 {
-int i;
-uint8_t *cin=(uint8_t *)in;
+cfc_job j={0};
 
-for (i=0;i<w*h;i++)
-	{
-	out[i].r=tab[*cin++];
-	out[i].g=tab[*cin++];
-	out[i].b=tab[*cin++];
-	out[i].a=atab[*cin++];
-	}
+j.in8=in; j.outf=out; j.tab=tab; j.atab=atab; j.alpha=1;
+cfc_run(&j, cfc_u2f_band, w, h);
 }
 
 //--------------------------------------------------------
@@ -229,49 +382,22 @@ for (i=0;i<w*h;i++)
 //tab = table used for RGB conversion
 static inline void RGB8_2_float(const uint32_t *in, float_rgba *out, int w, int h, float *tab)
 {
-int i;
-uint8_t *cin=(uint8_t *)in;
+cfc_job j={0};
 
-for (i=0;i<w*h;i++)
-	{
-	out[i].r=tab[*cin++];
-	out[i].g=tab[*cin++];
-	out[i].b=tab[*cin++];
-	cin++;
-	}
+j.in8=in; j.outf=out; j.tab=tab;
+cfc_run(&j, cfc_u2f_band, w, h);
 }
 
-
-//--------------------------------------------------------
-//in the following conversions, we can afford "direct" type punning
-//as the array already exists from well before (I hope :-)
-//
-//#if FREI0R_BYTE_ORDER == FREI0R_BIG_ENDIAN
-//big endian most significant 16 bit word from 32bit float
-//#define MSWF(x) *(uint16_t*)x
-//#endif
-//
-//#if FREI0R_BYTE_ORDER == FREI0R_LITTLE_ENDIAN
-//little endian most significant 16 bit word from 32bit float
-#define MSWF(x) *((uint16_t*)x+1)
-//#endif
-
 //----------------------------------------------------------
 //convert from packed float RGBA to packed uchar RGBA
 //tab = table used for RGB conversion
 //atab = table used for alpha converion (usually linear)
 static inline void float_2_RGBA8(const float_rgba *in, uint32_t *out, int w, int h, uint8_t *tab, uint8_t *atab)
 {
-int i;
-uint8_t *cout=(uint8_t *)out;
+cfc_job j={0};
 
-for (i=0;i<w*h;i++)
-	{
-	*cout++ = tab[MSWF(&in[i].r)];
-	*cout++ = tab[MSWF(&in[i].g)];
-	*cout++ = tab[MSWF(&in[i].b)];
-	*cout++ = atab[MSWF(&in[i].a)];
-	}
+j.inf=in; j.out8=out; j.ftab=tab; j.fatab=atab; j.alpha=1;
+cfc_run(&j, cfc_f2u_band, w, h);
 }
 
 //----------------------------------------------------------
@@ -280,19 +406,55 @@ for (i=0;i<w*h;i++)
 //tab = table used for RGB conversion
 static inline void float_2_RGB8(const float_rgba *in, uint32_t *out, int w, int h, uint8_t *tab)
 {
-int i;
-uint8_t *cout=(uint8_t *)out;
+cfc_job j={0};
 
-for (i=0;i<w*h;i++)
-	{
-	*cout++ = tab[MSWF(&in[i].r)];
-	*cout++ = tab[MSWF(&in[i].g)];
-	*cout++ = tab[MSWF(&in[i].b)];
-	cout++;
-	}
+j.inf=in; j.out8=out; j.ftab=tab;
+cfc_run(&j, cfc_f2u_band, w, h);
 }
 
-#undef MSWF
+//--------------------------------------------------------
+//linear uchar to float without tables, out=s*in+o
+//for all four channels
+static inline void RGBA8_2_float_lin(const uint32_t *in, float_rgba *out, int w, int h, double s, double o)
+{
+cfc_job j={0};
+
+j.in8=in; j.outf=out; j.s=s; j.o=o; j.alpha=1;
+cfc_run(&j, cfc_u2f_band, w, h);
+}
+
+//--------------------------------------------------------
+//linear uchar to float without tables, out=s*in+o
+//RGB only, SKIP ALPHA
+static inline void RGB8_2_float_lin(const uint32_t *in, float_rgba *out, int w, int h, double s, double o)
+{
+cfc_job j={0};
+
+j.in8=in; j.outf=out; j.s=s; j.o=o;
+cfc_run(&j, cfc_u2f_band, w, h);
+}
+
+//--------------------------------------------------------
+//linear float to uchar without tables, out=(uint8_t)(s*in)
+//for all four channels, no clamping
+static inline void float_2_RGBA8_lin(const float_rgba *in, uint32_t *out, int w, int h, double s)
+{
+cfc_job j={0};
+
+j.inf=in; j.out8=out; j.s=s; j.alpha=1;
+cfc_run(&j, cfc_f2u_band, w, h);
+}
+
+//--------------------------------------------------------
+//linear float to uchar without tables, out=(uint8_t)(s*in)
+//RGB only, SKIP ALPHA
+static inline void float_2_RGB8_lin(const float_rgba *in, uint32_t *out, int w, int h, double s)
+{
+cfc_job j={0};
+
+j.inf=in; j.out8=out; j.s=s;
+cfc_run(&j, cfc_f2u_band, w, h);
+}
 
 
 //--------------------------------------------------
@@ -317,3 +479,5 @@ return tab[((flint*)in)->i[1]];
 //return tab[((flint*)in)->i[0]];
 //}
 //#endif
+
+#endif
@@ -0,0 +1,460 @@
+#ifndef INCLUDED_FREI0R_COMPOSITE_H
+#define INCLUDED_FREI0R_COMPOSITE_H
+
+/*
+  Porter-Duff compositing of rows of RGBA8888 pixels, shared by the
+  alpha mixers.
+
+  f0r_composite_rgba8(mode, flags, in1, in2, out, n) composites n pixels
+  of in1 (the source, A) with in2 (the destination, B):
+
+    OVER  A over B     alpha = aA + aB (1 - aA)
+    ATOP  A atop B     alpha = aB
+    IN    A in B       alpha = aA aB
+    OUT   A out B      alpha = aA (1 - aB)
+    XOR   A xor B      alpha = aA (1 - aB) + aB (1 - aA)
+    ADD   A plus B weighted with aB, opaque result
+
+  Colours are straight (not premultiplied) unless the flag
+  F0R_COMPOSITE_PREMULTIPLIED is given. With F0R_COMPOSITE_SKIP_RUNS
+  runs of pixels whose result is one of the inputs or transparent black
+  (e.g. an opaque source over anything) are copied or cleared instead of
+  computed; this gives the same result, since the arithmetic is exact
+  for those pixels. Premultiplied input must have no colour above its
+  alpha for this to hold.
+
+  Like frei0r_simd.h every code path gives the same result. out may be
+  the same as in1 or in2.
+*/
+
+#include "frei0r_simd.h"
+
+#define F0R_COMPOSITE_OVER 0
+#define F0R_COMPOSITE_ATOP 1
+#define F0R_COMPOSITE_IN 2
+#define F0R_COMPOSITE_OUT 3
+#define F0R_COMPOSITE_XOR 4
+#define F0R_COMPOSITE_ADD 5
+
+#define F0R_COMPOSITE_PREMULTIPLIED 1
+#define F0R_COMPOSITE_SKIP_RUNS 2
+
+/* ------------------------------------------------------------------------
+ * scalar
+ *
+ * The weights f1 and f2 of the source and destination are 0..255.
+ */
+
+static inline void f0r_composite_weights(int mode, uint32_t a1, uint32_t a2,
+                                         uint32_t* f1, uint32_t* f2)
+{
+  switch (mode)
+    {
+    case F0R_COMPOSITE_OVER: *f1 = 255; *f2 = 255 - a1; break;
+    case F0R_COMPOSITE_ATOP: *f1 = a2; *f2 = 255 - a1; break;
+    case F0R_COMPOSITE_IN: *f1 = a2; *f2 = 0; break;
+    case F0R_COMPOSITE_OUT: *f1 = 255 - a2; *f2 = 0; break;
+    default: *f1 = 255 - a2; *f2 = 255 - a1; break;
+    }
+}
+
+static inline void f0r_composite_scalar(int mode, int premultiplied,
+                                        const uint8_t* s1, const uint8_t* s2,
+                                        uint8_t* d, unsigned int n)
+{
+  for (; n; --n, s1 += 4, s2 += 4, d += 4)
+    {
+      uint32_t a1 = s1[3], a2 = s2[3], f1, f2, alpha, c;
+      int b;
+
+      if (mode == F0R_COMPOSITE_ADD)
+        {
+          for (b = 0; b < 3; ++b)
+            {
+              c = s1[b] + ((s2[b] * a2) >> 8);
+              d[b] = c > 255 ? 255 : c;
+            }
+          d[3] = 255;
+          continue;
+        }
+
+      f0r_composite_weights(mode, a1, a2, &f1, &f2);
+      if (mode == F0R_COMPOSITE_ATOP)
+        alpha = a2;
+      else
+        alpha = f0r_mul255(a1, f1) + f0r_mul255(a2, f2);
+      for (b = 0; b < 3; ++b)
+        {
+          if (premultiplied)
+            c = f0r_mul255(s1[b], f1) + f0r_mul255(s2[b], f2);
+          else if (alpha)
+            c = (f0r_mul255(s1[b], a1) * f1 + f0r_mul255(s2[b], a2) * f2) / alpha;
+          else
+            c = 0;
+          d[b] = c > 255 ? 255 : c;
+        }
+      d[3] = alpha;
+    }
+}
+
+/* ------------------------------------------------------------------------
+ * vector, on 16 bit lanes holding one channel each
+ */
+
+#define F0R_PD_F1_over(P, a1, a2) f0r_set_##P(255)
+#define F0R_PD_F2_over(P, a1, a2) f0r_sub_##P(f0r_set_##P(255), a1)
+#define F0R_PD_F1_atop(P, a1, a2) (a2)
+#define F0R_PD_F2_atop(P, a1, a2) f0r_sub_##P(f0r_set_##P(255), a1)
+#define F0R_PD_F1_in(P, a1, a2) (a2)
+#define F0R_PD_F2_in(P, a1, a2) f0r_set_##P(0)
+#define F0R_PD_F1_out(P, a1, a2) f0r_sub_##P(f0r_set_##P(255), a2)
+#define F0R_PD_F2_out(P, a1, a2) f0r_set_##P(0)
+#define F0R_PD_F1_xor(P, a1, a2) f0r_sub_##P(f0r_set_##P(255), a2)
+#define F0R_PD_F2_xor(P, a1, a2) f0r_sub_##P(f0r_set_##P(255), a1)
+
+#define F0R_PD_ALPHA(P, a1, a2, f1, f2)                                 \
+  f0r_add_##P(f0r_mul255_##P(a1, f1), f0r_mul255_##P(a2, f2))
+#define F0R_PD_ALPHA_over F0R_PD_ALPHA
+#define F0R_PD_ALPHA_atop(P, a1, a2, f1, f2) (a2)
+#define F0R_PD_ALPHA_in F0R_PD_ALPHA
+#define F0R_PD_ALPHA_out F0R_PD_ALPHA
+#define F0R_PD_ALPHA_xor F0R_PD_ALPHA
+
+#define F0R_PD_LANES(P, mode)                                           \
+F0R_FN_##P F0R_VEC_##P f0r_pd_##mode##_##P(F0R_VEC_##P x, F0R_VEC_##P y, \
+                                           int premultiplied)           \
+{                                                                       \
+  F0R_VEC_##P a1 = f0r_alpha_##P(x);                                    \
+  F0R_VEC_##P a2 = f0r_alpha_##P(y);                                    \
+  F0R_VEC_##P f1 = F0R_PD_F1_##mode(P, a1, a2);                         \
+  F0R_VEC_##P f2 = F0R_PD_F2_##mode(P, a1, a2);                         \
+  F0R_VEC_##P alpha = F0R_PD_ALPHA_##mode(P, a1, a2, f1, f2);           \
+  F0R_VEC_##P c;                                                        \
+  if (premultiplied)                                                    \
+    c = f0r_min_##P(f0r_add_##P(f0r_mul255_##P(x, f1),                  \
+                                f0r_mul255_##P(y, f2)),                 \
+                    f0r_set_##P(255));                                  \
+  else                                                                  \
+    c = f0r_pddiv_##P(f0r_mul_##P(f0r_mul255_##P(x, a1), f1),           \
+                      f0r_mul_##P(f0r_mul255_##P(y, a2), f2), alpha);   \
+  return f0r_select_##P(f0r_alphamask_##P(), alpha, c);                 \
+}
+
+/* the sum is saturated when packing */
+#define F0R_PD_LANES_ADD(P)                                             \
+F0R_FN_##P F0R_VEC_##P f0r_pd_add_##P(F0R_VEC_##P x, F0R_VEC_##P y,     \
+                                      int premultiplied)                \
+{                                                                       \
+  F0R_VEC_##P c = f0r_add_##P(x, f0r_shr8_##P(f0r_mul_##P(y, f0r_alpha_##P(y)))); \
+  (void)premultiplied;                                                  \
+  return f0r_select_##P(f0r_alphamask_##P(), f0r_set_##P(255), c);      \
+}
+
+/* the lanes and row functions of every mode for path P, the row
+   functions leave the pixels after the last full vector alone */
+#define F0R_PD_ALL(P)                                           \
+  F0R_PD_LANES(P, over) F0R_PD_ROWS_##P(over)                   \
+  F0R_PD_LANES(P, atop) F0R_PD_ROWS_##P(atop)                   \
+  F0R_PD_LANES(P, in) F0R_PD_ROWS_##P(in)                       \
+  F0R_PD_LANES(P, out) F0R_PD_ROWS_##P(out)                     \
+  F0R_PD_LANES(P, xor) F0R_PD_ROWS_##P(xor)                     \
+  F0R_PD_LANES_ADD(P) F0R_PD_ROWS_##P(add)
+
+#define F0R_PD_DISPATCH(P, mode, s1, s2, d, n, premultiplied)            \
+  switch (mode)                                                         \
+    {                                                                   \
+    case F0R_COMPOSITE_OVER: f0r_pd_rows_over_##P(s1, s2, d, n, premultiplied); break; \
+    case F0R_COMPOSITE_ATOP: f0r_pd_rows_atop_##P(s1, s2, d, n, premultiplied); break; \
+    case F0R_COMPOSITE_IN: f0r_pd_rows_in_##P(s1, s2, d, n, premultiplied); break; \
+    case F0R_COMPOSITE_OUT: f0r_pd_rows_out_##P(s1, s2, d, n, premultiplied); break; \
+    case F0R_COMPOSITE_XOR: f0r_pd_rows_xor_##P(s1, s2, d, n, premultiplied); break; \
+    default: f0r_pd_rows_add_##P(s1, s2, d, n, premultiplied); break; \
+    }
+
+/* ------------------------------------------------------------------------
+ * SSE2
+ */
+
+#if defined(F0R_HAVE_SSE2)
+
+static inline __m128i f0r_udiv32_sse2(__m128i n, __m128i d)
+{
+  __m128 nf = _mm_cvtepi32_ps(n), df = _mm_cvtepi32_ps(d);
+  __m128i q = _mm_cvttps_epi32(_mm_div_ps(nf, df));
+  /* the float quotient may be off by one, the remainder is exact */
+  __m128 r = _mm_sub_ps(nf, _mm_mul_ps(_mm_cvtepi32_ps(q), df));
+  q = _mm_sub_epi32(q, _mm_castps_si128(_mm_cmpge_ps(r, df)));
+  return _mm_add_epi32(q, _mm_castps_si128(_mm_cmplt_ps(r, _mm_setzero_ps())));
+}
+
+//! (p1 + p2) / alpha limited to 255, 0 where alpha is 0
+static inline __m128i f0r_pddiv_sse2(__m128i p1, __m128i p2, __m128i alpha)
+{
+  const __m128i zero = _mm_setzero_si128();
+  __m128i d = _mm_max_epi16(alpha, _mm_set1_epi16(1));
+  __m128i q0 = f0r_udiv32_sse2(_mm_add_epi32(_mm_unpacklo_epi16(p1, zero),
+                                             _mm_unpacklo_epi16(p2, zero)),
+                               _mm_unpacklo_epi16(d, zero));
+  __m128i q1 = f0r_udiv32_sse2(_mm_add_epi32(_mm_unpackhi_epi16(p1, zero),
+                                             _mm_unpackhi_epi16(p2, zero)),
+                               _mm_unpackhi_epi16(d, zero));
+  __m128i q = _mm_min_epi16(_mm_packs_epi32(q0, q1), _mm_set1_epi16(255));
+  return _mm_andnot_si128(_mm_cmpeq_epi16(alpha, zero), q);
+}
+
+#define F0R_PD_ROWS_sse2(mode)                                          \
+static inline void f0r_pd_rows_##mode##_sse2(const uint8_t* s1,         \
+                                             const uint8_t* s2,         \
+                                             uint8_t* d, unsigned int n, \
+                                             int premultiplied)         \
+{                                                                       \
+  const __m128i zero = _mm_setzero_si128();                             \
+  for (; n >= 4; n -= 4, s1 += 16, s2 += 16, d += 16)                   \
+    {                                                                   \
+      __m128i a = _mm_loadu_si128((const __m128i*)s1);                  \
+      __m128i b = _mm_loadu_si128((const __m128i*)s2);                  \
+      __m128i lo = f0r_pd_##mode##_sse2(_mm_unpacklo_epi8(a, zero),     \
+                                        _mm_unpacklo_epi8(b, zero),     \
+                                        premultiplied);                 \
+      __m128i hi = f0r_pd_##mode##_sse2(_mm_unpackhi_epi8(a, zero),     \
+                                        _mm_unpackhi_epi8(b, zero),     \
+                                        premultiplied);                 \
+      _mm_storeu_si128((__m128i*)d, _mm_packus_epi16(lo, hi));          \
+    }                                                                   \
+}
+
+F0R_PD_ALL(sse2)
+
+#endif
+
+/* ------------------------------------------------------------------------
+ * AVX2
+ */
+
+#if defined(F0R_HAVE_AVX2)
+
+F0R_AVX2 __m256i f0r_udiv32_avx2(__m256i n, __m256i d)
+{
+  __m256 nf = _mm256_cvtepi32_ps(n), df = _mm256_cvtepi32_ps(d);
+  __m256i q = _mm256_cvttps_epi32(_mm256_div_ps(nf, df));
+  __m256 r = _mm256_sub_ps(nf, _mm256_mul_ps(_mm256_cvtepi32_ps(q), df));
+  q = _mm256_sub_epi32(q, _mm256_castps_si256(_mm256_cmp_ps(r, df, _CMP_GE_OQ)));
+  return _mm256_add_epi32(q, _mm256_castps_si256(_mm256_cmp_ps(r, _mm256_setzero_ps(),
+                                                               _CMP_LT_OQ)));
+}
+
+F0R_AVX2 __m256i f0r_pddiv_avx2(__m256i p1, __m256i p2, __m256i alpha)
+{
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i d = _mm256_max_epi16(alpha, _mm256_set1_epi16(1));
+  __m256i q0 = f0r_udiv32_avx2(_mm256_add_epi32(_mm256_unpacklo_epi16(p1, zero),
+                                                _mm256_unpacklo_epi16(p2, zero)),
+                               _mm256_unpacklo_epi16(d, zero));
+  __m256i q1 = f0r_udiv32_avx2(_mm256_add_epi32(_mm256_unpackhi_epi16(p1, zero),
+                                                _mm256_unpackhi_epi16(p2, zero)),
+                               _mm256_unpackhi_epi16(d, zero));
+  __m256i q = _mm256_min_epi16(_mm256_packs_epi32(q0, q1), _mm256_set1_epi16(255));
+  return _mm256_andnot_si256(_mm256_cmpeq_epi16(alpha, zero), q);
+}
+
+#define F0R_PD_ROWS_avx2(mode)                                          \
+F0R_AVX2 void f0r_pd_rows_##mode##_avx2(const uint8_t* s1,              \
+                                        const uint8_t* s2,              \
+                                        uint8_t* d, unsigned int n,     \
+                                        int premultiplied)              \
+{                                                                       \
+  const __m256i zero = _mm256_setzero_si256();                          \
+  for (; n >= 8; n -= 8, s1 += 32, s2 += 32, d += 32)                   \
+    {                                                                   \
+      __m256i a = _mm256_loadu_si256((const __m256i*)s1);               \
+      __m256i b = _mm256_loadu_si256((const __m256i*)s2);               \
+      __m256i lo = f0r_pd_##mode##_avx2(_mm256_unpacklo_epi8(a, zero),  \
+                                        _mm256_unpacklo_epi8(b, zero),  \
+                                        premultiplied);                 \
+      __m256i hi = f0r_pd_##mode##_avx2(_mm256_unpackhi_epi8(a, zero),  \
+                                        _mm256_unpackhi_epi8(b, zero),  \
+                                        premultiplied);                 \
+      _mm256_storeu_si256((__m256i*)d, _mm256_packus_epi16(lo, hi));    \
+    }                                                                   \
+}
+
+F0R_PD_ALL(avx2)
+
+#endif
+
+/* ------------------------------------------------------------------------
+ * NEON
+ */
+
+#if defined(F0R_HAVE_NEON)
+
+static inline uint32x4_t f0r_udiv32_neon(uint32x4_t n, uint32x4_t d)
+{
+  float32x4_t nf = vcvtq_f32_u32(n), df = vcvtq_f32_u32(d);
+  uint32x4_t q = vcvtq_u32_f32(vdivq_f32(nf, df));
+  float32x4_t r = vsubq_f32(nf, vmulq_f32(vcvtq_f32_u32(q), df));
+  q = vsubq_u32(q, vcgeq_f32(r, df));
+  return vaddq_u32(q, vcltq_f32(r, vdupq_n_f32(0)));
+}
+
+static inline int16x8_t f0r_pddiv_neon(int16x8_t p1, int16x8_t p2, int16x8_t alpha)
+{
+  uint16x8_t u1 = vreinterpretq_u16_s16(p1), u2 = vreinterpretq_u16_s16(p2);
+  uint16x8_t d = vreinterpretq_u16_s16(vmaxq_s16(alpha, vdupq_n_s16(1)));
+  uint32x4_t q0 = f0r_udiv32_neon(vaddl_u16(vget_low_u16(u1), vget_low_u16(u2)),
+                                  vmovl_u16(vget_low_u16(d)));
+  uint32x4_t q1 = f0r_udiv32_neon(vaddl_u16(vget_high_u16(u1), vget_high_u16(u2)),
+                                  vmovl_u16(vget_high_u16(d)));
+  uint16x8_t q = vminq_u16(vcombine_u16(vqmovn_u32(q0), vqmovn_u32(q1)),
+                           vdupq_n_u16(255));
+  return vreinterpretq_s16_u16(vbicq_u16(q, vceqq_s16(alpha, vdupq_n_s16(0))));
+}
+
+#define F0R_PD_ROWS_neon(mode)                                          \
+static inline void f0r_pd_rows_##mode##_neon(const uint8_t* s1,         \
+                                             const uint8_t* s2,         \
+                                             uint8_t* d, unsigned int n, \
+                                             int premultiplied)         \
+{                                                                       \
+  for (; n >= 4; n -= 4, s1 += 16, s2 += 16, d += 16)                   \
+    {                                                                   \
+      uint8x16_t a = vld1q_u8(s1);                                      \
+      uint8x16_t b = vld1q_u8(s2);                                      \
+      int16x8_t lo = f0r_pd_##mode##_neon(vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(a))), \
+                                          vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(b))), \
+                                          premultiplied);               \
+      int16x8_t hi = f0r_pd_##mode##_neon(vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(a))), \
+                                          vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(b))), \
+                                          premultiplied);               \
+      vst1q_u8(d, vcombine_u8(vqmovun_s16(lo), vqmovun_s16(hi)));       \
+    }                                                                   \
+}
+
+F0R_PD_ALL(neon)
+
+#endif
+
+/* ------------------------------------------------------------------------
+ * rows
+ */
+
+//! Composites n pixels on the best code path, without skipping.
+static inline void f0r_composite_span(int mode, int premultiplied,
+                                      const uint8_t* s1, const uint8_t* s2,
+                                      uint8_t* d, unsigned int n)
+{
+  unsigned int done = 0;
+  switch (f0r_simd_level())
+    {
+#if defined(F0R_HAVE_AVX2)
+    case F0R_SIMD_AVX2:
+      F0R_PD_DISPATCH(avx2, mode, s1, s2, d, n, premultiplied);
+      done = n & ~7u;
+      break;
+#endif
+#if defined(F0R_HAVE_SSE2)
+    case F0R_SIMD_SSE2:
+      F0R_PD_DISPATCH(sse2, mode, s1, s2, d, n, premultiplied);
+      done = n & ~3u;
+      break;
+#endif
+#if defined(F0R_HAVE_NEON)
+    case F0R_SIMD_NEON:
+      F0R_PD_DISPATCH(neon, mode, s1, s2, d, n, premultiplied);
+      done = n & ~3u;
+      break;
+#endif
+    default:
+      break;
+    }
+  f0r_composite_scalar(mode, premultiplied, s1 + 4 * done, s2 + 4 * done,
+                       d + 4 * done, n - done);
+}
+
+#define F0R_PD_COMPUTE 0
+#define F0R_PD_SRC1 1
+#define F0R_PD_SRC2 2
+#define F0R_PD_CLEAR 3
+
+/* What to do with a pixel of each mode, indexed by 3 * class of the
+   source alpha + class of the destination alpha, where the class is 0
+   for transparent, 1 for translucent and 2 for opaque. */
+static inline const unsigned char* f0r_pd_actions(int mode)
+{
+  static const unsigned char actions[6][9] = {
+    /* over */ { F0R_PD_CLEAR, F0R_PD_COMPUTE, F0R_PD_SRC2,
+                 F0R_PD_COMPUTE, F0R_PD_COMPUTE, F0R_PD_COMPUTE,
+                 F0R_PD_SRC1, F0R_PD_SRC1, F0R_PD_SRC1 },
+    /* atop */ { F0R_PD_CLEAR, F0R_PD_COMPUTE, F0R_PD_SRC2,
+                 F0R_PD_CLEAR, F0R_PD_COMPUTE, F0R_PD_COMPUTE,
+                 F0R_PD_CLEAR, F0R_PD_COMPUTE, F0R_PD_SRC1 },
+    /* in */   { F0R_PD_CLEAR, F0R_PD_CLEAR, F0R_PD_CLEAR,
+                 F0R_PD_CLEAR, F0R_PD_COMPUTE, F0R_PD_COMPUTE,
+                 F0R_PD_CLEAR, F0R_PD_COMPUTE, F0R_PD_SRC1 },
+    /* out */  { F0R_PD_CLEAR, F0R_PD_CLEAR, F0R_PD_CLEAR,
+                 F0R_PD_COMPUTE, F0R_PD_COMPUTE, F0R_PD_CLEAR,
+                 F0R_PD_SRC1, F0R_PD_COMPUTE, F0R_PD_CLEAR },
+    /* xor */  { F0R_PD_CLEAR, F0R_PD_COMPUTE, F0R_PD_SRC2,
+                 F0R_PD_COMPUTE, F0R_PD_COMPUTE, F0R_PD_COMPUTE,
+                 F0R_PD_SRC1, F0R_PD_COMPUTE, F0R_PD_CLEAR },
+    /* add */  { F0R_PD_COMPUTE, F0R_PD_COMPUTE, F0R_PD_COMPUTE,
+                 F0R_PD_COMPUTE, F0R_PD_COMPUTE, F0R_PD_COMPUTE,
+                 F0R_PD_COMPUTE, F0R_PD_COMPUTE, F0R_PD_COMPUTE }
+  };
+  return actions[mode];
+}
+
+static inline int f0r_pd_action(const unsigned char* actions,
+                                 const uint8_t* s1, const uint8_t* s2)
+{
+  int c1 = s1[3] == 0 ? 0 : (s1[3] == 255 ? 2 : 1);
+  int c2 = s2[3] == 0 ? 0 : (s2[3] == 255 ? 2 : 1);
+  return actions[3 * c1 + c2];
+}
+
+static inline void f0r_composite_rgba8(int mode, int flags,
+                                       const uint32_t* in1,
+                                       const uint32_t* in2,
+                                       uint32_t* out, unsigned int n)
+{
+  const uint8_t* s1 = (const uint8_t*)in1;
+  const uint8_t* s2 = (const uint8_t*)in2;
+  uint8_t* d = (uint8_t*)out;
+  const unsigned char* actions = f0r_pd_actions(mode);
+  int premultiplied = flags & F0R_COMPOSITE_PREMULTIPLIED;
+  unsigned int i = 0, j;
+
+  if (!(flags & F0R_COMPOSITE_SKIP_RUNS) || mode == F0R_COMPOSITE_ADD)
+    {
+      f0r_composite_span(mode, premultiplied, s1, s2, d, n);
+      return;
+    }
+
+  while (i < n)
+    {
+      int action = f0r_pd_action(actions, s1 + 4 * i, s2 + 4 * i);
+      for (j = i + 1; j < n && f0r_pd_action(actions, s1 + 4 * j, s2 + 4 * j) == action; ++j)
+        ;
+      switch (action)
+        {
+        case F0R_PD_SRC1:
+          if (out != in1)
+            memmove(d + 4 * i, s1 + 4 * i, 4 * (j - i));
+          break;
+        case F0R_PD_SRC2:
+          if (out != in2)
+            memmove(d + 4 * i, s2 + 4 * i, 4 * (j - i));
+          break;
+        case F0R_PD_CLEAR:
+          memset(d + 4 * i, 0, 4 * (j - i));
+          break;
+        default:
+          f0r_composite_span(mode, premultiplied, s1 + 4 * i, s2 + 4 * i,
+                             d + 4 * i, j - i);
+          break;
+        }
+      i = j;
+    }
+}
+
+#endif
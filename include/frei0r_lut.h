@@ -0,0 +1,395 @@
+#ifndef INCLUDED_FREI0R_LUT_H
+#define INCLUDED_FREI0R_LUT_H
+
+/*
+  Look-up tables for 8 bit point operations on RGBA8888 pixels.
+
+  A filter describes its operation once per parameter change as a
+  function of a single channel value (or of the three colour channels
+  for the mixing tables below), compiles it into tables with
+  f0r_lut_compile() and applies the tables to whole rows of pixels.
+
+  f0r_lut_t maps each of the four channels through a table of its own,
+  e.g. gamma or contrast. The tables hold the mapped value already in
+  the byte of its channel, so a pixel costs four loads and three ors.
+  AVX2 machines (chosen at run time, see frei0r_simd.h) gather eight
+  pixels at a time. f0r_lut_lightness_apply() looks all three colour
+  channels up at the HSL lightness (max + min) / 2 of the pixel instead,
+  for filters which desaturate before mapping.
+
+  f0r_lut_mix_t computes each colour channel from all three of them,
+  out[c] = (bias[c] + m[c][0][in[0]] + m[c][1][in[1]] + m[c][2][in[2]]) >> 16
+  clamped to [0, 255], with the entries in 16.16 fixed point. This
+  covers desaturation, tinting and channel mixing without any
+  multiplication per pixel. Alpha is copied. When all three channels
+  come out alike (black and white) only one of them is looked up.
+  f0r_lut_mix_lut_apply() maps the mixed pixels through a f0r_lut_t
+  as well, block by block while they are still in the cache, to chain
+  point operations in a single pass over the frame.
+
+  f0r_lut16_t does the same for frames of 16 bit channels (RGBA64),
+  with a full table of 65536 values for each channel it maps.
+
+  out may be the same as in for all of them.
+*/
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "frei0r_math.h"
+#include "frei0r_simd.h"
+
+/* channel masks for f0r_lut_compile() */
+#define F0R_LUT_R 1
+#define F0R_LUT_G 2
+#define F0R_LUT_B 4
+#define F0R_LUT_A 8
+#define F0R_LUT_RGB (F0R_LUT_R | F0R_LUT_G | F0R_LUT_B)
+
+//! The value of channel c (0 to 3) mapped from v, clamped to [0, 255] by the caller.
+typedef int (*f0r_lut_fn)(void* arg, int c, int v);
+
+//! The 16.16 contribution of the value v of channel k to channel c.
+typedef int32_t (*f0r_lut_mix_fn)(void* arg, int c, int k, int v);
+
+typedef struct f0r_lut
+{
+  uint32_t t[4][256]; /* t[c][v]: mapped v in the pixel byte of channel c */
+} f0r_lut_t;
+
+typedef struct f0r_lut_mix
+{
+  int32_t m[3][3][256];
+  int32_t bias[3];
+  int gray; /* the three output channels are equal */
+} f0r_lut_mix_t;
+
+//! Sets the table of channel c from 256 values, or to identity if table is 0.
+static inline void f0r_lut_table(f0r_lut_t* lut, int c, const uint8_t* table)
+{
+  int i;
+  for (i = 0; i < 256; ++i)
+    {
+      uint8_t bytes[4] = {0, 0, 0, 0};
+      bytes[c] = table ? table[i] : (uint8_t)i;
+      memcpy(&lut->t[c][i], bytes, sizeof(uint32_t));
+    }
+}
+
+//! Compiles fn into the tables of the channels in mask, the others map to themselves.
+static inline void f0r_lut_compile(f0r_lut_t* lut, f0r_lut_fn fn, void* arg,
+                                   int mask)
+{
+  uint8_t table[256];
+  int c, i;
+  for (c = 0; c < 4; ++c)
+    {
+      if (!(mask & (1 << c)))
+        {
+          f0r_lut_table(lut, c, 0);
+          continue;
+        }
+      for (i = 0; i < 256; ++i)
+        table[i] = CLAMP0255(fn(arg, c, i));
+      f0r_lut_table(lut, c, table);
+    }
+}
+
+//! Compiles fn into the mixing tables, with 16.16 offsets bias or 0.
+static inline void f0r_lut_mix_compile(f0r_lut_mix_t* mix, f0r_lut_mix_fn fn,
+                                       void* arg, const int32_t* bias)
+{
+  int c, k, i;
+  for (c = 0; c < 3; ++c)
+    {
+      mix->bias[c] = bias ? bias[c] : 0;
+      for (k = 0; k < 3; ++k)
+        for (i = 0; i < 256; ++i)
+          mix->m[c][k][i] = fn(arg, c, k, i);
+    }
+  mix->gray = mix->bias[0] == mix->bias[1] && mix->bias[0] == mix->bias[2]
+    && !memcmp(mix->m[0], mix->m[1], sizeof(mix->m[0]))
+    && !memcmp(mix->m[0], mix->m[2], sizeof(mix->m[0]));
+}
+
+static inline void f0r_lut_apply_scalar(const f0r_lut_t* lut,
+                                        const uint32_t* in, uint32_t* out,
+                                        unsigned int n)
+{
+  unsigned int i;
+  for (i = 0; i < n; ++i)
+    {
+      const uint8_t* s = (const uint8_t*)(in + i);
+      out[i] = lut->t[0][s[0]] | lut->t[1][s[1]] | lut->t[2][s[2]] | lut->t[3][s[3]];
+    }
+}
+
+#if defined(F0R_HAVE_AVX2)
+F0R_AVX2 void f0r_lut_apply_avx2(const f0r_lut_t* lut, const uint32_t* in,
+                                 uint32_t* out, unsigned int n)
+{
+  const __m256i ff = _mm256_set1_epi32(0xff);
+  const int* t0 = (const int*)lut->t[0];
+  const int* t1 = (const int*)lut->t[1];
+  const int* t2 = (const int*)lut->t[2];
+  const int* t3 = (const int*)lut->t[3];
+  unsigned int i = 0;
+  for (; i + 8 <= n; i += 8)
+    {
+      __m256i p = _mm256_loadu_si256((const __m256i*)(in + i));
+      __m256i r = _mm256_i32gather_epi32(t0, _mm256_and_si256(p, ff), 4);
+      __m256i g = _mm256_i32gather_epi32(t1, _mm256_and_si256(_mm256_srli_epi32(p, 8), ff), 4);
+      __m256i b = _mm256_i32gather_epi32(t2, _mm256_and_si256(_mm256_srli_epi32(p, 16), ff), 4);
+      __m256i a = _mm256_i32gather_epi32(t3, _mm256_srli_epi32(p, 24), 4);
+      _mm256_storeu_si256((__m256i*)(out + i),
+                          _mm256_or_si256(_mm256_or_si256(r, g), _mm256_or_si256(b, a)));
+    }
+  f0r_lut_apply_scalar(lut, in + i, out + i, n - i);
+}
+#endif
+
+//! Maps n pixels of in through lut into out.
+static inline void f0r_lut_apply(const f0r_lut_t* lut, const uint32_t* in,
+                                 uint32_t* out, unsigned int n)
+{
+#if defined(F0R_HAVE_AVX2)
+  if (f0r_simd_level() >= F0R_SIMD_AVX2)
+    {
+      f0r_lut_apply_avx2(lut, in, out, n);
+      return;
+    }
+#endif
+  f0r_lut_apply_scalar(lut, in, out, n);
+}
+
+static inline void f0r_lut_lightness_apply_scalar(const f0r_lut_t* lut,
+                                                  const uint32_t* in,
+                                                  uint32_t* out,
+                                                  unsigned int n)
+{
+  unsigned int i;
+  for (i = 0; i < n; ++i)
+    {
+      const uint8_t* s = (const uint8_t*)(in + i);
+      int hi = s[0] > s[1] ? s[0] : s[1];
+      int lo = s[0] > s[1] ? s[1] : s[0];
+      hi = s[2] > hi ? s[2] : hi;
+      lo = s[2] < lo ? s[2] : lo;
+      int l = (hi + lo + 1) >> 1;
+      out[i] = lut->t[0][l] | lut->t[1][l] | lut->t[2][l] | lut->t[3][s[3]];
+    }
+}
+
+#if defined(F0R_HAVE_AVX2)
+F0R_AVX2 void f0r_lut_lightness_apply_avx2(const f0r_lut_t* lut,
+                                           const uint32_t* in, uint32_t* out,
+                                           unsigned int n)
+{
+  const __m256i ff = _mm256_set1_epi32(0xff);
+  const __m256i one = _mm256_set1_epi32(1);
+  unsigned int i = 0;
+  for (; i + 8 <= n; i += 8)
+    {
+      __m256i p = _mm256_loadu_si256((const __m256i*)(in + i));
+      __m256i x0 = _mm256_and_si256(p, ff);
+      __m256i x1 = _mm256_and_si256(_mm256_srli_epi32(p, 8), ff);
+      __m256i x2 = _mm256_and_si256(_mm256_srli_epi32(p, 16), ff);
+      __m256i hi = _mm256_max_epi32(_mm256_max_epi32(x0, x1), x2);
+      __m256i lo = _mm256_min_epi32(_mm256_min_epi32(x0, x1), x2);
+      __m256i l = _mm256_srli_epi32(_mm256_add_epi32(_mm256_add_epi32(hi, lo), one), 1);
+      __m256i r = _mm256_i32gather_epi32((const int*)lut->t[0], l, 4);
+      __m256i g = _mm256_i32gather_epi32((const int*)lut->t[1], l, 4);
+      __m256i b = _mm256_i32gather_epi32((const int*)lut->t[2], l, 4);
+      __m256i a = _mm256_i32gather_epi32((const int*)lut->t[3], _mm256_srli_epi32(p, 24), 4);
+      _mm256_storeu_si256((__m256i*)(out + i),
+                          _mm256_or_si256(_mm256_or_si256(r, g), _mm256_or_si256(b, a)));
+    }
+  f0r_lut_lightness_apply_scalar(lut, in + i, out + i, n - i);
+}
+#endif
+
+//! Maps the lightness of n pixels of in through lut into the colour channels of out.
+static inline void f0r_lut_lightness_apply(const f0r_lut_t* lut,
+                                           const uint32_t* in, uint32_t* out,
+                                           unsigned int n)
+{
+#if defined(F0R_HAVE_AVX2)
+  if (f0r_simd_level() >= F0R_SIMD_AVX2)
+    {
+      f0r_lut_lightness_apply_avx2(lut, in, out, n);
+      return;
+    }
+#endif
+  f0r_lut_lightness_apply_scalar(lut, in, out, n);
+}
+
+static inline void f0r_lut_mix_apply_scalar(const f0r_lut_mix_t* mix,
+                                            const uint32_t* in, uint32_t* out,
+                                            unsigned int n)
+{
+  unsigned int i;
+  if (mix->gray)
+    {
+      for (i = 0; i < n; ++i)
+        {
+          const uint8_t* s = (const uint8_t*)(in + i);
+          uint8_t* d = (uint8_t*)(out + i);
+          int32_t v = mix->bias[0] + mix->m[0][0][s[0]] + mix->m[0][1][s[1]] + mix->m[0][2][s[2]];
+          d[3] = s[3];
+          d[0] = d[1] = d[2] = CLAMP0255(v >> 16);
+        }
+      return;
+    }
+  for (i = 0; i < n; ++i)
+    {
+      const uint8_t* s = (const uint8_t*)(in + i);
+      uint8_t* d = (uint8_t*)(out + i);
+      int x0 = s[0], x1 = s[1], x2 = s[2];
+      int32_t v0 = mix->bias[0] + mix->m[0][0][x0] + mix->m[0][1][x1] + mix->m[0][2][x2];
+      int32_t v1 = mix->bias[1] + mix->m[1][0][x0] + mix->m[1][1][x1] + mix->m[1][2][x2];
+      int32_t v2 = mix->bias[2] + mix->m[2][0][x0] + mix->m[2][1][x1] + mix->m[2][2][x2];
+      d[3] = s[3];
+      d[0] = CLAMP0255(v0 >> 16);
+      d[1] = CLAMP0255(v1 >> 16);
+      d[2] = CLAMP0255(v2 >> 16);
+    }
+}
+
+#if defined(F0R_HAVE_AVX2)
+F0R_AVX2 void f0r_lut_mix_apply_avx2(const f0r_lut_mix_t* mix,
+                                     const uint32_t* in, uint32_t* out,
+                                     unsigned int n)
+{
+  const __m256i ff = _mm256_set1_epi32(0xff);
+  const __m256i amask = _mm256_set1_epi32((int)0xff000000u);
+  const __m256i zero = _mm256_setzero_si256();
+  int channels = mix->gray ? 1 : 3;
+  unsigned int i = 0;
+  for (; i + 8 <= n; i += 8)
+    {
+      __m256i p = _mm256_loadu_si256((const __m256i*)(in + i));
+      __m256i x[3], v[3];
+      int c;
+      x[0] = _mm256_and_si256(p, ff);
+      x[1] = _mm256_and_si256(_mm256_srli_epi32(p, 8), ff);
+      x[2] = _mm256_and_si256(_mm256_srli_epi32(p, 16), ff);
+      for (c = 0; c < channels; ++c)
+        {
+          __m256i s = _mm256_set1_epi32(mix->bias[c]);
+          s = _mm256_add_epi32(s, _mm256_i32gather_epi32((const int*)mix->m[c][0], x[0], 4));
+          s = _mm256_add_epi32(s, _mm256_i32gather_epi32((const int*)mix->m[c][1], x[1], 4));
+          s = _mm256_add_epi32(s, _mm256_i32gather_epi32((const int*)mix->m[c][2], x[2], 4));
+          s = _mm256_srai_epi32(s, 16);
+          v[c] = _mm256_min_epi32(_mm256_max_epi32(s, zero), ff);
+        }
+      if (mix->gray)
+        v[1] = v[2] = v[0];
+      p = _mm256_or_si256(_mm256_and_si256(p, amask),
+                          _mm256_or_si256(v[0], _mm256_slli_epi32(v[1], 8)));
+      _mm256_storeu_si256((__m256i*)(out + i),
+                          _mm256_or_si256(p, _mm256_slli_epi32(v[2], 16)));
+    }
+  f0r_lut_mix_apply_scalar(mix, in + i, out + i, n - i);
+}
+#endif
+
+//! Mixes the colour channels of n pixels of in into out.
+static inline void f0r_lut_mix_apply(const f0r_lut_mix_t* mix,
+                                     const uint32_t* in, uint32_t* out,
+                                     unsigned int n)
+{
+#if defined(F0R_HAVE_AVX2)
+  if (f0r_simd_level() >= F0R_SIMD_AVX2)
+    {
+      f0r_lut_mix_apply_avx2(mix, in, out, n);
+      return;
+    }
+#endif
+  f0r_lut_mix_apply_scalar(mix, in, out, n);
+}
+
+#define F0R_LUT_BLOCK 1024
+
+//! Mixes n pixels of in and maps the result through lut into out.
+static inline void f0r_lut_mix_lut_apply(const f0r_lut_mix_t* mix,
+                                         const f0r_lut_t* lut,
+                                         const uint32_t* in, uint32_t* out,
+                                         unsigned int n)
+{
+  unsigned int i, m;
+  for (i = 0; i < n; i += m)
+    {
+      m = n - i < F0R_LUT_BLOCK ? n - i : F0R_LUT_BLOCK;
+      f0r_lut_mix_apply(mix, in + i, out + i, m);
+      f0r_lut_apply(lut, out + i, out + i, m);
+    }
+}
+
+/* ------------------------------------------------------------------------
+ * RGBA64
+ */
+
+typedef struct f0r_lut16
+{
+  uint16_t* t[4]; /* t[c][v]: mapped v, or 0 if channel c is copied */
+} f0r_lut16_t;
+
+//! Frees the tables of lut.
+static inline void f0r_lut16_free(f0r_lut16_t* lut)
+{
+  int c;
+  for (c = 0; c < 4; ++c)
+    {
+      free(lut->t[c]);
+      lut->t[c] = 0;
+    }
+}
+
+//! Compiles fn, on values in [0, 65535], into the tables of the channels
+//! in mask, the others are copied. Returns 0 if out of memory.
+static inline int f0r_lut16_compile(f0r_lut16_t* lut, f0r_lut_fn fn,
+                                    void* arg, int mask)
+{
+  int c, i;
+  for (c = 0; c < 4; ++c)
+    {
+      if (!(mask & (1 << c)))
+        {
+          free(lut->t[c]);
+          lut->t[c] = 0;
+          continue;
+        }
+      if (!lut->t[c])
+        lut->t[c] = (uint16_t*)malloc(65536 * sizeof(uint16_t));
+      if (!lut->t[c])
+        return 0;
+      for (i = 0; i < 65536; ++i)
+        {
+          int v = fn(arg, c, i);
+          lut->t[c][i] = v < 0 ? 0 : v > 65535 ? 65535 : v;
+        }
+    }
+  return 1;
+}
+
+//! Maps n pixels of 16 bit channels.
+static inline void f0r_lut16_apply(const f0r_lut16_t* lut,
+                                   const uint16_t* in, uint16_t* out,
+                                   unsigned int n)
+{
+  const uint16_t* t0 = lut->t[0];
+  const uint16_t* t1 = lut->t[1];
+  const uint16_t* t2 = lut->t[2];
+  const uint16_t* t3 = lut->t[3];
+  unsigned int i;
+  for (i = 0; i < n; ++i, in += 4, out += 4)
+    {
+      out[0] = t0 ? t0[in[0]] : in[0];
+      out[1] = t1 ? t1[in[1]] : in[1];
+      out[2] = t2 ? t2[in[2]] : in[2];
+      out[3] = t3 ? t3[in[3]] : in[3];
+    }
+}
+
+#endif
@@ -0,0 +1,482 @@
+#ifndef INCLUDED_FREI0R_REMAP_H
+#define INCLUDED_FREI0R_REMAP_H
+
+/*
+  Geometric remapping of RGBA8888 frames, the engine behind c0rners and
+  defish0r.
+
+  A plugin describes its geometry with a float map which holds, for
+  each output pixel, the x and y position in the input frame to take it
+  from, as interleaved pairs. An x which is not positive marks a
+  background pixel. f0r_remap_set() turns the map into packed
+  fixed-point entries whenever the geometry changes: the offset of the
+  input pixel and the x and y fractions in 1/256 steps. The kernel of
+  the interpolator is tabulated at the same time, as 12 bit weights for
+  each of the 256 fractions.
+
+  f0r_remap_run() then resamples a frame with integer arithmetic only.
+  Each kernel size has a row function of its own, so there is no call
+  through a pointer per pixel. Pixels whose kernel fits in the input
+  frame are filtered with SSE2 where available; near the border the
+  taps are clamped to the frame. Bands of output rows run on threads of
+  their own (see frei0r_thread.h).
+
+  The kinds of interpolation are numbered like the interpolation
+  parameter of the plugins: nearest neighbour, bilinear, smooth bicubic
+  (Lagrange), sharp bicubic (Keys, a = -0.75), 4x4 spline, 6x6 spline
+  and 16x16 truncated sinc.
+
+  Plugins which compute their positions themselves can fill the entries
+  directly with f0r_remap_prepare(), f0r_remap_point() and
+  f0r_remap_background() instead of going through a float map.
+
+  An f0r_remap_t must be zeroed before it is first prepared and
+  released with f0r_remap_free().
+*/
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "frei0r_simd.h"
+#include "frei0r_thread.h"
+
+enum
+{
+  F0R_REMAP_NEAREST = 0,
+  F0R_REMAP_BILINEAR,
+  F0R_REMAP_BICUBIC_SMOOTH,
+  F0R_REMAP_BICUBIC_SHARP,
+  F0R_REMAP_SPLINE4,
+  F0R_REMAP_SPLINE6,
+  F0R_REMAP_SINC16
+};
+
+#define F0R_REMAP_PHASES 256
+#define F0R_REMAP_MAX_TAPS 16
+#define F0R_REMAP_WBITS 12  /* weights, 1.0 = 4096 */
+#define F0R_REMAP_HBITS 7   /* dropped after the horizontal pass */
+#define F0R_REMAP_SHIFT (2 * F0R_REMAP_WBITS - F0R_REMAP_HBITS)
+
+#define F0R_REMAP_BACKGROUND 1
+#define F0R_REMAP_EDGE 2
+
+typedef struct f0r_remap_entry
+{
+  int32_t ofs;     /* input pixel at floor(x), floor(y) */
+  uint8_t fx, fy;  /* fractions of x and y in 1/256 */
+  uint16_t flags;  /* F0R_REMAP_BACKGROUND, F0R_REMAP_EDGE */
+} f0r_remap_entry_t;
+
+typedef struct f0r_remap
+{
+  int wi, hi, wo, ho;
+  int kind, taps;
+  f0r_remap_entry_t* map;
+  int16_t weight[F0R_REMAP_PHASES][F0R_REMAP_MAX_TAPS];
+} f0r_remap_t;
+
+//! The kernel of an interpolator at distance d from the sample.
+static inline double f0r_remap_kernel(int kind, double d)
+{
+  const double pi = 3.14159265358979323846;
+  double u;
+
+  d = fabs(d);
+  switch (kind)
+    {
+    case F0R_REMAP_BILINEAR:
+      return d < 1.0 ? 1.0 - d : 0.0;
+    case F0R_REMAP_BICUBIC_SMOOTH:
+      if (d < 1.0)
+        return (d - 2.0) * (d - 1.0) * (d + 1.0) / 2.0;
+      if (d < 2.0)
+        return -(d - 1.0) * (d - 2.0) * (d - 3.0) / 6.0;
+      return 0.0;
+    case F0R_REMAP_BICUBIC_SHARP:
+      if (d < 1.0)
+        return (1.25 * d - 2.25) * d * d + 1.0;
+      if (d < 2.0)
+        return (-0.75 * (d - 5.0) * d - 6.0) * d + 3.0;
+      return 0.0;
+    case F0R_REMAP_SPLINE4:
+      if (d < 1.0)
+        return ((d - 1.8) * d - 0.2) * d + 1.0;
+      u = d - 1.0;
+      if (d < 2.0)
+        return ((-0.333333 * u + 0.8) * u - 0.466667) * u;
+      return 0.0;
+    case F0R_REMAP_SPLINE6:
+      if (d < 1.0)
+        return ((1.181818 * d - 2.167464) * d + 0.014354) * d + 1.0;
+      u = d - 1.0;
+      if (d < 2.0)
+        return ((-0.545455 * u + 1.291866) * u - 0.746411) * u;
+      u = d - 2.0;
+      if (d < 3.0)
+        return ((0.090909 * u - 0.215311) * u + 0.124402) * u;
+      return 0.0;
+    case F0R_REMAP_SINC16:
+      if (d == 0.0)
+        return 1.0;
+      if (d < 8.0)
+        return sin(pi * d) / (pi * d) * sin(pi * d / 8.0) / (pi * d / 8.0);
+      return 0.0;
+    }
+  return d < 0.5 ? 1.0 : 0.0;
+}
+
+static inline int f0r_remap_taps(int kind)
+{
+  switch (kind)
+    {
+    case F0R_REMAP_BILINEAR:
+      return 2;
+    case F0R_REMAP_BICUBIC_SMOOTH:
+    case F0R_REMAP_BICUBIC_SHARP:
+    case F0R_REMAP_SPLINE4:
+      return 4;
+    case F0R_REMAP_SPLINE6:
+      return 6;
+    case F0R_REMAP_SINC16:
+      return 16;
+    }
+  return 1;
+}
+
+/* Tap i of an n tap kernel sits at floor(x) - n / 2 + 1 + i. The
+ * weights of each fraction are scaled to add up to one, which keeps flat
+ * areas flat (the 6x6 spline and the truncated sinc do not on their
+ * own), and the rounding error is put on the nearest tap. */
+static inline void f0r_remap_weights(f0r_remap_t* rm)
+{
+  double w[F0R_REMAP_MAX_TAPS], t, total;
+  int p, i, n = rm->taps, sum, near;
+
+  memset(rm->weight, 0, sizeof(rm->weight));
+  if (n < 2)
+    return;
+  for (p = 0; p < F0R_REMAP_PHASES; ++p)
+    {
+      t = (double)p / F0R_REMAP_PHASES;
+      total = 0.0;
+      for (i = 0; i < n; ++i)
+        {
+          w[i] = f0r_remap_kernel(rm->kind, t - (i - n / 2 + 1));
+          total += w[i];
+        }
+      sum = 0;
+      for (i = 0; i < n; ++i)
+        {
+          rm->weight[p][i] = (int16_t)floor(w[i] / total * (1 << F0R_REMAP_WBITS) + 0.5);
+          sum += rm->weight[p][i];
+        }
+      near = n / 2 - 1 + (t >= 0.5);
+      rm->weight[p][near] += (int16_t)((1 << F0R_REMAP_WBITS) - sum);
+    }
+}
+
+//! Free the entries of a remap.
+static inline void f0r_remap_free(f0r_remap_t* rm)
+{
+  free(rm->map);
+  rm->map = 0;
+}
+
+//! Size a remap for wo x ho entries into a wi x hi input frame and
+//! tabulate the kernel of the interpolator kind.
+static inline void f0r_remap_prepare(f0r_remap_t* rm, int wi, int hi, int wo, int ho,
+                                     int kind)
+{
+  if (!rm->map || rm->wo != wo || rm->ho != ho)
+    {
+      free(rm->map);
+      rm->map = (f0r_remap_entry_t*)malloc(sizeof(f0r_remap_entry_t) * wo * ho);
+    }
+  rm->wi = wi;
+  rm->hi = hi;
+  rm->wo = wo;
+  rm->ho = ho;
+  if (kind < F0R_REMAP_NEAREST || kind > F0R_REMAP_SINC16)
+    kind = F0R_REMAP_NEAREST;
+  if (rm->kind != kind || rm->taps == 0)
+    {
+      rm->kind = kind;
+      rm->taps = f0r_remap_taps(kind);
+      f0r_remap_weights(rm);
+    }
+}
+
+//! Make entry i a background pixel.
+static inline void f0r_remap_background(f0r_remap_t* rm, int i)
+{
+  f0r_remap_entry_t* e = rm->map + i;
+
+  e->ofs = 0;
+  e->fx = e->fy = 0;
+  e->flags = F0R_REMAP_BACKGROUND;
+}
+
+//! Make entry i sample the input frame at x, y, which are clamped to the
+//! frame.
+static inline void f0r_remap_point(f0r_remap_t* rm, int i, double x, double y)
+{
+  f0r_remap_entry_t* e = rm->map + i;
+  int xi, yi, fx, fy, before = rm->taps / 2 - 1, after = rm->taps / 2;
+
+  x = x > 0.0 ? (x < rm->wi - 1 ? x : rm->wi - 1) : 0.0;
+  y = y > 0.0 ? (y < rm->hi - 1 ? y : rm->hi - 1) : 0.0;
+  if (rm->kind == F0R_REMAP_NEAREST)
+    {
+      xi = (int)floor(x + 0.5);
+      yi = (int)floor(y + 0.5);
+      fx = fy = 0;
+    }
+  else
+    {
+      xi = (int)x;
+      yi = (int)y;
+      fx = (int)floor((x - xi) * F0R_REMAP_PHASES + 0.5);
+      fy = (int)floor((y - yi) * F0R_REMAP_PHASES + 0.5);
+      if (fx == F0R_REMAP_PHASES)
+        {
+          ++xi;
+          fx = 0;
+        }
+      if (fy == F0R_REMAP_PHASES)
+        {
+          ++yi;
+          fy = 0;
+        }
+    }
+  e->ofs = yi * rm->wi + xi;
+  e->fx = (uint8_t)fx;
+  e->fy = (uint8_t)fy;
+  e->flags = (xi - before < 0 || xi + after >= rm->wi
+              || yi - before < 0 || yi + after >= rm->hi) ? F0R_REMAP_EDGE : 0;
+}
+
+//! Build the entries of a remap from a float map of wo x ho positions in
+//! a wi x hi input frame, for the interpolator kind.
+static inline void f0r_remap_set(f0r_remap_t* rm, int wi, int hi, int wo, int ho,
+                                 const float* map, int kind)
+{
+  int i;
+
+  f0r_remap_prepare(rm, wi, hi, wo, ho, kind);
+  for (i = 0; i < wo * ho; ++i)
+    {
+      if (map[2 * i] > 0.0f)
+        f0r_remap_point(rm, i, map[2 * i], map[2 * i + 1]);
+      else
+        f0r_remap_background(rm, i);
+    }
+}
+
+/* ------------------------------------------------------------------------
+ * Filtering of a single pixel. n is a constant in every caller and the
+ * functions are forced inline, so the loops unroll.
+ */
+
+#if defined(__GNUC__)
+#define F0R_REMAP_INLINE static inline __attribute__((always_inline))
+#elif defined(_MSC_VER)
+#define F0R_REMAP_INLINE static __forceinline
+#else
+#define F0R_REMAP_INLINE static inline
+#endif
+
+F0R_REMAP_INLINE uint32_t f0r_remap_pack(int32_t v)
+{
+  v >>= F0R_REMAP_SHIFT;
+  return v < 0 ? 0 : (v > 255 ? 255 : (uint32_t)v);
+}
+
+/* p is the top left tap and stride the distance of the tap rows */
+F0R_REMAP_INLINE uint32_t f0r_remap_filter(const uint32_t* p, int stride,
+                                           const int16_t* wx, const int16_t* wy,
+                                           int n)
+{
+  int32_t a0 = 0, a1 = 0, a2 = 0, a3 = 0, h0, h1, h2, h3;
+  uint32_t px;
+  int i, j;
+
+  for (j = 0; j < n; ++j, p += stride)
+    {
+      h0 = h1 = h2 = h3 = 0;
+      for (i = 0; i < n; ++i)
+        {
+          px = p[i];
+          h0 += wx[i] * (int32_t)(px & 0xFF);
+          h1 += wx[i] * (int32_t)((px >> 8) & 0xFF);
+          h2 += wx[i] * (int32_t)((px >> 16) & 0xFF);
+          h3 += wx[i] * (int32_t)(px >> 24);
+        }
+      a0 += wy[j] * (h0 >> F0R_REMAP_HBITS);
+      a1 += wy[j] * (h1 >> F0R_REMAP_HBITS);
+      a2 += wy[j] * (h2 >> F0R_REMAP_HBITS);
+      a3 += wy[j] * (h3 >> F0R_REMAP_HBITS);
+    }
+  return f0r_remap_pack(a0) | (f0r_remap_pack(a1) << 8)
+    | (f0r_remap_pack(a2) << 16) | (f0r_remap_pack(a3) << 24);
+}
+
+/* near the border the taps are gathered into a window of their own */
+static inline uint32_t f0r_remap_edge(const f0r_remap_t* rm, const uint32_t* in,
+                                      const f0r_remap_entry_t* e, int n)
+{
+  uint32_t win[F0R_REMAP_MAX_TAPS * F0R_REMAP_MAX_TAPS];
+  int i, j, x, y, col[F0R_REMAP_MAX_TAPS];
+  const uint32_t* row;
+
+  x = e->ofs % rm->wi - n / 2 + 1;
+  y = e->ofs / rm->wi - n / 2 + 1;
+  for (i = 0; i < n; ++i)
+    col[i] = x + i < 0 ? 0 : (x + i >= rm->wi ? rm->wi - 1 : x + i);
+  for (j = 0; j < n; ++j)
+    {
+      row = in + rm->wi * (y + j < 0 ? 0 : (y + j >= rm->hi ? rm->hi - 1 : y + j));
+      for (i = 0; i < n; ++i)
+        win[j * n + i] = row[col[i]];
+    }
+  return f0r_remap_filter(win, n, rm->weight[e->fx], rm->weight[e->fy], n);
+}
+
+F0R_REMAP_INLINE uint32_t f0r_remap_scalar(const f0r_remap_t* rm, const uint32_t* in,
+                                           const f0r_remap_entry_t* e, int n)
+{
+  return f0r_remap_filter(in + e->ofs - (n / 2 - 1) * (rm->wi + 1), rm->wi,
+                          rm->weight[e->fx], rm->weight[e->fy], n);
+}
+
+#if defined(F0R_HAVE_SSE2)
+
+/* Two taps per _mm_madd_epi16: the channels of neighbouring taps are
+ * interleaved and multiplied with a pair of weights. The sums are the
+ * same as in f0r_remap_filter(). */
+F0R_REMAP_INLINE __m128i f0r_remap_pair_sse2(const int16_t* w)
+{
+  int32_t pair;
+  memcpy(&pair, w, sizeof(pair));
+  return _mm_set1_epi32(pair);
+}
+
+F0R_REMAP_INLINE __m128i f0r_remap_hsum_sse2(const uint32_t* p, const int16_t* wx, int n)
+{
+  __m128i z = _mm_setzero_si128(), h = z, v;
+  int i;
+
+  for (i = 0; i < n; i += 2)
+    {
+      v = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(p + i)), z);
+      v = _mm_unpacklo_epi16(v, _mm_srli_si128(v, 8));
+      h = _mm_add_epi32(h, _mm_madd_epi16(v, f0r_remap_pair_sse2(wx + i)));
+    }
+  return _mm_srai_epi32(h, F0R_REMAP_HBITS);
+}
+
+F0R_REMAP_INLINE uint32_t f0r_remap_sse2(const f0r_remap_t* rm, const uint32_t* in,
+                                         const f0r_remap_entry_t* e, int n)
+{
+  const int16_t* wx = rm->weight[e->fx];
+  const int16_t* wy = rm->weight[e->fy];
+  const uint32_t* p = in + e->ofs - (n / 2 - 1) * (rm->wi + 1);
+  __m128i acc = _mm_setzero_si128(), h;
+  int j;
+
+  for (j = 0; j < n; j += 2)
+    {
+      h = _mm_packs_epi32(f0r_remap_hsum_sse2(p, wx, n),
+                          f0r_remap_hsum_sse2(p + rm->wi, wx, n));
+      h = _mm_unpacklo_epi16(h, _mm_srli_si128(h, 8));
+      acc = _mm_add_epi32(acc, _mm_madd_epi16(h, f0r_remap_pair_sse2(wy + j)));
+      p += 2 * rm->wi;
+    }
+  acc = _mm_srai_epi32(acc, F0R_REMAP_SHIFT);
+  acc = _mm_packs_epi32(acc, acc);
+  return (uint32_t)_mm_cvtsi128_si32(_mm_packus_epi16(acc, acc));
+}
+
+#endif
+
+/* ------------------------------------------------------------------------
+ * Bands of output rows, one function per kernel size
+ */
+
+typedef struct f0r_remap_job
+{
+  const f0r_remap_t* rm;
+  const uint32_t* in;
+  uint32_t* out;
+  uint32_t bgc;
+  int simd;
+} f0r_remap_job_t;
+
+F0R_REMAP_INLINE void f0r_remap_rows(const f0r_remap_job_t* job,
+                                     unsigned int first, unsigned int last, int n)
+{
+  const f0r_remap_t* rm = job->rm;
+  const f0r_remap_entry_t* e = rm->map + first * rm->wo;
+  const f0r_remap_entry_t* end = rm->map + last * rm->wo;
+  uint32_t* out = job->out + first * rm->wo;
+
+  for (; e < end; ++e, ++out)
+    {
+      if (e->flags & F0R_REMAP_BACKGROUND)
+        *out = job->bgc;
+      else if (n == 1)
+        *out = job->in[e->ofs];
+      else if (e->flags & F0R_REMAP_EDGE)
+        *out = f0r_remap_edge(rm, job->in, e, n);
+#if defined(F0R_HAVE_SSE2)
+      else if (job->simd)
+        *out = f0r_remap_sse2(rm, job->in, e, n);
+#endif
+      else
+        *out = f0r_remap_scalar(rm, job->in, e, n);
+    }
+}
+
+#define F0R_REMAP_BAND(n)                                               \
+static inline void f0r_remap_band_##n(void* arg, unsigned int band,     \
+                                      unsigned int first, unsigned int last) \
+{                                                                       \
+  (void)band;                                                           \
+  f0r_remap_rows((const f0r_remap_job_t*)arg, first, last, n);          \
+}
+
+F0R_REMAP_BAND(1)
+F0R_REMAP_BAND(2)
+F0R_REMAP_BAND(4)
+F0R_REMAP_BAND(6)
+F0R_REMAP_BAND(16)
+
+//! Resample the input frame in into out through the remap, filling
+//! background pixels with bgc.
+static inline void f0r_remap_run(const f0r_remap_t* rm, const uint32_t* in,
+                                 uint32_t* out, uint32_t bgc)
+{
+  f0r_remap_job_t job;
+  f0r_band_fn fn;
+
+  if (!rm->map)
+    return;
+  job.rm = rm;
+  job.in = in;
+  job.out = out;
+  job.bgc = bgc;
+  job.simd = f0r_simd_level() != F0R_SIMD_SCALAR;
+
+  switch (rm->taps)
+    {
+    case 2: fn = f0r_remap_band_2; break;
+    case 4: fn = f0r_remap_band_4; break;
+    case 6: fn = f0r_remap_band_6; break;
+    case 16: fn = f0r_remap_band_16; break;
+    default: fn = f0r_remap_band_1; break;
+    }
+  f0r_parallel_bands(0, rm->ho, f0r_thread_count(), fn, &job);
+}
+
+#endif
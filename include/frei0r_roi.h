@@ -0,0 +1,108 @@
+#ifndef INCLUDED_FREI0R_ROI_H
+#define INCLUDED_FREI0R_ROI_H
+
+/*
+  Rectangle helpers for effects implementing f0r_update_roi().
+
+  f0r_rect_intersect(a, b) is the part of a within b,
+  f0r_rect_union(a, b) the bounding box of both, where an empty
+  rectangle contributes nothing. f0r_rect_copy(in, out, width, r)
+  copies the pixels of r from one frame of the given width to another,
+  unless they are the same frame. f0r_rect_nonzero(frame, width, r) is
+  the bounding box of the pixels of r which are not 0 (transparent
+  black), i.e. of the part of a graphic which covers anything.
+*/
+
+#include <string.h>
+
+#include "frei0r.h"
+
+static inline int f0r_rect_empty(const f0r_rect_t* r)
+{
+  return r->width == 0 || r->height == 0;
+}
+
+static inline f0r_rect_t f0r_rect_make(unsigned int x, unsigned int y,
+                                       unsigned int width,
+                                       unsigned int height)
+{
+  f0r_rect_t r;
+  r.x = x;
+  r.y = y;
+  r.width = width;
+  r.height = height;
+  return r;
+}
+
+static inline f0r_rect_t f0r_rect_intersect(const f0r_rect_t* a,
+                                            const f0r_rect_t* b)
+{
+  unsigned int x0 = a->x > b->x ? a->x : b->x;
+  unsigned int y0 = a->y > b->y ? a->y : b->y;
+  unsigned int x1 = a->x + a->width < b->x + b->width ?
+    a->x + a->width : b->x + b->width;
+  unsigned int y1 = a->y + a->height < b->y + b->height ?
+    a->y + a->height : b->y + b->height;
+  if (x1 <= x0 || y1 <= y0)
+    return f0r_rect_make(x0, y0, 0, 0);
+  return f0r_rect_make(x0, y0, x1 - x0, y1 - y0);
+}
+
+static inline f0r_rect_t f0r_rect_union(const f0r_rect_t* a,
+                                        const f0r_rect_t* b)
+{
+  unsigned int x0, y0, x1, y1;
+  if (f0r_rect_empty(a))
+    return *b;
+  if (f0r_rect_empty(b))
+    return *a;
+  x0 = a->x < b->x ? a->x : b->x;
+  y0 = a->y < b->y ? a->y : b->y;
+  x1 = a->x + a->width > b->x + b->width ?
+    a->x + a->width : b->x + b->width;
+  y1 = a->y + a->height > b->y + b->height ?
+    a->y + a->height : b->y + b->height;
+  return f0r_rect_make(x0, y0, x1 - x0, y1 - y0);
+}
+
+static inline void f0r_rect_copy(const uint32_t* in, uint32_t* out,
+                                 unsigned int width, const f0r_rect_t* r)
+{
+  unsigned int y;
+  if (in == out)
+    return;
+  for (y = r->y; y < r->y + r->height; ++y)
+    memcpy(out + y * width + r->x, in + y * width + r->x,
+           r->width * sizeof(uint32_t));
+}
+
+static inline f0r_rect_t f0r_rect_nonzero(const uint32_t* frame,
+                                          unsigned int width,
+                                          const f0r_rect_t* r)
+{
+  unsigned int x0 = r->x + r->width, x1 = r->x;
+  unsigned int y0 = r->y + r->height, y1 = r->y;
+  unsigned int x, y;
+  for (y = r->y; y < r->y + r->height; ++y)
+    {
+      const uint32_t* row = frame + y * width;
+      for (x = r->x; x < r->x + r->width && !row[x]; ++x)
+        ;
+      if (x == r->x + r->width)
+        continue;
+      if (x < x0)
+        x0 = x;
+      /* only the part right of the box so far is left to look at */
+      for (x = r->x + r->width; x > x1 && !row[x - 1]; --x)
+        ;
+      x1 = x;
+      if (y < y0)
+        y0 = y;
+      y1 = y + 1;
+    }
+  if (x1 <= x0)
+    return f0r_rect_make(r->x, r->y, 0, 0);
+  return f0r_rect_make(x0, y0, x1 - x0, y1 - y0);
+}
+
+#endif
@@ -0,0 +1,685 @@
+#ifndef INCLUDED_FREI0R_SIMD_H
+#define INCLUDED_FREI0R_SIMD_H
+
+/*
+  Vectorised companion of frei0r_math.h for rows of RGBA8888 pixels.
+
+  f0r_rgba8_<op>(in1, in2, out, n) combines the colour channels of n
+  pixels of in1 and in2 with the layer mode <op> and sets the alpha of
+  out to the smaller alpha of the two inputs, which is what the mixer2
+  plugins do. The result is the same on every code path: SSE2 and AVX2
+  (chosen at run time) on x86, NEON on aarch64 and a scalar fallback
+  built on the frei0r_math.h macros. out may be the same as in1 or in2.
+
+  Setting the environment variable FREI0R_SIMD to "scalar" or "sse2"
+  limits the code path which is used, e.g. to compare results.
+
+  Layer modes: multiply, screen, overlay, softlight, hardlight, burn,
+  dodge, grain_extract, grain_merge.
+
+  f0r_v4f and the f0r_v4f_<op>() functions are four float lanes for
+  filters working on float pixels, e.g. the IIR blurs.
+*/
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "frei0r_math.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define F0R_HAVE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(F0R_HAVE_SSE2) && (defined(__clang__) || \
+    (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+#define F0R_HAVE_AVX2 1
+#include <immintrin.h>
+#define F0R_AVX2 static inline __attribute__((target("avx2")))
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#define F0R_HAVE_NEON 1
+#include <arm_neon.h>
+#endif
+
+#define F0R_SIMD_SCALAR 0
+#define F0R_SIMD_SSE2 1
+#define F0R_SIMD_AVX2 2
+#define F0R_SIMD_NEON 3
+
+/* vector type and function qualifier of each code path, for code
+   written once for all of them */
+#define F0R_VEC_sse2 __m128i
+#define F0R_FN_sse2 static inline
+#define F0R_VEC_avx2 __m256i
+#define F0R_FN_avx2 F0R_AVX2
+#define F0R_VEC_neon int16x8_t
+#define F0R_FN_neon static inline
+
+static inline int f0r_simd_level_uncached()
+{
+  const char* env = getenv("FREI0R_SIMD");
+  int best = F0R_SIMD_SCALAR;
+#if defined(F0R_HAVE_NEON)
+  best = F0R_SIMD_NEON;
+#endif
+#if defined(F0R_HAVE_SSE2)
+  best = F0R_SIMD_SSE2;
+#endif
+#if defined(F0R_HAVE_AVX2)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    best = F0R_SIMD_AVX2;
+#endif
+  if (env && !strcmp(env, "scalar"))
+    best = F0R_SIMD_SCALAR;
+  else if (env && !strcmp(env, "sse2") && best == F0R_SIMD_AVX2)
+    best = F0R_SIMD_SSE2;
+  return best;
+}
+
+#if !defined(_WIN32) && defined(__GNUC__)
+#include <pthread.h>
+
+/* found once, the rows are run on the threads of frei0r_thread.h */
+static pthread_once_t f0r_simd_once = PTHREAD_ONCE_INIT;
+static int f0r_simd_best;
+
+static void f0r_simd_init()
+{
+  f0r_simd_best = f0r_simd_level_uncached();
+}
+
+//! The best code path supported by this CPU.
+static inline int f0r_simd_level()
+{
+  pthread_once(&f0r_simd_once, f0r_simd_init);
+  return f0r_simd_best;
+}
+#else
+//! The best code path supported by this CPU.
+static inline int f0r_simd_level()
+{
+  return f0r_simd_level_uncached();
+}
+#endif
+
+/* ------------------------------------------------------------------------
+ * scalar layer modes on one channel
+ */
+
+static inline uint32_t f0r_mul255(uint32_t a, uint32_t b)
+{
+  uint32_t t;
+  return INT_MULT(a, b, t);
+}
+
+static inline uint8_t f0r_px_multiply(uint32_t a, uint32_t b)
+{
+  return f0r_mul255(a, b);
+}
+
+static inline uint8_t f0r_px_screen(uint32_t a, uint32_t b)
+{
+  return 255 - f0r_mul255(255 - a, 255 - b);
+}
+
+static inline uint8_t f0r_px_overlay(uint32_t a, uint32_t b)
+{
+  return f0r_mul255(a, a + f0r_mul255(2 * b, 255 - a));
+}
+
+static inline uint8_t f0r_px_softlight(uint32_t a, uint32_t b)
+{
+  /* Mix multiply and screen */
+  return f0r_mul255(255 - a, f0r_px_multiply(a, b))
+    + f0r_mul255(a, f0r_px_screen(a, b));
+}
+
+static inline uint8_t f0r_px_hardlight(uint32_t a, uint32_t b)
+{
+  if (b > 128)
+    return 255 - (((255 - a) * (255 - ((b - 128) << 1))) >> 8);
+  return (a * (b << 1)) >> 8;
+}
+
+static inline uint8_t f0r_px_burn(uint32_t a, uint32_t b)
+{
+  uint32_t tmp = ((255 - a) << 8) / (b + 1);
+  return tmp > 255 ? 0 : 255 - tmp;
+}
+
+static inline uint8_t f0r_px_dodge(uint32_t a, uint32_t b)
+{
+  uint32_t tmp = (a << 8) / (256 - b);
+  return tmp > 255 ? 255 : tmp;
+}
+
+static inline uint8_t f0r_px_grain_extract(uint32_t a, uint32_t b)
+{
+  return CLAMP0255((int32_t)a - (int32_t)b + 128);
+}
+
+static inline uint8_t f0r_px_grain_merge(uint32_t a, uint32_t b)
+{
+  return CLAMP0255((int32_t)a + (int32_t)b - 128);
+}
+
+/* ------------------------------------------------------------------------
+ * vector layer modes on 16 bit lanes holding one channel each
+ *
+ * Written once in terms of the helpers f0r_<helper>_<isa> below.
+ */
+
+#define F0R_V_multiply(P, a, b) f0r_mul255_##P(a, b)
+
+#define F0R_V_screen(P, a, b)                                   \
+  f0r_sub_##P(f0r_set_##P(255),                                 \
+              f0r_mul255_##P(f0r_sub_##P(f0r_set_##P(255), a),  \
+                             f0r_sub_##P(f0r_set_##P(255), b)))
+
+#define F0R_V_overlay(P, a, b)                                          \
+  f0r_mul255w_##P(a, f0r_add_##P(a, f0r_mul255w_##P(f0r_add_##P(b, b),  \
+                                                    f0r_sub_##P(f0r_set_##P(255), a))))
+
+#define F0R_V_softlight(P, a, b)                                        \
+  f0r_add_##P(f0r_mul255_##P(f0r_sub_##P(f0r_set_##P(255), a),          \
+                             F0R_V_multiply(P, a, b)),                  \
+              f0r_mul255_##P(a, F0R_V_screen(P, a, b)))
+
+#define F0R_V_hardlight(P, a, b)                                        \
+  f0r_select_##P(f0r_gt_##P(b, f0r_set_##P(128)),                       \
+                 f0r_sub_##P(f0r_set_##P(255),                          \
+                             f0r_shr8_##P(f0r_mul_##P(f0r_sub_##P(f0r_set_##P(255), a), \
+                                                      f0r_sub_##P(f0r_set_##P(511), f0r_add_##P(b, b))))), \
+                 f0r_shr8_##P(f0r_mul_##P(a, f0r_add_##P(b, b))))
+
+#define F0R_V_burn(P, a, b)                                             \
+  f0r_sub_##P(f0r_set_##P(255),                                         \
+              f0r_divsat_##P(f0r_shl8_##P(f0r_sub_##P(f0r_set_##P(255), a)), \
+                             f0r_add_##P(b, f0r_set_##P(1))))
+
+#define F0R_V_dodge(P, a, b)                                            \
+  f0r_divsat_##P(f0r_shl8_##P(a), f0r_sub_##P(f0r_set_##P(256), b))
+
+/* results are saturated to 0..255 when packing */
+#define F0R_V_grain_extract(P, a, b)                                    \
+  f0r_add_##P(f0r_sub_##P(a, b), f0r_set_##P(128))
+
+#define F0R_V_grain_merge(P, a, b)                                      \
+  f0r_sub_##P(f0r_add_##P(a, b), f0r_set_##P(128))
+
+/* ------------------------------------------------------------------------
+ * SSE2
+ */
+
+#if defined(F0R_HAVE_SSE2)
+
+static inline __m128i f0r_set_sse2(short x) { return _mm_set1_epi16(x); }
+static inline __m128i f0r_add_sse2(__m128i a, __m128i b) { return _mm_add_epi16(a, b); }
+static inline __m128i f0r_sub_sse2(__m128i a, __m128i b) { return _mm_sub_epi16(a, b); }
+static inline __m128i f0r_mul_sse2(__m128i a, __m128i b) { return _mm_mullo_epi16(a, b); }
+static inline __m128i f0r_shr8_sse2(__m128i a) { return _mm_srli_epi16(a, 8); }
+static inline __m128i f0r_shl8_sse2(__m128i a) { return _mm_slli_epi16(a, 8); }
+static inline __m128i f0r_gt_sse2(__m128i a, __m128i b) { return _mm_cmpgt_epi16(a, b); }
+static inline __m128i f0r_min_sse2(__m128i a, __m128i b) { return _mm_min_epi16(a, b); }
+
+//! The alpha of each pixel in all four of its lanes
+static inline __m128i f0r_alpha_sse2(__m128i a)
+{
+  return _mm_shufflehi_epi16(_mm_shufflelo_epi16(a, 0xff), 0xff);
+}
+
+//! All ones in the alpha lanes
+static inline __m128i f0r_alphamask_sse2()
+{
+  return _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+}
+
+static inline __m128i f0r_select_sse2(__m128i m, __m128i a, __m128i b)
+{
+  return _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b));
+}
+
+//! INT_MULT for a * b < 65536
+static inline __m128i f0r_mul255_sse2(__m128i a, __m128i b)
+{
+  __m128i t = _mm_add_epi16(_mm_mullo_epi16(a, b), _mm_set1_epi16(0x80));
+  return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+static inline __m128i f0r_mul255w_half_sse2(__m128i p)
+{
+  __m128i t = _mm_add_epi32(p, _mm_set1_epi32(0x80));
+  return _mm_srli_epi32(_mm_add_epi32(t, _mm_srli_epi32(t, 8)), 8);
+}
+
+//! INT_MULT for larger products, computed on 32 bits
+static inline __m128i f0r_mul255w_sse2(__m128i a, __m128i b)
+{
+  __m128i lo = _mm_mullo_epi16(a, b);
+  __m128i hi = _mm_mulhi_epu16(a, b);
+  return _mm_packs_epi32(f0r_mul255w_half_sse2(_mm_unpacklo_epi16(lo, hi)),
+                         f0r_mul255w_half_sse2(_mm_unpackhi_epi16(lo, hi)));
+}
+
+//! Unsigned n / d limited to 255. The float quotient is exact enough
+//! for n < 65536 and d <= 256 to truncate to the integer quotient.
+static inline __m128i f0r_divsat_sse2(__m128i n, __m128i d)
+{
+  const __m128i zero = _mm_setzero_si128();
+  __m128i q0 = _mm_cvttps_epi32(_mm_div_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(n, zero)),
+                                           _mm_cvtepi32_ps(_mm_unpacklo_epi16(d, zero))));
+  __m128i q1 = _mm_cvttps_epi32(_mm_div_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(n, zero)),
+                                           _mm_cvtepi32_ps(_mm_unpackhi_epi16(d, zero))));
+  return _mm_min_epi16(_mm_packs_epi32(q0, q1), _mm_set1_epi16(255));
+}
+
+#define F0R_KERNEL_SSE2(name)                                           \
+static inline void f0r_rgba8_##name##_sse2(const uint8_t* s1,           \
+                                           const uint8_t* s2,           \
+                                           uint8_t* d, unsigned int n)  \
+{                                                                       \
+  const __m128i zero = _mm_setzero_si128();                             \
+  const __m128i alpha = _mm_set1_epi32((int)0xff000000);                \
+  for (; n >= 4; n -= 4, s1 += 16, s2 += 16, d += 16)                   \
+    {                                                                   \
+      __m128i a = _mm_loadu_si128((const __m128i*)s1);                  \
+      __m128i b = _mm_loadu_si128((const __m128i*)s2);                  \
+      __m128i lo = F0R_V_##name(sse2, _mm_unpacklo_epi8(a, zero),       \
+                                _mm_unpacklo_epi8(b, zero));            \
+      __m128i hi = F0R_V_##name(sse2, _mm_unpackhi_epi8(a, zero),       \
+                                _mm_unpackhi_epi8(b, zero));            \
+      _mm_storeu_si128((__m128i*)d,                                     \
+                       f0r_select_sse2(alpha, _mm_min_epu8(a, b),       \
+                                       _mm_packus_epi16(lo, hi)));      \
+    }                                                                   \
+  f0r_rgba8_##name##_scalar(s1, s2, d, n);                              \
+}
+
+#else
+#define F0R_KERNEL_SSE2(name)
+#endif
+
+/* ------------------------------------------------------------------------
+ * AVX2, same as SSE2 on twice the width
+ */
+
+#if defined(F0R_HAVE_AVX2)
+
+F0R_AVX2 __m256i f0r_set_avx2(short x) { return _mm256_set1_epi16(x); }
+F0R_AVX2 __m256i f0r_add_avx2(__m256i a, __m256i b) { return _mm256_add_epi16(a, b); }
+F0R_AVX2 __m256i f0r_sub_avx2(__m256i a, __m256i b) { return _mm256_sub_epi16(a, b); }
+F0R_AVX2 __m256i f0r_mul_avx2(__m256i a, __m256i b) { return _mm256_mullo_epi16(a, b); }
+F0R_AVX2 __m256i f0r_shr8_avx2(__m256i a) { return _mm256_srli_epi16(a, 8); }
+F0R_AVX2 __m256i f0r_shl8_avx2(__m256i a) { return _mm256_slli_epi16(a, 8); }
+F0R_AVX2 __m256i f0r_gt_avx2(__m256i a, __m256i b) { return _mm256_cmpgt_epi16(a, b); }
+F0R_AVX2 __m256i f0r_min_avx2(__m256i a, __m256i b) { return _mm256_min_epi16(a, b); }
+
+F0R_AVX2 __m256i f0r_alpha_avx2(__m256i a)
+{
+  return _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(a, 0xff), 0xff);
+}
+
+F0R_AVX2 __m256i f0r_alphamask_avx2()
+{
+  return _mm256_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0);
+}
+
+F0R_AVX2 __m256i f0r_select_avx2(__m256i m, __m256i a, __m256i b)
+{
+  return _mm256_blendv_epi8(b, a, m);
+}
+
+F0R_AVX2 __m256i f0r_mul255_avx2(__m256i a, __m256i b)
+{
+  __m256i t = _mm256_add_epi16(_mm256_mullo_epi16(a, b), _mm256_set1_epi16(0x80));
+  return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+F0R_AVX2 __m256i f0r_mul255w_half_avx2(__m256i p)
+{
+  __m256i t = _mm256_add_epi32(p, _mm256_set1_epi32(0x80));
+  return _mm256_srli_epi32(_mm256_add_epi32(t, _mm256_srli_epi32(t, 8)), 8);
+}
+
+F0R_AVX2 __m256i f0r_mul255w_avx2(__m256i a, __m256i b)
+{
+  __m256i lo = _mm256_mullo_epi16(a, b);
+  __m256i hi = _mm256_mulhi_epu16(a, b);
+  return _mm256_packs_epi32(f0r_mul255w_half_avx2(_mm256_unpacklo_epi16(lo, hi)),
+                            f0r_mul255w_half_avx2(_mm256_unpackhi_epi16(lo, hi)));
+}
+
+F0R_AVX2 __m256i f0r_divsat_avx2(__m256i n, __m256i d)
+{
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i q0 = _mm256_cvttps_epi32(_mm256_div_ps(_mm256_cvtepi32_ps(_mm256_unpacklo_epi16(n, zero)),
+                                                 _mm256_cvtepi32_ps(_mm256_unpacklo_epi16(d, zero))));
+  __m256i q1 = _mm256_cvttps_epi32(_mm256_div_ps(_mm256_cvtepi32_ps(_mm256_unpackhi_epi16(n, zero)),
+                                                 _mm256_cvtepi32_ps(_mm256_unpackhi_epi16(d, zero))));
+  return _mm256_min_epi16(_mm256_packs_epi32(q0, q1), _mm256_set1_epi16(255));
+}
+
+/* unpack and pack work within 128 bit lanes, so the pixel order is kept */
+#define F0R_KERNEL_AVX2(name)                                           \
+F0R_AVX2 void f0r_rgba8_##name##_avx2(const uint8_t* s1,                \
+                                      const uint8_t* s2,                \
+                                      uint8_t* d, unsigned int n)       \
+{                                                                       \
+  const __m256i zero = _mm256_setzero_si256();                          \
+  const __m256i alpha = _mm256_set1_epi32((int)0xff000000);             \
+  for (; n >= 8; n -= 8, s1 += 32, s2 += 32, d += 32)                   \
+    {                                                                   \
+      __m256i a = _mm256_loadu_si256((const __m256i*)s1);               \
+      __m256i b = _mm256_loadu_si256((const __m256i*)s2);               \
+      __m256i lo = F0R_V_##name(avx2, _mm256_unpacklo_epi8(a, zero),    \
+                                _mm256_unpacklo_epi8(b, zero));         \
+      __m256i hi = F0R_V_##name(avx2, _mm256_unpackhi_epi8(a, zero),    \
+                                _mm256_unpackhi_epi8(b, zero));         \
+      _mm256_storeu_si256((__m256i*)d,                                  \
+                          _mm256_blendv_epi8(_mm256_packus_epi16(lo, hi), \
+                                             _mm256_min_epu8(a, b), alpha)); \
+    }                                                                   \
+  f0r_rgba8_##name##_scalar(s1, s2, d, n);                              \
+}
+
+#else
+#define F0R_KERNEL_AVX2(name)
+#endif
+
+/* ------------------------------------------------------------------------
+ * NEON (aarch64), lanes are kept signed for the saturating pack
+ */
+
+#if defined(F0R_HAVE_NEON)
+
+static inline int16x8_t f0r_set_neon(short x) { return vdupq_n_s16(x); }
+static inline int16x8_t f0r_add_neon(int16x8_t a, int16x8_t b) { return vaddq_s16(a, b); }
+static inline int16x8_t f0r_sub_neon(int16x8_t a, int16x8_t b) { return vsubq_s16(a, b); }
+static inline int16x8_t f0r_mul_neon(int16x8_t a, int16x8_t b) { return vmulq_s16(a, b); }
+static inline int16x8_t f0r_shl8_neon(int16x8_t a) { return vshlq_n_s16(a, 8); }
+static inline int16x8_t f0r_min_neon(int16x8_t a, int16x8_t b) { return vminq_s16(a, b); }
+
+static inline int16x8_t f0r_alpha_neon(int16x8_t a)
+{
+  return vcombine_s16(vdup_lane_s16(vget_low_s16(a), 3),
+                      vdup_lane_s16(vget_high_s16(a), 3));
+}
+
+static inline int16x8_t f0r_alphamask_neon()
+{
+  int16x4_t m = vreinterpret_s16_u64(vcreate_u64(0xffff000000000000ULL));
+  return vcombine_s16(m, m);
+}
+
+static inline int16x8_t f0r_shr8_neon(int16x8_t a)
+{
+  return vreinterpretq_s16_u16(vshrq_n_u16(vreinterpretq_u16_s16(a), 8));
+}
+
+static inline int16x8_t f0r_gt_neon(int16x8_t a, int16x8_t b)
+{
+  return vreinterpretq_s16_u16(vcgtq_s16(a, b));
+}
+
+static inline int16x8_t f0r_select_neon(int16x8_t m, int16x8_t a, int16x8_t b)
+{
+  return vbslq_s16(vreinterpretq_u16_s16(m), a, b);
+}
+
+static inline int16x8_t f0r_mul255_neon(int16x8_t a, int16x8_t b)
+{
+  uint16x8_t t = vaddq_u16(vreinterpretq_u16_s16(vmulq_s16(a, b)), vdupq_n_u16(0x80));
+  return vreinterpretq_s16_u16(vshrq_n_u16(vaddq_u16(t, vshrq_n_u16(t, 8)), 8));
+}
+
+static inline uint32x4_t f0r_mul255w_half_neon(uint32x4_t p)
+{
+  uint32x4_t t = vaddq_u32(p, vdupq_n_u32(0x80));
+  return vshrq_n_u32(vaddq_u32(t, vshrq_n_u32(t, 8)), 8);
+}
+
+static inline int16x8_t f0r_mul255w_neon(int16x8_t a, int16x8_t b)
+{
+  uint16x8_t ua = vreinterpretq_u16_s16(a), ub = vreinterpretq_u16_s16(b);
+  uint32x4_t lo = f0r_mul255w_half_neon(vmull_u16(vget_low_u16(ua), vget_low_u16(ub)));
+  uint32x4_t hi = f0r_mul255w_half_neon(vmull_u16(vget_high_u16(ua), vget_high_u16(ub)));
+  return vreinterpretq_s16_u16(vcombine_u16(vmovn_u32(lo), vmovn_u32(hi)));
+}
+
+static inline int16x8_t f0r_divsat_neon(int16x8_t n, int16x8_t d)
+{
+  uint16x8_t un = vreinterpretq_u16_s16(n), ud = vreinterpretq_u16_s16(d);
+  uint32x4_t q0 = vcvtq_u32_f32(vdivq_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(un))),
+                                          vcvtq_f32_u32(vmovl_u16(vget_low_u16(ud)))));
+  uint32x4_t q1 = vcvtq_u32_f32(vdivq_f32(vcvtq_f32_u32(vmovl_u16(vget_high_u16(un))),
+                                          vcvtq_f32_u32(vmovl_u16(vget_high_u16(ud)))));
+  uint16x8_t q = vcombine_u16(vqmovn_u32(q0), vqmovn_u32(q1));
+  return vreinterpretq_s16_u16(vminq_u16(q, vdupq_n_u16(255)));
+}
+
+#define F0R_KERNEL_NEON(name)                                           \
+static inline void f0r_rgba8_##name##_neon(const uint8_t* s1,           \
+                                           const uint8_t* s2,           \
+                                           uint8_t* d, unsigned int n)  \
+{                                                                       \
+  const uint8x16_t alpha = vreinterpretq_u8_u32(vdupq_n_u32(0xff000000)); \
+  for (; n >= 4; n -= 4, s1 += 16, s2 += 16, d += 16)                   \
+    {                                                                   \
+      uint8x16_t a = vld1q_u8(s1);                                      \
+      uint8x16_t b = vld1q_u8(s2);                                      \
+      int16x8_t lo = F0R_V_##name(neon,                                 \
+                                  vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(a))), \
+                                  vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(b)))); \
+      int16x8_t hi = F0R_V_##name(neon,                                 \
+                                  vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(a))), \
+                                  vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(b)))); \
+      vst1q_u8(d, vbslq_u8(alpha, vminq_u8(a, b),                       \
+                           vcombine_u8(vqmovun_s16(lo), vqmovun_s16(hi)))); \
+    }                                                                   \
+  f0r_rgba8_##name##_scalar(s1, s2, d, n);                              \
+}
+
+#else
+#define F0R_KERNEL_NEON(name)
+#endif
+
+/* ------------------------------------------------------------------------
+ * row functions
+ */
+
+#if defined(F0R_HAVE_AVX2)
+#define F0R_DISPATCH_AVX2(name)                                         \
+    case F0R_SIMD_AVX2: f0r_rgba8_##name##_avx2(s1, s2, d, n); return;
+#else
+#define F0R_DISPATCH_AVX2(name)
+#endif
+#if defined(F0R_HAVE_SSE2)
+#define F0R_DISPATCH_SSE2(name)                                         \
+    case F0R_SIMD_SSE2: f0r_rgba8_##name##_sse2(s1, s2, d, n); return;
+#else
+#define F0R_DISPATCH_SSE2(name)
+#endif
+#if defined(F0R_HAVE_NEON)
+#define F0R_DISPATCH_NEON(name)                                         \
+    case F0R_SIMD_NEON: f0r_rgba8_##name##_neon(s1, s2, d, n); return;
+#else
+#define F0R_DISPATCH_NEON(name)
+#endif
+
+#define F0R_RGBA8_MODE(name)                                            \
+static inline void f0r_rgba8_##name##_scalar(const uint8_t* s1,         \
+                                             const uint8_t* s2,         \
+                                             uint8_t* d, unsigned int n) \
+{                                                                       \
+  for (; n; --n, s1 += 4, s2 += 4, d += 4)                              \
+    {                                                                   \
+      d[0] = f0r_px_##name(s1[0], s2[0]);                               \
+      d[1] = f0r_px_##name(s1[1], s2[1]);                               \
+      d[2] = f0r_px_##name(s1[2], s2[2]);                               \
+      d[3] = s1[3] < s2[3] ? s1[3] : s2[3];                             \
+    }                                                                   \
+}                                                                       \
+F0R_KERNEL_SSE2(name)                                                   \
+F0R_KERNEL_AVX2(name)                                                   \
+F0R_KERNEL_NEON(name)                                                   \
+static inline void f0r_rgba8_##name(const uint32_t* in1,                \
+                                    const uint32_t* in2,                \
+                                    uint32_t* out, unsigned int n)      \
+{                                                                       \
+  const uint8_t* s1 = (const uint8_t*)in1;                              \
+  const uint8_t* s2 = (const uint8_t*)in2;                              \
+  uint8_t* d = (uint8_t*)out;                                           \
+  switch (f0r_simd_level())                                             \
+    {                                                                   \
+    F0R_DISPATCH_AVX2(name)                                             \
+    F0R_DISPATCH_SSE2(name)                                             \
+    F0R_DISPATCH_NEON(name)                                             \
+    default: break;                                                     \
+    }                                                                   \
+  f0r_rgba8_##name##_scalar(s1, s2, d, n);                              \
+}
+
+F0R_RGBA8_MODE(multiply)
+F0R_RGBA8_MODE(screen)
+F0R_RGBA8_MODE(overlay)
+F0R_RGBA8_MODE(softlight)
+F0R_RGBA8_MODE(hardlight)
+F0R_RGBA8_MODE(burn)
+F0R_RGBA8_MODE(dodge)
+F0R_RGBA8_MODE(grain_extract)
+F0R_RGBA8_MODE(grain_merge)
+
+/* ------------------------------------------------------------------------
+ * four float lanes
+ *
+ * f0r_v4f holds one pixel of float channels or four neighbouring float
+ * samples. It is picked at compile time: SSE on x86, NEON on aarch64, a
+ * struct elsewhere. Each operation rounds like the same scalar float
+ * operation, so recursive filters keep their exact results.
+ */
+
+#if defined(F0R_HAVE_SSE2)
+
+typedef __m128 f0r_v4f;
+
+static inline f0r_v4f f0r_v4f_load(const float* p) { return _mm_loadu_ps(p); }
+static inline void f0r_v4f_store(float* p, f0r_v4f a) { _mm_storeu_ps(p, a); }
+static inline f0r_v4f f0r_v4f_set1(float x) { return _mm_set1_ps(x); }
+static inline f0r_v4f f0r_v4f_add(f0r_v4f a, f0r_v4f b) { return _mm_add_ps(a, b); }
+static inline f0r_v4f f0r_v4f_sub(f0r_v4f a, f0r_v4f b) { return _mm_sub_ps(a, b); }
+static inline f0r_v4f f0r_v4f_mul(f0r_v4f a, f0r_v4f b) { return _mm_mul_ps(a, b); }
+static inline f0r_v4f f0r_v4f_div(f0r_v4f a, f0r_v4f b) { return _mm_div_ps(a, b); }
+static inline f0r_v4f f0r_v4f_min(f0r_v4f a, f0r_v4f b) { return _mm_min_ps(a, b); }
+static inline f0r_v4f f0r_v4f_max(f0r_v4f a, f0r_v4f b) { return _mm_max_ps(a, b); }
+
+//! The colour channels of a RGBA8888 pixel, with 0 for alpha.
+static inline f0r_v4f f0r_v4f_from_rgb8(uint32_t px)
+{
+  __m128i z = _mm_setzero_si128();
+  __m128i v = _mm_cvtsi32_si128((int)(px & 0xFFFFFF));
+  return _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(v, z), z));
+}
+
+//! A RGBA8888 pixel with alpha 0, truncating and wrapping each channel
+//! like (uint32_t)x & 0xFF.
+static inline uint32_t f0r_v4f_to_rgb8(f0r_v4f a)
+{
+  __m128i v = _mm_and_si128(_mm_cvttps_epi32(a),
+                            _mm_set_epi32(0, 0xFF, 0xFF, 0xFF));
+  v = _mm_packs_epi32(v, v);
+  return (uint32_t)_mm_cvtsi128_si32(_mm_packus_epi16(v, v));
+}
+
+#elif defined(F0R_HAVE_NEON)
+
+typedef float32x4_t f0r_v4f;
+
+static inline f0r_v4f f0r_v4f_load(const float* p) { return vld1q_f32(p); }
+static inline void f0r_v4f_store(float* p, f0r_v4f a) { vst1q_f32(p, a); }
+static inline f0r_v4f f0r_v4f_set1(float x) { return vdupq_n_f32(x); }
+static inline f0r_v4f f0r_v4f_add(f0r_v4f a, f0r_v4f b) { return vaddq_f32(a, b); }
+static inline f0r_v4f f0r_v4f_sub(f0r_v4f a, f0r_v4f b) { return vsubq_f32(a, b); }
+static inline f0r_v4f f0r_v4f_mul(f0r_v4f a, f0r_v4f b) { return vmulq_f32(a, b); }
+static inline f0r_v4f f0r_v4f_div(f0r_v4f a, f0r_v4f b) { return vdivq_f32(a, b); }
+static inline f0r_v4f f0r_v4f_min(f0r_v4f a, f0r_v4f b) { return vminq_f32(a, b); }
+static inline f0r_v4f f0r_v4f_max(f0r_v4f a, f0r_v4f b) { return vmaxq_f32(a, b); }
+
+static inline f0r_v4f f0r_v4f_from_rgb8(uint32_t px)
+{
+  uint8x8_t v = vcreate_u8(px & 0xFFFFFF);
+  return vcvtq_f32_u32(vmovl_u16(vget_low_u16(vmovl_u8(v))));
+}
+
+static inline uint32_t f0r_v4f_to_rgb8(f0r_v4f a)
+{
+  static const int32_t mask[4] = { 0xFF, 0xFF, 0xFF, 0 };
+  int32x4_t v = vandq_s32(vcvtq_s32_f32(a), vld1q_s32(mask));
+  uint8x8_t b = vmovn_u16(vcombine_u16(vmovn_u32(vreinterpretq_u32_s32(v)),
+                                       vcreate_u16(0)));
+  return vget_lane_u32(vreinterpret_u32_u8(b), 0);
+}
+
+#else
+
+typedef struct { float v[4]; } f0r_v4f;
+
+#define F0R_V4F_OP(name, expr)                                          \
+static inline f0r_v4f f0r_v4f_##name(f0r_v4f a, f0r_v4f b)              \
+{                                                                       \
+  f0r_v4f r;                                                            \
+  int i;                                                                \
+  for (i = 0; i < 4; ++i)                                               \
+    r.v[i] = expr;                                                      \
+  return r;                                                             \
+}
+
+F0R_V4F_OP(add, a.v[i] + b.v[i])
+F0R_V4F_OP(sub, a.v[i] - b.v[i])
+F0R_V4F_OP(mul, a.v[i] * b.v[i])
+F0R_V4F_OP(div, a.v[i] / b.v[i])
+F0R_V4F_OP(min, a.v[i] < b.v[i] ? a.v[i] : b.v[i])
+F0R_V4F_OP(max, a.v[i] > b.v[i] ? a.v[i] : b.v[i])
+
+static inline f0r_v4f f0r_v4f_load(const float* p)
+{
+  f0r_v4f r;
+  memcpy(r.v, p, sizeof(r.v));
+  return r;
+}
+
+static inline void f0r_v4f_store(float* p, f0r_v4f a)
+{
+  memcpy(p, a.v, sizeof(a.v));
+}
+
+static inline f0r_v4f f0r_v4f_set1(float x)
+{
+  f0r_v4f r;
+  r.v[0] = r.v[1] = r.v[2] = r.v[3] = x;
+  return r;
+}
+
+static inline f0r_v4f f0r_v4f_from_rgb8(uint32_t px)
+{
+  f0r_v4f r;
+  r.v[0] = (float)(px & 0xFF);
+  r.v[1] = (float)((px >> 8) & 0xFF);
+  r.v[2] = (float)((px >> 16) & 0xFF);
+  r.v[3] = 0.0f;
+  return r;
+}
+
+static inline uint32_t f0r_v4f_to_rgb8(f0r_v4f a)
+{
+  return ((uint32_t)(int32_t)a.v[0] & 0xFF)
+    | (((uint32_t)(int32_t)a.v[1] & 0xFF) << 8)
+    | (((uint32_t)(int32_t)a.v[2] & 0xFF) << 16);
+}
+
+#endif
+
+#endif
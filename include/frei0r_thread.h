@@ -0,0 +1,236 @@
+#ifndef INCLUDED_FREI0R_THREAD_H
+#define INCLUDED_FREI0R_THREAD_H
+
+/*
+  Row band threading for plugins written in C. frei0r::fx::parallel_rows()
+  of frei0r.hpp runs on the same pool.
+
+  f0r_parallel_bands(begin, end, bands, fn, arg) splits [begin, end) into
+  at most bands consecutive bands and calls fn(arg, band, first, last)
+  for each of them, on the calling thread and the threads of a pool. It
+  returns when all bands are done. band numbers the bands from 0, e.g.
+  to pick scratch memory.
+
+  The pool is shared by all instances of the plugin. Its threads are
+  started by the first call and joined when the plugin is unloaded. A
+  call from a thread of the pool (from within a band), or while the pool
+  runs the bands of another thread (e.g. of another slice of
+  f0r_update_slice), runs all its bands on the calling thread, so nested
+  and concurrent calls do not multiply the threads.
+
+  The number of threads is taken from FREI0R_THREADS, or else from the
+  number of online processors, once. Without POSIX threads and GCC
+  compatible thread-local storage all bands run on the calling thread.
+*/
+
+#include <stdlib.h>
+
+#if !defined(_WIN32) && defined(__GNUC__)
+#define F0R_HAVE_PTHREAD 1
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#define F0R_MAX_THREADS 64
+
+typedef void (*f0r_band_fn)(void* arg, unsigned int band,
+                            unsigned int first, unsigned int last);
+
+static inline unsigned int f0r_thread_count_uncached()
+{
+  const char* env = getenv("FREI0R_THREADS");
+  long n = env ? atol(env) : 0;
+#if defined(F0R_HAVE_PTHREAD) && defined(_SC_NPROCESSORS_ONLN)
+  if (n <= 0)
+    n = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+  if (n <= 0)
+    n = 1;
+  return n > F0R_MAX_THREADS ? F0R_MAX_THREADS : (unsigned int)n;
+}
+
+typedef struct f0r_band
+{
+  f0r_band_fn fn;
+  void* arg;
+  unsigned int band, first, last;
+} f0r_band_t;
+
+static inline void f0r_band_run(f0r_band_t* b)
+{
+  b->fn(b->arg, b->band, b->first, b->last);
+}
+
+#if defined(F0R_HAVE_PTHREAD)
+
+typedef struct f0r_pool
+{
+  pthread_mutex_t run;   /* held by the thread owning the current job */
+  pthread_mutex_t mutex; /* protects the fields below */
+  pthread_cond_t wake;
+  pthread_cond_t done;
+  pthread_once_t once;
+  unsigned int count;    /* f0r_thread_count() */
+  int started;
+  unsigned int workers;
+  pthread_t worker[F0R_MAX_THREADS];
+  unsigned long generation;
+  unsigned int busy;     /* workers not done with the current job */
+  int quit;
+  f0r_band_t band[F0R_MAX_THREADS];
+  unsigned int bands, next; /* of the current job */
+} f0r_pool_t;
+
+static f0r_pool_t f0r_pool = { PTHREAD_MUTEX_INITIALIZER,
+                               PTHREAD_MUTEX_INITIALIZER,
+                               PTHREAD_COND_INITIALIZER,
+                               PTHREAD_COND_INITIALIZER,
+                               PTHREAD_ONCE_INIT,
+                               0, 0, 0, { 0 }, 0, 0, 0, { { 0, 0, 0, 0, 0 } },
+                               0, 0 };
+
+/* set on the threads of the pool and while a thread runs its own bands */
+static __thread int f0r_pool_serial;
+
+static void f0r_pool_count()
+{
+  f0r_pool.count = f0r_thread_count_uncached();
+}
+
+//! The number of threads to split work over.
+static inline unsigned int f0r_thread_count()
+{
+  pthread_once(&f0r_pool.once, f0r_pool_count);
+  return f0r_pool.count;
+}
+
+/* Runs the bands of the current job left, with f0r_pool.mutex held. */
+static inline void f0r_pool_work()
+{
+  while (f0r_pool.next < f0r_pool.bands)
+    {
+      f0r_band_t* b = &f0r_pool.band[f0r_pool.next++];
+      pthread_mutex_unlock(&f0r_pool.mutex);
+      f0r_band_run(b);
+      pthread_mutex_lock(&f0r_pool.mutex);
+    }
+}
+
+static void* f0r_pool_loop(void* p)
+{
+  unsigned long seen = 0;
+  (void)p;
+  f0r_pool_serial = 1;
+  pthread_mutex_lock(&f0r_pool.mutex);
+  for (;;)
+    {
+      while (!f0r_pool.quit && f0r_pool.generation == seen)
+        pthread_cond_wait(&f0r_pool.wake, &f0r_pool.mutex);
+      if (f0r_pool.quit)
+        break;
+      seen = f0r_pool.generation;
+      f0r_pool_work();
+      if (--f0r_pool.busy == 0)
+        pthread_cond_signal(&f0r_pool.done);
+    }
+  pthread_mutex_unlock(&f0r_pool.mutex);
+  return 0;
+}
+
+/* Joins the threads of the pool when the plugin is unloaded. */
+__attribute__((destructor)) static void f0r_pool_stop()
+{
+  unsigned int i;
+  pthread_mutex_lock(&f0r_pool.run);
+  pthread_mutex_lock(&f0r_pool.mutex);
+  f0r_pool.quit = 1;
+  pthread_cond_broadcast(&f0r_pool.wake);
+  pthread_mutex_unlock(&f0r_pool.mutex);
+  for (i = 0; i < f0r_pool.workers; ++i)
+    pthread_join(f0r_pool.worker[i], 0);
+  f0r_pool.workers = 0;
+  pthread_mutex_unlock(&f0r_pool.run);
+}
+
+/* Starts the threads of the pool once, with f0r_pool.run held. */
+static inline unsigned int f0r_pool_start()
+{
+  if (!f0r_pool.started)
+    {
+      unsigned int n = f0r_thread_count();
+      f0r_pool.started = 1;
+      while (f0r_pool.workers + 1 < n
+             && pthread_create(&f0r_pool.worker[f0r_pool.workers], 0,
+                               f0r_pool_loop, 0) == 0)
+        ++f0r_pool.workers;
+    }
+  return f0r_pool.workers;
+}
+
+#else
+
+//! The number of threads to split work over.
+static inline unsigned int f0r_thread_count()
+{
+  return f0r_thread_count_uncached();
+}
+
+#endif
+
+static inline void f0r_parallel_bands(unsigned int begin, unsigned int end,
+                                      unsigned int bands,
+                                      f0r_band_fn fn, void* arg)
+{
+  f0r_band_t band[F0R_MAX_THREADS];
+  unsigned int i, n = end > begin ? end - begin : 0;
+
+  if (bands > F0R_MAX_THREADS)
+    bands = F0R_MAX_THREADS;
+  if (bands > n)
+    bands = n;
+  if (bands <= 1)
+    {
+      if (n)
+        fn(arg, 0, begin, end);
+      return;
+    }
+
+  for (i = 0; i < bands; ++i)
+    {
+      band[i].fn = fn;
+      band[i].arg = arg;
+      band[i].band = i;
+      band[i].first = begin + (unsigned int)((unsigned long long)n * i / bands);
+      band[i].last = begin + (unsigned int)((unsigned long long)n * (i + 1) / bands);
+    }
+
+#if defined(F0R_HAVE_PTHREAD)
+  if (!f0r_pool_serial && pthread_mutex_trylock(&f0r_pool.run) == 0)
+    {
+      if (f0r_pool_start())
+        {
+          pthread_mutex_lock(&f0r_pool.mutex);
+          for (i = 0; i < bands; ++i)
+            f0r_pool.band[i] = band[i];
+          f0r_pool.bands = bands;
+          f0r_pool.next = 0;
+          f0r_pool.busy = f0r_pool.workers;
+          ++f0r_pool.generation;
+          pthread_cond_broadcast(&f0r_pool.wake);
+          f0r_pool_serial = 1;
+          f0r_pool_work();
+          f0r_pool_serial = 0;
+          while (f0r_pool.busy)
+            pthread_cond_wait(&f0r_pool.done, &f0r_pool.mutex);
+          pthread_mutex_unlock(&f0r_pool.mutex);
+          pthread_mutex_unlock(&f0r_pool.run);
+          return;
+        }
+      pthread_mutex_unlock(&f0r_pool.run);
+    }
+#endif
+  for (i = 0; i < bands; ++i)
+    f0r_band_run(&band[i]);
+}
+
+#endif
@@ -154,6 +154,8 @@ f0r_instance_t f0r_construct(unsigned int width,unsigned int height)
   inst->flip[0]=inst->flip[1]=inst->flip[2]=inst->rate[0]=inst->rate[1]=inst->rate[2]=0.5;
   
   inst->mask=(int*)malloc(sizeof(int)*inst->fsize);
+  memset(inst->mask,0xff,sizeof(int)*inst->fsize); // "dontblank" keeps it
+  inst->mustrecompute=1;
 
   return (f0r_instance_t)inst;
 }
@@ -74,6 +74,11 @@ void f0r_get_param_value(f0r_instance_t instance,
 			 f0r_param_t param, int param_index)
 { /* no params */ }
 
+int f0r_get_capabilities()
+{
+  return F0R_CAP_IN_PLACE;
+}
+
 void f0r_update(f0r_instance_t instance, double time,
 		const uint32_t* inframe, uint32_t* outframe)
 {
@@ -29,6 +29,7 @@ Copyright (C) 2010  Marko Cebokli    http://lea.hamradio.si/~s57uuu
 
 //#include <stdio.h>
 #include <frei0r.h>
+#include "frei0r_roi.h"
 #include <stdlib.h>
 #include <math.h>
 #include <assert.h>
@@ -46,6 +47,7 @@ float pozx,pozy,sizx,sizy,wdt,tilt,min,max;
 int shp,op;
 
 uint32_t *gr8;
+f0r_rect_t box;		//where gr8 changes the alpha
 
 } inst;
 
@@ -212,6 +214,35 @@ for (i=0;i<h;i++)
 		}
 }
 
+//-----------------------------------------------------
+//bounding box of the pixels whose alpha gr8 changes
+void find_box(inst *in)
+{
+int i,j,x0,y0,x1,y1;
+uint32_t id;
+
+if (in->op==0)		//write on clear changes all
+	{
+	in->box=f0r_rect_make(0,0,in->w,in->h);
+	return;
+	}
+id=(in->op==2) ? 0xFF000000 : 0;	//min keeps all under opaque
+x0=in->w; y0=in->h; x1=0; y1=0;
+for (i=0;i<in->h;i++)
+	for (j=0;j<in->w;j++)
+		if (in->gr8[i*in->w+j]!=id)
+			{
+			if (j<x0) x0=j;
+			if (j>=x1) x1=j+1;
+			if (i<y0) y0=i;
+			y1=i+1;
+			}
+if (x1<=x0)
+	in->box=f0r_rect_make(0,0,0,0);
+else
+	in->box=f0r_rect_make(x0,y0,x1-x0,y1-y0);
+}
+
 //-----------------------------------------------------
 void draw(inst *in)
 {
@@ -232,6 +263,7 @@ switch (in->shp)
 	default:
 		break;
 	}
+find_box(in);
 }
 
 //-----------------------------------------------------
@@ -488,48 +520,50 @@ switch(param_index)
 }
 
 //-------------------------------------------------
-void f0r_update(f0r_instance_t instance, double time, const uint32_t* inframe, uint32_t* outframe)
+int f0r_get_capabilities()
 {
-inst *in;
-int i,j;
-float a,d,st,ct;
-uint32_t t;
+return F0R_CAP_IN_PLACE | F0R_CAP_ROI;
+}
 
-assert(instance);
-in=(inst*)instance;
+//-------------------------------------------------
+//applies gr8 to the alpha of n pixels
+void alpha_row(int op, const uint32_t *gr8, const uint32_t* inframe, uint32_t* outframe, int n)
+{
+int i;
+uint32_t t;
 
-switch (in->op)
+switch (op)
 	{
 	case 0:		//write on clear
-		for (i=0;i<in->h*in->w;i++)
-			outframe[i] = (inframe[i]&0x00FFFFFF) | in->gr8[i];
+		for (i=0;i<n;i++)
+			outframe[i] = (inframe[i]&0x00FFFFFF) | gr8[i];
 		break;
 	case 1:		//max
-		for (i=0;i<in->h*in->w;i++)
+		for (i=0;i<n;i++)
 			{
-			t=((inframe[i]&0xFF000000)>in->gr8[i]) ? inframe[i]&0xFF000000 : in->gr8[i];
+			t=((inframe[i]&0xFF000000)>gr8[i]) ? inframe[i]&0xFF000000 : gr8[i];
 			outframe[i] = (inframe[i]&0x00FFFFFF) | t;
 			}
 		break;
 	case 2:		//min
-		for (i=0;i<in->h*in->w;i++)
+		for (i=0;i<n;i++)
 			{
-			t=((inframe[i]&0xFF000000)<in->gr8[i]) ? inframe[i]&0xFF000000 : in->gr8[i];
+			t=((inframe[i]&0xFF000000)<gr8[i]) ? inframe[i]&0xFF000000 : gr8[i];
 			outframe[i] = (inframe[i]&0x00FFFFFF) | t;
 			}
 		break;
 	case 3:		//add
-		for (i=0;i<in->h*in->w;i++)
+		for (i=0;i<n;i++)
 			{
-			t=((inframe[i]&0xFF000000)>>1)+(in->gr8[i]>>1);
+			t=((inframe[i]&0xFF000000)>>1)+(gr8[i]>>1);
 			t = (t>0x7F800000) ? 0xFF000000 : t<<1;
 			outframe[i] = (inframe[i]&0x00FFFFFF) | t;
 			}
 		break;
 	case 4:		//subtract
-		for (i=0;i<in->h*in->w;i++)
+		for (i=0;i<n;i++)
 			{
-			t= ((inframe[i]&0xFF000000)>in->gr8[i]) ? (inframe[i]&0xFF000000)-in->gr8[i] : 0;
+			t= ((inframe[i]&0xFF000000)>gr8[i]) ? (inframe[i]&0xFF000000)-gr8[i] : 0;
 			outframe[i] = (inframe[i]&0x00FFFFFF) | t;
 			}
 		break;
@@ -538,4 +572,32 @@ switch (in->op)
 	}
 }
 
+//-------------------------------------------------
+void f0r_update(f0r_instance_t instance, double time, const uint32_t* inframe, uint32_t* outframe)
+{
+inst *in;
+
+assert(instance);
+in=(inst*)instance;
+
+alpha_row(in->op, in->gr8, inframe, outframe, in->w*in->h);
+}
+
+//-------------------------------------------------
+void f0r_update_roi(f0r_instance_t instance, double time, const uint32_t* inframe1, const uint32_t* inframe2, const uint32_t* inframe3, uint32_t* outframe, const f0r_rect_t* roi, f0r_rect_t* modified)
+{
+inst *in;
+unsigned int i,k;
+
+assert(instance);
+in=(inst*)instance;
+
+*modified=f0r_rect_intersect(&in->box, roi);
+for (i=modified->y;i<modified->y+modified->height;i++)
+	{
+	k=i*in->w+modified->x;
+	alpha_row(in->op, in->gr8+k, inframe1+k, outframe+k, modified->width);
+	}
+}
+
 //**********************************************************
\ No newline at end of file
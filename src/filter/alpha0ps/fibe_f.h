@@ -5,6 +5,16 @@
 //	MC maj 2012
 
 
+//The passes along the rows and down the columns are split into
+//bands over the threads of frei0r_thread.h, and four columns at a
+//time go through the float lanes of frei0r_simd.h. The result is
+//the same as that of the serial version.
+
+#include <stdlib.h>
+
+#include "frei0r_simd.h"
+#include "frei0r_thread.h"
+
 #define EDGEAVG 8
 
 double PI=3.14159265358979;
@@ -54,80 +64,121 @@ for (i=n-3;i>=0;i--)
 //-------------------------------------------------------
 // 2-tap IIR v stirih smereh   a only verzija, a0=1.0
 //desno kompenzacijo izracuna direktno (rdx,rsx,rcx)
-//optimized for speed
 
 // rep za navzgor racuna iz ze procesiranih
 // (fibe-2 ga racuna iz deviskih)
 
-void fibe2o_f(float s[], int w, int h, float a1, float a2,  float rd1, float rd2, float rs1, float rs2, float rc1, float rc2, int ec)
+typedef struct
+	{
+	float *s;
+	int w,h,ec;
+	float a1,a2,rd1,rd2,rs1,rs2,rc1,rc2;
+	} fibe_f_job;
+
+//last two samples from the extrapolated continuation,
+//s1 is the last one, s2 the one before
+static inline void fibe2o_f_edge(float *s1, float *s2, float cr, const fibe_f_job *jb)
 {
-float cr,g,g4,avg,gavg,avgg,iavg;
 float rep1,rep2;
-int i,j;
-int jw,jww,h1w,h2w,iw,i1w,i2w;
 
+rep1=(*s1+*s2)*0.5*jb->rs1+(*s1-*s2)*jb->rd1;
+rep2=(*s1+*s2)*0.5*jb->rs2+(*s1-*s2)*jb->rd2;
+
+if (jb->ec!=0)
+	{
+	rep1=rep1+jb->rc1*cr;
+	rep2=rep2+jb->rc2*cr;
+	}
+
+*s1=*s1-jb->a1*rep1-jb->a2*rep2;
+*s2=*s2-jb->a1*(*s1)-jb->a2*rep1;
+}
+
+//d[j]=d[j]-a1*p1[j]-a2*p2[j] for j in [first,last)
+static inline void fibe2o_f_step(float *d, const float *p1, const float *p2, int first, int last, float a1, float a2)
+{
+f0r_v4f va1,va2;
+int j;
+
+va1=f0r_v4f_set1(a1); va2=f0r_v4f_set1(a2);
+for (j=first;j+4<=last;j+=4)
+	f0r_v4f_store(d+j,f0r_v4f_sub(f0r_v4f_sub(f0r_v4f_load(d+j),f0r_v4f_mul(va1,f0r_v4f_load(p1+j))),f0r_v4f_mul(va2,f0r_v4f_load(p2+j))));
+for (;j<last;j++)
+	d[j]=d[j]-a1*p1[j]-a2*p2[j];
+}
+
+//forward and back along the rows [first,last)
+static void fibe2o_f_rows(void *arg, unsigned int band, unsigned int first, unsigned int last)
+{
+fibe_f_job *jb=(fibe_f_job*)arg;
+float cr,g,g4,avg,gavg,a1,a2;
+float *s;
+int i,j,w;
+
+w=jb->w; a1=jb->a1; a2=jb->a2;
 g=1.0/(1.0+a1+a2);
 g4=1.0/g/g/g/g;
 avg=EDGEAVG;	//koliko vzorcev za povprecje pri edge comp
 gavg=g4/avg;
-avgg=1.0/g/avg;
-iavg=1.0/avg;
 
-for (j=0;j<avg;j++)	//prvih avg vrstic tja in nazaj
+for (j=first;j<last;j++)
 	{
-	jw=j*w; jww=jw+w;
+	s=jb->s+j*w;
 	cr=0.0;
-	if (ec!=0)
+	if (jb->ec!=0)
 		{	//edge comp (popvprecje prvih)
 		for (i=0;i<avg;i++)
 			{
-			cr=cr+s[jw+i];
+			cr=cr+s[i];
 			}
 		cr=cr*gavg;
 		}
-	s[jw]=g4*s[jw]-(a1+a2)*g*cr;
-	s[jw+1]=g4*s[jw+1]-a1*s[jw]-a2*g*cr;
+	s[0]=g4*s[0]-(a1+a2)*g*cr;
+	s[1]=g4*s[1]-a1*s[0]-a2*g*cr;
 
-	if (ec!=0)
+	if (jb->ec!=0)
 		{	//edge comp za nazaj
 		cr=0.0;
 		for (i=w-avg;i<w;i++)
 			{
-			cr=cr+s[jw+i];
+			cr=cr+s[i];
 			}
 		cr=cr*gavg;
 		}
 
 	for (i=2;i<w;i++)		//tja
 		{
-		s[jw+i]=g4*s[jw+i]-a1*s[jw+i-1]-a2*s[jw+i-2];
+		s[i]=g4*s[i]-a1*s[i-1]-a2*s[i-2];
 		}
 
-	rep1=(s[jww-1]+s[jww-2])*0.5*rs1+(s[jww-1]-s[jww-2])*rd1;
-	rep2=(s[jww-1]+s[jww-2])*0.5*rs2+(s[jww-1]-s[jww-2])*rd2;
-
-	if (ec!=0)
-		{
-		rep1=rep1+rc1*cr;
-		rep2=rep2+rc2*cr;
-		}
-
-	s[jww-1]=s[jww-1]-a1*rep1-a2*rep2;
-	s[jww-2]=s[jww-2]-a1*s[jww-1]-a2*rep1;
+	fibe2o_f_edge(&s[w-1],&s[w-2],cr,jb);
 
 	for (i=w-3;i>=0;i--)		//nazaj
 		{
-		s[jw+i]=s[jw+i]-a1*s[jw+i+1]-a2*s[jw+i+2];
+		s[i]=s[i]-a1*s[i+1]-a2*s[i+2];
 		}
-	}	//prvih avg vrstic
+	}
+}
+
+//down and up the columns [first,last)
+static void fibe2o_f_cols(void *arg, unsigned int band, unsigned int first, unsigned int last)
+{
+fibe_f_job *jb=(fibe_f_job*)arg;
+float cr,g,avg,avgg,iavg,a1,a2;
+float *s;
+int i,j,w,h,h1w,h2w;
 
-//printaj(s,w,h,1,1,0);
+s=jb->s; w=jb->w; h=jb->h; a1=jb->a1; a2=jb->a2;
+g=1.0/(1.0+a1+a2);
+avg=EDGEAVG;
+avgg=1.0/g/avg;
+iavg=1.0/avg;
 
 //edge comp zgoraj za navzdol
-for (j=0;j<w;j++)	//po stolpcih
+for (j=first;j<last;j++)	//po stolpcih
 	{
 	cr=0.0;
-	if (ec!=0)
+	if (jb->ec!=0)
 		{	//edge comp (popvprecje prvih)
 		for (i=0;i<avg;i++)
 			{
@@ -141,117 +192,38 @@ for (j=0;j<w;j++)	//po stolpcih
 	s[j+w]=s[j+w]-a1*s[j]-a2*g*cr;
 	}
 
-//tretja do avg, samo navzdol (nazaj so ze)
-for (i=2;i<avg;i++)
-	{
-	iw=i*w; i1w=iw-w;
-	for (j=0;j<w;j++)	//po stolpcih
-		{
-		s[j+iw]=s[j+iw]-a1*s[j+i1w]-a2*s[j+i1w-w];
-		}
-	}
-
-for (j=avg;j<h;j++)	//po vrsticah tja, nazaj in dol
-	{
-	jw=j*w; jww=jw+w;
-	cr=0.0;
-	if (ec!=0)
-		{	//edge comp (popvprecje prvih)
-		for (i=0;i<avg;i++)
-			{
-			cr=cr+s[jw+i];
-			}
-		cr=cr*gavg;
-		}
-	s[jw]=g4*s[jw]-(a1+a2)*g*cr;
-	s[jw+1]=g4*s[jw+1]-a1*s[jw]-a2*g*cr;
-
-	if (ec!=0)
-		{	//edge comp za nazaj
-		cr=0.0;
-		for (i=w-avg;i<w;i++)
-			{
-			cr=cr+s[jw+i];
-			}
-		cr=cr*gavg;
-		}
-
-	for (i=2;i<w;i++)		//tja
-		{
-		s[jw+i]=g4*s[jw+i]-a1*s[jw+i-1]-a2*s[jw+i-2];
-		}
-
-	rep1=(s[jww-1]+s[jww-2])*0.5*rs1+(s[jww-1]-s[jww-2])*rd1;
-	rep2=(s[jww-1]+s[jww-2])*0.5*rs2+(s[jww-1]-s[jww-2])*rd2;
-
-	if (ec!=0)
-		{
-		rep1=rep1+rc1*cr;
-		rep2=rep2+rc2*cr;
-		}
-
-	s[jww-1]=s[jww-1]-a1*rep1-a2*rep2;
-	s[jww-2]=s[jww-2]-a1*s[jww-1]-a2*rep1;
-
-	for (i=w-3;i>=0;i--)	//po stolpcih
-		{ //nazaj
-		s[jw+i]=s[jw+i]-a1*s[jw+i+1]-a2*s[jw+i+2];
-//dol
-		s[jw+i+2]=s[jw+i+2]-a1*s[jw-w+i+2]-a2*s[jw-w-w+i+2];
-		}
-
-//se leva stolpca dol
-	s[jw+1]=s[jw+1]-a1*s[jw-w+1]-a2*s[jw-w-w+1];
-	s[jw]=s[jw]-a1*s[jw-w]-a2*s[jw-w-w];
-
-	}	//po vrsticah
-
-//printaj(s,w,h,1,1,0);
-//printf("\n\n");
-//printaj(s,w,h,100,100,0);
+for (i=2;i<h;i++)	//dol
+	fibe2o_f_step(s+i*w,s+(i-1)*w,s+(i-2)*w,first,last,a1,a2);
 
 //pa se navzgor
 //spodnji dve vrstici
 h1w=(h-1)*w; h2w=(h-2)*w;
-for (j=0;j<w;j++)	//po stolpcih
+for (j=first;j<last;j++)	//po stolpcih
 	{
-	if (ec!=0)
+	cr=0.0;
+	if (jb->ec!=0)
 		{	//edge comp za gor
-		cr=0.0;
 		for (i=h-avg;i<h;i++)
 			{
 			cr=cr+s[j+w*i];
 			}
 		cr=cr*avgg;
 		}
-
-	rep1=(s[j+h1w]+s[j+h2w])*0.5*rs1+(s[j+h1w]-s[j+h2w])*rd1;
-	rep2=(s[j+h1w]+s[j+h2w])*0.5*rs2+(s[j+h1w]-s[j+h2w])*rd2;
-
-	if (ec!=0)
-		{	//edge comp
-		rep1=rep1+rc1*cr;
-		rep2=rep2+rc2*cr;
-		}
-
-	s[j+h1w]=s[j+h1w]-a1*rep1-a2*rep2;
-	s[j+h2w]=s[j+h2w]-a1*s[j+h1w]-a2*rep1;
+	fibe2o_f_edge(&s[j+h1w],&s[j+h2w],cr,jb);
 	}
 
 //ostale vrstice
 for (i=h-3;i>=0;i--)		//gor
-	{
-	iw=i*w; i1w=iw+w; i2w=i1w+w;
-	for (j=0;j<w;j++)
-		{
-		s[j+iw]=s[j+iw]-a1*s[j+i1w]-a2*s[j+i2w];
-		}
-	}
+	fibe2o_f_step(s+i*w,s+(i+1)*w,s+(i+2)*w,first,last,a1,a2);
+}
 
-//printaj(s,w,h,1,1,1);
-//printf("\n\n");
-//printaj(s,w,h,100,100,1);
-//printaj(s,w,h,300,300,0);
-//printaj(s,w,h,300,574,0);
+void fibe2o_f(float s[], int w, int h, float a1, float a2,  float rd1, float rd2, float rs1, float rs2, float rc1, float rc2, int ec)
+{
+fibe_f_job job;
 
+job.s=s; job.w=w; job.h=h; job.ec=ec;
+job.a1=a1; job.a2=a2;
+job.rd1=rd1; job.rd2=rd2; job.rs1=rs1; job.rs2=rs2; job.rc1=rc1; job.rc2=rc2;
+f0r_parallel_bands(0, h, f0r_thread_count(), fibe2o_f_rows, &job);
+f0r_parallel_bands(0, w, f0r_thread_count(), fibe2o_f_cols, &job);
 }
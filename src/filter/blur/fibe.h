@@ -45,11 +45,9 @@ rep()		auxilliary function to calculate wraparound
 		values for FIBE-2
 
 fibe1o_8()	one tap quadrilateral IIR filter
-		speed optimized C function
 		includes 8bit/float conversions
 
 fibe2o_8()	two tap quadrilateral IIR filter
-		speed optimized C function
 		includes 8bit/float conversions
 
 fibe3_8()	three tap quadrilateral IIR filter
@@ -60,6 +58,15 @@ the 8bit/float conversion into the first and last
 processing loops, to avoid two additional cache polluting
 and therefore time consuming "walks" through memory.
 
+Each filter runs in two passes: forward and back along the
+rows, then down and up along the columns. The rows are
+independent, and so are the columns, so each pass is split
+into bands of rows or columns over the threads of
+frei0r_thread.h. The three colour channels of a pixel are
+filtered together in the float lanes of frei0r_simd.h, which
+round like the scalar code, so the result does not depend on
+the number of threads.
+
 */
 
 
@@ -68,6 +75,10 @@ and therefore time consuming "walks" through memory.
 #define EDGEAVG 8
 
 #include <sys/types.h>
+#include <stdlib.h>
+
+#include "frei0r_simd.h"
+#include "frei0r_thread.h"
 
 
 //---------------------------------------------------------
@@ -138,717 +149,385 @@ for (i=n-3;i>=0;i--)
 }
 
 //---------------------------------------------------------
-// 1-tap IIR v 4 smereh
-//optimized for speed
-//loops rearanged for more locality (better cache hit ratio)
-//outer (vertical) loop 2x unroll to break dependency chain
-//simplified indexes
-void fibe1o_8(const uint32_t* inframe, uint32_t* outframe, float_rgba *s, int w, int h, float a, int ec)
+//shared state of the row and column bands of one frame
+typedef struct
+	{
+	const uint32_t *in;
+	uint32_t *out;
+	float_rgba *s;
+	int w,h,ec;
+	float a1,a2,a3;		//taps, fibe1o uses a1 only
+	float rd1,rd2,rs1,rs2,rc1,rc2;	//right edge compensation of fibe2o
+	} fibe_job;
+
+#define FIBE_LD(p) f0r_v4f_load(&(p).r)
+#define FIBE_ST(p,v) f0r_v4f_store(&(p).r,(v))
+
+//sum of n pixels stride apart, added in the same order as the
+//scalar edge compensation
+static inline f0r_v4f fibe_sum(const float_rgba *s, int n, int stride)
 {
-int i,j;
-float b,g,g4,avg,avg1,cr,cg,cb,g4a,g4b;
-int p,pw,pj,pwj,pww,pmw;
+f0r_v4f c;
+int i;
 
-avg=EDGEAVG;	//koliko vzorcev za povprecje pri edge comp
-avg1=1.0/avg;
+c=f0r_v4f_set1(0.0);
+for (i=0;i<n;i++)
+	c=f0r_v4f_add(c,FIBE_LD(s[i*stride]));
+return c;
+}
 
-g=1.0/(1.0-a);
-g4=1.0/g/g/g/g;
+static inline void fibe_parallel(int n, f0r_band_fn fn, fibe_job *job)
+{
+f0r_parallel_bands(0, n, f0r_thread_count(), fn, job);
+}
 
+//---------------------------------------------------------
+// 1-tap IIR v 4 smereh
+//forward and back along the rows [first,last), two rows at a time
+//like fibe2o_rows()
+static void fibe1o_rows(void *arg, unsigned int band, unsigned int first, unsigned int last)
+{
+fibe_job *jb=(fibe_job*)arg;
+float g,b,avg,avg1;
+f0r_v4f va,vg,vb,vavg1,c,x,y;
+float_rgba *s,*t;
+const uint32_t *in,*in2;
+int i,j,k,n,w;
+
+w=jb->w;
+avg=EDGEAVG;	//koliko vzorcev za povprecje pri edge comp
+avg1=1.0/avg;
+g=1.0/(1.0-jb->a1);
 //predpostavimo, da je "zunaj" crnina (nicle)
-b=1.0/(1.0-a)/(1.0+a);
+b=1.0/(1.0-jb->a1)/(1.0+jb->a1);
+va=f0r_v4f_set1(jb->a1); vg=f0r_v4f_set1(g); vb=f0r_v4f_set1(b);
+vavg1=f0r_v4f_set1(avg1);
 
-//prvih avg vrstic
-for (i=0;i<avg;i++)
+for (j=first;j<last;j+=2)
 	{
-	p=i*w;pw=p+w;
-	if (ec!=0)
-		{
-		cr=0.0;cg=0.0;cb=0.0;
-		for (j=0;j<avg;j++)
-			{
-			s[p+j].r=(float)(inframe[p+j]&0xFF);
-			s[p+j].g=(float)((inframe[p+j]&0xFF00)>>8);
-			s[p+j].b=(float)((inframe[p+j]&0xFF0000)>>16);
-			cr=cr+s[p+j].r;
-			cg=cg+s[p+j].g;
-			cb=cb+s[p+j].b;
-			}
-		cr=cr*avg1; cg=cg*avg1; cb=cb*avg1;
-		s[p].r=cr*g+b*(s[p].r-cr);
-		s[p].g=cg*g+b*(s[p].g-cg);
-		s[p].b=cb*g+b*(s[p].b-cb);
-		}
-	else
-		for (j=0;j<avg;j++)
-			{
-			s[p+j].r=(float)(inframe[p+j]&0xFF);
-			s[p+j].g=(float)((inframe[p+j]&0xFF00)>>8);
-			s[p+j].b=(float)((inframe[p+j]&0xFF0000)>>16);
-			}
-
-	for (j=1;j<avg;j++)	//tja  (ze pretvorjeni)
-		{
-		s[p+j].r=s[p+j].r+a*s[p+j-1].r;
-		s[p+j].g=s[p+j].g+a*s[p+j-1].g;
-		s[p+j].b=s[p+j].b+a*s[p+j-1].b;
-		}
-	for (j=avg;j<w;j++)	//tja  (s pretvorbo)
-		{
-		s[p+j].r=(float)(inframe[p+j]&0xFF);
-		s[p+j].g=(float)((inframe[p+j]&0xFF00)>>8);
-		s[p+j].b=(float)((inframe[p+j]&0xFF0000)>>16);
-		s[p+j].r=s[p+j].r+a*s[p+j-1].r;
-		s[p+j].g=s[p+j].g+a*s[p+j-1].g;
-		s[p+j].b=s[p+j].b+a*s[p+j-1].b;
-		}
+	n=j+1<last ? 2 : 1;
+	s=jb->s+j*w; in=jb->in+j*w;
+	t=s+(n-1)*w; in2=in+(n-1)*w;
 
-	if (ec!=0)
+	for (k=0;k<n;k++)
 		{
-		cr=0.0;cg=0.0;cb=0.0;
-		for (j=w-avg;j<w;j++)
-			{
-			cr=cr+s[p+j].r;
-			cg=cg+s[p+j].g;
-			cb=cb+s[p+j].b;
-			}
-		cr=cr*avg1; cg=cg*avg1; cb=cb*avg1;
-		s[pw-1].r=cr*g+b*(s[pw-1].r-cr);
-		s[pw-1].g=cg*g+b*(s[pw-1].g-cg);
-		s[pw-1].b=cb*g+b*(s[pw-1].b-cb);
-		}
-	else
-		{
-		s[pw-1].r=b*s[pw-1].r;
-		s[pw-1].g=b*s[pw-1].g;
-		s[pw-1].b=b*s[pw-1].b;
-		}
-	for (j=w-2;j>=0;j--)	//nazaj
-		{
-		s[p+j].r=a*s[p+j+1].r+s[p+j].r;
-		s[p+j].g=a*s[p+j+1].g+s[p+j].g;
-		s[p+j].b=a*s[p+j+1].b+s[p+j].b;
-		}
-	}
-
-//prvih avg vrstic samo navzdol (nazaj so ze)
-for (i=0;i<w;i++)
-	{
-	if (ec!=0)
-		{
-		cr=0.0;cg=0.0;cb=0.0;
-		for (j=0;j<avg;j++)
+		for (i=0;i<avg;i++)
+			FIBE_ST(s[k*w+i],f0r_v4f_from_rgb8(in[k*w+i]));
+		if (jb->ec!=0)
 			{
-			cr=cr+s[i+w*j].r;
-			cg=cg+s[i+w*j].g;
-			cb=cb+s[i+w*j].b;
+			c=f0r_v4f_mul(fibe_sum(s+k*w,avg,1),vavg1);
+			FIBE_ST(s[k*w],f0r_v4f_add(f0r_v4f_mul(c,vg),f0r_v4f_mul(vb,f0r_v4f_sub(FIBE_LD(s[k*w]),c))));
 			}
-		cr=cr*avg1; cg=cg*avg1; cb=cb*avg1;
-		s[i].r=cr*g+b*(s[i].r-cr);
-		s[i].g=cg*g+b*(s[i].g-cg);
-		s[i].b=cb*g+b*(s[i].b-cb);
-		}
-	for (j=1;j<avg;j++)	//dol
-		{
-		s[i+j*w].r=s[i+j*w].r+a*s[i+w*(j-1)].r;
-		s[i+j*w].g=s[i+j*w].g+a*s[i+w*(j-1)].g;
-		s[i+j*w].b=s[i+j*w].b+a*s[i+w*(j-1)].b;
 		}
-	}
 
-for (i=avg;i<h-1;i=i+2)	//po vrsticah navzdol
-	{
-	p=i*w; pw=p+w; pww=pw+w; pmw=p-w;
-	if (ec!=0)
-		{
-		cr=0.0;cg=0.0;cb=0.0;
-		for (j=0;j<avg;j++)
-			{
-			s[p+j].r=(float)(inframe[p+j]&0xFF);
-			s[p+j].g=(float)((inframe[p+j]&0xFF00)>>8);
-			s[p+j].b=(float)((inframe[p+j]&0xFF0000)>>16);
-			cr=cr+s[p+j].r;
-			cg=cg+s[p+j].g;
-			cb=cb+s[p+j].b;
-			}
-		cr=cr*avg1; cg=cg*avg1; cb=cb*avg1;
-		s[p].r=cr*g+b*(s[p].r-cr);
-		s[p].g=cg*g+b*(s[p].g-cg);
-		s[p].b=cb*g+b*(s[p].b-cb);
-		cr=0.0;cg=0.0;cb=0.0;
-		for (j=0;j<avg;j++)
-			{
-			s[pw+j].r=(float)(inframe[pw+j]&0xFF);
-			s[pw+j].g=(float)((inframe[pw+j]&0xFF00)>>8);
-			s[pw+j].b=(float)((inframe[pw+j]&0xFF0000)>>16);
-			cr=cr+s[pw+j].r;
-			cg=cg+s[pw+j].g;
-			cb=cb+s[pw+j].b;
-			}
-		cr=cr*avg1; cg=cg*avg1; cb=cb*avg1;
-		s[pw].r=cr*g+b*(s[pw].r-cr);
-		s[pw].g=cg*g+b*(s[pw].g-cg);
-		s[pw].b=cb*g+b*(s[pw].b-cb);
-		}
-	else
+	x=FIBE_LD(s[0]); y=FIBE_LD(t[0]);
+	for (i=1;i<w;i++)	//tja
 		{
-		for (j=0;j<avg;j++)
+		if (i<avg)
 			{
-			s[p+j].r=(float)(inframe[p+j]&0xFF);
-			s[p+j].g=(float)((inframe[p+j]&0xFF00)>>8);
-			s[p+j].b=(float)((inframe[p+j]&0xFF0000)>>16);
+			x=f0r_v4f_add(FIBE_LD(s[i]),f0r_v4f_mul(va,x));
+			y=f0r_v4f_add(FIBE_LD(t[i]),f0r_v4f_mul(va,y));
 			}
-		for (j=0;j<avg;j++)
+		else
 			{
-			s[pw+j].r=(float)(inframe[pw+j]&0xFF);
-			s[pw+j].g=(float)((inframe[pw+j]&0xFF00)>>8);
-			s[pw+j].b=(float)((inframe[pw+j]&0xFF0000)>>16);
+			x=f0r_v4f_add(f0r_v4f_from_rgb8(in[i]),f0r_v4f_mul(va,x));
+			y=f0r_v4f_add(f0r_v4f_from_rgb8(in2[i]),f0r_v4f_mul(va,y));
 			}
-		}
-	for (j=1;j<avg;j++)	//tja  (ze pretvojeni)
-		{
-		pj=p+j;pwj=pw+j;
-		s[pj].r=s[pj].r+a*s[pj-1].r;
-		s[pj].g=s[pj].g+a*s[pj-1].g;
-		s[pj].b=s[pj].b+a*s[pj-1].b;
-		s[pwj].r=s[pwj].r+a*s[pwj-1].r;
-		s[pwj].g=s[pwj].g+a*s[pwj-1].g;
-		s[pwj].b=s[pwj].b+a*s[pwj-1].b;
-		}
-	for (j=avg;j<w;j++)	//tja  (s pretvorbo)
-		{
-		pj=p+j;pwj=pw+j;
-		s[pj].r=(float)(inframe[pj]&0xFF);
-		s[pj].g=(float)((inframe[pj]&0xFF00)>>8);
-		s[pj].b=(float)((inframe[pj]&0xFF0000)>>16);
-		s[pj].r=s[pj].r+a*s[pj-1].r;
-		s[pj].g=s[pj].g+a*s[pj-1].g;
-		s[pj].b=s[pj].b+a*s[pj-1].b;
-		s[pwj].r=(float)(inframe[pwj]&0xFF);
-		s[pwj].g=(float)((inframe[pwj]&0xFF00)>>8);
-		s[pwj].b=(float)((inframe[pwj]&0xFF0000)>>16);
-		s[pwj].r=s[pwj].r+a*s[pwj-1].r;
-		s[pwj].g=s[pwj].g+a*s[pwj-1].g;
-		s[pwj].b=s[pwj].b+a*s[pwj-1].b;
+		FIBE_ST(s[i],x); FIBE_ST(t[i],y);
 		}
 
-	if (ec!=0)
+	for (k=0;k<n;k++)
 		{
-		cr=0.0;cg=0.0;cb=0.0;
-		for (j=w-avg;j<w;j++)
+		x=FIBE_LD(s[k*w+w-1]);
+		if (jb->ec!=0)
 			{
-			cr=cr+s[p+j].r;
-			cg=cg+s[p+j].g;
-			cb=cb+s[p+j].b;
+			c=f0r_v4f_mul(fibe_sum(s+k*w+w-(int)avg,avg,1),vavg1);
+			x=f0r_v4f_add(f0r_v4f_mul(c,vg),f0r_v4f_mul(vb,f0r_v4f_sub(x,c)));
 			}
-		cr=cr*avg1; cg=cg*avg1; cb=cb*avg1;
-		s[pw-1].r=cr*g+b*(s[pw-1].r-cr);
-		s[pw-1].g=cg*g+b*(s[pw-1].g-cg);
-		s[pw-1].b=cb*g+b*(s[pw-1].b-cb);
-		cr=0.0;cg=0.0;cb=0.0;
-		for (j=w-avg;j<w;j++)
-			{
-			cr=cr+s[pw+j].r;
-			cg=cg+s[pw+j].g;
-			cb=cb+s[pw+j].b;
-			}
-		cr=cr*avg1; cg=cg*avg1; cb=cb*avg1;
-		s[pww-1].r=cr*g+b*(s[pww-1].r-cr);
-		s[pww-1].g=cg*g+b*(s[pww-1].g-cg);
-		s[pww-1].b=cb*g+b*(s[pww-1].b-cb);
+		else
+			x=f0r_v4f_mul(vb,x);
+		FIBE_ST(s[k*w+w-1],x);
 		}
-	else
-		{
-		s[pw-1].r=b*s[pw-1].r;	//rep H
-		s[pw-1].g=b*s[pw-1].g;
-		s[pw-1].b=b*s[pw-1].b;
-		s[pww-1].r=b*s[pww-1].r;
-		s[pww-1].g=b*s[pww-1].g;
-		s[pww-1].b=b*s[pww-1].b;
-		}
-
-//zacetek na desni
-	s[pw-2].r=s[pw-2].r+a*s[pw-1].r;	//nazaj
-	s[pw-2].g=s[pw-2].g+a*s[pw-1].g;
-	s[pw-2].b=s[pw-2].b+a*s[pw-1].b;
-	s[pw-1].r=s[pw-1].r+a*s[p-1].r;		//dol
-	s[pw-1].g=s[pw-1].g+a*s[p-1].g;
-	s[pw-1].b=s[pw-1].b+a*s[p-1].b;
 
-	for (j=w-2;j>=1;j--)	//nazaj
+	x=FIBE_LD(s[w-1]); y=FIBE_LD(t[w-1]);
+	for (i=w-2;i>=0;i--)	//nazaj
 		{
-		pj=p+j;pwj=pw+j;
-		s[pj-1].r=a*s[pj].r+s[pj-1].r;
-		s[pj-1].g=a*s[pj].g+s[pj-1].g;
-		s[pj-1].b=a*s[pj].b+s[pj-1].b;
-		s[pwj].r=a*s[pwj+1].r+s[pwj].r;
-		s[pwj].g=a*s[pwj+1].g+s[pwj].g;
-		s[pwj].b=a*s[pwj+1].b+s[pwj].b;
-//zdaj naredi se en piksel vertikalno dol, za vse stolpce
-//dva nazaj, da ne vpliva na H nazaj
-		s[pj].r=s[pj].r+a*s[pmw+j].r;
-		s[pj].g=s[pj].g+a*s[pmw+j].g;
-		s[pj].b=s[pj].b+a*s[pmw+j].b;
-		s[pwj+1].r=s[pwj+1].r+a*s[pj+1].r;
-		s[pwj+1].g=s[pwj+1].g+a*s[pj+1].g;
-		s[pwj+1].b=s[pwj+1].b+a*s[pj+1].b;
+		x=f0r_v4f_add(f0r_v4f_mul(va,x),FIBE_LD(s[i]));
+		y=f0r_v4f_add(f0r_v4f_mul(va,y),FIBE_LD(t[i]));
+		FIBE_ST(s[i],x); FIBE_ST(t[i],y);
 		}
-//konec levo
-	s[pw].r=s[pw].r+a*s[pw+1].r;	//nazaj
-	s[pw].g=s[pw].g+a*s[pw+1].g;
-	s[pw].b=s[pw].b+a*s[pw+1].b;
-	s[p].r=s[p].r+a*s[pmw].r;	//dol
-	s[p].g=s[p].g+a*s[pmw].g;
-	s[p].b=s[p].b+a*s[pmw].b;
-	s[pw+1].r=s[pw+1].r+a*s[p+1].r;	//dol
-	s[pw+1].g=s[pw+1].g+a*s[p+1].g;
-	s[pw+1].b=s[pw+1].b+a*s[p+1].b;
-	s[pw].r=s[pw].r+a*s[p].r;	//dol
-	s[pw].g=s[pw].g+a*s[p].g;
-	s[pw].b=s[pw].b+a*s[p].b;
 	}
+}
 
-//ce je sodo stevilo vrstic, moras zadnjo posebej
-if (i!=h)
-	{
-	p=i*w; pw=p+w;
-	for (j=1;j<w;j++)	//tja
-		{
-		s[p+j].r=s[p+j].r+a*s[p+j-1].r;
-		s[p+j].g=s[p+j].g+a*s[p+j-1].g;
-		s[p+j].b=s[p+j].b+a*s[p+j-1].b;
-		}
-
-	s[pw-1].r=b*s[pw-1].r;	//rep H
-	s[pw-1].g=b*s[pw-1].g;
-	s[pw-1].b=b*s[pw-1].b;
+//down and up the columns [first,last), with the 8 bit output
+static void fibe1o_cols(void *arg, unsigned int band, unsigned int first, unsigned int last)
+{
+fibe_job *jb=(fibe_job*)arg;
+float g,b,g4,avg,avg1,g4a,g4b;
+f0r_v4f va,vg,vb,vg4,vg4a,vg4b,vavg1,c,v;
+float_rgba *s,*p,*q;
+uint32_t *out;
+int i,j,w,h;
+
+w=jb->w; h=jb->h; s=jb->s;
+avg=EDGEAVG;
+avg1=1.0/avg;
+g=1.0/(1.0-jb->a1);
+g4=1.0/g/g/g/g;
+b=1.0/(1.0-jb->a1)/(1.0+jb->a1);
+g4b=g4*b;
+g4a=g4/(1.0-jb->a1);
+va=f0r_v4f_set1(jb->a1); vg=f0r_v4f_set1(g); vb=f0r_v4f_set1(b);
+vg4=f0r_v4f_set1(g4); vg4a=f0r_v4f_set1(g4a); vg4b=f0r_v4f_set1(g4b);
+vavg1=f0r_v4f_set1(avg1);
 
-	for (j=w-2;j>=0;j--)	//nazaj in dol
+if (jb->ec!=0)	//edge comp zgoraj
+	for (j=first;j<last;j++)
 		{
-		s[p+j].r=a*s[p+j+1].r+s[p+j].r;
-		s[p+j].g=a*s[p+j+1].g+s[p+j].g;
-		s[p+j].b=a*s[p+j+1].b+s[p+j].b;
-
-//zdaj naredi se en piksel vertikalno dol, za vse stolpce
-//dva nazaj, da ne vpliva na H nazaj
-		s[p+j+1].r=s[p+j+1].r+a*s[p-w+j+1].r;
-		s[p+j+1].g=s[p+j+1].g+a*s[p-w+j+1].g;
-		s[p+j+1].b=s[p+j+1].b+a*s[p-w+j+1].b;
+		c=f0r_v4f_mul(fibe_sum(s+j,avg,w),vavg1);
+		FIBE_ST(s[j],f0r_v4f_add(f0r_v4f_mul(c,vg),f0r_v4f_mul(vb,f0r_v4f_sub(FIBE_LD(s[j]),c))));
 		}
-//levi piksel vert
-	s[p].r=s[p].r+a*s[p-w].r;
-	s[p].g=s[p].g+a*s[p-w].g;
-	s[p].b=s[p].b+a*s[p-w].b;
-	}
 
-//zadnja vrstica (h-1)
-g4b=g4*b;
-g4a=g4/(1.0-a);
-p=(h-1)*w;
-if (ec!=0)
+for (i=1;i<h;i++)	//po vrsticah navzdol
 	{
-	for (i=0;i<w;i++)	//po stolpcih
-		{
-		cr=0.0;cg=0.0;cb=0.0;
-		for (j=h-avg;j<h;j++)
-			{
-			cr=cr+s[i+w*j].r;
-			cg=cg+s[i+w*j].g;
-			cb=cb+s[i+w*j].b;
-			}
-		cr=cr*avg1; cg=cg*avg1; cb=cb*avg1;
-		s[i+p].r=g4a*cr+g4b*(s[i+p].r-cr);
-		s[i+p].g=g4a*cg+g4b*(s[i+p].g-cg);
-		s[i+p].b=g4a*cb+g4b*(s[i+p].b-cb);
-		outframe[p+i]=((uint32_t)s[p+i].r&0xFF) + (((uint32_t)s[p+i].g&0xFF)<<8) + (((uint32_t)s[p+i].b&0xFF)<<16);
-		}
+	p=s+i*w; q=p-w;
+	for (j=first;j<last;j++)
+		FIBE_ST(p[j],f0r_v4f_add(FIBE_LD(p[j]),f0r_v4f_mul(va,FIBE_LD(q[j]))));
 	}
-else
+
+//zadnja vrstica (h-1)
+p=s+(h-1)*w; out=jb->out+(h-1)*w;
+for (j=first;j<last;j++)
 	{
-	for (j=0;j<w;j++)	//po stolpcih
+	if (jb->ec!=0)
 		{
-		s[j+p].r=g4b*s[j+p].r;	//rep V
-		s[j+p].g=g4b*s[j+p].g;
-		s[j+p].b=g4b*s[j+p].b;
-		outframe[p+j]=((uint32_t)s[p+j].r&0xFF) + (((uint32_t)s[p+j].g&0xFF)<<8) + (((uint32_t)s[p+j].b&0xFF)<<16);
+		c=f0r_v4f_mul(fibe_sum(s+(h-(int)avg)*w+j,avg,w),vavg1);
+		v=f0r_v4f_add(f0r_v4f_mul(vg4a,c),f0r_v4f_mul(vg4b,f0r_v4f_sub(FIBE_LD(p[j]),c)));
 		}
+	else
+		v=f0r_v4f_mul(vg4b,FIBE_LD(p[j]));	//rep V
+	FIBE_ST(p[j],v);
+	out[j]=f0r_v4f_to_rgb8(v);
 	}
 
 for (i=h-2;i>=0;i--)	//po vrsticah navzgor
 	{
-	p=i*w; pw=p+w;
-	for (j=0;j<w;j++)	//po stolpcih
+	p=s+i*w; q=p+w; out=jb->out+i*w;
+	for (j=first;j<last;j++)
 		{
-		s[p+j].r=a*s[pw+j].r+g4*s[p+j].r;
-		s[p+j].g=a*s[pw+j].g+g4*s[p+j].g;
-		s[p+j].b=a*s[pw+j].b+g4*s[p+j].b;
-		outframe[p+j]=((uint32_t)s[p+j].r&0xFF) + (((uint32_t)s[p+j].g&0xFF)<<8) + (((uint32_t)s[p+j].b&0xFF)<<16);
+		v=f0r_v4f_add(f0r_v4f_mul(va,FIBE_LD(q[j])),f0r_v4f_mul(vg4,FIBE_LD(p[j])));
+		FIBE_ST(p[j],v);
+		out[j]=f0r_v4f_to_rgb8(v);
 		}
 	}
+}
+
+void fibe1o_8(const uint32_t* inframe, uint32_t* outframe, float_rgba *s, int w, int h, float a, int ec)
+{
+fibe_job job;
 
+job.in=inframe; job.out=outframe; job.s=s;
+job.w=w; job.h=h; job.ec=ec;
+job.a1=a;
+fibe_parallel(h,fibe1o_rows,&job);
+fibe_parallel(w,fibe1o_cols,&job);
 }
 
 //-------------------------------------------------------
 // 2-tap IIR v stirih smereh   a only verzija, a0=1.0
 //desno kompenzacijo izracuna direktno (rdx,rsx,rcx)
-//optimized for speed
-void fibe2o_8(const uint32_t* inframe, uint32_t* outframe, float_rgba s[], int w, int h, float a1, float a2,  float rd1, float rd2, float rs1, float rs2, float rc1, float rc2, int ec)
+
+//x-a1*l1-a2*l2
+#define FIBE2O_TAP(x,l1,l2) \
+	f0r_v4f_sub(f0r_v4f_sub((x),f0r_v4f_mul(va1,(l1))),f0r_v4f_mul(va2,(l2)))
+
+//last two samples of one channel from the extrapolated continuation,
+//s1 is the last one, s2 the one before; clip limits them to [0,255]
+static inline void fibe2o_edge(float *s1, float *s2, float c, const fibe_job *jb, int clip)
 {
-float cr,cg,cb,g,g4,avg,gavg,avgg,iavg;
-float_rgba rep1,rep2;
-int i,j;
-int jw,jww,h1w,h2w,iw,i1w,i2w;
+float rep1,rep2;
+
+rep1=(*s1+*s2)*0.5*jb->rs1+(*s1-*s2)*jb->rd1;
+rep2=(*s1+*s2)*0.5*jb->rs2+(*s1-*s2)*jb->rd2;
+if (jb->ec!=0)
+	{
+	rep1=rep1+jb->rc1*c;
+	rep2=rep2+jb->rc2*c;
+	}
+*s1=*s1-jb->a1*rep1-jb->a2*rep2;
+if (clip)
+	{
+	if (*s1>255) *s1=255.0;
+	if (*s1<0.0) *s1=0.0;
+	}
+*s2=*s2-jb->a1*(*s1)-jb->a2*rep1;
+if (clip)
+	{
+	if (*s2>255) *s2=255.0;
+	if (*s2<0.0) *s2=0.0;
+	}
+}
 
-g=1.0/(1.0+a1+a2);
+//forward and back along the rows [first,last)
+//Two rows go through each loop together, so that their dependency
+//chains overlap.
+static void fibe2o_rows(void *arg, unsigned int band, unsigned int first, unsigned int last)
+{
+fibe_job *jb=(fibe_job*)arg;
+float g,g4,avg,gavg;
+f0r_v4f va1,va2,vg4,va12g,va2g,cl,x,y,v1,v2,u1,u2;
+float_rgba *s,*t,cr[2];
+const uint32_t *in,*in2;
+int i,j,k,n,w,w1;
+
+w=jb->w;
+g=1.0/(1.0+jb->a1+jb->a2);
 g4=1.0/g/g/g/g;
 avg=EDGEAVG;	//koliko vzorcev za povprecje pri edge comp
 gavg=g4/avg;
-avgg=1.0/g/avg;
-iavg=1.0/avg;
+va1=f0r_v4f_set1(jb->a1); va2=f0r_v4f_set1(jb->a2); vg4=f0r_v4f_set1(g4);
+va12g=f0r_v4f_set1((jb->a1+jb->a2)*g); va2g=f0r_v4f_set1(jb->a2*g);
+w1=w-avg;
 
-for (j=0;j<avg;j++)	//prvih avg vrstic tja in nazaj
+for (j=first;j<last;j+=2)
 	{
-	jw=j*w; jww=jw+w;
-	cr=0.0;cg=0.0;cb=0.0;
-	if (ec!=0)
-		{	//edge comp (popvprecje prvih)
+	//a single last row goes through both chains, which then
+	//compute and store the same values
+	n=j+1<last ? 2 : 1;
+	s=jb->s+j*w; in=jb->in+j*w;
+	t=s+(n-1)*w; in2=in+(n-1)*w;
+
+	for (k=0;k<n;k++)
+		{
 		for (i=0;i<avg;i++)
-			{
-			s[jw+i].r=(float)(inframe[jw+i]&0xFF);
-			s[jw+i].g=(float)((inframe[jw+i]&0xFF00)>>8);
-			s[jw+i].b=(float)((inframe[jw+i]&0xFF0000)>>16);
-			cr=cr+s[jw+i].r;
-			cg=cg+s[jw+i].g;
-			cb=cb+s[jw+i].b;
+			FIBE_ST(s[k*w+i],f0r_v4f_from_rgb8(in[k*w+i]));
+		for (i=w1;i<w;i++)
+			FIBE_ST(s[k*w+i],f0r_v4f_from_rgb8(in[k*w+i]));
+
+		cl=f0r_v4f_set1(0.0);
+		FIBE_ST(cr[k],cl);
+		if (jb->ec!=0)
+			{	//edge comp (popvprecje prvih in zadnjih)
+			cl=f0r_v4f_mul(fibe_sum(s+k*w,avg,1),f0r_v4f_set1(gavg));
+			FIBE_ST(cr[k],f0r_v4f_mul(fibe_sum(s+k*w+w1,avg,1),f0r_v4f_set1(gavg)));
 			}
-		cr=cr*gavg; cg=cg*gavg; cb=cb*gavg;
+		x=f0r_v4f_sub(f0r_v4f_mul(vg4,FIBE_LD(s[k*w])),f0r_v4f_mul(va12g,cl));
+		FIBE_ST(s[k*w],x);
+		FIBE_ST(s[k*w+1],f0r_v4f_sub(f0r_v4f_sub(f0r_v4f_mul(vg4,FIBE_LD(s[k*w+1])),f0r_v4f_mul(va1,x)),f0r_v4f_mul(va2g,cl)));
 		}
-	else
-		for (i=0;i<avg;i++)
-			{
-			s[jw+i].r=(float)(inframe[jw+i]&0xFF);
-			s[jw+i].g=(float)((inframe[jw+i]&0xFF00)>>8);
-			s[jw+i].b=(float)((inframe[jw+i]&0xFF0000)>>16);
-			}
 
-	s[jw].r=g4*s[jw].r-(a1+a2)*g*cr;
-	s[jw].g=g4*s[jw].g-(a1+a2)*g*cg;
-	s[jw].b=g4*s[jw].b-(a1+a2)*g*cb;
-	s[jw+1].r=g4*s[jw+1].r-a1*s[jw].r-a2*g*cr;
-	s[jw+1].g=g4*s[jw+1].g-a1*s[jw].g-a2*g*cg;
-	s[jw+1].b=g4*s[jw+1].b-a1*s[jw].b-a2*g*cb;
-
-	if (ec!=0)
-		{	//edge comp za nazaj
-		cr=0.0;cg=0.0;cb=0.0;
-		for (i=w-avg;i<w;i++)
+	v2=FIBE_LD(s[0]); v1=FIBE_LD(s[1]);
+	u2=FIBE_LD(t[0]); u1=FIBE_LD(t[1]);
+	for (i=2;i<w;i++)	//tja
+		{
+		if (i<avg||i>=w1)
 			{
-			s[jw+i].r=(float)(inframe[jw+i]&0xFF);
-			s[jw+i].g=(float)((inframe[jw+i]&0xFF00)>>8);
-			s[jw+i].b=(float)((inframe[jw+i]&0xFF0000)>>16);
-			cr=cr+s[jw+i].r;
-			cg=cg+s[jw+i].g;
-			cb=cb+s[jw+i].b;
+			x=FIBE_LD(s[i]); y=FIBE_LD(t[i]);
 			}
-		cr=cr*gavg; cg=cg*gavg; cb=cb*gavg;
-		}
-	else
-		for (i=w-avg;i<w;i++)
+		else
 			{
-			s[jw+i].r=(float)(inframe[jw+i]&0xFF);
-			s[jw+i].g=(float)((inframe[jw+i]&0xFF00)>>8);
-			s[jw+i].b=(float)((inframe[jw+i]&0xFF0000)>>16);
+			x=f0r_v4f_from_rgb8(in[i]); y=f0r_v4f_from_rgb8(in2[i]);
 			}
-
-	for (i=2;i<avg;i++)	//tja (ze pretv. levo)
-		{
-		s[jw+i].r=g4*s[jw+i].r-a1*s[jw+i-1].r-a2*s[jw+i-2].r;
-		s[jw+i].g=g4*s[jw+i].g-a1*s[jw+i-1].g-a2*s[jw+i-2].g;
-		s[jw+i].b=g4*s[jw+i].b-a1*s[jw+i-1].b-a2*s[jw+i-2].b;
+		x=FIBE2O_TAP(f0r_v4f_mul(vg4,x),v1,v2);
+		y=FIBE2O_TAP(f0r_v4f_mul(vg4,y),u1,u2);
+		FIBE_ST(s[i],x); FIBE_ST(t[i],y);
+		v2=v1; v1=x; u2=u1; u1=y;
 		}
 
-	for (i=avg;i<w-avg;i++)	//tja (s pretvorbo)
+	for (k=0;k<n;k++)
 		{
-		s[jw+i].r=(float)(inframe[jw+i]&0xFF);
-		s[jw+i].g=(float)((inframe[jw+i]&0xFF00)>>8);
-		s[jw+i].b=(float)((inframe[jw+i]&0xFF0000)>>16);
-		s[jw+i].r=g4*s[jw+i].r-a1*s[jw+i-1].r-a2*s[jw+i-2].r;
-		s[jw+i].g=g4*s[jw+i].g-a1*s[jw+i-1].g-a2*s[jw+i-2].g;
-		s[jw+i].b=g4*s[jw+i].b-a1*s[jw+i-1].b-a2*s[jw+i-2].b;
+		fibe2o_edge(&s[k*w+w-1].r,&s[k*w+w-2].r,cr[k].r,jb,0);
+		fibe2o_edge(&s[k*w+w-1].g,&s[k*w+w-2].g,cr[k].g,jb,0);
+		fibe2o_edge(&s[k*w+w-1].b,&s[k*w+w-2].b,cr[k].b,jb,0);
 		}
 
-	for (i=w-avg;i<w;i++)	//tja (ze pretv. desno)
+	v2=FIBE_LD(s[w-1]); v1=FIBE_LD(s[w-2]);
+	u2=FIBE_LD(t[w-1]); u1=FIBE_LD(t[w-2]);
+	for (i=w-3;i>=0;i--)	//nazaj
 		{
-		s[jw+i].r=g4*s[jw+i].r-a1*s[jw+i-1].r-a2*s[jw+i-2].r;
-		s[jw+i].g=g4*s[jw+i].g-a1*s[jw+i-1].g-a2*s[jw+i-2].g;
-		s[jw+i].b=g4*s[jw+i].b-a1*s[jw+i-1].b-a2*s[jw+i-2].b;
+		x=FIBE2O_TAP(FIBE_LD(s[i]),v1,v2);
+		y=FIBE2O_TAP(FIBE_LD(t[i]),u1,u2);
+		FIBE_ST(s[i],x); FIBE_ST(t[i],y);
+		v2=v1; v1=x; u2=u1; u1=y;
 		}
+	}
+}
 
-	rep1.r=(s[jww-1].r+s[jww-2].r)*0.5*rs1+(s[jww-1].r-s[jww-2].r)*rd1;
-	rep1.g=(s[jww-1].g+s[jww-2].g)*0.5*rs1+(s[jww-1].g-s[jww-2].g)*rd1;
-	rep1.b=(s[jww-1].b+s[jww-2].b)*0.5*rs1+(s[jww-1].b-s[jww-2].b)*rd1;
-	rep2.r=(s[jww-1].r+s[jww-2].r)*0.5*rs2+(s[jww-1].r-s[jww-2].r)*rd2;
-	rep2.g=(s[jww-1].g+s[jww-2].g)*0.5*rs2+(s[jww-1].g-s[jww-2].g)*rd2;
-	rep2.b=(s[jww-1].b+s[jww-2].b)*0.5*rs2+(s[jww-1].b-s[jww-2].b)*rd2;
-
-	if (ec!=0)
-		{
-		rep1.r=rep1.r+rc1*cr;
-		rep1.g=rep1.g+rc1*cg;
-		rep1.b=rep1.b+rc1*cb;
-		rep2.r=rep2.r+rc2*cr;
-		rep2.g=rep2.g+rc2*cg;
-		rep2.b=rep2.b+rc2*cb;
-		}
-
-	s[jww-1].r=s[jww-1].r-a1*rep1.r-a2*rep2.r;
-	s[jww-1].g=s[jww-1].g-a1*rep1.g-a2*rep2.g;
-	s[jww-1].b=s[jww-1].b-a1*rep1.b-a2*rep2.b;
-	s[jww-2].r=s[jww-2].r-a1*s[jww-1].r-a2*rep1.r;
-	s[jww-2].g=s[jww-2].g-a1*s[jww-1].g-a2*rep1.g;
-	s[jww-2].b=s[jww-2].b-a1*s[jww-1].b-a2*rep1.b;
-
-	for (i=w-3;i>=0;i--)		//nazaj
-		{
-		s[jw+i].r=s[jw+i].r-a1*s[jw+i+1].r-a2*s[jw+i+2].r;
-		s[jw+i].g=s[jw+i].g-a1*s[jw+i+1].g-a2*s[jw+i+2].g;
-		s[jw+i].b=s[jw+i].b-a1*s[jw+i+1].b-a2*s[jw+i+2].b;
-		}
-	}	//prvih avg vrstic
+//down and up the columns [first,last), with the 8 bit output
+static void fibe2o_cols(void *arg, unsigned int band, unsigned int first, unsigned int last)
+{
+fibe_job *jb=(fibe_job*)arg;
+float g,avg,avgg,iavg;
+f0r_v4f va1,va2,va12g,va2g,v0,v255,c,v;
+float_rgba *s,*p,*q1,*q2,cc;
+uint32_t *out;
+int i,j,w,h;
+
+w=jb->w; h=jb->h; s=jb->s;
+g=1.0/(1.0+jb->a1+jb->a2);
+avg=EDGEAVG;
+avgg=1.0/g/avg;
+iavg=1.0/avg;
+va1=f0r_v4f_set1(jb->a1); va2=f0r_v4f_set1(jb->a2);
+va12g=f0r_v4f_set1((jb->a1+jb->a2)*g); va2g=f0r_v4f_set1(jb->a2*g);
+v0=f0r_v4f_set1(0.0); v255=f0r_v4f_set1(255.0);
 
-//edge comp zgoraj za navzdol
-for (j=0;j<w;j++)	//po stolpcih
+//edge comp zgoraj za navzdol, zgornji vrstici
+for (j=first;j<last;j++)
 	{
-	cr=0.0;cg=0.0;cb=0.0;
-	if (ec!=0)
-		{	//edge comp (popvprecje prvih)
-		for (i=0;i<avg;i++)
-			{
-			cr=cr+s[j+w*i].r;
-			cg=cg+s[j+w*i].g;
-			cb=cb+s[j+w*i].b;
-			}
-		cr=cr*iavg; cg=cg*iavg; cb=cb*iavg;
-		}
-
-//zgornji vrstici
-	s[j].r=s[j].r-(a1+a2)*g*cr;
-	s[j].g=s[j].g-(a1+a2)*g*cg;
-	s[j].b=s[j].b-(a1+a2)*g*cb;
-	s[j+w].r=s[j+w].r-a1*s[j].r-a2*g*cr;
-	s[j+w].g=s[j+w].g-a1*s[j].g-a2*g*cg;
-	s[j+w].b=s[j+w].b-a1*s[j].b-a2*g*cb;
+	c=v0;
+	if (jb->ec!=0)
+		c=f0r_v4f_mul(fibe_sum(s+j,avg,w),f0r_v4f_set1(iavg));
+	v=f0r_v4f_sub(FIBE_LD(s[j]),f0r_v4f_mul(va12g,c));
+	FIBE_ST(s[j],v);
+	FIBE_ST(s[j+w],f0r_v4f_sub(f0r_v4f_sub(FIBE_LD(s[j+w]),f0r_v4f_mul(va1,v)),f0r_v4f_mul(va2g,c)));
 	}
 
-//tretja do avg, samo navzdol (nazaj so ze)
-for (i=2;i<avg;i++)
+for (i=2;i<h;i++)	//dol
 	{
-	iw=i*w; i1w=iw-w;
-	for (j=0;j<w;j++)	//po stolpcih
-		{
-		s[j+iw].r=s[j+iw].r-a1*s[j+i1w].r-a2*s[j+i1w-w].r;
-		s[j+iw].g=s[j+iw].g-a1*s[j+i1w].g-a2*s[j+i1w-w].g;
-		s[j+iw].b=s[j+iw].b-a1*s[j+i1w].b-a2*s[j+i1w-w].b;
-		}
+	p=s+i*w; q1=p-w; q2=q1-w;
+	for (j=first;j<last;j++)
+		FIBE_ST(p[j],FIBE2O_TAP(FIBE_LD(p[j]),FIBE_LD(q1[j]),FIBE_LD(q2[j])));
 	}
 
-for (j=avg;j<h;j++)	//po vrsticah tja, nazaj in dol
-	{
-	jw=j*w; jww=jw+w;
-	cr=0.0;cg=0.0;cb=0.0;
-	if (ec!=0)
-		{	//edge comp (popvprecje prvih)
-		for (i=0;i<avg;i++)
-			{
-			s[jw+i].r=(float)(inframe[jw+i]&0xFF);
-			s[jw+i].g=(float)((inframe[jw+i]&0xFF00)>>8);
-			s[jw+i].b=(float)((inframe[jw+i]&0xFF0000)>>16);
-			cr=cr+s[jw+i].r;
-			cg=cg+s[jw+i].g;
-			cb=cb+s[jw+i].b;
-			}
-		cr=cr*gavg; cg=cg*gavg; cb=cb*gavg;
-		}
-	else
-		for (i=0;i<avg;i++)
-			{
-			s[jw+i].r=(float)(inframe[jw+i]&0xFF);
-			s[jw+i].g=(float)((inframe[jw+i]&0xFF00)>>8);
-			s[jw+i].b=(float)((inframe[jw+i]&0xFF0000)>>16);
-			}
-	s[jw].r=g4*s[jw].r-(a1+a2)*g*cr;
-	s[jw].g=g4*s[jw].g-(a1+a2)*g*cg;
-	s[jw].b=g4*s[jw].b-(a1+a2)*g*cb;
-	s[jw+1].r=g4*s[jw+1].r-a1*s[jw].r-a2*g*cr;
-	s[jw+1].g=g4*s[jw+1].g-a1*s[jw].g-a2*g*cg;
-	s[jw+1].b=g4*s[jw+1].b-a1*s[jw].b-a2*g*cb;
-
-	if (ec!=0)
-		{	//edge comp za nazaj
-		cr=0.0;cg=0.0;cb=0.0;
-		for (i=w-avg;i<w;i++)
-			{
-			s[jw+i].r=(float)(inframe[jw+i]&0xFF);
-			s[jw+i].g=(float)((inframe[jw+i]&0xFF00)>>8);
-			s[jw+i].b=(float)((inframe[jw+i]&0xFF0000)>>16);
-			cr=cr+s[jw+i].r;
-			cg=cg+s[jw+i].g;
-			cb=cb+s[jw+i].b;
-			}
-		cr=cr*gavg; cg=cg*gavg; cb=cb*gavg;
-		}
-	else
-		for (i=w-avg;i<w;i++)
-			{
-			s[jw+i].r=(float)(inframe[jw+i]&0xFF);
-			s[jw+i].g=(float)((inframe[jw+i]&0xFF00)>>8);
-			s[jw+i].b=(float)((inframe[jw+i]&0xFF0000)>>16);
-			}
-
-	for (i=2;i<avg;i++)	//tja  (ze pretv. levo)
-		{
-		s[jw+i].r=g4*s[jw+i].r-a1*s[jw+i-1].r-a2*s[jw+i-2].r;
-		s[jw+i].g=g4*s[jw+i].g-a1*s[jw+i-1].g-a2*s[jw+i-2].g;
-		s[jw+i].b=g4*s[jw+i].b-a1*s[jw+i-1].b-a2*s[jw+i-2].b;
-		}
-
-	for (i=avg;i<w-avg;i++)	//tja  (s retvorbo)
-		{
-		s[jw+i].r=(float)(inframe[jw+i]&0xFF);
-		s[jw+i].g=(float)((inframe[jw+i]&0xFF00)>>8);
-		s[jw+i].b=(float)((inframe[jw+i]&0xFF0000)>>16);
-		s[jw+i].r=g4*s[jw+i].r-a1*s[jw+i-1].r-a2*s[jw+i-2].r;
-		s[jw+i].g=g4*s[jw+i].g-a1*s[jw+i-1].g-a2*s[jw+i-2].g;
-		s[jw+i].b=g4*s[jw+i].b-a1*s[jw+i-1].b-a2*s[jw+i-2].b;
-		}
-
-	for (i=w-avg;i<w;i++)	//tja  (ze pretv. desno)
-		{
-		s[jw+i].r=g4*s[jw+i].r-a1*s[jw+i-1].r-a2*s[jw+i-2].r;
-		s[jw+i].g=g4*s[jw+i].g-a1*s[jw+i-1].g-a2*s[jw+i-2].g;
-		s[jw+i].b=g4*s[jw+i].b-a1*s[jw+i-1].b-a2*s[jw+i-2].b;
-		}
-
-	rep1.r=(s[jww-1].r+s[jww-2].r)*0.5*rs1+(s[jww-1].r-s[jww-2].r)*rd1;
-	rep1.g=(s[jww-1].g+s[jww-2].g)*0.5*rs1+(s[jww-1].g-s[jww-2].g)*rd1;
-	rep1.b=(s[jww-1].b+s[jww-2].b)*0.5*rs1+(s[jww-1].b-s[jww-2].b)*rd1;
-	rep2.r=(s[jww-1].r+s[jww-2].r)*0.5*rs2+(s[jww-1].r-s[jww-2].r)*rd2;
-	rep2.g=(s[jww-1].g+s[jww-2].g)*0.5*rs2+(s[jww-1].g-s[jww-2].g)*rd2;
-	rep2.b=(s[jww-1].b+s[jww-2].b)*0.5*rs2+(s[jww-1].b-s[jww-2].b)*rd2;
-
-	if (ec!=0)
-		{
-		rep1.r=rep1.r+rc1*cr;
-		rep1.g=rep1.g+rc1*cg;
-		rep1.b=rep1.b+rc1*cb;
-		rep2.r=rep2.r+rc2*cr;
-		rep2.g=rep2.g+rc2*cg;
-		rep2.b=rep2.b+rc2*cb;
-		}
-
-	s[jww-1].r=s[jww-1].r-a1*rep1.r-a2*rep2.r;
-	s[jww-1].g=s[jww-1].g-a1*rep1.g-a2*rep2.g;
-	s[jww-1].b=s[jww-1].b-a1*rep1.b-a2*rep2.b;
-	s[jww-2].r=s[jww-2].r-a1*s[jww-1].r-a2*rep1.r;
-	s[jww-2].g=s[jww-2].g-a1*s[jww-1].g-a2*rep1.g;
-	s[jww-2].b=s[jww-2].b-a1*s[jww-1].b-a2*rep1.b;
-
-	for (i=w-3;i>=0;i--)	//po stolpcih
-		{ //nazaj
-		s[jw+i].r=s[jw+i].r-a1*s[jw+i+1].r-a2*s[jw+i+2].r;
-		s[jw+i].g=s[jw+i].g-a1*s[jw+i+1].g-a2*s[jw+i+2].g;
-		s[jw+i].b=s[jw+i].b-a1*s[jw+i+1].b-a2*s[jw+i+2].b;
-//dol
-		s[jw+i+2].r=s[jw+i+2].r-a1*s[jw-w+i+2].r-a2*s[jw-w-w+i+2].r;
-		s[jw+i+2].g=s[jw+i+2].g-a1*s[jw-w+i+2].g-a2*s[jw-w-w+i+2].g;
-		s[jw+i+2].b=s[jw+i+2].b-a1*s[jw-w+i+2].b-a2*s[jw-w-w+i+2].b;
-		}
-
-//se leva stolpca dol
-	s[jw+1].r=s[jw+1].r-a1*s[jw-w+1].r-a2*s[jw-w-w+1].r;
-	s[jw+1].g=s[jw+1].g-a1*s[jw-w+1].g-a2*s[jw-w-w+1].g;
-	s[jw+1].b=s[jw+1].b-a1*s[jw-w+1].b-a2*s[jw-w-w+1].b;
-	s[jw].r=s[jw].r-a1*s[jw-w].r-a2*s[jw-w-w].r;
-	s[jw].g=s[jw].g-a1*s[jw-w].g-a2*s[jw-w-w].g;
-	s[jw].b=s[jw].b-a1*s[jw-w].b-a2*s[jw-w-w].b;
-
-	}	//po vrsticah
-
-//pa se navzgor
 //spodnji dve vrstici
-h1w=(h-1)*w; h2w=(h-2)*w;
-for (j=0;j<w;j++)	//po stolpcih
+p=s+(h-1)*w; q1=p-w;
+for (j=first;j<last;j++)
 	{
-	if (ec!=0)
-		{	//edge comp za gor
-		cr=0.0;cg=0.0;cb=0.0;
-		for (i=h-avg;i<h;i++)
-			{
-			cr=cr+s[j+w*i].r;
-			cg=cg+s[j+w*i].g;
-			cb=cb+s[j+w*i].b;
-			}
-		cr=cr*avgg; cg=cg*avgg; cb=cb*avgg;
-		}
-
-	rep1.r=(s[j+h1w].r+s[j+h2w].r)*0.5*rs1+(s[j+h1w].r-s[j+h2w].r)*rd1;
-	rep1.g=(s[j+h1w].g+s[j+h2w].g)*0.5*rs1+(s[j+h1w].g-s[j+h2w].g)*rd1;
-	rep1.b=(s[j+h1w].b+s[j+h2w].b)*0.5*rs1+(s[j+h1w].b-s[j+h2w].b)*rd1;
-	rep2.r=(s[j+h1w].r+s[j+h2w].r)*0.5*rs2+(s[j+h1w].r-s[j+h2w].r)*rd2;
-	rep2.g=(s[j+h1w].g+s[j+h2w].g)*0.5*rs2+(s[j+h1w].g-s[j+h2w].g)*rd2;
-	rep2.b=(s[j+h1w].b+s[j+h2w].b)*0.5*rs2+(s[j+h1w].b-s[j+h2w].b)*rd2;
-
-	if (ec!=0)
-		{	//edge comp
-		rep1.r=rep1.r+rc1*cr;
-		rep1.g=rep1.g+rc1*cg;
-		rep1.b=rep1.b+rc1*cb;
-		rep2.r=rep2.r+rc2*cr;
-		rep2.g=rep2.g+rc2*cg;
-		rep2.b=rep2.b+rc2*cb;
-		}
-
-	s[j+h1w].r=s[j+h1w].r-a1*rep1.r-a2*rep2.r;
-	s[j+h1w].g=s[j+h1w].g-a1*rep1.g-a2*rep2.g;
-	s[j+h1w].b=s[j+h1w].b-a1*rep1.b-a2*rep2.b;
-	if (s[j+h1w].r>255) s[j+h1w].r=255.0;
-	if (s[j+h1w].r<0.0) s[j+h1w].r=0.0;
-	if (s[j+h1w].g>255) s[j+h1w].g=255.0;
-	if (s[j+h1w].g<0.0) s[j+h1w].g=0.0;
-	if (s[j+h1w].b>255) s[j+h1w].b=255.0;
-	if (s[j+h1w].b<0.0) s[j+h1w].b=0.0;
-	outframe[j+h1w]=((uint32_t)s[j+h1w].r&0xFF) + (((uint32_t)s[j+h1w].g&0xFF)<<8) + (((uint32_t)s[j+h1w].b&0xFF)<<16);
-	s[j+h2w].r=s[j+h2w].r-a1*s[j+h1w].r-a2*rep1.r;
-	s[j+h2w].g=s[j+h2w].g-a1*s[j+h1w].g-a2*rep1.g;
-	s[j+h2w].b=s[j+h2w].b-a1*s[j+h1w].b-a2*rep1.b;
-	if (s[j+h2w].r>255) s[j+h2w].r=255.0;
-	if (s[j+h2w].r<0.0) s[j+h2w].r=0.0;
-	if (s[j+h2w].g>255) s[j+h2w].g=255.0;
-	if (s[j+h2w].g<0.0) s[j+h2w].g=0.0;
-	if (s[j+h2w].b>255) s[j+h2w].b=255.0;
-	if (s[j+h2w].b<0.0) s[j+h2w].b=0.0;
-	outframe[j+h2w]=((uint32_t)s[j+h2w].r&0xFF) + (((uint32_t)s[j+h2w].g&0xFF)<<8) + (((uint32_t)s[j+h2w].b&0xFF)<<16);
+	c=v0;
+	if (jb->ec!=0)	//edge comp za gor
+		c=f0r_v4f_mul(fibe_sum(s+(h-(int)avg)*w+j,avg,w),f0r_v4f_set1(avgg));
+	FIBE_ST(cc,c);
+	fibe2o_edge(&p[j].r,&q1[j].r,cc.r,jb,1);
+	fibe2o_edge(&p[j].g,&q1[j].g,cc.g,jb,1);
+	fibe2o_edge(&p[j].b,&q1[j].b,cc.b,jb,1);
+	jb->out[(h-1)*w+j]=f0r_v4f_to_rgb8(FIBE_LD(p[j]));
+	jb->out[(h-2)*w+j]=f0r_v4f_to_rgb8(FIBE_LD(q1[j]));
 	}
 
-//ostale vrstice
-for (i=h-3;i>=0;i--)		//gor
+for (i=h-3;i>=0;i--)	//gor
 	{
-	iw=i*w; i1w=iw+w; i2w=i1w+w;
-	for (j=0;j<w;j++)
+	p=s+i*w; q1=p+w; q2=q1+w; out=jb->out+i*w;
+	for (j=first;j<last;j++)
 		{
-		s[j+iw].r=s[j+iw].r-a1*s[j+i1w].r-a2*s[j+i2w].r;
-		s[j+iw].g=s[j+iw].g-a1*s[j+i1w].g-a2*s[j+i2w].g;
-		s[j+iw].b=s[j+iw].b-a1*s[j+i1w].b-a2*s[j+i2w].b;
-		if (s[j+iw].r>255) s[j+iw].r=255.0;
-		if (s[j+iw].r<0.0) s[j+iw].r=0.0;
-		if (s[j+iw].g>255) s[j+iw].g=255.0;
-		if (s[j+iw].g<0.0) s[j+iw].g=0.0;
-		if (s[j+iw].b>255) s[j+iw].b=255.0;
-		if (s[j+iw].b<0.0) s[j+iw].b=0.0;
-		outframe[j+iw]=((uint32_t)s[j+iw].r&0xFF) + (((uint32_t)s[j+iw].g&0xFF)<<8) + (((uint32_t)s[j+iw].b&0xFF)<<16);
+		v=FIBE2O_TAP(FIBE_LD(p[j]),FIBE_LD(q1[j]),FIBE_LD(q2[j]));
+		v=f0r_v4f_max(f0r_v4f_min(v,v255),v0);
+		FIBE_ST(p[j],v);
+		out[j]=f0r_v4f_to_rgb8(v);
 		}
 	}
+}
 
+void fibe2o_8(const uint32_t* inframe, uint32_t* outframe, float_rgba s[], int w, int h, float a1, float a2,  float rd1, float rd2, float rs1, float rs2, float rc1, float rc2, int ec)
+{
+fibe_job job;
+
+job.in=inframe; job.out=outframe; job.s=s;
+job.w=w; job.h=h; job.ec=ec;
+job.a1=a1; job.a2=a2;
+job.rd1=rd1; job.rd2=rd2; job.rs1=rs1; job.rs2=rs2; job.rc1=rc1; job.rc2=rc2;
+fibe_parallel(h,fibe2o_rows,&job);
+fibe_parallel(w,fibe2o_cols,&job);
 }
 
 //-------------------------------------------------------
@@ -856,199 +535,150 @@ for (i=h-3;i>=0;i--)		//gor
 //a only verzija, a0=1.0
 //edge efekt na desni kompenzira tako, da racuna 256 vzorcev
 //cez rob in in gre potem nazaj
-void fibe3_8(const uint32_t* inframe, uint32_t* outframe, float_rgba s[], int w, int h, float a1, float a2, float a3, int ec)
-{
-float cr,cg,cb,g,g4,avg;
-int i,j;
-float_rgba lb[4096];
-int cez;
-
-g=1.0/(1.0+a1+a2+a3); g4=1.0/g/g/g/g;
-
-avg=EDGEAVG;	//koliko vzorcev za povprecje pri edge comp
-cez=256;	//koliko vzorcev gre cez na desni
-
-for (j=0;j<h;j++)	//po vrsticah
-	{
-	cr=0.0;cg=0.0;cb=0.0;
-	if (ec!=0)
-		{	//edge comp (popvprecje prvih)
-		for (i=0;i<avg;i++)
-			{
-			s[j*w+i].r=(float)(inframe[j*w+i]&0xFF);
-			s[j*w+i].g=(float)((inframe[j*w+i]&0xFF00)>>8);
-			s[j*w+i].b=(float)((inframe[j*w+i]&0xFF0000)>>16);
-			cr=cr+s[j*w+i].r;
-			cg=cg+s[j*w+i].g;
-			cb=cb+s[j*w+i].b;
-			}
-		cr=g4*cr/avg; cg=g4*cg/avg; cb=g4*cb/avg;
-		}
-	else
-		for (i=0;i<avg;i++)
-			{
-			s[j*w+i].r=(float)(inframe[j*w+i]&0xFF);
-			s[j*w+i].g=(float)((inframe[j*w+i]&0xFF00)>>8);
-			s[j*w+i].b=(float)((inframe[j*w+i]&0xFF0000)>>16);
-			}
-	lb[0].r=g4*s[j*w].r-(a1+a2+a3)*g*cr;
-	lb[0].g=g4*s[j*w].g-(a1+a2+a3)*g*cg;
-	lb[0].b=g4*s[j*w].b-(a1+a2+a3)*g*cb;
-	lb[1].r=g4*s[j*w+1].r-a1*lb[0].r-(a2+a3)*g*cr;
-	lb[1].g=g4*s[j*w+1].g-a1*lb[0].g-(a2+a3)*g*cg;
-	lb[1].b=g4*s[j*w+1].b-a1*lb[0].b-(a2+a3)*g*cb;
-	lb[2].r=g4*s[j*w+2].r-a1*lb[1].r-a2*lb[0].r-a3*g*cr;
-	lb[2].g=g4*s[j*w+2].g-a1*lb[1].g-a2*lb[0].g-a3*g*cg;
-	lb[2].b=g4*s[j*w+2].b-a1*lb[1].b-a2*lb[0].b-a3*g*cb;
-
-	for (i=3;i<avg;i++)	//tja  (ze pretvorjeni)
-		{
-		lb[i].r=g4*s[j*w+i].r-a1*lb[i-1].r-a2*lb[i-2].r-a3*lb[i-3].r;
-		lb[i].g=g4*s[j*w+i].g-a1*lb[i-1].g-a2*lb[i-2].g-a3*lb[i-3].g;
-		lb[i].b=g4*s[j*w+i].b-a1*lb[i-1].b-a2*lb[i-2].b-a3*lb[i-3].b;
-		}
 
-	for (i=avg;i<w;i++)	//tja  (s pretvorbo)
-		{
-		s[j*w+i].r=(float)(inframe[j*w+i]&0xFF);
-		s[j*w+i].g=(float)((inframe[j*w+i]&0xFF00)>>8);
-		s[j*w+i].b=(float)((inframe[j*w+i]&0xFF0000)>>16);
-		lb[i].r=g4*s[j*w+i].r-a1*lb[i-1].r-a2*lb[i-2].r-a3*lb[i-3].r;
-		lb[i].g=g4*s[j*w+i].g-a1*lb[i-1].g-a2*lb[i-2].g-a3*lb[i-3].g;
-		lb[i].b=g4*s[j*w+i].b-a1*lb[i-1].b-a2*lb[i-2].b-a3*lb[i-3].b;
-		}
+#define FIBE3_CEZ 256	//koliko vzorcev gre cez na desni
+#define FIBE3_COLS 8	//columns filtered together
 
-	cr=0.0;cg=0.0;cb=0.0;
-	if (ec!=0)
-		{	//edge comp
-		for (i=w-avg;i<w;i++)
-			{
-			cr=cr+s[j*w+i].r;
-			cg=cg+s[j*w+i].g;
-			cb=cb+s[j*w+i].b;
-			}
-		cr=g4*cr/avg; cg=g4*cg/avg; cb=g4*cb/avg;
-		}
+//x-a1*l1-a2*l2-a3*l3
+#define FIBE3_TAP(x,l1,l2,l3) \
+	f0r_v4f_sub(f0r_v4f_sub(f0r_v4f_sub((x),f0r_v4f_mul(va1,(l1))),f0r_v4f_mul(va2,(l2))),f0r_v4f_mul(va3,(l3)))
 
-	for (i=w;i<(w+cez);i++)	//naprej cez rob
-		{
-		lb[i].r=cr-a1*lb[i-1].r-a2*lb[i-2].r-a3*lb[i-3].r;
-		lb[i].g=cr-a1*lb[i-1].g-a2*lb[i-2].g-a3*lb[i-3].g;
-		lb[i].b=cr-a1*lb[i-1].b-a2*lb[i-2].b-a3*lb[i-3].b;
-		}
-	//nazaj do roba
-	lb[w+cez-2].r=lb[w+cez-2].r-a1*lb[w+cez-1].r;
-	lb[w+cez-2].g=lb[w+cez-2].g-a1*lb[w+cez-1].g;
-	lb[w+cez-2].b=lb[w+cez-2].b-a1*lb[w+cez-1].b;
-	lb[w+cez-3].r=lb[w+cez-3].r-a1*lb[w+cez-2].r-a2*lb[w+cez-1].r;
-	lb[w+cez-3].g=lb[w+cez-3].g-a1*lb[w+cez-2].g-a2*lb[w+cez-1].g;
-	lb[w+cez-3].b=lb[w+cez-3].b-a1*lb[w+cez-2].b-a2*lb[w+cez-1].b;
-	for (i=(w+cez-4);i>=w;i--)
-		{
-		lb[i].r=lb[i].r-a1*lb[i+1].r-a2*lb[i+2].r-a3*lb[i+3].r;
-		lb[i].g=lb[i].g-a1*lb[i+1].g-a2*lb[i+2].g-a3*lb[i+3].g;
-		lb[i].b=lb[i].b-a1*lb[i+1].b-a2*lb[i+2].b-a3*lb[i+3].b;
-		}
+//continues the forward pass lb[0..n) past the edge with the constant
+//input c, runs back to the edge and then back over s[0..n). Pixels
+//are step apart in lb and sstep apart in s.
+static inline void fibe3_back(float_rgba *lb, float_rgba *s, int n, int step, int sstep, f0r_v4f c, f0r_v4f va1, f0r_v4f va2, f0r_v4f va3)
+{
+int i,m;
+
+m=n+FIBE3_CEZ;
+for (i=n;i<m;i++)	//naprej cez rob
+	FIBE_ST(lb[i*step],FIBE3_TAP(c,FIBE_LD(lb[(i-1)*step]),FIBE_LD(lb[(i-2)*step]),FIBE_LD(lb[(i-3)*step])));
+//nazaj do roba
+FIBE_ST(lb[(m-2)*step],f0r_v4f_sub(FIBE_LD(lb[(m-2)*step]),f0r_v4f_mul(va1,FIBE_LD(lb[(m-1)*step]))));
+FIBE_ST(lb[(m-3)*step],f0r_v4f_sub(f0r_v4f_sub(FIBE_LD(lb[(m-3)*step]),f0r_v4f_mul(va1,FIBE_LD(lb[(m-2)*step]))),f0r_v4f_mul(va2,FIBE_LD(lb[(m-1)*step]))));
+for (i=m-4;i>=n;i--)
+	FIBE_ST(lb[i*step],FIBE3_TAP(FIBE_LD(lb[i*step]),FIBE_LD(lb[(i+1)*step]),FIBE_LD(lb[(i+2)*step]),FIBE_LD(lb[(i+3)*step])));
+
+FIBE_ST(s[(n-1)*sstep],FIBE3_TAP(FIBE_LD(lb[(n-1)*step]),FIBE_LD(lb[n*step]),FIBE_LD(lb[(n+1)*step]),FIBE_LD(lb[(n+2)*step])));
+FIBE_ST(s[(n-2)*sstep],FIBE3_TAP(FIBE_LD(lb[(n-2)*step]),FIBE_LD(s[(n-1)*sstep]),FIBE_LD(lb[n*step]),FIBE_LD(lb[(n+1)*step])));
+FIBE_ST(s[(n-3)*sstep],FIBE3_TAP(FIBE_LD(lb[(n-3)*step]),FIBE_LD(s[(n-2)*sstep]),FIBE_LD(s[(n-1)*sstep]),FIBE_LD(lb[n*step])));
+for (i=n-4;i>=0;i--)	//nazaj
+	FIBE_ST(s[i*sstep],FIBE3_TAP(FIBE_LD(lb[i*step]),FIBE_LD(s[(i+1)*sstep]),FIBE_LD(s[(i+2)*sstep]),FIBE_LD(s[(i+3)*sstep])));
+}
 
-	s[j*w+w-1].r=lb[w-1].r-a1*lb[w].r-a2*lb[w+1].r-a3*lb[w+2].r;
-	s[j*w+w-1].g=lb[w-1].g-a1*lb[w].g-a2*lb[w+1].g-a3*lb[w+2].g;
-	s[j*w+w-1].b=lb[w-1].b-a1*lb[w].b-a2*lb[w+1].b-a3*lb[w+2].b;
-	s[j*w+w-2].r=lb[w-2].r-a1*s[j*w+w-1].r-a2*lb[w].r-a3*lb[w+1].r;
-	s[j*w+w-2].g=lb[w-2].g-a1*s[j*w+w-1].g-a2*lb[w].g-a3*lb[w+1].g;
-	s[j*w+w-2].b=lb[w-2].b-a1*s[j*w+w-1].b-a2*lb[w].b-a3*lb[w+1].b;
-	s[j*w+w-3].r=lb[w-3].r-a1*s[j*w+w-2].r-a2*s[j*w+w-1].r-a3*lb[w].r;
-	s[j*w+w-3].g=lb[w-3].g-a1*s[j*w+w-2].g-a2*s[j*w+w-1].g-a3*lb[w].g;
-	s[j*w+w-3].b=lb[w-3].b-a1*s[j*w+w-2].b-a2*s[j*w+w-1].b-a3*lb[w].b;
-
-	for (i=w-4;i>=0;i--)		//nazaj
-		{
-		s[j*w+i].r=lb[i].r-a1*s[j*w+i+1].r-a2*s[j*w+i+2].r-a3*s[j*w+i+3].r;
-		s[j*w+i].g=lb[i].g-a1*s[j*w+i+1].g-a2*s[j*w+i+2].g-a3*s[j*w+i+3].g;
-		s[j*w+i].b=lb[i].b-a1*s[j*w+i+1].b-a2*s[j*w+i+2].b-a3*s[j*w+i+3].b;
-		}
-	}	//po vrsticah
+//forward and back along the rows [first,last)
+static void fibe3_rows(void *arg, unsigned int band, unsigned int first, unsigned int last)
+{
+fibe_job *jb=(fibe_job*)arg;
+float g,g4,avg;
+f0r_v4f va1,va2,va3,vg4,vk3,vk2,vk1,c;
+float_rgba *s,*lb,cc;
+const uint32_t *in;
+int i,j,w;
+
+w=jb->w;
+g=1.0/(1.0+jb->a1+jb->a2+jb->a3); g4=1.0/g/g/g/g;
+avg=EDGEAVG;	//koliko vzorcev za povprecje pri edge comp
+va1=f0r_v4f_set1(jb->a1); va2=f0r_v4f_set1(jb->a2); va3=f0r_v4f_set1(jb->a3);
+vg4=f0r_v4f_set1(g4);
+vk3=f0r_v4f_set1((jb->a1+jb->a2+jb->a3)*g);
+vk2=f0r_v4f_set1((jb->a2+jb->a3)*g);
+vk1=f0r_v4f_set1(jb->a3*g);
+lb=(float_rgba*)malloc((w+FIBE3_CEZ)*sizeof(float_rgba));
+
+for (j=first;j<last;j++)	//po vrsticah
+	{
+	s=jb->s+j*w; in=jb->in+j*w;
+	for (i=0;i<w;i++)
+		FIBE_ST(s[i],f0r_v4f_from_rgb8(in[i]));
+
+	c=f0r_v4f_set1(0.0);
+	if (jb->ec!=0)	//edge comp (popvprecje prvih)
+		c=f0r_v4f_div(f0r_v4f_mul(vg4,fibe_sum(s,avg,1)),f0r_v4f_set1(avg));
+	FIBE_ST(lb[0],f0r_v4f_sub(f0r_v4f_mul(vg4,FIBE_LD(s[0])),f0r_v4f_mul(vk3,c)));
+	FIBE_ST(lb[1],f0r_v4f_sub(f0r_v4f_sub(f0r_v4f_mul(vg4,FIBE_LD(s[1])),f0r_v4f_mul(va1,FIBE_LD(lb[0]))),f0r_v4f_mul(vk2,c)));
+	FIBE_ST(lb[2],f0r_v4f_sub(f0r_v4f_sub(f0r_v4f_sub(f0r_v4f_mul(vg4,FIBE_LD(s[2])),f0r_v4f_mul(va1,FIBE_LD(lb[1]))),f0r_v4f_mul(va2,FIBE_LD(lb[0]))),f0r_v4f_mul(vk1,c)));
+	for (i=3;i<w;i++)	//tja
+		FIBE_ST(lb[i],FIBE3_TAP(f0r_v4f_mul(vg4,FIBE_LD(s[i])),FIBE_LD(lb[i-1]),FIBE_LD(lb[i-2]),FIBE_LD(lb[i-3])));
+
+	c=f0r_v4f_set1(0.0);
+	if (jb->ec!=0)	//edge comp
+		c=f0r_v4f_div(f0r_v4f_mul(vg4,fibe_sum(s+w-(int)avg,avg,1)),f0r_v4f_set1(avg));
+	//the scalar version continued all three channels of a row with
+	//the red average, which is kept
+	FIBE_ST(cc,c);
+	fibe3_back(lb,s,w,1,1,f0r_v4f_set1(cc.r),va1,va2,va3);
+	}
+free(lb);
+}
 
-for (j=0;j<w;j++)	//po stolpcih
+//down and up the columns [first,last), with the 8 bit output
+static void fibe3_cols(void *arg, unsigned int band, unsigned int first, unsigned int last)
+{
+fibe_job *jb=(fibe_job*)arg;
+float g,avg;
+f0r_v4f va1,va2,va3,vk3,vk2,vk1,vavg,c;
+float_rgba *s,*lb,*l,*col;
+uint32_t *out;
+int i,j,k,n,w,h;
+
+w=jb->w; h=jb->h;
+g=1.0/(1.0+jb->a1+jb->a2+jb->a3);
+avg=EDGEAVG;
+va1=f0r_v4f_set1(jb->a1); va2=f0r_v4f_set1(jb->a2); va3=f0r_v4f_set1(jb->a3);
+vk3=f0r_v4f_set1((jb->a1+jb->a2+jb->a3)*g);
+vk2=f0r_v4f_set1((jb->a2+jb->a3)*g);
+vk1=f0r_v4f_set1(jb->a3*g);
+vavg=f0r_v4f_set1(avg);
+lb=(float_rgba*)malloc((h+FIBE3_CEZ)*FIBE3_COLS*sizeof(float_rgba));
+
+//groups of columns, so that a row of the group is contiguous
+for (j=first;j<last;j+=FIBE3_COLS)
 	{
-	cr=0.0;cg=0.0;cb=0.0;
-	if (ec!=0)
-		{	//edge comp (popvprecje prvih)
-		for (i=0;i<avg;i++)
-			{
-			cr=cr+s[j+w*i].r;
-			cg=cg+s[j+w*i].g;
-			cb=cb+s[j+w*i].b;
-			}
-		cr=cr/avg; cg=cg/avg; cb=cb/avg;
-		}
-	lb[0].r=s[j].r-(a1+a2+a3)*g*cr;
-	lb[0].g=s[j].g-(a1+a2+a3)*g*cg;
-	lb[0].b=s[j].b-(a1+a2+a3)*g*cb;
-	lb[1].r=s[j+w].r-a1*lb[0].r-(a2+a3)*g*cr;
-	lb[1].g=s[j+w].g-a1*lb[0].g-(a2+a3)*g*cg;
-	lb[1].b=s[j+w].b-a1*lb[0].b-(a2+a3)*g*cb;
-	lb[2].r=s[j+2*w].r-a1*lb[1].r-a2*lb[0].r-a3*g*cr;
-	lb[2].g=s[j+2*w].g-a1*lb[1].g-a2*lb[0].g-a3*g*cg;
-	lb[2].b=s[j+2*w].b-a1*lb[1].b-a2*lb[0].b-a3*g*cb;
-
-	for (i=3;i<h;i++)		//dol
+	n=last-j; if (n>FIBE3_COLS) n=FIBE3_COLS;
+	s=jb->s+j;
+	for (k=0;k<n;k++)
 		{
-		lb[i].r=s[j+w*i].r-a1*lb[i-1].r-a2*lb[i-2].r-a3*lb[i-3].r;
-		lb[i].g=s[j+w*i].g-a1*lb[i-1].g-a2*lb[i-2].g-a3*lb[i-3].g;
-		lb[i].b=s[j+w*i].b-a1*lb[i-1].b-a2*lb[i-2].b-a3*lb[i-3].b;
-		}
-
-	cr=0.0;cg=0.0;cb=0.0;
-	if (ec!=0)
-		{	//edge comp
-		for (i=h-avg;i<h;i++)
-			{
-			cr=cr+s[j+w*i].r;
-			cg=cg+s[j+w*i].g;
-			cb=cb+s[j+w*i].b;
-			}
-		cr=cr/avg; cg=cg/avg; cb=cb/avg;
+		c=f0r_v4f_set1(0.0);
+		if (jb->ec!=0)	//edge comp (popvprecje prvih)
+			c=f0r_v4f_div(fibe_sum(s+k,avg,w),vavg);
+		l=lb+k;
+		FIBE_ST(l[0],f0r_v4f_sub(FIBE_LD(s[k]),f0r_v4f_mul(vk3,c)));
+		FIBE_ST(l[FIBE3_COLS],f0r_v4f_sub(f0r_v4f_sub(FIBE_LD(s[k+w]),f0r_v4f_mul(va1,FIBE_LD(l[0]))),f0r_v4f_mul(vk2,c)));
+		FIBE_ST(l[2*FIBE3_COLS],f0r_v4f_sub(f0r_v4f_sub(f0r_v4f_sub(FIBE_LD(s[k+2*w]),f0r_v4f_mul(va1,FIBE_LD(l[FIBE3_COLS]))),f0r_v4f_mul(va2,FIBE_LD(l[0]))),f0r_v4f_mul(vk1,c)));
 		}
-
-	for (i=h;i<(h+cez);i++)	//naprej cez rob
+	for (i=3;i<h;i++)	//dol
 		{
-		lb[i].r=cr-a1*lb[i-1].r-a2*lb[i-2].r-a3*lb[i-3].r;
-		lb[i].g=cg-a1*lb[i-1].g-a2*lb[i-2].g-a3*lb[i-3].g;
-		lb[i].b=cb-a1*lb[i-1].b-a2*lb[i-2].b-a3*lb[i-3].b;
+		l=lb+i*FIBE3_COLS; col=s+i*w;
+		for (k=0;k<n;k++)
+			FIBE_ST(l[k],FIBE3_TAP(FIBE_LD(col[k]),FIBE_LD(l[k-FIBE3_COLS]),FIBE_LD(l[k-2*FIBE3_COLS]),FIBE_LD(l[k-3*FIBE3_COLS])));
 		}
-	//nazaj do roba
-	lb[h+cez-2].r=lb[h+cez-2].r-a1*lb[h+cez-1].r;
-	lb[h+cez-2].g=lb[h+cez-2].g-a1*lb[h+cez-1].g;
-	lb[h+cez-2].b=lb[h+cez-2].b-a1*lb[h+cez-1].b;
-	lb[h+cez-3].r=lb[h+cez-3].r-a1*lb[h+cez-2].r-a2*lb[h+cez-1].r;
-	lb[h+cez-3].g=lb[h+cez-3].g-a1*lb[h+cez-2].g-a2*lb[h+cez-1].g;
-	lb[h+cez-3].b=lb[h+cez-3].b-a1*lb[h+cez-2].b-a2*lb[h+cez-1].b;
-	for (i=(h+cez-4);i>=h;i--)
+
+	for (k=0;k<n;k++)
 		{
-		lb[i].r=lb[i].r-a1*lb[i+1].r-a2*lb[i+2].r-a3*lb[i+3].r;
-		lb[i].g=lb[i].g-a1*lb[i+1].g-a2*lb[i+2].g-a3*lb[i+3].g;
-		lb[i].b=lb[i].b-a1*lb[i+1].b-a2*lb[i+2].b-a3*lb[i+3].b;
+		c=f0r_v4f_set1(0.0);
+		if (jb->ec!=0)	//edge comp
+			c=f0r_v4f_div(fibe_sum(s+(h-(int)avg)*w+k,avg,w),vavg);
+		fibe3_back(lb+k,s+k,h,FIBE3_COLS,w,c,va1,va2,va3);
 		}
 
-	s[j+(h-1)*w].r=lb[h-1].r-a1*lb[h].r-a2*lb[h+1].r-a3*lb[h+2].r;
-	s[j+(h-1)*w].g=lb[h-1].g-a1*lb[h].g-a2*lb[h+1].g-a3*lb[h+2].g;
-	s[j+(h-1)*w].b=lb[h-1].b-a1*lb[h].b-a2*lb[h+1].b-a3*lb[h+2].b;
-	s[j+(h-2)*w].r=lb[h-2].r-a1*s[j+(h-1)*w].r-a2*lb[h].r-a3*lb[h+1].r;
-	s[j+(h-2)*w].g=lb[h-2].g-a1*s[j+(h-1)*w].g-a2*lb[h].g-a3*lb[h+1].g;
-	s[j+(h-2)*w].b=lb[h-2].b-a1*s[j+(h-1)*w].b-a2*lb[h].b-a3*lb[h+1].b;
-	s[j+(h-3)*w].r=lb[h-3].r-a1*s[j+(h-2)*w].r-a2*s[j+(h-1)*w].r-a3*lb[h].r;
-	s[j+(h-3)*w].g=lb[h-3].g-a1*s[j+(h-2)*w].g-a2*s[j+(h-1)*w].g-a3*lb[h].g;
-	s[j+(h-3)*w].b=lb[h-3].b-a1*s[j+(h-2)*w].b-a2*s[j+(h-1)*w].b-a3*lb[h].b;
-
-	for (i=h-4;i>=0;i--)		//gor
+	for (i=0;i<h;i++)
 		{
-		s[j+w*i].r=lb[i].r-a1*s[j+w*(i+1)].r-a2*s[j+w*(i+2)].r-a3*s[j+w*(i+3)].r;
-		s[j+w*i].g=lb[i].g-a1*s[j+w*(i+1)].g-a2*s[j+w*(i+2)].g-a3*s[j+w*(i+3)].g;
-		s[j+w*i].b=lb[i].b-a1*s[j+w*(i+1)].b-a2*s[j+w*(i+2)].b-a3*s[j+w*(i+3)].b;
-		outframe[j+w*i]=((uint32_t)s[j+w*i].r&0xFF) + (((uint32_t)s[j+w*i].g&0xFF)<<8) + (((uint32_t)s[j+w*i].b&0xFF)<<16);
+		col=s+i*w; out=jb->out+i*w+j;
+		for (k=0;k<n;k++)
+			out[k]=f0r_v4f_to_rgb8(FIBE_LD(col[k]));
 		}
-	}	//po stolpcih
-
+	}
+free(lb);
 }
 
+void fibe3_8(const uint32_t* inframe, uint32_t* outframe, float_rgba s[], int w, int h, float a1, float a2, float a3, int ec)
+{
+fibe_job job;
 
+job.in=inframe; job.out=outframe; job.s=s;
+job.w=w; job.h=h; job.ec=ec;
+job.a1=a1; job.a2=a2; job.a3=a3;
+fibe_parallel(h,fibe3_rows,&job);
+fibe_parallel(w,fibe3_cols,&job);
+}
@@ -22,32 +22,29 @@
 
 #include "frei0r.h"
 #include "frei0r_math.h"
+#include "frei0r_lut.h"
 
 typedef struct brightness_instance
 {
   unsigned int width;
   unsigned int height;
   int brightness; /* the brightness [-256, 256] */
-  unsigned char lut[256]; /* look-up table */
+  f0r_lut_t lut; /* look-up table */
 } brightness_instance_t;
 
-/* Updates the look-up-table. */
-void update_lut(brightness_instance_t *inst)
+static int brightness_map(void* arg, int c, int i)
 {
-  int i;
-  unsigned char *lut = inst->lut;
-  int brightness = inst->brightness;
-
+  int brightness = *(int*)arg;
   if (brightness < 0)
-  {
-    for (i=0; i<256; ++i)
-      lut[i] = CLAMP0255((i * (256 + brightness))>>8);
-  }
+    return (i * (256 + brightness))>>8;
   else
-  {
-    for (i=0; i<256; ++i)
-      lut[i] = CLAMP0255(i + (((256 - i) * brightness)>>8));
-  }
+    return i + (((256 - i) * brightness)>>8);
+}
+
+/* Updates the look-up-table. */
+void update_lut(brightness_instance_t *inst)
+{
+  f0r_lut_compile(&inst->lut, brightness_map, &inst->brightness, F0R_LUT_RGB);
 }
 
 int f0r_init()
@@ -132,22 +129,29 @@ void f0r_get_param_value(f0r_instance_t instance,
   }
 }
 
+int f0r_get_capabilities()
+{
+  return F0R_CAP_SLICE_SAFE | F0R_CAP_IN_PLACE;
+}
+
 void f0r_update(f0r_instance_t instance, double time,
                 const uint32_t* inframe, uint32_t* outframe)
 {
   assert(instance);
   brightness_instance_t* inst = (brightness_instance_t*)instance;
-  unsigned int len = inst->width * inst->height;
-  
-  unsigned char* lut = inst->lut;
-  unsigned char* dst = (unsigned char*)outframe;
-  const unsigned char* src = (unsigned char*)inframe;
-  while (len--)
-  {
-    *dst++ = lut[*src++];
-    *dst++ = lut[*src++];
-    *dst++ = lut[*src++];
-    *dst++ = *src++;// copy alpha
-  }
+  f0r_update_slice(instance, time, inframe, 0, 0, outframe, 0, inst->height);
+}
+
+void f0r_update_slice(f0r_instance_t instance, double time,
+                      const uint32_t* inframe1, const uint32_t* inframe2,
+                      const uint32_t* inframe3, uint32_t* outframe,
+                      unsigned int slice_start, unsigned int slice_height)
+{
+  assert(instance);
+  brightness_instance_t* inst = (brightness_instance_t*)instance;
+  unsigned int offset = inst->width * slice_start;
+  unsigned int len = inst->width * slice_height;
+
+  f0r_lut_apply(&inst->lut, inframe1 + offset, outframe + offset, len);
 }
 
@@ -1,4 +1,5 @@
 #include "frei0r.h"
+#include "frei0r_lut.h"
 #include <stdlib.h>
 #include <assert.h>
 
@@ -6,8 +7,15 @@ typedef struct blackwhite_instance
 {
   unsigned int width;
   unsigned int height;
+  f0r_lut_mix_t mix;
 } blackwhite_instance_t;
 
+/* (r + g + b) / 3, 21846 / 65536 being close enough to 1/3 to be exact */
+static int32_t blackwhite_mix(void* arg, int c, int k, int v)
+{
+  return v * 21846;
+}
+
 int f0r_init()
 {
   return 1;
@@ -38,6 +46,7 @@ f0r_instance_t f0r_construct(unsigned int width, unsigned int height)
 {
   blackwhite_instance_t* inst = (blackwhite_instance_t*)calloc(1, sizeof(*inst));
   inst->width = width; inst->height = height;
+  f0r_lut_mix_compile(&inst->mix, blackwhite_mix, 0, 0);
   return (f0r_instance_t)inst;
 }
 
@@ -54,24 +63,28 @@ void f0r_get_param_value(f0r_instance_t instance,
 			 f0r_param_t param, int param_index)
 { /* no params */ }
 
+int f0r_get_capabilities()
+{
+  return F0R_CAP_SLICE_SAFE | F0R_CAP_IN_PLACE;
+}
+
 void f0r_update(f0r_instance_t instance, double time,
 		const uint32_t* inframe, uint32_t* outframe)
 {
   assert(instance);
   blackwhite_instance_t* inst = (blackwhite_instance_t*)instance;
-  unsigned int w = inst->width;
-  unsigned int h = inst->height;
-  unsigned int x,y;
-  
-  uint32_t* dst = outframe;
-  const uint32_t* src = inframe;
-  for(y=h;y>0;--y)
-      for(x=w;x>0;--x,++src,++dst)
-	{
-	  int tmpbw;
-	  unsigned char* tmpc = (unsigned char*)src;
-	  tmpbw = (tmpc[0] + tmpc[1] + tmpc[2]) / 3;
-	  *dst = (tmpc[3] << 24) | (tmpbw << 16) | (tmpbw << 8) | tmpbw;
-	}
+  f0r_update_slice(instance, time, inframe, 0, 0, outframe, 0, inst->height);
 }
 
+void f0r_update_slice(f0r_instance_t instance, double time,
+		      const uint32_t* inframe1, const uint32_t* inframe2,
+		      const uint32_t* inframe3, uint32_t* outframe,
+		      unsigned int slice_start, unsigned int slice_height)
+{
+  assert(instance);
+  blackwhite_instance_t* inst = (blackwhite_instance_t*)instance;
+  unsigned int offset = inst->width * slice_start;
+
+  f0r_lut_mix_apply(&inst->mix, inframe1 + offset, outframe + offset,
+                    inst->width * slice_height);
+}
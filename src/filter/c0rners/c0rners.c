@@ -29,7 +29,7 @@
 #include <string.h>
 #include <math.h>
 #include "frei0r_math.h"
-#include "interp.h"
+#include "frei0r_remap.h"
 
 //----------------------------------------
 //structure for Frei0r instance
@@ -53,7 +53,7 @@ typedef struct
 	float feath;
         int op;
 
-	interpp interp;
+	f0r_remap_t remap;
 	float *map;
 	unsigned char *amap;
 	int mapIsDirty;
@@ -623,23 +623,6 @@ int geom4c_b(int wi, int hi, int wo, int ho, tocka2 vog[], int str, float strx,
 	return 0;
 }
 
-//-------------------------------------------------------
-interpp set_intp(inst p)
-{
-	switch (p.intp)	//katero interpolacijo bo uporabil
-	{
-		//	case -1:return interpNNpr_b;	//nearest neighbor+print
-	case 0:	return interpNN_b32;	//nearest neighbor
-	case 1: return interpBL_b32;	//bilinear
-	case 2:	return interpBC_b32;	//bicubic smooth
-	case 3:	return interpBC2_b32;	//bicibic sharp
-	case 4:	return interpSP4_b32;	//spline 4x4
-	case 5:	return interpSP6_b32;	//spline 6x6
-	case 6: return interpSC16_b32;	//lanczos 8x8
-	default: return NULL;
-	}
-}
-
 //-----------------------------------------------------
 //stretch [0...1] to parameter range [min...max] linear
 float map_value_forward(double v, float min, float max)
@@ -793,7 +776,6 @@ f0r_instance_t f0r_construct(unsigned int width, unsigned int height)
 
 	in->map=(float*)calloc(1, sizeof(float)*(in->w*in->h*2+2));
 	in->amap=(unsigned char*)calloc(1, sizeof(char)*(in->w*in->h*2+2));
-	in->interp=set_intp(*in);
 	in->mapIsDirty=1;
 
 	return (f0r_instance_t)in;
@@ -808,6 +790,7 @@ void f0r_destruct(f0r_instance_t instance)
 
 	free(p->map);
 	free(p->amap);
+	f0r_remap_free(&p->remap);
 	free(instance);
 }
 
@@ -900,7 +883,6 @@ void f0r_set_param_value(f0r_instance_t instance, f0r_param_t parm, int param_in
 
 	if (chg!=0)
 	{
-		p->interp=set_intp(*p);
 		p->mapIsDirty = 1;
 	}
 
@@ -996,13 +978,14 @@ void f0r_update(f0r_instance_t instance, double time, const uint32_t* inframe, u
 		vog[3].y=(p->y4*3-1)*p->h;
 		geom4c_b(p->w, p->h, p->w, p->h, vog, p->stretchON, p->stretchx, p->stretchy, p->map, nots);
 		make_alphamap(p->amap, vog, p->w, p->h, p->map, p->feath, nots);
+		f0r_remap_set(&p->remap, p->w, p->h, p->w, p->h, p->map, p->intp);
 		p->mapIsDirty = 0;
 	}
 
 	//if (p->transb==0) bkgr=0xFF000000; else bkgr=0;
 	bkgr=0xFF000000;
 
-	remap32(p->w, p->h, p->w, p->h, (unsigned char*) inframe, (unsigned char *) outframe, p->map, bkgr, p->interp);
+	f0r_remap_run(&p->remap, inframe, outframe, bkgr);
 
 	if (p->transb!=0)
 		apply_alphamap(outframe, p->w, p->h, p->amap, p->op);
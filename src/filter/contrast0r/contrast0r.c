@@ -23,25 +23,29 @@
 
 #include "frei0r.h"
 #include "frei0r_math.h"
+#include "frei0r_lut.h"
 
 typedef struct contrast0r_instance
 {
   unsigned int width;
   unsigned int height;
   int contrast; /* the contrast [-256, 256] */
-  unsigned char lut[256]; /* look-up table */
+  f0r_lut_t lut; /* look-up table */
 } contrast0r_instance_t;
 
+static int contrast0r_map(void* arg, int c, int i)
+{
+  int contrast = *(int*)arg;
+  if (i < 128)
+    return i - (((128 - i)*contrast)>>8);
+  else
+    return i + (((i - 128)*contrast)>>8);
+}
+
 /* Updates the look-up-table. */
 void update_lut(contrast0r_instance_t *inst)
 {
-  int i;
-  unsigned char *lut = inst->lut;
-  int contrast = inst->contrast;
-  for (i=0; i<128; ++i)
-    lut[i] = CLAMP0255(i - (((128 - i)*contrast)>>8));
-  for (i=128; i<256; ++i)
-    lut[i] = CLAMP0255(i + (((i - 128)*contrast)>>8));
+  f0r_lut_compile(&inst->lut, contrast0r_map, &inst->contrast, F0R_LUT_RGB);
 }
 
 int f0r_init()
@@ -125,22 +129,29 @@ void f0r_get_param_value(f0r_instance_t instance,
   }
 }
 
+int f0r_get_capabilities()
+{
+  return F0R_CAP_SLICE_SAFE | F0R_CAP_IN_PLACE;
+}
+
 void f0r_update(f0r_instance_t instance, double time,
                 const uint32_t* inframe, uint32_t* outframe)
 {
   assert(instance);
   contrast0r_instance_t* inst = (contrast0r_instance_t*)instance;
-  unsigned int len = inst->width * inst->height;
-  
-  unsigned char* lut = inst->lut;
-  unsigned char* dst = (unsigned char*)outframe;
-  const unsigned char* src = (unsigned char*)inframe;
-  while (len--)
-  {
-    *dst++ = lut[*src++];
-    *dst++ = lut[*src++];
-    *dst++ = lut[*src++];
-    *dst++ = *src++; // copy alpha
-  }
+  f0r_update_slice(instance, time, inframe, 0, 0, outframe, 0, inst->height);
+}
+
+void f0r_update_slice(f0r_instance_t instance, double time,
+                      const uint32_t* inframe1, const uint32_t* inframe2,
+                      const uint32_t* inframe3, uint32_t* outframe,
+                      unsigned int slice_start, unsigned int slice_height)
+{
+  assert(instance);
+  contrast0r_instance_t* inst = (contrast0r_instance_t*)instance;
+  unsigned int offset = inst->width * slice_start;
+  unsigned int len = inst->width * slice_height;
+
+  f0r_lut_apply(&inst->lut, inframe1 + offset, outframe + offset, len);
 }
 
@@ -29,6 +29,7 @@
 
 #include "frei0r.h"
 #include "frei0r_math.h"
+#include "frei0r_lut.h"
 
 #define MAX3(a, b, c) ( ( a > b && a > c) ? a : (b > c ? b : c) )
 #define MIN3(a, b, c) ( ( a < b && a < c) ? a : (b < c ? b : c) )
@@ -38,6 +39,8 @@
 #define POS_BOTTOM_LEFT 2
 #define POS_BOTTOM_RIGHT 3
 
+#define MAX_POINTS 5
+
 #define POINT "Point "
 #define INPUT_VALUE " input value"
 #define OUTPUT_VALUE " output value"
@@ -66,8 +69,38 @@ typedef struct curves_instance
 
   char *bspline;
   double *bsplineMap;
+
+  // maps built from the parameters, rebuilt by updateMaps() on a change
+  int mapsDirty;
+  double curvePoints[10]; // points sorted by input value
+  double coeffs[5 * MAX_POINTS]; // spline through curvePoints
+  int mapI[256];
+  double mapLuma[256];
+  double map[361];
+  double lumaFactor[3];
+  double lumaWeight[3][256];
+  uint32_t lut[4][256]; // mapI or identity, in the pixel bytes of each channel
+  float *mapCurves;
+
+  int deep; // frames are RGBA64
+  f0r_lut16_t lut16; // the curve on RGBA64 frames, in luma mode the red table maps the luma
 } curves_instance_t;
 
+// Channel values of the curve graph, which is drawn with 8 bit values on
+// both kinds of frames
+static inline int get_px(const void* frame, int deep, int i)
+{
+  return deep ? ((const uint16_t*)frame)[i] >> 8 : ((const uint8_t*)frame)[i];
+}
+
+static inline void put_px(void* frame, int deep, int i, int v)
+{
+  if (deep)
+    ((uint16_t*)frame)[i] = v * 257;
+  else
+    ((uint8_t*)frame)[i] = v;
+}
+
 
 // color conversion functions taken from:
 // http://www.cs.rit.edu/~ncs/color/t_convert.html
@@ -162,6 +195,7 @@ void HSVtoRGB(double *r, double *g, double *b, double h, double s, double v)
 }
 
 void updateBsplineMap(f0r_instance_t instance);
+void updateMaps(curves_instance_t* inst);
 
 char **param_names = NULL;
 int f0r_init()
@@ -263,6 +297,8 @@ f0r_instance_t f0r_construct(unsigned int width, unsigned int height)
   inst->points[7] = 0;
   inst->points[8] = 0;
   inst->points[9] = 0;
+  inst->mapCurves = (float*)calloc(height / 2 + 1, sizeof(float));
+  updateMaps(inst);
   return (f0r_instance_t)inst;
 }
 
@@ -271,6 +307,8 @@ void f0r_destruct(f0r_instance_t instance)
   if (((curves_instance_t*)instance)->bspline)
       free(((curves_instance_t*)instance)->bspline);
   free(((curves_instance_t*)instance)->bsplineMap);
+  free(((curves_instance_t*)instance)->mapCurves);
+  f0r_lut16_free(&((curves_instance_t*)instance)->lut16);
   free(instance);
 }
 
@@ -292,12 +330,14 @@ void f0r_set_param_value(f0r_instance_t instance,
               if (tmp == 3) {
                   if (inst->channel != CHANNEL_LUMA) {
                     inst->channel = CHANNEL_LUMA;
+                    inst->mapsDirty = 1;
                     if (strlen(inst->bspline))
                         updateBsplineMap(instance);
                   }
               } else {
                   if ((int)inst->channel != (int)tmp) {
                     inst->channel = (enum CHANNELS)((int)tmp);
+                    inst->mapsDirty = 1;
                     if (strlen(inst->bspline))
                         updateBsplineMap(instance);
                   }
@@ -305,6 +345,7 @@ void f0r_set_param_value(f0r_instance_t instance,
           } else {
               if ((int)inst->channel != (int)(tmp * 10)) {
                 inst->channel = (enum CHANNELS)(tmp * 10);
+                inst->mapsDirty = 1;
                 if (strlen(inst->bspline))
                     updateBsplineMap(instance);
               }
@@ -317,10 +358,17 @@ void f0r_set_param_value(f0r_instance_t instance,
 	  inst->curvesPosition =  floor(*((f0r_param_double *)param) * 10);
 	  break;
 	case 3:
-	  inst->pointNumber = floor(*((f0r_param_double *)param) * 10);
+	  tmp = CLAMP(floor(*((f0r_param_double *)param) * 10), 2, 5);
+	  if (inst->pointNumber != tmp) {
+	    inst->pointNumber = tmp;
+	    inst->mapsDirty = 1;
+	  }
 	  break;
         case 4:
-          inst->formula = *((f0r_param_double *)param);
+          if (inst->formula != *((f0r_param_double *)param)) {
+            inst->formula = *((f0r_param_double *)param);
+            inst->mapsDirty = 1;
+          }
           break;
         case 5:
           bspline = *((f0r_param_string *)param);
@@ -328,13 +376,18 @@ void f0r_set_param_value(f0r_instance_t instance,
               free(inst->bspline);
               inst->bspline = strdup(bspline);
               updateBsplineMap(instance);
+              inst->mapsDirty = 1;
           }
           break;
 	default:
-	  if (param_index > 5)
+	  if (param_index > 5 && inst->points[param_index - 6] != *((f0r_param_double *)param)) {
 		inst->points[param_index - 6] = *((f0r_param_double *)param); //Assigning value to curve point
+		inst->mapsDirty = 1;
+	  }
 	  break;
   }
+  if (inst->mapsDirty)
+      updateMaps(inst);
 }
 
 void f0r_get_param_value(f0r_instance_t instance,
@@ -370,7 +423,7 @@ void f0r_get_param_value(f0r_instance_t instance,
   }
 }
 
-double* gaussSLESolve(size_t size, double* A) {
+void gaussSLESolve(size_t size, double* A, double* solution) {
 	int extSize = size + 1;
 	//direct way: tranform matrix A to triangular form
 	for(int row = 0; row < size; row++) {
@@ -396,35 +449,33 @@ double* gaussSLESolve(size_t size, double* A) {
 		}
 	}
 	//backward way: find solution from last to first
-	double *solution = (double*)calloc(size, sizeof(double));
 	for(int i = size - 1; i >= 0; i--) {
 		solution[i] = A[i * extSize + size];// 
 		for(int j = size - 1; j > i; j--) {
 			solution[i] -= solution[j] * A[i * extSize + j];
 		}
 	}
-	return solution;
 }
 
 
 
-double* calcSplineCoeffs(double* points, size_t pointsSize) {
-	double* coeffs = NULL;
+// coeffs holds 5 * pointsSize values, pointsSize is at most MAX_POINTS
+void calcSplineCoeffs(double* points, size_t pointsSize, double* coeffs) {
 	int size = pointsSize;
 	int mxSize = size > 3?4:size;
 	int extMxSize = mxSize + 1;
+	memset(coeffs, 0, 5 * size * sizeof(double));
 	if (size == 2) { //coefficients of linear function Ax + B = y
-		double *m = (double*)calloc(mxSize * extMxSize, sizeof(double));
+		double m[2 * 3] = {0};
 		for(int i = 0; i < size; i++) {
 			int offset = i * 2;
 			m[i * extMxSize] = points[offset];
 			m[i * extMxSize + 1] = 1;
 			m[i * extMxSize + 2] = points[offset + 1];
 		}
-		coeffs = gaussSLESolve(size, m);
-		free(m);
+		gaussSLESolve(size, m, coeffs);
 	} else if (size == 3) { //coefficients of quadrant function Ax^2 + Bx + C = y
-		double *m = (double*)calloc(mxSize * extMxSize, sizeof(double));
+		double m[3 * 4] = {0};
 		for(int i = 0; i < size; i++) {
 			int offset = i * 2;
 			m[i * extMxSize] = points[offset]*points[offset];
@@ -432,10 +483,8 @@ double* calcSplineCoeffs(double* points, size_t pointsSize) {
 			m[i * extMxSize + 2] = 1;
 			m[i * extMxSize + 3] = points[offset + 1];
 		}
-		coeffs = gaussSLESolve(size, m);
-		free(m);
+		gaussSLESolve(size, m, coeffs);
 	} else if (size > 3) { //coefficients of cubic spline Ax^3 + Bx^2 + Cx + D = y
-		coeffs = (double*)calloc(5 * size,sizeof(double));
 		for(int i = 0; i < size; i++) {
 			int offset = i * 5;
 			int srcOffset = i * 2;
@@ -443,8 +492,7 @@ double* calcSplineCoeffs(double* points, size_t pointsSize) {
 			coeffs[offset + 1] = points[srcOffset + 1];
 		}
 		coeffs[3] = coeffs[(size - 1) * 5 + 3] = 0;
-		double *alpha = (double*)calloc(size - 1,sizeof(double));
-		double *beta = (double*)calloc(size - 1,sizeof(double));
+		double alpha[MAX_POINTS - 1], beta[MAX_POINTS - 1];
 		alpha[0] = beta[0] = 0;
 		for(int i = 1; i < size - 1; i++) {
 			int srcI = i * 2;
@@ -462,8 +510,6 @@ double* calcSplineCoeffs(double* points, size_t pointsSize) {
 		}
 		for (int i = size - 2; i > 0; --i)
 			coeffs[i * 5 + 3] = alpha[i] * coeffs[(i + 1) * 5 + 3] + beta[i];
-		free(beta);
-		free(alpha);
 	  
 		for (int i = size - 1; i > 0; --i){
 			int srcI = i * 2;
@@ -474,7 +520,6 @@ double* calcSplineCoeffs(double* points, size_t pointsSize) {
 			coeffs[offset + 2] = h_i * (2. * coeffs[offset + 3] + coeffs[offset - 2]) / 6. + (points[srcI + 1] - points[srcI_1 + 1]) / h_i;
 		}			
 	}
-	return coeffs;
 }
 
 double spline(double x, double* points, size_t pointSize, double* coeffs) {
@@ -685,26 +730,45 @@ void updateBsplineMap(f0r_instance_t instance)
 }
 
 
-void f0r_update(f0r_instance_t instance, double time,
-                const uint32_t* inframe, uint32_t* outframe)
+/**
+ * The curve at \param v for 16 bit channel values: the spline itself, or
+ * the Bézier map interpolated between its 256 entries.
+ */
+static int curves_map16(void* arg, int c, int v)
 {
-  assert(instance);
-  curves_instance_t* inst = (curves_instance_t*)instance;
-  unsigned int len = inst->width * inst->height;
+  curves_instance_t* inst = (curves_instance_t*)arg;
+  double x = v / 65535.;
+  double y;
 
-  unsigned char* dst = (unsigned char*)outframe;
-  const unsigned char* src = (unsigned char*)inframe;
+  if (strlen(inst->bspline) == 0) {
+      y = spline(x, inst->curvePoints, (size_t)inst->pointNumber, inst->coeffs);
+  } else {
+      int i = v < 65535 ? (int)(x * 255) : 254;
+      double f = x * 255 - i;
+      double y0 = inst->bsplineMap[i], y1 = inst->bsplineMap[i + 1];
+      if (inst->channel == CHANNEL_LUMA) { // the map holds luma factors
+          y0 *= i;
+          y1 *= i + 1;
+      }
+      y = (y0 + (y1 - y0) * f) / 255.;
+  }
+  return ROUND(CLAMP(y, 0, 1) * 65535);
+}
 
-  int i = 0;
-  int mapI[256];
-  double mapLuma[256];
-  double *map = NULL;
-  float *mapCurves = NULL;
+/**
+ * Rebuilds the color maps and the curve graph when a parameter changed,
+ * so that f0r_update() only has to look values up.
+ */
+void updateMaps(curves_instance_t* inst)
+{
+  int i, c;
   int scale = inst->height / 2;
-  double *points = NULL;
+  double *points = inst->curvePoints;
+  double factorR, factorG, factorB;
+
   if (strlen(inst->bspline) == 0) {
-      points = (double*)calloc(inst->pointNumber * 2, sizeof(double));
       i = inst->pointNumber * 2;
+      points[0] = 0;
       //copy point values 
       while(--i > 0)
           points[i] = inst->points[i];
@@ -713,103 +777,202 @@ void f0r_update(f0r_instance_t instance, double time,
           for(int j = i; j > 0 && points[j * 2] < points[(j - 1) * 2]; j--)
               swap(points, j, j - 1);
       //calculating spline coeffincients
-      double *coeffs = calcSplineCoeffs(points, (size_t)inst->pointNumber);
+      double *coeffs = inst->coeffs;
+      calcSplineCoeffs(points, (size_t)inst->pointNumber, coeffs);
 
       //building map for values from 0 to 255
       for(i = 0; i < 256; i++) {
           double v = i / 255.;
 	  double w = spline(v, points, (size_t)inst->pointNumber, coeffs);
-	  mapI[i] = CLAMP(w, 0, 1) * 255;
-	  mapLuma[i] = i == 0?w:w / v;	
+	  inst->mapI[i] = CLAMP(w, 0, 1) * 255;
+	  inst->mapLuma[i] = i == 0?w:w / v;	
       }
       //building map for drawing curve
-      if (inst->drawCurves) {
-          mapCurves = (float*)calloc(scale, sizeof(float));
-	  for(i = 0; i < scale; i++)
-              mapCurves[i] = spline((float)i / scale, points, (size_t)inst->pointNumber, coeffs) * scale;
-      }
-      free(coeffs);
-
-      if (inst->channel == CHANNEL_HUE || inst->channel == CHANNEL_SATURATION) {
-          map = malloc(361*sizeof(double));
-          if (CHANNEL_SATURATION)
-              for (i = 0; i < 256; ++i)
-                  map[i] = mapI[i] / 255.;
-          else
-              for (i = 0; i < 361; ++i)
-                  map[i] = mapI[(int)(i / 360. * 255)] / 360. * 255;
-      }
+      for(i = 0; i < scale; i++)
+          inst->mapCurves[i] = spline((float)i / scale, points, (size_t)inst->pointNumber, coeffs) * scale;
+
+      if (inst->channel == CHANNEL_SATURATION)
+          for (i = 0; i < 256; ++i)
+              inst->map[i] = inst->mapI[i] / 255.;
+      else if (inst->channel == CHANNEL_HUE)
+          for (i = 0; i < 361; ++i)
+              inst->map[i] = inst->mapI[(int)(i / 360. * 255)] / 360. * 255;
   } else {
-      map = malloc(361*sizeof(double));
-      memcpy(map, inst->bsplineMap, (inst->channel == CHANNEL_HUE ? 361 : 256)*sizeof(double));
+      memcpy(inst->map, inst->bsplineMap, (inst->channel == CHANNEL_HUE ? 361 : 256)*sizeof(double));
       if (inst->channel != CHANNEL_SATURATION && inst->channel != CHANNEL_HUE) {
           if (inst->channel == CHANNEL_LUMA)
-              memcpy(mapLuma, map, 256*sizeof(double));
+              memcpy(inst->mapLuma, inst->map, 256*sizeof(double));
           else
               for (i = 0; i < 256; ++i)
-                  mapI[i] = (int)map[i];
+                  inst->mapI[i] = (int)inst->map[i];
       }
   }
 
-  int r, g, b, luma;
-  double factorR, factorG, factorB, lumaValue;
-  double rf, gf, bf, hue, sat, val;
+  //single channel and rgb modes map every byte of a pixel with one table
+  for (c = 0; c < 4; c++) {
+      int mapped = inst->channel == CHANNEL_RGB ? c < 3 : c == (int)inst->channel;
+      for (i = 0; i < 256; i++) {
+          unsigned char bytes[4] = {0, 0, 0, 0};
+          bytes[c] = mapped ? inst->mapI[i] : i;
+          memcpy(&inst->lut[c][i], bytes, sizeof(uint32_t));
+      }
+  }
+
+  if (inst->formula) {      // Rec.709
+      factorR = .2126;
+      factorG = .7152;
+      factorB = .0722;
+  } else {                  // Rec. 601
+      factorR = .299;
+      factorG = .587;
+      factorB = .114;
+  }
+  inst->lumaFactor[0] = factorR;
+  inst->lumaFactor[1] = factorG;
+  inst->lumaFactor[2] = factorB;
+  for (i = 0; i < 256; i++) {
+      inst->lumaWeight[0][i] = factorR * i;
+      inst->lumaWeight[1][i] = factorG * i;
+      inst->lumaWeight[2][i] = factorB * i;
+  }
+
+  //hue and saturation keep their 8 bit maps on RGBA64 frames
+  if (inst->deep) {
+      int mask =
+          inst->channel == CHANNEL_RGB ? F0R_LUT_RGB :
+          inst->channel == CHANNEL_LUMA ? F0R_LUT_R :
+          inst->channel <= CHANNEL_ALPHA ? 1 << inst->channel : 0;
+      f0r_lut16_compile(&inst->lut16, curves_map16, inst, mask);
+  }
+
+  inst->mapsDirty = 0;
+}
+
+int f0r_get_capabilities()
+{
+  return F0R_CAP_RGBA64;
+}
+
+int f0r_set_color_model(f0r_instance_t instance, int color_model)
+{
+  assert(instance);
+  curves_instance_t* inst = (curves_instance_t*)instance;
+
+  if (color_model != F0R_COLOR_MODEL_RGBA8888
+      && color_model != F0R_COLOR_MODEL_RGBA64)
+    return 0;
+  inst->deep = color_model == F0R_COLOR_MODEL_RGBA64;
+  updateMaps(inst);
+  return 1;
+}
+
+/**
+ * Maps the len pixels of an RGBA64 frame.
+ */
+static void update16(curves_instance_t* inst, const uint16_t* src,
+                     uint16_t* dst, unsigned int len)
+{
+  const uint16_t* lumaMap = inst->lut16.t[0];
+  double *map = inst->map;
+  double rf, gf, bf, hue, sat, val, lumaValue;
+  int luma;
 
   switch ((int)inst->channel) {
   case CHANNEL_RGB:
-      while (len--) {
-          *dst++ = mapI[*src++];        // r
-          *dst++ = mapI[*src++];        // g
-          *dst++ = mapI[*src++];        // b
-          *dst++ = *src++;              // a
-      }
-      break;
   case CHANNEL_RED:
-      memcpy(outframe, inframe, len*sizeof(uint32_t));
-      while (len--) {
-          *dst = mapI[*dst];
-          dst += 4;
-      }
-      break;
   case CHANNEL_GREEN:
-      memcpy(outframe, inframe, len*sizeof(uint32_t));
-      dst += 1;
-      while (len--) {
-          *dst = mapI[*dst];
-          dst += 4;
+  case CHANNEL_BLUE:
+  case CHANNEL_ALPHA:
+      f0r_lut16_apply(&inst->lut16, src, dst, len);
+      break;
+  case CHANNEL_LUMA:
+      for (; len--; src += 4, dst += 4) {
+          luma = ROUND(inst->lumaFactor[0] * src[0] + inst->lumaFactor[1] * src[1]
+                       + inst->lumaFactor[2] * src[2]);
+          if (luma == 0) { // as the byte mapLuma[0] on 8 bit frames
+              dst[0] = dst[1] = dst[2] = (int)inst->mapLuma[0] * 257;
+          } else {
+              lumaValue = lumaMap[luma] / (double)luma;
+              dst[0] = CLAMP(ROUND(src[0] * lumaValue), 0, 65535);
+              dst[1] = CLAMP(ROUND(src[1] * lumaValue), 0, 65535);
+              dst[2] = CLAMP(ROUND(src[2] * lumaValue), 0, 65535);
+          }
+          dst[3] = src[3];
       }
       break;
-  case CHANNEL_BLUE:
-      memcpy(outframe, inframe, len*sizeof(uint32_t));
-      dst += 2;
-      while (len--) {
-          *dst = mapI[*dst];
-          dst += 4;
+  // hue and saturation go through the 8 bit maps, on values scaled to [0, 255]
+  case CHANNEL_HUE:
+      for (; len--; src += 4, dst += 4) {
+          rf = src[0] / 257.;
+          gf = src[1] / 257.;
+          bf = src[2] / 257.;
+          RGBtoHSV(rf, gf, bf, &hue, &sat, &val);
+          if (hue != -1) {
+              HSVtoRGB(&rf, &gf, &bf, map[(int)hue], sat, val);
+              dst[0] = rf * 65535;
+              dst[1] = gf * 65535;
+              dst[2] = bf * 65535;
+          } else {
+              dst[0] = src[0];
+              dst[1] = src[1];
+              dst[2] = src[2];
+          }
+          dst[3] = src[3];
       }
       break;
-  case CHANNEL_ALPHA:
-      memcpy(outframe, inframe, len*sizeof(uint32_t));
-      dst += 3;
-      while (len--) {
-          *dst = mapI[*dst];
-          dst += 4;
+  case CHANNEL_SATURATION:
+      for (; len--; src += 4, dst += 4) {
+          rf = src[0] / 257.;
+          gf = src[1] / 257.;
+          bf = src[2] / 257.;
+          RGBtoHSV(rf, gf, bf, &hue, &sat, &val);
+          HSVtoRGB(&rf, &gf, &bf, hue, map[(int)(sat * 255)], val);
+          dst[0] = rf * 65535;
+          dst[1] = gf * 65535;
+          dst[2] = bf * 65535;
+          dst[3] = src[3];
       }
+  }
+}
+
+void f0r_update(f0r_instance_t instance, double time,
+                const uint32_t* inframe, uint32_t* outframe)
+{
+  assert(instance);
+  curves_instance_t* inst = (curves_instance_t*)instance;
+  unsigned int len = inst->width * inst->height;
+
+  unsigned char* dst = (unsigned char*)outframe;
+  const unsigned char* src = (unsigned char*)inframe;
+
+  int i = 0;
+  int scale = inst->height / 2;
+  double *points = inst->curvePoints;
+  double *map = inst->map;
+  double *mapLuma = inst->mapLuma;
+
+  int r, g, b, luma;
+  double lumaValue;
+  double rf, gf, bf, hue, sat, val;
+
+  if (inst->deep)
+      update16(inst, (const uint16_t*)inframe, (uint16_t*)outframe, len);
+  else switch ((int)inst->channel) {
+  case CHANNEL_RGB:
+  case CHANNEL_RED:
+  case CHANNEL_GREEN:
+  case CHANNEL_BLUE:
+  case CHANNEL_ALPHA:
+      for (i = 0; i < len; i++, src += 4)
+          outframe[i] = inst->lut[0][src[0]] | inst->lut[1][src[1]]
+              | inst->lut[2][src[2]] | inst->lut[3][src[3]];
       break;
   case CHANNEL_LUMA:
-      if (inst->formula) {      // Rec.709
-          factorR = .2126;
-          factorG = .7152;
-          factorB = .0722;
-      } else {                  // Rec. 601
-          factorR = .299;
-          factorG = .587;
-          factorB = .114;
-      }
       while (len--) {
           r = *src++;
           g = *src++;
           b = *src++;
-          luma = ROUND(factorR * r + factorG * g + factorB * b);
+          luma = ROUND(inst->lumaWeight[0][r] + inst->lumaWeight[1][g] + inst->lumaWeight[2][b]);
           lumaValue = mapLuma[luma];
           if (luma == 0) {
               *dst++ = lumaValue;
@@ -856,9 +1019,6 @@ void f0r_update(f0r_instance_t instance, double time,
       }
   }
 
-  if (map)
-      free(map);
-
   if (inst->drawCurves && !strlen(inst->bspline)) {
 	unsigned char color[] = {0, 0, 0};
 	if (inst->channel == CHANNEL_RED || inst->channel == CHANNEL_GREEN || inst->channel == CHANNEL_BLUE)
@@ -868,7 +1028,6 @@ void f0r_update(f0r_instance_t instance, double time,
 	int graphYOffset = inst->curvesPosition == POS_TOP_LEFT || inst->curvesPosition == POS_TOP_RIGHT?0:inst->height - scale;
 	int maxYvalue = scale - 1;
 	int stride = inst->width;
-	dst = (unsigned char*)outframe;
 	float lineWidth = scale / 254.;
 	int cellSize = floor(lineWidth * 32);
 	//filling up background and drawing grid
@@ -877,11 +1036,11 @@ void f0r_update(f0r_instance_t instance, double time,
 		for(int j = 0; j < scale; j++) {
 		  if (j % cellSize > lineWidth) { //point doesn't aly on the grid
 			int offset = ((maxYvalue - i + graphYOffset) * stride + j + graphXOffset) * 4;
-			dst[offset] = (dst[offset] >> 1) + 0x7F;
+			put_px(outframe, inst->deep, offset, (get_px(outframe, inst->deep, offset) >> 1) + 0x7F);
 			offset++;
-			dst[offset] = (dst[offset] >> 1) + 0x7F;
+			put_px(outframe, inst->deep, offset, (get_px(outframe, inst->deep, offset) >> 1) + 0x7F);
 			offset++;
-			dst[offset] = (dst[offset] >> 1) + 0x7F;
+			put_px(outframe, inst->deep, offset, (get_px(outframe, inst->deep, offset) >> 1) + 0x7F);
 			offset++;
 		  }
 		}
@@ -897,28 +1056,27 @@ void f0r_update(f0r_instance_t instance, double time,
 		  for(int y = (int)floor(yPoint - doubleLineWidth); y <= yPoint + doubleLineWidth; y++) {
 			if (y >= 0 && y < scale) {
 			  int offset = ((maxYvalue - y + graphYOffset) * stride + x + graphXOffset) * 4;
-			  dst[offset++] = color[0];
-			  dst[offset++] = color[1];
-			  dst[offset++] = color[2];
+			  put_px(outframe, inst->deep, offset++, color[0]);
+			  put_px(outframe, inst->deep, offset++, color[1]);
+			  put_px(outframe, inst->deep, offset++, color[2]);
 			}
 		  }
 		}
 	  }
 	}
-	free(points);
 	//drawing curve on the graph
 	float halfLineWidth = lineWidth * .5;
 	float coeff = 255. / scale;
 	float prevY = 0;
 	for(int j = 0; j < scale; j++) {
-	  float y = mapCurves[j];
+	  float y = inst->mapCurves[j];
 	  if (j == 0 || y == prevY) {
 		for(i = (int)floor(y - halfLineWidth); i <= ceil(y + halfLineWidth); i++) {
 		  int clampedI = i < 0?0:i >= scale?scale - 1:i;
 		  int offset = ((maxYvalue - clampedI + graphYOffset) * stride + j + graphXOffset) * 4;
-		  dst[offset++] = color[0];
-		  dst[offset++] = color[1];
-		  dst[offset++] = color[2];
+		  put_px(outframe, inst->deep, offset++, color[0]);
+		  put_px(outframe, inst->deep, offset++, color[1]);
+		  put_px(outframe, inst->deep, offset++, color[2]);
 		}
 	  } else {
 		int factor = prevY > y?-1:1;
@@ -929,22 +1087,21 @@ void f0r_update(f0r_instance_t instance, double time,
 		for(i = ROUND(prevY - gap); factor * i < factor * (mid + gap); i += factor) {
 		  int clampedI = i < 0?0:i >= scale?scale - 1:i;
 		  int offset = ((maxYvalue - clampedI + graphYOffset) * stride + j - 1 + graphXOffset) * 4;
-		  dst[offset++] = color[0];
-		  dst[offset++] = color[1];
-		  dst[offset++] = color[2];
+		  put_px(outframe, inst->deep, offset++, color[0]);
+		  put_px(outframe, inst->deep, offset++, color[1]);
+		  put_px(outframe, inst->deep, offset++, color[2]);
 		}
 		  //drawing line from mid point to current value
 		for(i = ROUND(mid - gap); factor * i < factor * ceil(y + gap); i += factor) {
 		  int clampedI = i < 0?0:i >= scale?scale - 1:i;
 		  int offset = ((maxYvalue - clampedI + graphYOffset) * stride + j + graphXOffset) * 4;
-		  dst[offset++] = color[0];
-		  dst[offset++] = color[1];
-		  dst[offset++] = color[2];
+		  put_px(outframe, inst->deep, offset++, color[0]);
+		  put_px(outframe, inst->deep, offset++, color[1]);
+		  put_px(outframe, inst->deep, offset++, color[2]);
 		}
 	  }
 	  prevY = y;
 	}
-	free(mapCurves);
   }
 }
 
@@ -32,7 +32,7 @@
 
 #include <frei0r.h>
 
-#include "interp.h"
+#include "frei0r_remap.h"
 
 
 double PI=3.14159265358979;
@@ -251,28 +251,11 @@ typedef struct
 	float mpar;
 	float par;
 	float *map;
-	interpp interpol;
+	f0r_remap_t remap;
 } param;
 
 
 
-//-------------------------------------------------------
-interpp set_intp(param p)
-{
-	switch (p.intp)	//katero interpolacijo bo uporabil
-	{
-		//	case -1:return interpNNpr_b;	//nearest neighbor+print
-	case 0:	return interpNN_b32;	//nearest neighbor
-	case 1: return interpBL_b32;	//bilinear
-	case 2:	return interpBC_b32;	//bicubic smooth
-	case 3:	return interpBC2_b32;	//bicibic sharp
-	case 4:	return interpSP4_b32;	//spline 4x4
-	case 5:	return interpSP6_b32;	//spline 6x6
-	case 6: return interpSC16_b32;	//lanczos 8x8
-	default: return NULL;
-	}
-}
-
 //--------------------------------------------------------
 void make_map(param p)
 {
@@ -419,9 +402,8 @@ f0r_instance_t  f0r_construct(unsigned int width, unsigned int height)
 	p->mpar=1.0;
 
 	p->map=(float*)calloc(1, sizeof(float)*(p->w*p->h*2+2));
-	p->interpol=set_intp(*p);
-
 	make_map(*p);
+	f0r_remap_set(&p->remap, p->w, p->h, p->w, p->h, p->map, p->intp);
 
 	//printf("Construct, w=%d h=%d\n",width,height);
 
@@ -435,6 +417,7 @@ void f0r_destruct(f0r_instance_t instance)
 	p=(param*)instance;
 
 	free(p->map);
+	f0r_remap_free(&p->remap);
 	free(instance);
 }
 
@@ -456,8 +439,8 @@ void change_param(param *p, int w, int h, float f, int dir, int type, int scal,
 		p->h=h;
 	}
 
-	p->interpol=set_intp(*p);
 	make_map(*p);
+	f0r_remap_set(&p->remap, p->w, p->h, p->w, p->h, p->map, p->intp);
 }
 
 //-----------------------------------------------------
@@ -590,8 +573,8 @@ void f0r_set_param_value(f0r_instance_t instance, f0r_param_t parm, int param_in
 		case 3: p->par=1.333;break;		//HDV
 		case 4: p->par=p->mpar;break;	//manual
 		}
-		p->interpol=set_intp(*p);
 		make_map(*p);
+		f0r_remap_set(&p->remap, p->w, p->h, p->w, p->h, p->map, p->intp);
 	}
 
 	//print_param(*p);
@@ -645,6 +628,6 @@ void f0r_update(f0r_instance_t instance, double time, const uint32_t* inframe, u
 
 	p=(param*)instance;
 
-	remap32(p->w, p->h, p->w, p->h, (unsigned char*) inframe, (unsigned char*) outframe, p->map, 0, p->interpol);
+	f0r_remap_run(&p->remap, inframe, outframe, 0);
 
 }
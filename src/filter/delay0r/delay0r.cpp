@@ -2,78 +2,204 @@
 
 #include <algorithm>
 #include <vector>
-#include <utility>
 #include <cassert>
 
+// The input frames of the last DelayTime seconds are kept in a ring of
+// at most MaxFrames entries, oldest first, and the oldest one is the
+// output. MaxFrames maps [0, 1] onto 1 to MAX_FRAMES frames, the default
+// of 125 frames holds 5 seconds at 25 fps. The copies come from a pool
+// which only grows to the number of frames needed at once, so a changing
+// delay reuses them instead of churning the heap. With Dedup an input
+// equal to the previous one shares its copy, so static input costs a
+// single frame. An application handing over the previous frames through
+// f0r_update_history keeps them instead, and the ring stays empty.
 class delay0r : public frei0r::filter
 {
+  static const unsigned int MAX_FRAMES = 1000;
+
 public:
   delay0r(unsigned int width, unsigned int height)
   {
     delay = 0.0;
+    max_frames = 125.0 / MAX_FRAMES;
+    dedup = false;
     register_param(delay,"DelayTime","the delay time");
+    register_param(max_frames,"MaxFrames","the number of frames kept at most, which bounds the delay (1000 frames at 1)");
+    register_param(dedup,"Dedup","keep repeated input frames only once");
+    head = count = 0;
   }
-  
-  ~delay0r()
+
+  virtual int capabilities() { return F0R_CAP_HISTORY; }
+
+  // The frames of the ring but the current one.
+  virtual unsigned int history_depth() { return capacity() - 1; }
+
+  // Like filter::update_l, but the ring keeps the frames, so they are
+  // not copied into the frame_history as well.
+  virtual void update_l(double time_,
+			const uint32_t* inframe1,
+			const uint32_t* inframe2,
+			const uint32_t* inframe3,
+			uint32_t* outframe)
   {
-    for (std::list< std::pair< double, unsigned int* > >::iterator i=buffer.begin(); i != buffer.end(); ++i)
-    {
-       delete[] i->second;
-       i=buffer.erase(i);
-    }
+    time = time_;
+    out = outframe;
+    in = inframe1;
+    update();
   }
-  
+
   virtual void update()
   {
-    unsigned int* reusable = 0;
-    // remove old frames
-    for (std::list< std::pair< double, unsigned int* > >::iterator i=buffer.begin(); i != buffer.end(); ++i)
+    if (history.attached())
       {
-	if (i->first < (time - delay))
-	  {
-	    // remove me
-	    if (reusable != 0)
-	      delete[] i->second;
-	    else
-	      reusable = i->second;
-
-	    i=buffer.erase(i);
-	  }
+	update_attached();
+	return;
       }
-    
-    // add new frame
-    if (reusable == 0)
-      reusable = new unsigned int[width*height];
 
-    std::copy(in, in+width*height,reusable);
-    buffer.push_back(std::make_pair(time,reusable));
+    unsigned int capacity = this->capacity();
+    if (capacity != ring.size())
+      resize(capacity);
+    else if (count > 0 && time < at(count - 1).time)
+      release(count); // the host went back in time
 
-    // copy best
-    unsigned int* best_data=0;
-    double best_time=0;
+    // remove old frames, and the oldest one if the ring is full
+    release(first_at(time - delay));
+    if (count == ring.size())
+      release(1);
 
-    assert (buffer.size() >0);
-    for (std::list< std::pair< double, unsigned int* > >::iterator i=buffer.begin(); i != buffer.end(); ++i)
+    // add new frame
+    entry e;
+    e.time = time;
+    if (dedup && count > 0
+	&& std::equal(in, in + size, &frames[at(count - 1).frame][0]))
+      e.frame = at(count - 1).frame;
+    else
       {
-	if (best_data==0 || (i->first < best_time))
-	  {
-	    best_time=i->first;
-	    best_data=i->second;
-	  }
+	e.frame = acquire();
+	std::copy(in, in + size, &frames[e.frame][0]);
       }
+    ++refs[e.frame];
+    at(count) = e;
+    ++count;
 
-    assert(best_data != 0);
-    std::copy(best_data,best_data+width*height,out);
+    // copy best
+    const std::vector<uint32_t>& best = frames[at(0).frame];
+    std::copy(best.begin(), best.end(), out);
   }
-  
+
 private:
+  unsigned int capacity()
+  {
+    double f = std::min(1.0, std::max(0.0, max_frames));
+    return std::max(1, (int)(f * MAX_FRAMES + 0.5));
+  }
+
+  // The output is the oldest of the frames of the application which is
+  // not older than the delay, or the input frame. The ring restarts
+  // when the application stops handing over frames.
+  void update_attached()
+  {
+    if (count > 0)
+      resize(0);
+    const uint32_t* best = in;
+    for (unsigned int i = history.count(); i > 0; --i)
+      if (history.time(i - 1) >= time - delay)
+	{
+	  best = history[i - 1];
+	  break;
+	}
+    std::copy(best, best + size, out);
+  }
+
+  struct entry
+  {
+    double time;
+    unsigned int frame; // in frames
+  };
+
+  // The i-th oldest entry of the ring.
+  entry& at(unsigned int i)
+  {
+    return ring[(head + i) % ring.size()];
+  }
+
+  // The number of entries older than t, by binary search (the entries
+  // are in time order).
+  unsigned int first_at(double t)
+  {
+    unsigned int lo = 0, hi = count;
+    while (lo < hi)
+      {
+	unsigned int mid = lo + (hi - lo) / 2;
+	if (at(mid).time < t)
+	  lo = mid + 1;
+	else
+	  hi = mid;
+      }
+    return lo;
+  }
+
+  // Removes the n oldest entries.
+  void release(unsigned int n)
+  {
+    assert(n <= count);
+    for (; n > 0; --n)
+      {
+	unsigned int f = at(0).frame;
+	if (--refs[f] == 0)
+	  unused.push_back(f);
+	head = (head + 1) % ring.size();
+	--count;
+      }
+  }
+
+  unsigned int acquire()
+  {
+    unsigned int f;
+    if (unused.empty())
+      {
+	f = frames.size();
+	frames.push_back(std::vector<uint32_t>());
+	refs.push_back(0);
+      }
+    else
+      {
+	f = unused.back();
+	unused.pop_back();
+      }
+    frames[f].resize(size);
+    return f;
+  }
+
+  // Changes the capacity of the ring, keeping the newest entries, and
+  // gives the copies no longer needed back to the heap.
+  void resize(unsigned int capacity)
+  {
+    if (count > capacity)
+      release(count - capacity);
+    std::vector<entry> r(capacity);
+    for (unsigned int i = 0; i < count; ++i)
+      r[i] = at(i);
+    ring.swap(r);
+    head = 0;
+    for (unsigned int i = 0; i < unused.size(); ++i)
+      std::vector<uint32_t>().swap(frames[unused[i]]);
+  }
+
   f0r_param_double delay;
-  std::list< std::pair< double, unsigned int* > > buffer;
+  f0r_param_double max_frames;
+  bool dedup;
+
+  std::vector<entry> ring;
+  unsigned int head, count;
+  std::vector< std::vector<uint32_t> > frames;
+  std::vector<unsigned int> refs; // entries of ring per frame
+  std::vector<unsigned int> unused; // frames without entries
 };
 
 
 frei0r::construct<delay0r> plugin("delay0r",
 				  "video delay",
 				  "Martin Bayer",
-				  0,1);
+				  0,2);
 
@@ -59,6 +59,11 @@ public:
   DelayGrab(int wdt, int hgt);
   ~DelayGrab();
 
+  virtual int capabilities() { return F0R_CAP_HISTORY; }
+
+  // the current frame takes the first place of the queue
+  virtual unsigned int history_depth() { return QUEUEDEPTH - 1; }
+
   virtual void update();
 
 
@@ -78,11 +83,9 @@ private:
   void fastsrand(uint32_t seed) { randval = seed; };
 
   int x,y,i,xyoff,v;
-  uint8_t *imagequeue,*curqueue;
-  int curqueuenum;
   uint32_t *curdelaymap;
-  uint8_t *curpos,*curimage;
-  int curposnum;
+  const uint8_t *curpos;
+  uint8_t *curimage;
   void *delaymap;
 
 /* initialized from the init */
@@ -115,60 +118,45 @@ DelayGrab::DelayGrab(int wdt, int hgt) {
   delaymap = NULL;
   _init(wdt, hgt);
 
-  imagequeue = (uint8_t *) malloc(QUEUEDEPTH*(geo.size));
-
   /* starting mode */
   current_mode = 4;
   /* starting blocksize */
   set_blocksize(2);
-  
-  curqueue=imagequeue;
-  curqueuenum=0;
 
   fastsrand(::time(NULL));
 }
 
 DelayGrab::~DelayGrab() {
   if(delaymap) free(delaymap);
-  free(imagequeue);
 }
 
 
 
 void DelayGrab::update() {
 
-  /* Update queue pointer */
-  if (curqueuenum==0) {
-    curqueuenum=QUEUEDEPTH-1;
-    curqueue = imagequeue;
-    curqueue += (geo.size*(QUEUEDEPTH-1));
-  } else {
-    curqueuenum--;
-    curqueue -= geo.size;
-  }
-
-   /* Copy image to queue */
-  memcpy(curqueue,in,geo.size);
+  /* The queue is the history of the input, the frames before the
+     start of the stream are black */
 
      /* Copy image blockwise to screenbuffer */
   curdelaymap= (uint32_t *)delaymap;
   for (y=0; y<delaymapheight; y++) {
     for (x=0; x<delaymapwidth; x++) {
 
-      curposnum=((curqueuenum + (*curdelaymap)) % QUEUEDEPTH);
-      
       xyoff= (x*block_per_bytespp) + (y*block_per_pitch);
       /* source */
-      curpos= imagequeue;
-      curpos += (geo.size*curposnum);
-      curpos += xyoff;
+      curpos= (const uint8_t *)
+	(*curdelaymap ? history[*curdelaymap - 1] : in);
+      if (curpos) curpos += xyoff;
       /* target */
       curimage = (uint8_t *)out;
       curimage += xyoff;
       /* copy block */
       for (i=0; i<blocksize; i++) {
-	memcpy(curimage,curpos,block_per_res);
-	curpos += geo.pitch;
+	if (curpos) {
+	  memcpy(curimage,curpos,block_per_res);
+	  curpos += geo.pitch;
+	} else
+	  memset(curimage,0,block_per_res);
 	curimage += geo.pitch;
       }
       curdelaymap++;
@@ -36,6 +36,8 @@ Copyright (C) 2010  Marko Cebokli    http://lea.hamradio.si/~s57uuu
 #include <assert.h>
 #include <inttypes.h>
 
+#include "frei0r_thread.h"
+
 #define MIN_MATRIX_SIZE 3
 #define MAX_MATRIX_SIZE 63
 
@@ -44,7 +46,7 @@ Copyright (C) 2010  Marko Cebokli    http://lea.hamradio.si/~s57uuu
 typedef struct {
         int Coefs[4][512*16];
         unsigned int *Line;
-	unsigned short *Frame[3];
+	unsigned short *Frame;
 }vf_priv_s;
 
 //----------------------------------------
@@ -57,14 +59,15 @@ int w;
 double LumSpac,LumTmp;
 vf_priv_s vps;
 
-unsigned char *Rplani,*Gplani,*Bplani,*Rplano,*Gplano,*Bplano;
+int bands;		//column bands of deNoise()
+unsigned int *edge;
 } inst;
 
 
 //========================================================
-//functions LowPassMul, deNoiseTemporal, deNoiseSpacial,
-//deNoise and PrecalaCoefs  are from Mplayer "hqdn3d" filter
-//by Daniel Moreno <comac@comac.darktech.org>
+//functions LowPassMul, deNoise and PrecalaCoefs  are from
+//Mplayer "hqdn3d" filter by Daniel Moreno <comac@comac.darktech.org>
+//deNoise has been rewritten for packed color, see below
 
 static inline unsigned int LowPassMul(unsigned int PrevMul, unsigned int CurrMul, int* Coef){
 //    int dMul= (PrevMul&0xFFFFFF)-(CurrMul&0xFFFFFF);
@@ -73,137 +76,178 @@ static inline unsigned int LowPassMul(unsigned int PrevMul, unsigned int CurrMul
     return CurrMul + Coef[d];
 }
 
-void deNoiseTemporal(
-                    unsigned char *Frame,        // mpi->planes[x]
-                    unsigned char *FrameDest,    // dmpi->planes[x]
-                    unsigned short *FrameAnt,
-                    int W, int H, int sStride, int dStride,
-                    int *Temporal)
-{
-    long X, Y;
-    unsigned int PixelDst;
+/*
+ * frei0r: deNoise() works on the packed RGBA frame, the three colour
+ * channels of a pixel together, instead of on three planes. Its result
+ * is the same as that of the planar functions of Mplayer.
+ *
+ * The vertical filter recurses down the columns, so the main pass is
+ * split into bands of columns over the threads of frei0r_thread.h. The
+ * horizontal filter recurses along the rows, so a first pass, split into
+ * bands of rows, runs it up to the left edge of each column band and
+ * keeps its state there.
+ */
 
-    for (Y = 0; Y < H; Y++){
-        for (X = 0; X < W; X++){
-            PixelDst = LowPassMul(FrameAnt[X]<<8, Frame[X]<<16, Temporal);
-            FrameAnt[X] = ((PixelDst+0x1000007F)>>8);
-            FrameDest[X]= ((PixelDst+0x10007FFF)>>16);
+typedef struct {
+    const uint32_t *Frame;
+    uint32_t *FrameDest;
+    unsigned int *LineAnt;      // 3 per column
+    unsigned short *FrameAnt;   // 3 per pixel
+    unsigned int *Edge;         // 3 per column band per row
+    int W, H, Bands, Init;
+    int *Horizontal, *Vertical, *Temporal; // 0 if not filtering
+} deNoiseJob;
+
+#define CHANNEL(P,C) (((P)>>(8*(C)))&0xFF)
+
+/* One row of the frame from column X0 to X1, PixelAnt being the
+ * horizontal state left of X0. Horizontal, Vertical, Temporal, FirstLine
+ * and Advance are constants where it is called, so that each case gets a
+ * loop of its own. */
+static inline void deNoiseRow(const uint32_t *Frame, uint32_t *FrameDest,
+                              unsigned int *LineAnt, unsigned short *FrameAnt,
+                              unsigned int *PixelAnt, long X0, long X1,
+                              int *Horizontal, int *Vertical, int *Temporal,
+                              const int FirstLine, const int Advance)
+{
+    long X;
+    int C;
+
+    for (X = X0; X < X1; X++){
+        uint32_t Pixel = Frame[X];
+        uint32_t Dest = Pixel & 0xFF000000; /* alpha is kept */
+
+        for (C = 0; C < 3; C++){
+            unsigned int PixelDst = CHANNEL(Pixel, C)<<16;
+
+            if (Horizontal){
+                /* First pixel on each line doesn't have previous pixel */
+                if (X == 0)
+                    PixelAnt[C] = PixelDst;
+                else {
+                    PixelDst = LowPassMul(PixelAnt[C], PixelDst, Horizontal);
+                    if (Advance)
+                        PixelAnt[C] = PixelDst;
+                }
+                /* First line has no top neighbor */
+                if (FirstLine)
+                    LineAnt[3*X+C] = PixelDst;
+                else
+                    PixelDst = LineAnt[3*X+C] = LowPassMul(LineAnt[3*X+C], PixelDst, Vertical);
+            }
+            if (Temporal){
+                PixelDst = LowPassMul(FrameAnt[3*X+C]<<8, PixelDst, Temporal);
+                FrameAnt[3*X+C] = ((PixelDst+0x1000007F)>>8);
+            }
+            Dest |= (((PixelDst+0x10007FFF)>>16)&0xFF) << (8*C);
         }
-        Frame += sStride;
-        FrameDest += dStride;
-        FrameAnt += W;
+        FrameDest[X] = Dest;
     }
 }
 
-void deNoiseSpacial(
-                    unsigned char *Frame,        // mpi->planes[x]
-                    unsigned char *FrameDest,    // dmpi->planes[x]
-                    unsigned int *LineAnt,       // vf->priv->Line (width bytes)
-                    int W, int H, int sStride, int dStride,
-                    int *Horizontal, int *Vertical)
+/* The horizontal state left of each column band but the first, for the
+ * rows [First, Last). */
+static void deNoiseEdges(void *Arg, unsigned int Band, unsigned int First, unsigned int Last)
 {
+    const deNoiseJob *J = (const deNoiseJob*)Arg;
     long X, Y;
-    long sLineOffs = 0, dLineOffs = 0;
-    unsigned int PixelAnt;
-    unsigned int PixelDst;
-
-    /* First pixel has no left nor top neighbor. */
-    PixelDst = LineAnt[0] = PixelAnt = Frame[0]<<16;
-    FrameDest[0]= ((PixelDst+0x10007FFF)>>16);
-
-    /* First line has no top neighbor, only left. */
-    for (X = 1; X < W; X++){
-        PixelDst = LineAnt[X] = LowPassMul(PixelAnt, Frame[X]<<16, Horizontal);
-        FrameDest[X]= ((PixelDst+0x10007FFF)>>16);
-    }
-
-    for (Y = 1; Y < H; Y++){
-	unsigned int PixelAnt;
-	sLineOffs += sStride, dLineOffs += dStride;
-        /* First pixel on each line doesn't have previous pixel */
-        PixelAnt = Frame[sLineOffs]<<16;
-        PixelDst = LineAnt[0] = LowPassMul(LineAnt[0], PixelAnt, Vertical);
-        FrameDest[dLineOffs]= ((PixelDst+0x10007FFF)>>16);
-
-        for (X = 1; X < W; X++){
-            unsigned int PixelDst;
-            /* The rest are normal */
-            PixelAnt = LowPassMul(PixelAnt, Frame[sLineOffs+X]<<16, Horizontal);
-            PixelDst = LineAnt[X] = LowPassMul(LineAnt[X], PixelAnt, Vertical);
-            FrameDest[dLineOffs+X]= ((PixelDst+0x10007FFF)>>16);
+    int B, C;
+
+    for (Y = First; Y < Last; Y++){
+        const uint32_t *Frame = J->Frame + Y*J->W;
+        unsigned int *Edge = J->Edge + 3*J->Bands*Y;
+        unsigned int PixelAnt[3];
+
+        for (C = 0; C < 3; C++)
+            PixelAnt[C] = CHANNEL(Frame[0], C)<<16;
+        for (B = 1, X = 1; B < J->Bands; B++){
+            long X0 = (long)((unsigned long long)J->W*B/J->Bands);
+            /* The first line of the spatial filter alone filters each
+             * pixel with the first one, as in Mplayer. */
+            if (Y > 0 || J->Temporal)
+                for (; X < X0; X++)
+                    for (C = 0; C < 3; C++)
+                        PixelAnt[C] = LowPassMul(PixelAnt[C], CHANNEL(Frame[X], C)<<16, J->Horizontal);
+            for (C = 0; C < 3; C++)
+                Edge[3*B+C] = PixelAnt[C];
         }
     }
 }
 
-void deNoise(unsigned char *Frame,        // mpi->planes[x]
-                    unsigned char *FrameDest,    // dmpi->planes[x]
-                    unsigned int *LineAnt,      // vf->priv->Line (width bytes)
-		    unsigned short **FrameAntPtr,
-                    int W, int H, int sStride, int dStride,
-                    int *Horizontal, int *Vertical, int *Temporal)
+/* The columns [First, Last) of all rows. */
+static void deNoiseBand(void *Arg, unsigned int Band, unsigned int First, unsigned int Last)
 {
+    const deNoiseJob *J = (const deNoiseJob*)Arg;
+    int *Horizontal = J->Horizontal, *Vertical = J->Vertical, *Temporal = J->Temporal;
     long X, Y;
-    long sLineOffs = 0, dLineOffs = 0;
-    unsigned int PixelAnt;
-    unsigned int PixelDst;
-    unsigned short* FrameAnt=(*FrameAntPtr);
-
-    if(!FrameAnt){
-	(*FrameAntPtr)=FrameAnt=malloc(W*H*sizeof(unsigned short));
-	for (Y = 0; Y < H; Y++){
-	    unsigned short* dst=&FrameAnt[Y*W];
-	    unsigned char* src=Frame+Y*sStride;
-	    for (X = 0; X < W; X++) dst[X]=src[X]<<8;
-	}
-    }
-
-    if(!Horizontal[0] && !Vertical[0]){
-        deNoiseTemporal(Frame, FrameDest, FrameAnt,
-                        W, H, sStride, dStride, Temporal);
-        return;
-    }
-    if(!Temporal[0]){
-        deNoiseSpacial(Frame, FrameDest, LineAnt,
-                       W, H, sStride, dStride, Horizontal, Vertical);
-        return;
-    }
-
-    /* First pixel has no left nor top neighbor. Only previous frame */
-    LineAnt[0] = PixelAnt = Frame[0]<<16;
-    PixelDst = LowPassMul(FrameAnt[0]<<8, PixelAnt, Temporal);
-    FrameAnt[0] = ((PixelDst+0x1000007F)>>8);
-    FrameDest[0]= ((PixelDst+0x10007FFF)>>16);
-
-    /* First line has no top neighbor. Only left one for each pixel and
-     * last frame */
-    for (X = 1; X < W; X++){
-        LineAnt[X] = PixelAnt = LowPassMul(PixelAnt, Frame[X]<<16, Horizontal);
-        PixelDst = LowPassMul(FrameAnt[X]<<8, PixelAnt, Temporal);
-        FrameAnt[X] = ((PixelDst+0x1000007F)>>8);
-        FrameDest[X]= ((PixelDst+0x10007FFF)>>16);
+    int C;
+
+    for (Y = 0; Y < J->H; Y++){
+        const uint32_t *Frame = J->Frame + Y*J->W;
+        uint32_t *FrameDest = J->FrameDest + Y*J->W;
+        unsigned short *FrameAnt = J->FrameAnt + 3*Y*J->W;
+        unsigned int PixelAnt[3] = {0, 0, 0};
+
+        if (J->Init)
+            for (X = First; X < Last; X++)
+                for (C = 0; C < 3; C++)
+                    FrameAnt[3*X+C] = CHANNEL(Frame[X], C)<<8;
+        if (Horizontal && First > 0)
+            for (C = 0; C < 3; C++)
+                PixelAnt[C] = J->Edge[3*(J->Bands*Y+Band)+C];
+
+        if (!Horizontal)
+            deNoiseRow(Frame, FrameDest, J->LineAnt, FrameAnt, PixelAnt, First, Last,
+                       0, 0, Temporal, 0, 1);
+        else if (!Temporal && Y == 0)
+            deNoiseRow(Frame, FrameDest, J->LineAnt, FrameAnt, PixelAnt, First, Last,
+                       Horizontal, Vertical, 0, 1, 0);
+        else if (!Temporal)
+            deNoiseRow(Frame, FrameDest, J->LineAnt, FrameAnt, PixelAnt, First, Last,
+                       Horizontal, Vertical, 0, 0, 1);
+        else if (Y == 0)
+            deNoiseRow(Frame, FrameDest, J->LineAnt, FrameAnt, PixelAnt, First, Last,
+                       Horizontal, Vertical, Temporal, 1, 1);
+        else
+            deNoiseRow(Frame, FrameDest, J->LineAnt, FrameAnt, PixelAnt, First, Last,
+                       Horizontal, Vertical, Temporal, 0, 1);
     }
+}
 
-    for (Y = 1; Y < H; Y++){
-	unsigned int PixelAnt;
-	unsigned short* LinePrev=&FrameAnt[Y*W];
-	sLineOffs += sStride, dLineOffs += dStride;
-        /* First pixel on each line doesn't have previous pixel */
-        PixelAnt = Frame[sLineOffs]<<16;
-        LineAnt[0] = LowPassMul(LineAnt[0], PixelAnt, Vertical);
-	PixelDst = LowPassMul(LinePrev[0]<<8, LineAnt[0], Temporal);
-        LinePrev[0] = ((PixelDst+0x1000007F)>>8);
-        FrameDest[dLineOffs]= ((PixelDst+0x10007FFF)>>16);
-
-        for (X = 1; X < W; X++){
-            unsigned int PixelDst;
-            /* The rest are normal */
-            PixelAnt = LowPassMul(PixelAnt, Frame[sLineOffs+X]<<16, Horizontal);
-            LineAnt[X] = LowPassMul(LineAnt[X], PixelAnt, Vertical);
-	    PixelDst = LowPassMul(LinePrev[X]<<8, LineAnt[X], Temporal);
-            LinePrev[X] = ((PixelDst+0x1000007F)>>8);
-            FrameDest[dLineOffs+X]= ((PixelDst+0x10007FFF)>>16);
-        }
-    }
+void deNoise(const uint32_t *Frame,     // packed RGBA
+             uint32_t *FrameDest,       // packed RGBA, alpha from Frame
+             unsigned int *LineAnt,     // 3*W
+             unsigned short **FrameAntPtr,
+             unsigned int *Edge,        // 3*Bands*H
+             int Bands, int W, int H,
+             int *Horizontal, int *Vertical, int *Temporal)
+{
+    deNoiseJob J;
+
+    J.Frame = Frame;
+    J.FrameDest = FrameDest;
+    J.LineAnt = LineAnt;
+    J.Edge = Edge;
+    J.W = W;
+    J.H = H;
+    J.Bands = Bands;
+    J.Init = !*FrameAntPtr;
+    if (J.Init)
+        *FrameAntPtr = (unsigned short*)malloc(3*W*H*sizeof(unsigned short));
+    J.FrameAnt = *FrameAntPtr;
+
+    /* The same cases as the planar deNoise() of Mplayer */
+    J.Horizontal = Horizontal;
+    J.Vertical = Vertical;
+    J.Temporal = Temporal;
+    if (!Horizontal[0] && !Vertical[0])
+        J.Horizontal = J.Vertical = 0;
+    else if (!Temporal[0])
+        J.Temporal = 0;
+
+    if (J.Horizontal && Bands > 1)
+        f0r_parallel_bands(0, H, Bands, deNoiseEdges, &J);
+    f0r_parallel_bands(0, W, Bands, deNoiseBand, &J);
 }
 
 #define ABS(A) ( (A) > 0 ? (A) : -(A) )
@@ -302,13 +346,12 @@ in->h=height;
 
 in->LumSpac=4;
 in->LumTmp=6;
-in->vps.Line=calloc(width,sizeof(int));
-in->Rplani=calloc(width*height,sizeof(unsigned char));
-in->Gplani=calloc(width*height,sizeof(unsigned char));
-in->Bplani=calloc(width*height,sizeof(unsigned char));
-in->Rplano=calloc(width*height,sizeof(unsigned char));
-in->Gplano=calloc(width*height,sizeof(unsigned char));
-in->Bplano=calloc(width*height,sizeof(unsigned char));
+in->vps.Line=calloc(3*width,sizeof(int));
+//at least 64 columns per band
+in->bands=f0r_thread_count();
+if (in->bands>width/64) in->bands=width/64;
+if (in->bands<1) in->bands=1;
+in->edge=calloc(3*in->bands*height,sizeof(int));
 
 PrecalcCoefs(in->vps.Coefs[0],in->LumSpac);
 PrecalcCoefs(in->vps.Coefs[1],in->LumTmp);
@@ -324,12 +367,8 @@ inst *in;
 in=(inst*)instance;
 
 free(in->vps.Line);
-free(in->Rplani);
-free(in->Gplani);
-free(in->Bplani);
-free(in->Rplano);
-free(in->Gplano);
-free(in->Bplano);
+free(in->vps.Frame);
+free(in->edge);
 
 free(instance);
 }
@@ -387,32 +426,10 @@ switch(param_index)
 void f0r_update(f0r_instance_t instance, double time, const uint32_t* inframe, uint32_t* outframe)
 {
 inst *in;
-int i;
 
 assert(instance);
 in=(inst*)instance;
 
-//Frei0r works with packed color, Mplayer with planar color
-//I decided to copy data rather than modify the hqdn3d functions
-//this takes some time, but future inmprovements in hqdn3d
-//functions can be simply copied here without modification
-
-for (i=0;i<(in->w*in->h);i++)	//copy to planar
-	{
-	in->Rplani[i]=inframe[i]&255;
-	in->Gplani[i]=(inframe[i]>>8)&255;
-	in->Bplani[i]=(inframe[i]>>16)&255;
-	}
-
-deNoise(in->Rplani, in->Rplano, in->vps.Line, &in->vps.Frame[0], in->w, in->h, in->w, in->w, in->vps.Coefs[0], in->vps.Coefs[0], in->vps.Coefs[1]);
-deNoise(in->Gplani, in->Gplano, in->vps.Line, &in->vps.Frame[1], in->w, in->h, in->w, in->w, in->vps.Coefs[0], in->vps.Coefs[0], in->vps.Coefs[1]);
-deNoise(in->Bplani, in->Bplano, in->vps.Line, &in->vps.Frame[2], in->w, in->h, in->w, in->w, in->vps.Coefs[0], in->vps.Coefs[0], in->vps.Coefs[1]);
-
-for (i=0;i<(in->w*in->h);i++)	//copy to packed, preserve alpha
-	{
-	outframe[i]=((uint32_t)in->Rplano[i])|((uint32_t)in->Gplano[i]<<8)|((uint32_t)in->Bplano[i]<<16)|(inframe[i]&0xFF000000);
-	}
-
-
+deNoise(inframe, outframe, in->vps.Line, &in->vps.Frame, in->edge, in->bands, in->w, in->h, in->vps.Coefs[0], in->vps.Coefs[0], in->vps.Coefs[1]);
 }
 
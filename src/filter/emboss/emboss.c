@@ -166,7 +166,7 @@ void f0r_update(f0r_instance_t instance, double time,
   unsigned int len = inst->width * inst->height;
   unsigned char bumpPixels[len];
   unsigned char alphaVals[len];
-  unsigned int index, r, g, b, a = 0;
+  unsigned int index = 0, r, g, b, a = 0;
   const unsigned char* src = (unsigned char*)inframe;
   while (len--)
   {
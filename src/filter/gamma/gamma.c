@@ -23,6 +23,7 @@
 
 #include "frei0r.h"
 #include "frei0r_math.h"
+#include "frei0r_lut.h"
 
 #define MAX_GAMMA 4.0
 
@@ -31,19 +32,40 @@ typedef struct gamma_instance
   unsigned int width;
   unsigned int height;
   double gamma; /* the gamma value [0, 1] */
-  unsigned char lut[256]; /* look-up table */
+  int deep; /* the frames are RGBA64 */
+  f0r_lut_t lut; /* look-up table */
+  f0r_lut16_t lut16; /* look-up table for RGBA64 frames */
 } gamma_instance_t;
 
+typedef struct gamma_map_arg
+{
+  double inv_gamma;
+  double max; /* the largest channel value */
+} gamma_map_arg_t;
+
+static int gamma_map(void* arg, int c, int v)
+{
+  gamma_map_arg_t* g = (gamma_map_arg_t*)arg;
+  if (v == 0)
+    return 0;
+  return ROUND(g->max * pow( (double)v / g->max, g->inv_gamma ) );
+}
+
 /* Updates the look-up-table. */
 void update_lut(gamma_instance_t *inst)
 {
-  int i;
-  unsigned char *lut = inst->lut;
-  double inv_gamma = 1.0 / (inst->gamma * MAX_GAMMA); /* set gamma in the range [0,MAX_GAMMA] and take its inverse */
-
-  lut[0] = 0;
-  for (i=1; i<256; ++i)
-    lut[i] = CLAMP0255( ROUND(255.0 * pow( (double)i / 255.0, inv_gamma ) ) );
+  gamma_map_arg_t g;
+  g.inv_gamma = 1.0 / (inst->gamma * MAX_GAMMA); /* set gamma in the range [0,MAX_GAMMA] and take its inverse */
+  if (inst->deep)
+    {
+      g.max = 65535.0;
+      f0r_lut16_compile(&inst->lut16, gamma_map, &g, F0R_LUT_RGB);
+    }
+  else
+    {
+      g.max = 255.0;
+      f0r_lut_compile(&inst->lut, gamma_map, &g, F0R_LUT_RGB);
+    }
 }
 
 int f0r_init()
@@ -91,6 +113,8 @@ f0r_instance_t f0r_construct(unsigned int width, unsigned int height)
 
 void f0r_destruct(f0r_instance_t instance)
 {
+  gamma_instance_t* inst = (gamma_instance_t*)instance;
+  f0r_lut16_free(&inst->lut16);
   free(instance);
 }
 
@@ -129,22 +153,46 @@ void f0r_get_param_value(f0r_instance_t instance,
   }
 }
 
+int f0r_get_capabilities()
+{
+  return F0R_CAP_SLICE_SAFE | F0R_CAP_RGBA64 | F0R_CAP_IN_PLACE;
+}
+
+int f0r_set_color_model(f0r_instance_t instance, int color_model)
+{
+  assert(instance);
+  gamma_instance_t* inst = (gamma_instance_t*)instance;
+
+  if (color_model != F0R_COLOR_MODEL_RGBA8888
+      && color_model != F0R_COLOR_MODEL_RGBA64)
+    return 0;
+  inst->deep = color_model == F0R_COLOR_MODEL_RGBA64;
+  update_lut(inst);
+  return 1;
+}
+
 void f0r_update(f0r_instance_t instance, double time,
                 const uint32_t* inframe, uint32_t* outframe)
 {
   assert(instance);
   gamma_instance_t* inst = (gamma_instance_t*)instance;
-  unsigned int len = inst->width * inst->height;
-  
-  unsigned char* lut = inst->lut;
-  unsigned char* dst = (unsigned char*)outframe;
-  const unsigned char* src = (unsigned char*)inframe;
-  while (len--)
-  {
-    *dst++ = lut[*src++];
-    *dst++ = lut[*src++];
-    *dst++ = lut[*src++];
-    *dst++ = *src++;// copy alpha
-  }
+  f0r_update_slice(instance, time, inframe, 0, 0, outframe, 0, inst->height);
+}
+
+void f0r_update_slice(f0r_instance_t instance, double time,
+                      const uint32_t* inframe1, const uint32_t* inframe2,
+                      const uint32_t* inframe3, uint32_t* outframe,
+                      unsigned int slice_start, unsigned int slice_height)
+{
+  assert(instance);
+  gamma_instance_t* inst = (gamma_instance_t*)instance;
+  unsigned int offset = inst->width * slice_start;
+  unsigned int len = inst->width * slice_height;
+
+  if (inst->deep)
+    f0r_lut16_apply(&inst->lut16, (const uint16_t*)inframe1 + 4 * offset,
+                    (uint16_t*)outframe + 4 * offset, len);
+  else
+    f0r_lut_apply(&inst->lut, inframe1 + offset, outframe + offset, len);
 }
 
@@ -98,6 +98,11 @@ void f0r_get_param_value(f0r_instance_t instance,
 			break;
 	}
 }
+int f0r_get_capabilities()
+{
+	return F0R_CAP_SLICE_SAFE;
+}
+
 void f0r_update(f0r_instance_t instance, double time,
                 const uint32_t* inframe, uint32_t* outframe)
 {
@@ -122,3 +127,29 @@ void f0r_update(f0r_instance_t instance, double time,
 
 }
 
+void f0r_update_slice(f0r_instance_t instance, double time,
+                      const uint32_t* inframe1, const uint32_t* inframe2,
+                      const uint32_t* inframe3, uint32_t* outframe,
+                      unsigned int slice_start, unsigned int slice_height)
+{
+	glow_instance_t* inst = (glow_instance_t*)instance;
+	unsigned int offset = inst->w * slice_start;
+
+	uint8_t* dst = (uint8_t*)(outframe + offset);
+	const uint8_t* src = (uint8_t*)(inframe1 + offset);
+	const uint8_t* blur = (uint8_t*)(inst->blurred + offset);
+
+	int len = inst->w * slice_height * 4;
+
+	// slices only write their own rows of the blurred frame
+	blur_update_slice(inst->blur_instance, 0.0, inframe1, inst->blurred,
+	                  slice_start, slice_height );
+
+	int i;
+	for ( i = 0; i < len; i++ ) {
+		*dst = 255 - ( ( 255 - *src ) * ( 255 - *blur ) ) / 255;
+		dst++;
+		src++;
+		blur++;
+	}
+}
@@ -126,6 +126,11 @@ void f0r_get_param_value(f0r_instance_t instance,
   }
 }
 
+int f0r_get_capabilities()
+{
+  return F0R_CAP_IN_PLACE;
+}
+
 void f0r_update(f0r_instance_t instance, double time,
                 const uint32_t* inframe, uint32_t* outframe)
 {
@@ -133,7 +138,8 @@ void f0r_update(f0r_instance_t instance, double time,
   hueshift0r_instance_t* inst = (hueshift0r_instance_t*)instance;
   unsigned int len = inst->width * inst->height;
   
-  memcpy(outframe, inframe, len*sizeof(uint32_t));
+  if (outframe != inframe)
+    memcpy(outframe, inframe, len*sizeof(uint32_t));
   applymatrix((unsigned long*)outframe, inst->mat, len);
 }
 
@@ -55,19 +55,33 @@ void f0r_get_param_value(f0r_instance_t instance,
 			 f0r_param_t param, int param_index)
 { /* no params */ }
 
+int f0r_get_capabilities()
+{
+  return F0R_CAP_SLICE_SAFE | F0R_CAP_IN_PLACE;
+}
+
 void f0r_update(f0r_instance_t instance, double time,
 		const uint32_t* inframe, uint32_t* outframe)
+{
+  assert(instance);
+  inverter_instance_t* inst = (inverter_instance_t*)instance;
+  f0r_update_slice(instance, time, inframe, 0, 0, outframe, 0, inst->height);
+}
+
+void f0r_update_slice(f0r_instance_t instance, double time,
+		      const uint32_t* inframe1, const uint32_t* inframe2,
+		      const uint32_t* inframe3, uint32_t* outframe,
+		      unsigned int slice_start, unsigned int slice_height)
 {
   assert(instance);
   inverter_instance_t* inst = (inverter_instance_t*)instance;
   unsigned int w = inst->width;
-  unsigned int h = inst->height;
+  unsigned int h = slice_height;
   unsigned int x,y;
   
-  uint32_t* dst = outframe;
-  const uint32_t* src = inframe;
+  uint32_t* dst = outframe + w * slice_start;
+  const uint32_t* src = inframe1 + w * slice_start;
   for(y=0;y<h;++y)
       for(x=0;x<w;++x,++src)
 	  *dst++ = 0x00ffffff^(*src); 
 }
-
@@ -41,47 +41,18 @@ Copyright (C) 2012  Marko Cebokli    http://lea.hamradio.si/~s57uuu
 
 double PI=3.14159265358979;
 
-typedef struct
-	{
-	float r;
-	float g;
-	float b;
-	float a;
-	} float_rgba;
+#include "frei0r_cfc.h"
 
 //----------------------------------------------------
 void RGBA8888_2_float(const uint32_t* in, float_rgba *out, int w, int h)
 {
-uint8_t *cin;
-int i;
-float f1;
-
-cin=(uint8_t *)in;
-f1=1.0/255.0;
-for (i=0;i<w*h;i++)
-	{
-	out[i].r=f1*(float)*cin++;
-	out[i].g=f1*(float)*cin++;
-	out[i].b=f1*(float)*cin++;
-	out[i].a=f1*(float)*cin++;
-	}
+RGBA8_2_float_lin(in, out, w, h, (float)(1.0/255.0), 0.0);
 }
 
 //------------------------------------------------------------------
 void float_2_RGBA8888(const float_rgba *in, uint32_t* out, int w, int h)
 {
-uint8_t *cout;
-int i;
-
-cout=(uint8_t *)out;
-
-for (i=0;i<w*h;i++)
-	{
-	*cout++=(uint8_t)(in[i].r*255.0);
-	*cout++=(uint8_t)(in[i].g*255.0);
-	*cout++=(uint8_t)(in[i].b*255.0);
-	*cout++=(uint8_t)(in[i].a*255.0);
-	}
+float_2_RGBA8_lin(in, out, w, h, 255.0);
 }
 
 //------------------------------------------------
@@ -675,6 +646,7 @@ int showmask;
 int m2a;
 int fo;		//foreground only (speed)
 int cm;		//color model 0=rec601  1=rec 709
+int flt;	//frames are RGBA_FLOAT
 
 //video buffers
 float_rgba *sl;
@@ -1027,60 +999,71 @@ switch(param_index)
 void f0r_update(f0r_instance_t instance, double time, const uint32_t* inframe, uint32_t* outframe)
 {
 inst *in;
+float_rgba *sl;
 
 assert(instance);
 in=(inst*)instance;
 
-RGBA8888_2_float(inframe, in->sl, in->w, in->h);
+if (in->flt)		//RGBA_FLOAT frames, work on the output
+    {
+    sl=(float_rgba*)outframe;
+    if (inframe!=outframe)
+        memcpy(sl, inframe, in->w*in->h*sizeof(float_rgba));
+    }
+else
+    {
+    sl=in->sl;
+    RGBA8888_2_float(inframe, sl, in->w, in->h);
+    }
 
 switch(in->maskType)		//GENERATE MASK
     {
     case 0:		//Color distance based mask
 	{
-	rgb_mask(in->sl, in->w, in->h, in->mask, in->krgb, in->tol, in->slope, in->fo);
+	rgb_mask(sl, in->w, in->h, in->mask, in->krgb, in->tol, in->slope, in->fo);
         break;
 	}
     case 1:		//Transparency based mask
 	{
-	trans_mask(in->sl, in->w, in->h, in->mask, in->tol);
+	trans_mask(sl, in->w, in->h, in->mask, in->tol);
 	break;
 	}
     case 2:		//Edge based mask inwards
 	{
-	edge_mask(in->sl, in->w, in->h, in->mask, in->tol*200.0, -1);
+	edge_mask(sl, in->w, in->h, in->mask, in->tol*200.0, -1);
 	break;
 	}
     case 3:		//Edge based mask outwards
 	{
-	edge_mask(in->sl, in->w, in->h, in->mask, in->tol*200.0, 1);
+	edge_mask(sl, in->w, in->h, in->mask, in->tol*200.0, 1);
 	break;
 	}
     }
 
-hue_gate(in->sl, in->w, in->h, in->mask, in->krgb, in->Hgate, 0.5*in->Hgate);
-sat_thres(in->sl, in->w, in->h, in->mask, in->Sthresh);
+hue_gate(sl, in->w, in->h, in->mask, in->krgb, in->Hgate, 0.5*in->Hgate);
+sat_thres(sl, in->w, in->h, in->mask, in->Sthresh);
 
 switch(in->op1)		//OPERATION 1
     {
     case 0: break;
     case 1:	//De-Key
 	{
-	clean_rad_m(in->sl, in->w, in->h, in->krgb, in->mask, in->am1);
+	clean_rad_m(sl, in->w, in->h, in->krgb, in->mask, in->am1);
 	break;
 	}
     case 2:	//Target
 	{
-	clean_tgt_m(in->sl, in->w, in->h, in->krgb, in->mask, in->am1, in->trgb);
+	clean_tgt_m(sl, in->w, in->h, in->krgb, in->mask, in->am1, in->trgb);
 	break;
 	}
     case 3:	//Desaturate
 	{
-	desat_m(in->sl, in->w, in->h, in->mask, in->am1, in->cm);
+	desat_m(sl, in->w, in->h, in->mask, in->am1, in->cm);
 	break;
 	}
     case 4:	//Luma adjust
 	{
-	luma_m(in->sl, in->w, in->h, in->mask, in->am1, in->cm);
+	luma_m(sl, in->w, in->h, in->mask, in->am1, in->cm);
 	break;
 	}
     }
@@ -1090,36 +1073,58 @@ switch(in->op2)		//OPERATION 2
     case 0: break;
     case 1:	//De-Key
 	{
-	clean_rad_m(in->sl, in->w, in->h, in->krgb, in->mask, in->am2);
+	clean_rad_m(sl, in->w, in->h, in->krgb, in->mask, in->am2);
 	break;
 	}
     case 2:	//Target
 	{
-	clean_tgt_m(in->sl, in->w, in->h, in->krgb, in->mask, in->am2, in->trgb);
+	clean_tgt_m(sl, in->w, in->h, in->krgb, in->mask, in->am2, in->trgb);
 	break;
 	}
     case 3:	//Desaturate
 	{
-	desat_m(in->sl, in->w, in->h, in->mask, in->am2, in->cm);
+	desat_m(sl, in->w, in->h, in->mask, in->am2, in->cm);
 	break;
 	}
     case 4:	//Luma adjust
 	{
-	luma_m(in->sl, in->w, in->h, in->mask, in->am2, in->cm);
+	luma_m(sl, in->w, in->h, in->mask, in->am2, in->cm);
 	break;
 	}
     }
 
 if (in->showmask)	//REPLACE IMAGE WITH THE MASK
     {
-    copy_mask_i(in->sl, in->w, in->h, in->mask);
+    copy_mask_i(sl, in->w, in->h, in->mask);
     }
     
 if (in->m2a)		//REPLACE ALPHA WITH THE MASK
     {
-    copy_mask_a(in->sl, in->w, in->h, in->mask);
+    copy_mask_a(sl, in->w, in->h, in->mask);
     }      
       
       
-float_2_RGBA8888(in->sl, outframe, in->w, in->h);
+if (!in->flt)
+    float_2_RGBA8888(sl, outframe, in->w, in->h);
+}
+
+//-----------------------------------------------------
+int f0r_get_capabilities()
+{
+return F0R_CAP_RGBA_FLOAT | F0R_CAP_IN_PLACE;
+}
+
+//-----------------------------------------------------
+int f0r_set_color_model(f0r_instance_t instance, int color_model)
+{
+inst *in;
+
+in=(inst*)instance;
+if (color_model==F0R_COLOR_MODEL_RGBA_FLOAT)
+	in->flt=1;
+else if (color_model==F0R_COLOR_MODEL_RGBA8888)
+	in->flt=0;
+else
+	return 0;
+return 1;
 }
\ No newline at end of file
@@ -18,11 +18,13 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include <assert.h>
 
 #include "frei0r.h"
 #include "frei0r_math.h"
+#include "frei0r_remap.h"
 
 typedef struct lenscorrection_instance
 {
@@ -33,6 +35,9 @@ typedef struct lenscorrection_instance
   double correctionnearcenter;
   double correctionnearedges;
   double brightness;
+  double interpolation;
+  f0r_remap_t remap;
+  double map_params[5]; /* parameters the remap was built for */
 } lenscorrection_instance_t;
 
 
@@ -52,8 +57,8 @@ void f0r_get_plugin_info(f0r_plugin_info_t* lenscorrection_info)
   lenscorrection_info->color_model = F0R_COLOR_MODEL_RGBA8888;
   lenscorrection_info->frei0r_version = FREI0R_MAJOR_VERSION;
   lenscorrection_info->major_version = 0; 
-  lenscorrection_info->minor_version = 2; 
-  lenscorrection_info->num_params =  5; 
+  lenscorrection_info->minor_version = 3; 
+  lenscorrection_info->num_params =  6; 
   lenscorrection_info->explanation = "Allows compensation of lens distortion";
 }
 
@@ -86,6 +91,11 @@ void f0r_get_param_info(f0r_param_info_t* info, int param_index)
 			info->type = F0R_PARAM_DOUBLE;
 			info->explanation = "";
 			break;
+		case 5:
+			info->name = "Interpolation";
+			info->type = F0R_PARAM_DOUBLE;
+			info->explanation = "Nearest neighbour, bilinear or bicubic";
+			break;
 	}
 }
 
@@ -99,11 +109,14 @@ f0r_instance_t f0r_construct(unsigned int width, unsigned int height)
   inst->correctionnearcenter = 0.5;
   inst->correctionnearedges = 0.5;
   inst->brightness = 0.5;
+  inst->interpolation = 0.5;
   return (f0r_instance_t)inst;
 }
 
 void f0r_destruct(f0r_instance_t instance)
 {
+  lenscorrection_instance_t* inst = (lenscorrection_instance_t*)instance;
+  f0r_remap_free(&inst->remap);
   free(instance);
 }
 
@@ -136,6 +149,10 @@ void f0r_set_param_value(f0r_instance_t instance,
 			val = *((double*)param);
 			inst->brightness = val;
 			break;
+		case 5:
+			val = *((double*)param);
+			inst->interpolation = val;
+			break;
 	}
 }
 
@@ -162,16 +179,20 @@ void f0r_get_param_value(f0r_instance_t instance,
 		case 4:
 			*((double*)param) = inst->brightness;
 			break;
+		case 5:
+			*((double*)param) = inst->interpolation;
+			break;
 	}
 }
 
-void f0r_update(f0r_instance_t instance, double time,
-		const uint32_t* inframe, uint32_t* outframe)
+/* Computes the source position of every pixel into the remap. Only
+ * done when the parameters change, f0r_update() is a gather after that. */
+static void update_map(lenscorrection_instance_t* inst)
 {
 	//Algorithm fetched from Krita
-	int x, y;
-	assert(instance);
-	lenscorrection_instance_t* inst = (lenscorrection_instance_t*)instance;
+	static const int kinds[3] = { F0R_REMAP_NEAREST, F0R_REMAP_BILINEAR,
+				      F0R_REMAP_BICUBIC_SHARP };
+	int x, y, kind;
 
 	double xcenter = inst->xcenter;
 	double ycenter = inst->ycenter;
@@ -185,6 +206,10 @@ void f0r_update(f0r_instance_t instance, double time,
 	double mult_sq = ( correctionnearcenter - 0.5 );
 	double mult_qd = ( correctionnearedges - 0.5);
 
+	kind = kinds[CLAMP((int)(inst->interpolation * 3.0), 0, 2)];
+	f0r_remap_prepare(&inst->remap, inst->width, inst->height,
+			  inst->width, inst->height, kind);
+
 	for ( y = 0; y < inst->height; y++ ) {
 		for ( x = 0; x < inst->width; x++ ) {
 			double off_x = x - xcenter;
@@ -205,15 +230,33 @@ void f0r_update(f0r_instance_t instance, double time,
 			sx = srcX;
 			sy = srcY;
 			if ( sx < 0 || sy < 0 || sx >= inst->width || sy >= inst->height ) {
-				outframe[x + y * inst->width] =	0x00000000;
+				f0r_remap_background(&inst->remap, x + y * inst->width);
 				continue;
 			}
-			//FIXME: interpolate pixel!!
-			outframe[x + y * inst->width] = inframe[sx + sy * inst->width];
+			if ( kind == F0R_REMAP_NEAREST )
+				f0r_remap_point(&inst->remap, x + y * inst->width, sx, sy);
+			else
+				f0r_remap_point(&inst->remap, x + y * inst->width, srcX, srcY);
 		}
 	}
 }
 
+void f0r_update(f0r_instance_t instance, double time,
+		const uint32_t* inframe, uint32_t* outframe)
+{
+	assert(instance);
+	lenscorrection_instance_t* inst = (lenscorrection_instance_t*)instance;
+	double params[5] = { inst->xcenter, inst->ycenter,
+			     inst->correctionnearcenter, inst->correctionnearedges,
+			     inst->interpolation };
+
+	if ( !inst->remap.map || memcmp(params, inst->map_params, sizeof(params)) ) {
+		update_map(inst);
+		memcpy(inst->map_params, params, sizeof(params));
+	}
+	f0r_remap_run(&inst->remap, inframe, outframe, 0x00000000);
+}
+
 uint32_t interpolate_pixel( uint8_t* frame, int w, int h, double x, double y ) {
 /*
 	+--+--+
@@ -19,6 +19,7 @@
 
 #include <math.h>
 #include "frei0r.h"
+#include "frei0r_roi.h"
 #include <stdlib.h>
 #include <stdio.h>
 
@@ -123,6 +124,10 @@ void f0r_get_param_value(f0r_instance_t instance,
 			break;
 	}
 }
+int f0r_get_capabilities()
+{
+	return F0R_CAP_IN_PLACE | F0R_CAP_ROI;
+}
 void f0r_update(f0r_instance_t instance, double time,
                 const uint32_t* inframe, uint32_t* outframe)
 {
@@ -139,4 +144,32 @@ void f0r_update(f0r_instance_t instance, double time,
 	}
 	
 }
+void f0r_update_roi(f0r_instance_t instance, double time,
+                    const uint32_t* inframe1, const uint32_t* inframe2,
+                    const uint32_t* inframe3, uint32_t* outframe,
+                    const f0r_rect_t* roi, f0r_rect_t* modified)
+{
+	letterb0xed_instance_t* inst = (letterb0xed_instance_t*)instance;
+	unsigned int top = inst->top / inst->w;
+	unsigned int bottom = inst->bottom / inst->w;
+	f0r_rect_t top_bar = f0r_rect_make( 0, 0, inst->w, top );
+	f0r_rect_t bottom_bar = f0r_rect_make( 0, bottom, inst->w, inst->h - bottom );
+	unsigned int x, y;
 
+	// only the bars change, the picture between them is copied where
+	// the bounding box of both covers it
+	top_bar = f0r_rect_intersect( &top_bar, roi );
+	bottom_bar = f0r_rect_intersect( &bottom_bar, roi );
+	*modified = f0r_rect_union( &top_bar, &bottom_bar );
+	for ( y = modified->y; y < modified->y + modified->height; y++ ) {
+		uint32_t* out = outframe + y * inst->w;
+		if ( y >= top && y < bottom ) {
+			f0r_rect_t row = f0r_rect_make( modified->x, y, modified->width, 1 );
+			f0r_rect_copy( inframe1, outframe, inst->w, &row );
+			continue;
+		}
+		for ( x = modified->x; x < modified->x + modified->width; x++ ) {
+			out[x] = inst->background;
+		}
+	}
+}
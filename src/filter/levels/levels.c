@@ -24,6 +24,7 @@
 
 #include "frei0r.h"
 #include "frei0r_math.h"
+#include "frei0r_lut.h"
 #define CHANNEL_RED 0
 #define CHANNEL_GREEN 1
 #define CHANNEL_BLUE 2
@@ -46,8 +47,45 @@ typedef struct levels_instance
   double channel;
   double showHistogram;
   double histogramPosition;
+  int deep; // frames are RGBA64
+  int dirty; // lut16 is out of date
+  f0r_lut16_t lut16;
 } levels_instance_t;
 
+// The levels curve at v, for channel values in [0, max]
+static int levels_map(const levels_instance_t* inst, int i, double max)
+{
+  double inScale = inst->inputMax != inst->inputMin?inst->inputMax - inst->inputMin:1;
+  double exp = inst->gamma == 0?1:1/inst->gamma;
+  double outScale = inst->outputMax - inst->outputMin;
+  double v = i / max - inst->inputMin;
+  if (v < 0.0) {
+	v = 0.0;
+  }
+  double w = pow(v / inScale, exp) * outScale + inst->outputMin;
+  return lrintf(w * max);
+}
+
+static int levels_map16(void* arg, int c, int v)
+{
+  return levels_map((const levels_instance_t*)arg, v, 65535.0);
+}
+
+// Channel values of the histogram overlay, which is drawn with 8 bit
+// values on both kinds of frames
+static inline int get_px(const void* frame, int deep, int i)
+{
+  return deep ? ((const uint16_t*)frame)[i] >> 8 : ((const uint8_t*)frame)[i];
+}
+
+static inline void put_px(void* frame, int deep, int i, int v)
+{
+  if (deep)
+	((uint16_t*)frame)[i] = v * 257;
+  else
+	((uint8_t*)frame)[i] = v;
+}
+
 int f0r_init()
 {
   return 1;
@@ -128,11 +166,14 @@ f0r_instance_t f0r_construct(unsigned int width, unsigned int height)
   inst->channel = 0;
   inst->showHistogram = 1;
   inst->histogramPosition = 3;
+  inst->dirty = 1;
   return (f0r_instance_t)inst;
 }
 
 void f0r_destruct(f0r_instance_t instance)
 {
+  levels_instance_t* inst = (levels_instance_t*)instance;
+  f0r_lut16_free(&inst->lut16);
   free(instance);
 }
 
@@ -142,6 +183,7 @@ void f0r_set_param_value(f0r_instance_t instance,
   assert(instance);
   levels_instance_t* inst = (levels_instance_t*)instance;
 
+  inst->dirty = 1;
   switch(param_index)
   {
 	case 0:
@@ -206,6 +248,23 @@ void f0r_get_param_value(f0r_instance_t instance,
   }
 }
 
+int f0r_get_capabilities()
+{
+  return F0R_CAP_RGBA64;
+}
+
+int f0r_set_color_model(f0r_instance_t instance, int color_model)
+{
+  assert(instance);
+  levels_instance_t* inst = (levels_instance_t*)instance;
+
+  if (color_model != F0R_COLOR_MODEL_RGBA8888
+      && color_model != F0R_COLOR_MODEL_RGBA64)
+    return 0;
+  inst->deep = color_model == F0R_COLOR_MODEL_RGBA64;
+  return 1;
+}
+
 void f0r_update(f0r_instance_t instance, double time,
                 const uint32_t* inframe, uint32_t* outframe)
 {
@@ -221,23 +280,42 @@ void f0r_update(f0r_instance_t instance, double time,
   double levels[256];
   unsigned int map[256];
 
-  double inScale = inst->inputMax != inst->inputMin?inst->inputMax - inst->inputMin:1;
-  double exp = inst->gamma == 0?1:1/inst->gamma;
-  double outScale = inst->outputMax - inst->outputMin;
-
-  for(int i = 0; i < 256; i++) {
-	double v = i / 255. - inst->inputMin;
-	if (v < 0.0) {
-		v = 0.0;
-	}           
-	double w = pow(v / inScale, exp) * outScale + inst->outputMin;
-	map[i] = CLAMP0255(lrintf(w * 255.0));
-  }
-
   if (inst->showHistogram)
 	for(int i = 0; i < 256; i++)
 	  levels[i] = 0;  
 
+  if (inst->deep) {
+	const uint16_t* src16 = (const uint16_t*)inframe;
+	if (inst->dirty) {
+	  int mask =
+	    inst->channel == CHANNEL_RED?F0R_LUT_R:
+	    inst->channel == CHANNEL_GREEN?F0R_LUT_G:
+	    inst->channel == CHANNEL_BLUE?F0R_LUT_B:
+	    inst->channel == CHANNEL_LUMA?F0R_LUT_RGB:0;
+	  f0r_lut16_compile(&inst->lut16, levels_map16, inst, mask);
+	  inst->dirty = 0;
+	}
+	if (inst->showHistogram)
+	  for (unsigned int i = 0; i < len; i++, src16 += 4) {
+		r = src16[0] >> 8;
+		g = src16[1] >> 8;
+		b = src16[2] >> 8;
+		int intensity = 
+		  inst->channel == CHANNEL_RED?r:
+		  inst->channel == CHANNEL_GREEN?g:
+		  inst->channel == CHANNEL_BLUE?b:
+		      CLAMP0255(b * .114 + g * .587 + r * .299);
+		levels[intensity]++;
+		if (levels[intensity] > maxHisto)
+		  maxHisto = levels[intensity];
+	  }
+	f0r_lut16_apply(&inst->lut16, (const uint16_t*)inframe, (uint16_t*)outframe, len);
+	len = 0;
+  }
+  else
+	for(int i = 0; i < 256; i++)
+	  map[i] = CLAMP0255(levels_map(inst, i, 255.0));
+
   while (len--)
   {
 	r = *src++;
@@ -277,6 +355,11 @@ void f0r_update(f0r_instance_t instance, double time,
 	  *dst++ = map[g];
 	  *dst++ = map[b];
 	  break;
+	default: // no such channel, as on RGBA64 frames
+	  *dst++ = r;
+	  *dst++ = g;
+	  *dst++ = b;
+	  break;
 	}
 
 	*dst++ = *src++;  // copy alpha
@@ -299,10 +382,9 @@ void f0r_update(f0r_instance_t instance, double time,
 	  for(int x = 0; x < thirdX; x++) {
 		int offset = ((y + yOffset) * inst->width + x + xOffset) * 4;
 		int drawPoint = pointValue < (double)levels[CLAMP0255(x * 255 / thirdX)] / maxHisto;
-		dst[offset] = drawPoint?(CHANNEL_RED != inst->channel || CHANNEL_LUMA == inst->channel?0:255):127 + src[offset]/2;
-		dst[offset + 1] = drawPoint?(CHANNEL_GREEN != inst->channel || CHANNEL_LUMA == inst->channel?0:255):127 + src[offset + 1]/2;
-		dst[offset + 2] = drawPoint?(CHANNEL_BLUE != inst->channel || CHANNEL_LUMA == inst->channel?0:255):127 + src[offset + 2]/2;
-		dst[offset + 3] = src[offset + 3];
+		put_px(dst, inst->deep, offset, drawPoint?(CHANNEL_RED != inst->channel || CHANNEL_LUMA == inst->channel?0:255):127 + get_px(src, inst->deep, offset)/2);
+		put_px(dst, inst->deep, offset + 1, drawPoint?(CHANNEL_GREEN != inst->channel || CHANNEL_LUMA == inst->channel?0:255):127 + get_px(src, inst->deep, offset + 1)/2);
+		put_px(dst, inst->deep, offset + 2, drawPoint?(CHANNEL_BLUE != inst->channel || CHANNEL_LUMA == inst->channel?0:255):127 + get_px(src, inst->deep, offset + 2)/2);
 	  }
 	}
 	int posInMin = inst->inputMin * thirdX;
@@ -325,13 +407,13 @@ void f0r_update(f0r_instance_t instance, double time,
 	  int offsettedYlower = (y + yOffset + barHeight * 2) * inst->width; 
 	  for(int x = 0; x < thirdX; x++) {
 		int offset = (offsettedY + x + xOffset) * 4;
-		dst[offset] = 127 + dst[offset]/2;
-		dst[offset + 1] = 127 + dst[offset + 1]/2;
-		dst[offset + 2] = 127 + dst[offset + 2]/2;
+		put_px(dst, inst->deep, offset, 127 + get_px(dst, inst->deep, offset)/2);
+		put_px(dst, inst->deep, offset + 1, 127 + get_px(dst, inst->deep, offset + 1)/2);
+		put_px(dst, inst->deep, offset + 2, 127 + get_px(dst, inst->deep, offset + 2)/2);
 		offset = (offsettedYlower + x + xOffset) * 4;
-		dst[offset] = 127 + dst[offset]/2;
-		dst[offset + 1] = 127 + dst[offset + 1]/2;
-		dst[offset + 2] = 127 + dst[offset + 2]/2;
+		put_px(dst, inst->deep, offset, 127 + get_px(dst, inst->deep, offset)/2);
+		put_px(dst, inst->deep, offset + 1, 127 + get_px(dst, inst->deep, offset + 1)/2);
+		put_px(dst, inst->deep, offset + 2, 127 + get_px(dst, inst->deep, offset + 2)/2);
 	  }
 	  int delta = (y - histoHeight)/2;
 	  
@@ -343,33 +425,33 @@ void f0r_update(f0r_instance_t instance, double time,
 		int xGamma = x + posGamma;
 		if (xInMin >= 0 && xInMin < thirdX) {
 		  int offset = (offsettedY + xInMin + xOffset) * 4;
-		  dst[offset] = 0;
-		  dst[offset + 1] = 0;
-		  dst[offset + 2] = 0;
+		  put_px(dst, inst->deep, offset, 0);
+		  put_px(dst, inst->deep, offset + 1, 0);
+		  put_px(dst, inst->deep, offset + 2, 0);
 		}
 		if (xInMax >= 0 && xInMax < thirdX) {
 		  int offset = (offsettedY + xInMax + xOffset) * 4;
-		  dst[offset] = color[0];
-		  dst[offset + 1] = color[1];
-		  dst[offset + 2] = color[2];
+		  put_px(dst, inst->deep, offset, color[0]);
+		  put_px(dst, inst->deep, offset + 1, color[1]);
+		  put_px(dst, inst->deep, offset + 2, color[2]);
 		}
 		if (xGamma >= 0 && xGamma < thirdX) {
 		  int offset = (offsettedY + xGamma + xOffset) * 4;
-		  dst[offset] = midColor[0];
-		  dst[offset + 1] = midColor[1];
-		  dst[offset + 2] = midColor[2];
+		  put_px(dst, inst->deep, offset, midColor[0]);
+		  put_px(dst, inst->deep, offset + 1, midColor[1]);
+		  put_px(dst, inst->deep, offset + 2, midColor[2]);
 		}
 		if (xOutMin >= 0 && xOutMin < thirdX) {
 		  int offset = (offsettedYlower + xOutMin + xOffset) * 4;
-		  dst[offset] = 0;
-		  dst[offset + 1] = 0;
-		  dst[offset + 2] = 0;
+		  put_px(dst, inst->deep, offset, 0);
+		  put_px(dst, inst->deep, offset + 1, 0);
+		  put_px(dst, inst->deep, offset + 2, 0);
 		}
 		if (xOutMax >= 0 && xOutMax < thirdX) {
 		  int offset = (offsettedYlower + xOutMax + xOffset) * 4;
-		  dst[offset] = color[0];
-		  dst[offset + 1] = color[1];
-		  dst[offset + 2] = color[2];
+		  put_px(dst, inst->deep, offset, color[0]);
+		  put_px(dst, inst->deep, offset + 1, color[1]);
+		  put_px(dst, inst->deep, offset + 2, color[2]);
 		}
 	  }
 	}
@@ -377,9 +459,9 @@ void f0r_update(f0r_instance_t instance, double time,
 	  for(int x = 0; x < thirdX; x++) {
 		int offset = ((y + yOffset) * inst->width + x + xOffset) * 4;
 		int pointValue = CLAMP0255(x * 255 / thirdX);
-		dst[offset] = inst->channel == CHANNEL_RED || inst->channel == CHANNEL_LUMA?pointValue:0;
-		dst[offset + 1] = inst->channel == CHANNEL_GREEN || inst->channel == CHANNEL_LUMA?pointValue:0;
-		dst[offset + 2] = inst->channel == CHANNEL_BLUE || inst->channel == CHANNEL_LUMA?pointValue:0;
+		put_px(dst, inst->deep, offset, inst->channel == CHANNEL_RED || inst->channel == CHANNEL_LUMA?pointValue:0);
+		put_px(dst, inst->deep, offset + 1, inst->channel == CHANNEL_GREEN || inst->channel == CHANNEL_LUMA?pointValue:0);
+		put_px(dst, inst->deep, offset + 2, inst->channel == CHANNEL_BLUE || inst->channel == CHANNEL_LUMA?pointValue:0);
 	  }
 	}
   }
@@ -79,16 +79,32 @@ void f0r_get_param_value(f0r_instance_t instance,
 {
 }
 
+int f0r_get_capabilities()
+{
+  return F0R_CAP_SLICE_SAFE | F0R_CAP_IN_PLACE;
+}
+
 void f0r_update(f0r_instance_t instance, double time,
                 const uint32_t* inframe, uint32_t* outframe)
 {
   assert(instance);
   luminance_instance_t* inst = (luminance_instance_t*)instance;
-  unsigned int len = inst->width * inst->height;
+  f0r_update_slice(instance, time, inframe, 0, 0, outframe, 0, inst->height);
+}
+
+void f0r_update_slice(f0r_instance_t instance, double time,
+                      const uint32_t* inframe1, const uint32_t* inframe2,
+                      const uint32_t* inframe3, uint32_t* outframe,
+                      unsigned int slice_start, unsigned int slice_height)
+{
+  assert(instance);
+  luminance_instance_t* inst = (luminance_instance_t*)instance;
+  unsigned int offset = inst->width * slice_start;
+  unsigned int len = inst->width * slice_height;
 
 
-  unsigned char* dst = (unsigned char*)outframe;
-  const unsigned char* src = (unsigned char*)inframe;
+  unsigned char* dst = (unsigned char*)(outframe + offset);
+  const unsigned char* src = (unsigned char*)(inframe1 + offset);
 
   int b, g, r, l;
   while (len--)
@@ -26,13 +26,7 @@ Copyright (C) 2010  Marko Cebokli    http://lea.hamradio.si/~s57uuu
 
 //measurement functions for direct inclusion in pr0be.c, pr0file.c
 
-typedef struct		//float pixel
-	{
-	float r;
-	float g;
-	float b;
-	float a;
-	} float_rgba;
+#include "frei0r_cfc.h"	//float pixel
 
 typedef struct		//statistics
 	{
@@ -29,6 +29,7 @@ Copyright (C) 2010  Marko Cebokli    http://lea.hamradio.si/~s57uuu
 #include <stdio.h>
 #include <frei0r.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include <assert.h>
 
@@ -248,9 +249,9 @@ if (sx>np)
       {
       y=y0+np2*vp+j+vp/2;
       x=x0+i;
-      s[w*y+x]=white;
+      if ((x>=0)&&(x<w)&&(y>=0)&&(y<h)) s[w*y+x]=white;
       x=x0+(np+2)*vp-i-1;
-      s[w*y+x]=white;
+      if ((x>=0)&&(x<w)&&(y>=0)&&(y<h)) s[w*y+x]=white;
       }	
   }
 if (sy>np)
@@ -260,9 +261,9 @@ if (sy>np)
       {
       x=x0+np2*vp+j+vp/2;
       y=y0+i;
-      s[w*y+x]=white;
+      if ((x>=0)&&(x<w)&&(y>=0)&&(y<h)) s[w*y+x]=white;
       y=y0+(np+2)*vp-i-1;
-      s[w*y+x]=white;
+      if ((x>=0)&&(x<w)&&(y>=0)&&(y<h)) s[w*y+x]=white;
       }	
   }
 
@@ -462,17 +463,7 @@ switch (m)
 //Frei0r rgba8888 color
 void floatrgba2color(float_rgba *sl, uint32_t* outframe, int w , int h)
 {
-int i;
-uint32_t p;
-
-for (i=0;i<w*h;i++)
-	{
-	p=(uint32_t)(255.0*sl[i].a) & 0xFF;
-	p=(p<<8) + ((uint32_t)(255.0*sl[i].b) & 0xFF);
-	p=(p<<8) + ((uint32_t)(255.0*sl[i].g) & 0xFF);
-	p=(p<<8) + ((uint32_t)(255.0*sl[i].r) & 0xFF);
-	outframe[i]=p;
-	}
+float_2_RGBA8_lin(sl, outframe, w, h, 255.0);
 }
 
 //-----------------------------------------------------
@@ -480,15 +471,7 @@ for (i=0;i<w*h;i++)
 //internal float RGBA
 void color2floatrgba(const uint32_t* inframe, float_rgba *sl, int w , int h)
 {
-int i;
-
-for (i=0;i<w*h;i++)
-	{
-	sl[i].r=((float)(inframe[i] & 0x000000FF))*0.00392157;
-	sl[i].g=((float)((inframe[i] & 0x0000FF00)>>8))*0.00392157;
-	sl[i].b=((float)((inframe[i] & 0x00FF0000)>>16))*0.00392157;
-	sl[i].a=((float)((inframe[i] & 0xFF000000)>>24))*0.00392157;
-	}
+RGBA8_2_float_lin(inframe, sl, w, h, 0.00392157, 0.0);
 }
 
 //-----------------------------------------------------
@@ -522,6 +505,7 @@ int sha;
 int bw;
 
 int poz;
+int flt;	//frames are RGBA_FLOAT
 float_rgba *sl;
 } inst;
 
@@ -741,15 +725,48 @@ inst *in;
 float l;
 unsigned char lc;
 int i;
+float_rgba *sl;
 
 assert(instance);
 in=(inst*)instance;
 
-color2floatrgba(inframe, in->sl, in->w , in->h);
+if (in->flt)		//RGBA_FLOAT frames, draw on the output
+	{
+	sl=(float_rgba*)outframe;
+	if (inframe!=outframe)
+		memcpy(sl, inframe, in->w*in->h*sizeof(float_rgba));
+	}
+else
+	{
+	sl=in->sl;
+	color2floatrgba(inframe, sl, in->w , in->h);
+	}
 
-sonda(in->sl, in->w, in->h, in->x, in->y, 2*in->sx+1, 2*in->sy+1, &in->poz, in->mer, in->un, in->sha, in->bw);
-crosshair(in->sl, in->w, in->h, in->x, in->y, 2*in->sx+1, 2*in->sy+1, 15);
+sonda(sl, in->w, in->h, in->x, in->y, 2*in->sx+1, 2*in->sy+1, &in->poz, in->mer, in->un, in->sha, in->bw);
+crosshair(sl, in->w, in->h, in->x, in->y, 2*in->sx+1, 2*in->sy+1, 15);
 
-floatrgba2color(in->sl, outframe, in->w , in->h);
+if (!in->flt)
+	floatrgba2color(sl, outframe, in->w , in->h);
+}
+
+//-----------------------------------------------------
+int f0r_get_capabilities()
+{
+return F0R_CAP_RGBA_FLOAT | F0R_CAP_IN_PLACE;
+}
+
+//-----------------------------------------------------
+int f0r_set_color_model(f0r_instance_t instance, int color_model)
+{
+inst *in;
+
+in=(inst*)instance;
+if (color_model==F0R_COLOR_MODEL_RGBA_FLOAT)
+	in->flt=1;
+else if (color_model==F0R_COLOR_MODEL_RGBA8888)
+	in->flt=0;
+else
+	return 0;
+return 1;
 }
 
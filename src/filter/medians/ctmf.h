@@ -48,6 +48,10 @@ typedef UINT32 uint32_t;
 #include <stdint.h>
 #endif
 
+/* frei0r: the stripes of an image run on threads */
+#include <stdio.h>
+#include "frei0r_thread.h"
+
 /* Intrinsic declarations */
 #if defined(__SSE2__) || defined(__MMX__)
 #if defined(__SSE2__)
@@ -338,6 +342,76 @@ static void ctmf_helper(
 #endif
 }
 
+/**
+ * frei0r: the stripes of an image, for f0r_parallel_bands().
+ */
+typedef struct
+{
+    const unsigned char* src;
+    unsigned char* dst;
+    int width, height, src_step, dst_step, r, cn;
+    int stripe_size; /* columns of each stripe but the rightmost one */
+    int last; /* the index of the rightmost stripe */
+} ctmf_stripes;
+
+static void ctmf_stripe_band( void* arg, unsigned int band,
+                              unsigned int first, unsigned int last )
+{
+    const ctmf_stripes* job = (const ctmf_stripes*) arg;
+    unsigned int s;
+
+    for ( s = first; s < last; ++s ) {
+        int i = s * (job->stripe_size - 2*job->r);
+        int w = (int) s == job->last ? job->width - i : job->stripe_size;
+        ctmf_helper( job->src + job->cn*i, job->dst + job->cn*i, w,
+                job->height, job->src_step, job->dst_step, job->r, job->cn,
+                i == 0, (int) s == job->last );
+    }
+}
+
+/**
+ * frei0r: the size of the L2 cache of this CPU in bytes, for the memsize
+ * argument of ctmf(), or 512 kB if it cannot be found out. It may read
+ * files, so call it once, e.g. from f0r_init(), and keep the result.
+ */
+static long unsigned int ctmf_cache_size()
+{
+    long size = 0;
+#if defined(_SC_LEVEL2_CACHE_SIZE)
+    size = sysconf( _SC_LEVEL2_CACHE_SIZE );
+#endif
+#if defined(__linux__)
+    {
+        int i;
+        for ( i = 0; size <= 0 && i < 8; ++i ) {
+            char path[64];
+            int level = 0;
+            long kb = 0;
+            FILE* f;
+            sprintf( path, "/sys/devices/system/cpu/cpu0/cache/index%d/level", i );
+            if ( !(f = fopen( path, "r" )) ) {
+                break;
+            }
+            if ( fscanf( f, "%d", &level ) != 1 ) {
+                level = 0;
+            }
+            fclose( f );
+            sprintf( path, "/sys/devices/system/cpu/cpu0/cache/index%d/size", i );
+            if ( level == 2 && (f = fopen( path, "r" )) ) {
+                if ( fscanf( f, "%ldK", &kb ) == 1 ) {
+                    size = kb * 1024;
+                }
+                fclose( f );
+            }
+        }
+    }
+#endif
+    if ( size <= 0 ) {
+        size = 512 * 1024;
+    }
+    return (long unsigned int) size;
+}
+
 /**
  * \brief Constant-time median filtering
  *
@@ -373,7 +447,8 @@ static void ctmf_helper(
  *                      the size of the L2 cache, then vary it slightly and
  *                      measure the processing time to find the optimal value.
  *                      For example, a 512 kB L2 cache would have
- *                      memsize=512*1024 initially.
+ *                      memsize=512*1024 initially. ctmf_cache_size() gives
+ *                      the size of the L2 cache of this CPU.
  */
 void ctmf(
         const unsigned char* const src, unsigned char* const dst,
@@ -412,22 +487,47 @@ void ctmf(
      * image was zero-padded.
      */
     int stripes = (int) ceil( (double) (width - 2*r) / (memsize / sizeof(Histogram) - 2*r) );
-    int stripe_size = (int) ceil( (double) ( width + stripes*2*r - 2*r ) / stripes );
+    int stripe_size;
 
-    int i;
+    /*
+     * frei0r: each thread gets stripes of its own, so there are at least as
+     * many stripes as threads, as long as each of them still outputs 2*r+1
+     * columns. The histograms of a stripe then stay in the cache of the
+     * core running it.
+     */
+    int threads = f0r_thread_count();
+    int most = (width - 2*r) / (2*r+1);
+    ctmf_stripes job;
+    int i, n;
 
-    for ( i = 0; i < width; i += stripe_size - 2*r ) {
-        int stripe = stripe_size;
+    if ( stripes < threads ) {
+        stripes = MAX( 1, MIN( threads, most ) );
+    }
+    stripe_size = (int) ceil( (double) ( width + stripes*2*r - 2*r ) / stripes );
+
+    job.src = src;
+    job.dst = dst;
+    job.width = width;
+    job.height = height;
+    job.src_step = src_step;
+    job.dst_step = dst_step;
+    job.r = r;
+    job.cn = cn;
+    job.stripe_size = stripe_size;
+
+    /*
+     * frei0r: count the stripes, they start every stripe_size - 2*r columns
+     * and ctmf_stripe_band() finds their columns again, so nothing needs
+     * to be allocated here.
+     */
+    for ( i = 0, n = 0; i < width; i += stripe_size - 2*r ) {
+        ++n;
         /* Make sure that the filter kernel fits into one stripe. */
         if ( i + stripe_size - 2*r >= width || width - (i + stripe_size - 2*r) < 2*r+1 ) {
-            stripe = width - i;
-        }
-
-        ctmf_helper( src + cn*i, dst + cn*i, stripe, height, src_step, dst_step, r, cn,
-                i == 0, stripe == width - i );
-
-        if ( stripe == width - i ) {
             break;
         }
     }
+    job.last = n - 1;
+
+    f0r_parallel_bands( 0, n, threads, ctmf_stripe_band, &job );
 }
@@ -37,8 +37,10 @@ Copyright (C) 2013  Marko Cebokli    http://lea.hamradio.si/~s57uuu
 #include <string.h>
 #include <stdio.h>
 
+#include "frei0r_thread.h"
 #include "small_medians.h"
 #include "ctmf.h"
+#include "simd_medians.h"
 
 
 /* ******************************************
@@ -77,13 +79,14 @@ ML3DEX:		multilevel spatio-temporal, see [1]
 //cross5	packed char RGB image (uint32_t)
 //vs = input image
 //is = output image
-void cross5(const uint32_t *vs, int w, int h, uint32_t *is)
+//rows i0...i1-1, which leave a border of 1
+void cross5(const uint32_t *vs, int w, uint32_t *is, int i0, int i1)
 {
 int i,j,p;
 uint32_t m[8];
 
-for (i=1;i<h-1;i++)
-    for (j=1;j<w-1;j++)
+for (i=i0;i<i1;i++)
+    for (j=cross5_row(vs,w,is,i);j<w-1;j++)
 	{
 	p=i*w+j;
 
@@ -98,13 +101,14 @@ for (i=1;i<h-1;i++)
 //square 3x3		packed char RGB image (uint32_t)
 //vs = input image
 //is = output image
-void sq3x3(const uint32_t *vs, int w, int h, uint32_t *is)
+//rows i0...i1-1, which leave a border of 1
+void sq3x3(const uint32_t *vs, int w, uint32_t *is, int i0, int i1)
 {
 int i,j,p;
 uint32_t m[16];
 
-for (i=1;i<h-1;i++)
-    for (j=1;j<w-1;j++)
+for (i=i0;i<i1;i++)
+    for (j=sq3x3_row(vs,w,is,i);j<w-1;j++)
 	{
 	p=i*w+j;
 
@@ -120,13 +124,14 @@ for (i=1;i<h-1;i++)
 //bilevel		packed char RGB image (uint32_t)
 //vs = input image
 //is = output image
-void bilevel(const uint32_t *vs, int w, int h, uint32_t *is)
+//rows i0...i1-1, which leave a border of 1
+void bilevel(const uint32_t *vs, int w, uint32_t *is, int i0, int i1)
 {
 int i,j,p;
 uint32_t m[8],mm[4];
 
-for (i=1;i<h-1;i++)
-    for (j=1;j<w-1;j++)
+for (i=i0;i<i1;i++)
+    for (j=bilevel_row(vs,w,is,i);j<w-1;j++)
 	{
 	p=i*w+j;
 
@@ -146,12 +151,13 @@ for (i=1;i<h-1;i++)
 //diamond 3x3		packed char RGB image (uint32_t)
 //vs = input image
 //is = output image
-void dia3x3(const uint32_t *vs, int w, int h, uint32_t *is)
+//rows i0...i1-1, which leave a border of 2
+void dia3x3(const uint32_t *vs, int w, uint32_t *is, int i0, int i1)
 {
 int i,j,p;
 uint32_t m[16];
 
-for (i=2;i<h-2;i++)
+for (i=i0;i<i1;i++)
     for (j=2;j<w-2;j++)
 	{
 	p=i*w+j;
@@ -169,13 +175,14 @@ for (i=2;i<h-2;i++)
 //square 5x5		packed char RGB image (uint32_t)
 //vs = input image
 //is = output image
-void sq5x5(const uint32_t *vs, int w, int h, uint32_t *is)
+//rows i0...i1-1, which leave a border of 2
+void sq5x5(const uint32_t *vs, int w, uint32_t *is, int i0, int i1)
 {
 int i,j,p;
 uint32_t m[32];
 
-for (i=2;i<h-2;i++)
-    for (j=2;j<w-2;j++)
+for (i=i0;i<i1;i++)
+    for (j=sq5x5_row(vs,w,is,i);j<w-2;j++)
 	{
 	p=i*w+j;
 
@@ -196,7 +203,7 @@ for (i=2;i<h-2;i++)
 
 //--------------------------------------------------------
 //temporal 3 frames
-void temp3(uint32_t *s1, uint32_t *s2, uint32_t *s3, int w, int h, uint32_t *is)
+void temp3(const uint32_t *s1, const uint32_t *s2, const uint32_t *s3, int w, int h, uint32_t *is)
 {
 int i;
 uint32_t m[32];
@@ -211,7 +218,7 @@ for (i=0;i<w*h;i++)
 
 //--------------------------------------------------------
 //temporal 5 frames
-void temp5(uint32_t *s1, uint32_t *s2, uint32_t *s3, uint32_t *s4, uint32_t *s5, int w, int h, uint32_t *is)
+void temp5(const uint32_t *s1, const uint32_t *s2, const uint32_t *s3, const uint32_t *s4, const uint32_t *s5, int w, int h, uint32_t *is)
 {
 int i;
 uint32_t m[32];
@@ -229,7 +236,7 @@ for (i=0;i<w*h;i++)
 //Arce BI	packed char RGB image (uint32_t)
 //s1,s2,s3 = previous, current, next frame
 //is = output image
-void ArceBI(uint32_t *s1, uint32_t *s2, uint32_t *s3, int w, int h, uint32_t *is)
+void ArceBI(const uint32_t *s1, const uint32_t *s2, const uint32_t *s3, int w, int h, uint32_t *is)
 {
 int i,j,p;
 uint32_t mm[8],m[16];
@@ -274,7 +281,7 @@ for (i=1;i<h-1;i++)
 //Arp ML3D	packed char RGB image (uint32_t)
 //s1,s2,s3 = previous, current, next frame
 //is = output image
-void ml3d(uint32_t *s1, uint32_t *s2, uint32_t *s3, int w, int h, uint32_t *is)
+void ml3d(const uint32_t *s1, const uint32_t *s2, const uint32_t *s3, int w, int h, uint32_t *is)
 {
 int i,j,p;
 uint32_t mm[8],m[16];
@@ -304,7 +311,7 @@ for (i=1;i<h-1;i++)
 //Kokaram ML3Dex	packed char RGB image (uint32_t)
 //s1,s2,s3 = previous, current, next frame
 //is = output image
-void ml3dex(uint32_t *s1, uint32_t *s2, uint32_t *s3, int w, int h, uint32_t *is)
+void ml3dex(const uint32_t *s1, const uint32_t *s2, const uint32_t *s3, int w, int h, uint32_t *is)
 {
 int i,j,p;
 uint32_t mm[8],m[16];
@@ -343,6 +350,40 @@ for (i=1;i<h-1;i++)
 	}
 }
 
+//------------------------------------------------------------
+//the spatial medians on a band of rows, for f0r_parallel_bands()
+typedef struct
+{
+int type;
+int w;
+const uint32_t *vs;
+uint32_t *is;
+} spatial_job;
+
+void spatial_band(void *arg, unsigned int band, unsigned int first, unsigned int last)
+{
+spatial_job *job=(spatial_job*)arg;
+
+switch (job->type)
+	{
+	case 0:
+		cross5(job->vs, job->w, job->is, first, last);
+		break;
+	case 1:
+		sq3x3(job->vs, job->w, job->is, first, last);
+		break;
+	case 2:
+		bilevel(job->vs, job->w, job->is, first, last);
+		break;
+	case 3:
+		dia3x3(job->vs, job->w, job->is, first, last);
+		break;
+	case 4:
+		sq5x5(job->vs, job->w, job->is, first, last);
+		break;
+	}
+}
+
 //****************************************************
 
 //----------------------------------------
@@ -357,20 +398,95 @@ int type;
 int size;
 
 //internal variables
-uint32_t *ppf,*pf,*cf,*nf,*nnf;
-
-//image buffers
-uint32_t *f1;
-uint32_t *f2;
-uint32_t *f3;
-uint32_t *f4;
-uint32_t *f5;
+//copies of the previous frames, hist[0] the last one, allocated
+//and filled only while a temporal type is used
+uint32_t *hist[4];
+int nhist;
+uint32_t *zero;		//black frame for missing history
 
 
 char *liststr;
 } inst;
 
 
+//-----------------------------------------------------
+//number of previous frames the type needs
+int history_depth(int type)
+{
+switch (type)
+	{
+	case 6:
+		return 4;
+	case 5:
+	case 7:
+	case 8:
+	case 9:
+		return 2;
+	default:
+		return 0;
+	}
+}
+
+//-----------------------------------------------------
+//h[0...3] from the n frames of the history, the frames
+//before the start are black
+void fill_history(inst *in, const uint32_t * const *frames, int n, const uint32_t **h)
+{
+int i;
+
+if ((n<4)&&(in->zero==NULL))
+	in->zero=(uint32_t*)calloc(in->w*in->h,sizeof(uint32_t));
+for (i=0;i<4;i++)
+	h[i] = (i<n) ? frames[i] : in->zero;
+}
+
+//-----------------------------------------------------
+//keeps a copy of the frame while a temporal type is used,
+//by swapping the oldest buffer to the front
+//the history starts again when another type is chosen
+void capture(inst *in, const uint32_t *inframe)
+{
+uint32_t *tmpp;
+int i;
+
+if (history_depth(in->type)==0)
+	{
+	in->nhist=0;
+	return;
+	}
+
+if (in->hist[0]==NULL)
+	for (i=0;i<4;i++)
+		in->hist[i]=(uint32_t*)malloc(4*in->w*in->h);
+
+tmpp=in->hist[3];
+in->hist[3]=in->hist[2];
+in->hist[2]=in->hist[1];
+in->hist[1]=in->hist[0];
+in->hist[0]=tmpp;
+memcpy(tmpp, inframe, 4*in->w*in->h);
+if (in->nhist<4) in->nhist++;
+}
+
+//-----------------------------------------------------
+//L2 cache size, found once in f0r_init()
+static long unsigned int cache_size;
+
+//memory for the ctmf histograms: a quarter of the L2 cache leaves
+//room for the rows of the image, which measured faster than all of it,
+//but at least 512 kB and four times the 2r+1 histograms every stripe
+//shares with its neighbours, so small caches do not cut the image
+//into many narrow stripes
+long unsigned int varsize_memsize(int r)
+{
+long unsigned int m,min;
+
+m=cache_size/4;
+min=4*(2*r+1)*sizeof(Histogram);
+if (min<512*1024) min=512*1024;
+return (m<min) ? min : m;
+}
+
 //-----------------------------------------------------
 //stretch [0...1] to parameter range [min...max] linear
 float map_value_forward(double v, float min, float max)
@@ -391,6 +507,7 @@ return (v-min)/(max-min);
 //-----------------------------------------------
 int f0r_init()
 {
+cache_size=ctmf_cache_size();
 return 1;
 }
 
@@ -451,18 +568,6 @@ in->liststr=calloc(1,strlen("Square3x3")+1);
 strcpy(in->liststr,"Square3x3");
 in->size=5;
 
-in->f1=calloc(in->w*in->h,sizeof(uint32_t));
-in->f2=calloc(in->w*in->h,sizeof(uint32_t));
-in->f3=calloc(in->w*in->h,sizeof(uint32_t));
-in->f4=calloc(in->w*in->h,sizeof(uint32_t));
-in->f5=calloc(in->w*in->h,sizeof(uint32_t));
-
-in->ppf=in->f1;
-in->pf=in->f2;
-in->cf=in->f3;
-in->nf=in->f4;
-in->nnf=in->f5;
-
 return (f0r_instance_t)in;
 }
 
@@ -471,13 +576,13 @@ void f0r_destruct(f0r_instance_t instance)
 {
 inst *in;
 
+int i;
+
 in=(inst*)instance;
 
-free(in->f1);
-free(in->f2);
-free(in->f3);
-free(in->f4);
-free(in->f5);
+for (i=0;i<4;i++)
+	free(in->hist[i]);
+free(in->zero);
 
 free(in->liststr);
 free(instance);
@@ -534,23 +639,40 @@ switch(param_index)
 }
 
 //-------------------------------------------------
-void f0r_update(f0r_instance_t instance, double time, const uint32_t* inframe, uint32_t* outframe)
+int f0r_get_capabilities()
 {
-inst *in;
+return F0R_CAP_HISTORY;
+}
 
-assert(instance);
-in=(inst*)instance;
-uint32_t *tmpp;
-uint8_t *cin,*cout;
-int step,i;
+//-------------------------------------------------
+unsigned int f0r_get_history_depth(f0r_instance_t instance)
+{
+return history_depth(((inst*)instance)->type);
+}
 
-memcpy(in->ppf, inframe, 4*in->w*in->h);
-tmpp=in->nnf;
-in->nnf=in->ppf;
-in->ppf=in->pf;
-in->pf=in->cf;
-in->cf=in->nf;
-in->nf=tmpp;
+//-------------------------------------------------
+//the filters leave a border of b pixels, which is
+//copied from the input
+void copy_border(const uint32_t *vs, int w, int h, int b, uint32_t *is)
+{
+int i;
+
+memcpy(is, vs, 4*w*b);
+memcpy(is+w*(h-b), vs+w*(h-b), 4*w*b);
+for (i=b;i<h-b;i++)
+	{
+	memcpy(is+w*i, vs+w*i, 4*b);
+	memcpy(is+w*i+w-b, vs+w*i+w-b, 4*b);
+	}
+}
+
+//-------------------------------------------------
+//h[0...3] = previous frames, h[0] the last one
+void process(inst *in, const uint32_t* inframe, const uint32_t **h, uint32_t* outframe)
+{
+uint8_t *cin,*cout;
+int step,i,b,r;
+spatial_job job;
 
 cin=(uint8_t*)inframe;
 cout=(uint8_t*)outframe;
@@ -558,39 +680,44 @@ cout=(uint8_t*)outframe;
 switch (in->type)
 	{
 	case 0:
-		cross5(inframe, in->w, in->h, outframe);
-		break;
 	case 1:
-		sq3x3(inframe, in->w, in->h, outframe);
-		break;
 	case 2:
-		bilevel(inframe, in->w, in->h, outframe);
-		break;
 	case 3:
-		dia3x3(inframe, in->w, in->h, outframe);
-		break;
 	case 4:
-		sq5x5(inframe, in->w, in->h, outframe);
+		job.type=in->type;
+		job.w=in->w;
+		job.vs=inframe;
+		job.is=outframe;
+		b = (in->type>=3) ? 2 : 1;	//border left
+		f0r_parallel_bands(b, in->h-b, f0r_thread_count(), spatial_band, &job);
+		copy_border(inframe, in->w, in->h, b, outframe);
 		break;
 	case 5:
-		temp3(in->cf, in->nf, in->nnf, in->w, in->h, outframe);
+		temp3(h[1], h[0], inframe, in->w, in->h, outframe);
 		break;
 	case 6:
-		temp5(in->ppf, in->pf, in->cf, in->nf, in->nnf, in->w, in->h, outframe);
+		temp5(h[3], h[2], h[1], h[0], inframe, in->w, in->h, outframe);
 		break;
 	case 7:
-		ArceBI(in->cf, in->nf, in->nnf, in->w, in->h, outframe);
+		ArceBI(h[1], h[0], inframe, in->w, in->h, outframe);
+		copy_border(inframe, in->w, in->h, 1, outframe);
 		break;
 	case 8:
-		ml3d(in->cf, in->nf, in->nnf, in->w, in->h, outframe);
+		ml3d(h[1], h[0], inframe, in->w, in->h, outframe);
+		copy_border(inframe, in->w, in->h, 1, outframe);
 		break;
 	case 9:
-		ml3dex(in->cf, in->nf, in->nnf, in->w, in->h, outframe);
+		ml3dex(h[1], h[0], inframe, in->w, in->h, outframe);
+		copy_border(inframe, in->w, in->h, 1, outframe);
 		break;
 	case 10:
 		//varsize
 		step=in->w*4;
-		ctmf(cin,cout,in->w,in->h,step,step,in->size,4,512*1024);
+		//ctmf needs the kernel to fit into the frame
+		r=in->size;
+		if (2*r+1>in->w) r=(in->w-1)/2;
+		if (2*r+1>in->h) r=(in->h-1)/2;
+		ctmf(cin,cout,in->w,in->h,step,step,r,4,varsize_memsize(r));
 		break;
 	default:
 		break;
@@ -598,6 +725,39 @@ switch (in->type)
 //COPY ALPHA
 for (i = 3; i < 4 * in->w * in->h; i += 4)
 	cout[i]=cin[i];
+}
+
+//-------------------------------------------------
+void f0r_update(f0r_instance_t instance, double time, const uint32_t* inframe, uint32_t* outframe)
+{
+inst *in;
+const uint32_t *h[4];
+
+assert(instance);
+in=(inst*)instance;
+
+if (history_depth(in->type)>0)
+	fill_history(in, (const uint32_t * const *)in->hist, in->nhist, h);
+process(in, inframe, h, outframe);
+capture(in, inframe);
+}
+
+//-------------------------------------------------
+//the same with the previous frames kept by the host
+void f0r_update_history(f0r_instance_t instance, double time, const uint32_t* inframe, const uint32_t* const* history, const double* history_time, unsigned int history_count, uint32_t* outframe)
+{
+inst *in;
+const uint32_t *h[4];
+int n;
+
+assert(instance);
+in=(inst*)instance;
 
+n=history_depth(in->type);
+if ((int)history_count<n) n=history_count;
+if (history_depth(in->type)>0)
+	fill_history(in, history, n, h);
+in->nhist=0;
+process(in, inframe, h, outframe);
 }
 
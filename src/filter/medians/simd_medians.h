@@ -0,0 +1,217 @@
+/*
+simd_medians.h  the small spatial medians of medians.c on SIMD vectors
+
+The sorting networks of small_medians.h, with the min and max of each
+compare-and-swap done on whole vectors of pixels. Each byte lane gets
+its own median, so every vector holds the medians of MED_N neighbouring
+pixels, the alpha lane included (medians.c copies alpha afterwards).
+The results are the same as those of small_medians.h.
+
+<name>_row(vs, w, is, i) does as many pixels of row i as fit into whole
+vectors and returns the first column left for the scalar code. The code
+path is picked by f0r_simd_level() of frei0r_simd.h.
+*/
+
+#include "frei0r_simd.h"
+
+//compare and swap, so that a<=b
+#define V_SO(P,a,b) { MED_VEC_##P t_=med_min_##P(a,b); b=med_max_##P(a,b); a=t_; }
+//a=min(a,b)
+#define V_MI(P,a,b) { a=med_min_##P(a,b); }
+//b=max(a,b)
+#define V_MA(P,a,b) { b=med_max_##P(a,b); }
+
+//median of 3 vectors, ends up in m[1]
+#define V_MEDIAN3(P,m)                                                  \
+V_SO(P,m[0],m[1]); V_MI(P,m[1],m[2]); V_MA(P,m[0],m[1]);
+
+//median of 5 vectors, ends up in m[2]
+#define V_MEDIAN5(P,m)                                                  \
+V_SO(P,m[0],m[1]); V_SO(P,m[3],m[4]); V_MI(P,m[1],m[4]);                \
+V_MA(P,m[0],m[3]); V_SO(P,m[1],m[2]); V_MI(P,m[2],m[3]);                \
+V_MA(P,m[1],m[2]);
+
+//median of 9 vectors, ends up in m[4]
+#define V_MEDIAN9(P,m)                                                  \
+V_SO(P,m[1],m[2]); V_SO(P,m[4],m[5]); V_SO(P,m[7],m[8]);                \
+V_SO(P,m[0],m[1]); V_SO(P,m[3],m[4]); V_SO(P,m[6],m[7]);                \
+V_SO(P,m[1],m[2]); V_SO(P,m[4],m[5]); V_SO(P,m[7],m[8]);                \
+V_MA(P,m[0],m[3]); V_MI(P,m[5],m[8]); V_SO(P,m[4],m[7]);                \
+V_MA(P,m[3],m[6]); V_MA(P,m[1],m[4]); V_MI(P,m[2],m[5]);                \
+V_MI(P,m[4],m[7]); V_SO(P,m[4],m[2]); V_MA(P,m[6],m[4]);                \
+V_MI(P,m[4],m[2]);
+
+//median of 25 vectors, ends up in m[12]
+#define V_MEDIAN25(P,m)                                                 \
+V_SO(P,m[0],m[1]); V_SO(P,m[3],m[4]); V_SO(P,m[2],m[4]);                \
+V_SO(P,m[2],m[3]); V_SO(P,m[6],m[7]); V_SO(P,m[5],m[7]);                \
+V_SO(P,m[5],m[6]); V_SO(P,m[9],m[10]); V_SO(P,m[8],m[10]);              \
+V_SO(P,m[8],m[9]); V_SO(P,m[12],m[13]); V_SO(P,m[11],m[13]);            \
+V_SO(P,m[11],m[12]); V_SO(P,m[15],m[16]); V_SO(P,m[14],m[16]);          \
+V_SO(P,m[14],m[15]); V_SO(P,m[18],m[19]); V_SO(P,m[17],m[19]);          \
+V_SO(P,m[17],m[18]); V_SO(P,m[21],m[22]); V_SO(P,m[20],m[22]);          \
+V_SO(P,m[20],m[21]); V_SO(P,m[23],m[24]); V_SO(P,m[2],m[5]);            \
+V_SO(P,m[3],m[6]); V_SO(P,m[0],m[6]); V_SO(P,m[0],m[3]);                \
+V_SO(P,m[4],m[7]); V_SO(P,m[1],m[7]); V_SO(P,m[1],m[4]);                \
+V_SO(P,m[11],m[14]); V_SO(P,m[8],m[14]); V_SO(P,m[8],m[11]);            \
+V_SO(P,m[12],m[15]); V_SO(P,m[9],m[15]); V_SO(P,m[9],m[12]);            \
+V_SO(P,m[13],m[16]); V_SO(P,m[10],m[16]); V_SO(P,m[10],m[13]);          \
+V_SO(P,m[20],m[23]); V_SO(P,m[17],m[23]); V_SO(P,m[17],m[20]);          \
+V_SO(P,m[21],m[24]); V_SO(P,m[18],m[24]); V_SO(P,m[18],m[21]);          \
+V_SO(P,m[19],m[22]); V_MA(P,m[8],m[17]); V_SO(P,m[9],m[18]);            \
+V_SO(P,m[0],m[18]); V_MA(P,m[0],m[9]); V_SO(P,m[10],m[19]);             \
+V_SO(P,m[1],m[19]); V_SO(P,m[1],m[10]); V_SO(P,m[11],m[20]);            \
+V_SO(P,m[2],m[20]); V_MA(P,m[2],m[11]); V_SO(P,m[12],m[21]);            \
+V_SO(P,m[3],m[21]); V_SO(P,m[3],m[12]); V_SO(P,m[13],m[22]);            \
+V_MI(P,m[4],m[22]); V_SO(P,m[4],m[13]); V_SO(P,m[14],m[23]);            \
+V_SO(P,m[5],m[23]); V_SO(P,m[5],m[14]); V_SO(P,m[15],m[24]);            \
+V_MI(P,m[6],m[24]); V_SO(P,m[6],m[15]); V_MI(P,m[7],m[16]);             \
+V_MI(P,m[7],m[19]); V_MI(P,m[13],m[21]); V_MI(P,m[15],m[23]);           \
+V_MI(P,m[7],m[13]); V_MI(P,m[7],m[15]); V_MA(P,m[1],m[9]);              \
+V_MA(P,m[3],m[11]); V_MA(P,m[5],m[17]); V_MA(P,m[11],m[17]);            \
+V_MA(P,m[9],m[17]); V_SO(P,m[4],m[10]); V_SO(P,m[6],m[12]);             \
+V_SO(P,m[7],m[14]); V_SO(P,m[4],m[6]); V_MA(P,m[4],m[7]);               \
+V_SO(P,m[12],m[14]); V_MI(P,m[10],m[14]); V_SO(P,m[6],m[7]);            \
+V_SO(P,m[10],m[12]); V_SO(P,m[6],m[10]); V_MA(P,m[6],m[17]);            \
+V_SO(P,m[12],m[17]); V_MI(P,m[7],m[17]); V_SO(P,m[7],m[10]);            \
+V_SO(P,m[12],m[18]); V_MA(P,m[7],m[12]); V_MI(P,m[10],m[18]);           \
+V_SO(P,m[12],m[20]); V_MI(P,m[10],m[20]); V_MA(P,m[10],m[12]);
+
+#define MEDIAN_KERNELS(P)                                               \
+F0R_FN_##P int cross5_row_##P(const uint32_t *vs, int w,                \
+  uint32_t *is, int i)                                                  \
+{                                                                       \
+int j,p;                                                                \
+MED_VEC_##P m[5];                                                       \
+for (j=1;j+MED_N_##P<=w-1;j+=MED_N_##P)                                 \
+  {                                                                     \
+  p=i*w+j;                                                              \
+  m[0]=med_load_##P(vs+p-w); m[1]=med_load_##P(vs+p-1);                 \
+  m[2]=med_load_##P(vs+p); m[3]=med_load_##P(vs+p+1);                   \
+  m[4]=med_load_##P(vs+p+w);                                            \
+  V_MEDIAN5(P,m)                                                        \
+  med_store_##P(is+p,m[2]);                                             \
+  }                                                                     \
+return j;                                                               \
+}                                                                       \
+F0R_FN_##P int sq3x3_row_##P(const uint32_t *vs, int w,                 \
+  uint32_t *is, int i)                                                  \
+{                                                                       \
+int j,k,p;                                                              \
+MED_VEC_##P m[9];                                                       \
+for (j=1;j+MED_N_##P<=w-1;j+=MED_N_##P)                                 \
+  {                                                                     \
+  p=i*w+j;                                                              \
+  for (k=0;k<3;k++)                                                     \
+    {                                                                   \
+    m[k]=med_load_##P(vs+p-w-1+k);                                      \
+    m[3+k]=med_load_##P(vs+p-1+k);                                      \
+    m[6+k]=med_load_##P(vs+p+w-1+k);                                    \
+    }                                                                   \
+  V_MEDIAN9(P,m)                                                        \
+  med_store_##P(is+p,m[4]);                                             \
+  }                                                                     \
+return j;                                                               \
+}                                                                       \
+F0R_FN_##P int bilevel_row_##P(const uint32_t *vs, int w,               \
+  uint32_t *is, int i)                                                  \
+{                                                                       \
+int j,p;                                                                \
+MED_VEC_##P m[5],mm[3];                                                 \
+for (j=1;j+MED_N_##P<=w-1;j+=MED_N_##P)                                 \
+  {                                                                     \
+  p=i*w+j;                                                              \
+  m[0]=med_load_##P(vs+p-w-1); m[1]=med_load_##P(vs+p-w+1);             \
+  m[2]=med_load_##P(vs+p);                                              \
+  m[3]=med_load_##P(vs+p+w-1); m[4]=med_load_##P(vs+p+w+1);             \
+  V_MEDIAN5(P,m)                                                        \
+  mm[0]=m[2];                                                           \
+  mm[1]=med_load_##P(vs+p);                                             \
+  m[0]=med_load_##P(vs+p-w); m[1]=med_load_##P(vs+p-1);                 \
+  m[2]=med_load_##P(vs+p);                                              \
+  m[3]=med_load_##P(vs+p+1); m[4]=med_load_##P(vs+p+w);                 \
+  V_MEDIAN5(P,m)                                                        \
+  mm[2]=m[2];                                                           \
+  V_MEDIAN3(P,mm)                                                       \
+  med_store_##P(is+p,mm[1]);                                            \
+  }                                                                     \
+return j;                                                               \
+}                                                                       \
+F0R_FN_##P int sq5x5_row_##P(const uint32_t *vs, int w,                 \
+  uint32_t *is, int i)                                                  \
+{                                                                       \
+int j,k,l,p;                                                            \
+MED_VEC_##P m[25];                                                      \
+for (j=2;j+MED_N_##P<=w-2;j+=MED_N_##P)                                 \
+  {                                                                     \
+  p=i*w+j;                                                              \
+  for (k=0;k<5;k++)                                                     \
+    for (l=0;l<5;l++)                                                   \
+      m[5*k+l]=med_load_##P(vs+p+(k-2)*w+l-2);                          \
+  V_MEDIAN25(P,m)                                                       \
+  med_store_##P(is+p,m[12]);                                            \
+  }                                                                     \
+return j;                                                               \
+}
+
+//------------------------------------------------------------
+#if defined(F0R_HAVE_SSE2)
+#define MED_VEC_sse2 __m128i
+#define MED_N_sse2 4
+static inline __m128i med_load_sse2(const uint32_t *p) { return _mm_loadu_si128((const __m128i*)p); }
+static inline void med_store_sse2(uint32_t *p, __m128i v) { _mm_storeu_si128((__m128i*)p,v); }
+static inline __m128i med_min_sse2(__m128i a, __m128i b) { return _mm_min_epu8(a,b); }
+static inline __m128i med_max_sse2(__m128i a, __m128i b) { return _mm_max_epu8(a,b); }
+MEDIAN_KERNELS(sse2)
+#define MED_CASE_SSE2(name) case F0R_SIMD_SSE2: return name##_row_sse2(vs,w,is,i);
+#else
+#define MED_CASE_SSE2(name)
+#endif
+
+//------------------------------------------------------------
+#if defined(F0R_HAVE_AVX2)
+#define MED_VEC_avx2 __m256i
+#define MED_N_avx2 8
+F0R_AVX2 __m256i med_load_avx2(const uint32_t *p) { return _mm256_loadu_si256((const __m256i*)p); }
+F0R_AVX2 void med_store_avx2(uint32_t *p, __m256i v) { _mm256_storeu_si256((__m256i*)p,v); }
+F0R_AVX2 __m256i med_min_avx2(__m256i a, __m256i b) { return _mm256_min_epu8(a,b); }
+F0R_AVX2 __m256i med_max_avx2(__m256i a, __m256i b) { return _mm256_max_epu8(a,b); }
+MEDIAN_KERNELS(avx2)
+#define MED_CASE_AVX2(name) case F0R_SIMD_AVX2: return name##_row_avx2(vs,w,is,i);
+#else
+#define MED_CASE_AVX2(name)
+#endif
+
+//------------------------------------------------------------
+#if defined(F0R_HAVE_NEON)
+#define MED_VEC_neon uint8x16_t
+#define MED_N_neon 4
+static inline uint8x16_t med_load_neon(const uint32_t *p) { return vld1q_u8((const uint8_t*)p); }
+static inline void med_store_neon(uint32_t *p, uint8x16_t v) { vst1q_u8((uint8_t*)p,v); }
+static inline uint8x16_t med_min_neon(uint8x16_t a, uint8x16_t b) { return vminq_u8(a,b); }
+static inline uint8x16_t med_max_neon(uint8x16_t a, uint8x16_t b) { return vmaxq_u8(a,b); }
+MEDIAN_KERNELS(neon)
+#define MED_CASE_NEON(name) case F0R_SIMD_NEON: return name##_row_neon(vs,w,is,i);
+#else
+#define MED_CASE_NEON(name)
+#endif
+
+//------------------------------------------------------------
+#define MEDIAN_ROW(name,first)                                          \
+static inline int name##_row(const uint32_t *vs, int w,                 \
+  uint32_t *is, int i)                                                  \
+{                                                                       \
+switch (f0r_simd_level())                                               \
+  {                                                                     \
+  MED_CASE_AVX2(name)                                                   \
+  MED_CASE_SSE2(name)                                                   \
+  MED_CASE_NEON(name)                                                   \
+  default:                                                              \
+    return first;                                                       \
+  }                                                                     \
+}
+
+MEDIAN_ROW(cross5,1)
+MEDIAN_ROW(sq3x3,1)
+MEDIAN_ROW(bilevel,1)
+MEDIAN_ROW(sq5x5,2)
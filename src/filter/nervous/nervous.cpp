@@ -33,6 +33,7 @@
 #include <assert.h>
 #include <math.h>
 #include <string.h>
+#include <time.h>
 
 #include <frei0r.hpp>
 
@@ -57,6 +58,11 @@ public:
 
   ~Nervous();
 
+  virtual int capabilities() { return F0R_CAP_HISTORY; }
+
+  // the current frame takes the last of the planes
+  virtual unsigned int history_depth() { return PLANES - 1; }
+
   virtual void update();
 
 private:
@@ -64,8 +70,6 @@ private:
   ScreenGeometry geo;
 
   void _init(int wdt, int hgt);
-  int32_t *buffer;
-  int32_t *planetable[PLANES];
   int mode;
   int plane, stock, timer, stride, readplane;
 
@@ -77,28 +81,17 @@ private:
 };
 
 Nervous::Nervous(int wdt, int hgt) {
-    int c;
     _init(wdt, hgt);
     
-    buffer = (int32_t*) malloc(geo.size*PLANES);
-    if(!buffer) {
-      fprintf(stderr,"ERROR: nervous plugin can't allocate needed memory: %u bytes\n",
-	      geo.size*PLANES);
-      return;
-    }
-    memset(buffer,0,geo.size*PLANES);
-    for(c=0;c<PLANES;c++)
-      planetable[c] = &buffer[geo.w*geo.h*c];
-    
     plane = 0;
     stock = 0;
     timer = 0;
     readplane = 0;
     mode = 1;
+    fastsrand(::time(NULL));
 }
 
 Nervous::~Nervous() {
-  if(buffer) free(buffer);
 }
 
 void Nervous::_init(int wdt, int hgt) {
@@ -112,9 +105,11 @@ void Nervous::_init(int wdt, int hgt) {
 
 
 void Nervous::update() {
-  memcpy(planetable[plane],in,geo.size);
+  const uint32_t *src;
+  int age;
 
-  if(stock<PLANES) stock++;
+  /* the planes are the current frame and its history */
+  stock = history.count() + 1;
 
   if(mode) {
     if(timer) {
@@ -131,11 +126,16 @@ void Nervous::update() {
   } else
     if(stock > 0)
       readplane = fastrand() % stock;
+
+  /* readplane numbers the planes in the order they were filled */
+  age = (plane - readplane + PLANES) % PLANES;
+  src = age ? history[age - 1] : in;
+  if(!src) src = in;
   
   plane++;
   if(plane==PLANES) plane=0;
 
-  memcpy(out,planetable[readplane],geo.size);
+  memcpy(out,src,geo.size);
 
 }
 
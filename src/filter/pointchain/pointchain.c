@@ -0,0 +1,299 @@
+/* pointchain.c
+ * Copyright (C) 2026 the frei0r authors
+ * This file is a Frei0r plugin.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/*
+ * Applies brightness, contrast0r, gamma, saturat0r and levels (on all
+ * colour channels, without histogram) one after the other, with the
+ * parameters of these plugins. The per-channel stages before and after
+ * the saturation are folded into look-up tables and the saturation
+ * into a mixing table, so the frame is read and written only once. The
+ * result is the same as that of the plugins chained.
+ */
+
+#include <stdlib.h>
+#include <assert.h>
+#include <math.h>
+
+#include "frei0r.h"
+#include "frei0r_math.h"
+#include "frei0r_lut.h"
+
+#define NUM_PARAMS 9
+
+#define MAX_GAMMA 4.0
+#define MAX_SATURATION 8.0
+
+enum
+{
+  BRIGHTNESS,
+  CONTRAST,
+  GAMMA,
+  SATURATION,
+  INPUT_BLACK,
+  INPUT_WHITE,
+  LEVELS_GAMMA,
+  OUTPUT_BLACK,
+  OUTPUT_WHITE
+};
+
+typedef struct pointchain_instance
+{
+  unsigned int width;
+  unsigned int height;
+  double params[NUM_PARAMS];
+  int mixing; /* the saturation is not neutral */
+  f0r_lut_t lut; /* the whole chain, or the stages after the saturation */
+  f0r_lut_mix_t mix; /* the stages up to the saturation */
+  uint8_t pre[256]; /* the stages before the saturation */
+} pointchain_instance_t;
+
+/* brightness: the parameter remapped to [-256, 256] */
+static int brightness_map(int brightness, int i)
+{
+  if (brightness < 0)
+    return CLAMP0255((i * (256 + brightness))>>8);
+  else
+    return CLAMP0255(i + (((256 - i) * brightness)>>8));
+}
+
+/* contrast0r: the parameter remapped to [-256, 256] */
+static int contrast_map(int contrast, int i)
+{
+  if (i < 128)
+    return CLAMP0255(i - (((128 - i)*contrast)>>8));
+  else
+    return CLAMP0255(i + (((i - 128)*contrast)>>8));
+}
+
+/* gamma */
+static int gamma_map(double inv_gamma, int i)
+{
+  if (i == 0)
+    return 0;
+  return CLAMP0255(ROUND(255.0 * pow((double)i / 255.0, inv_gamma)));
+}
+
+/* levels, with the parameters as in that plugin */
+static int levels_map(const double* params, int i)
+{
+  double inScale = params[INPUT_WHITE] != params[INPUT_BLACK] ?
+    params[INPUT_WHITE] - params[INPUT_BLACK] : 1;
+  double gamma = params[LEVELS_GAMMA] * 4;
+  double exp = gamma == 0 ? 1 : 1 / gamma;
+  double outScale = params[OUTPUT_WHITE] - params[OUTPUT_BLACK];
+  double v = i / 255. - params[INPUT_BLACK];
+  double w;
+  if (v < 0.0)
+    v = 0.0;
+  w = pow(v / inScale, exp) * outScale + params[OUTPUT_BLACK];
+  return CLAMP0255(lrintf(w * 255.0));
+}
+
+static int post_map(void* arg, int c, int i)
+{
+  return levels_map((const double*)arg, i);
+}
+
+static int chain_map(void* arg, int c, int i)
+{
+  pointchain_instance_t* inst = (pointchain_instance_t*)arg;
+  return levels_map(inst->params, inst->pre[i]);
+}
+
+/* saturat0r, applied to the output of the stages before it */
+static int32_t saturation_mix(void* arg, int c, int k, int v)
+{
+  pointchain_instance_t* inst = (pointchain_instance_t*)arg;
+  double saturation = inst->params[SATURATION] * MAX_SATURATION;
+  double one_minus_saturation = 1.0-saturation;
+  int wgt[3];
+  wgt[0] = (int)(7471.0  * one_minus_saturation);
+  wgt[1] = (int)(38470.0 * one_minus_saturation);
+  wgt[2] = (int)(19595.0 * one_minus_saturation);
+
+  v = inst->pre[v];
+  if (c == k)
+    return v*wgt[k] + (int32_t)(v*saturation) * 65536;
+  return v*wgt[k];
+}
+
+/* Compiles the chain into the look-up tables. */
+static void update_lut(pointchain_instance_t* inst)
+{
+  int brightness = (int) ((inst->params[BRIGHTNESS] - 0.5) * 512.0);
+  int contrast = (int) ((inst->params[CONTRAST] - 0.5) * 512.0);
+  double inv_gamma = 1.0 / (inst->params[GAMMA] * MAX_GAMMA);
+  int i;
+
+  for (i = 0; i < 256; ++i)
+    inst->pre[i] = gamma_map(inv_gamma,
+                             contrast_map(contrast, brightness_map(brightness, i)));
+
+  inst->mixing = inst->params[SATURATION] * MAX_SATURATION != 1.0;
+  if (inst->mixing)
+    {
+      f0r_lut_mix_compile(&inst->mix, saturation_mix, inst, 0);
+      f0r_lut_compile(&inst->lut, post_map, inst->params, F0R_LUT_RGB);
+    }
+  else
+    f0r_lut_compile(&inst->lut, chain_map, inst, F0R_LUT_RGB);
+}
+
+int f0r_init()
+{
+  return 1;
+}
+
+void f0r_deinit()
+{ /* no initialization required */ }
+
+void f0r_get_plugin_info(f0r_plugin_info_t* pointchain_info)
+{
+  pointchain_info->name = "pointchain";
+  pointchain_info->author = "frei0r";
+  pointchain_info->plugin_type = F0R_PLUGIN_TYPE_FILTER;
+  pointchain_info->color_model = F0R_COLOR_MODEL_RGBA8888;
+  pointchain_info->frei0r_version = FREI0R_MAJOR_VERSION;
+  pointchain_info->major_version = 0;
+  pointchain_info->minor_version = 1;
+  pointchain_info->num_params = NUM_PARAMS;
+  pointchain_info->explanation = "Brightness, contrast, gamma, saturation and levels in a single pass";
+}
+
+void f0r_get_param_info(f0r_param_info_t* info, int param_index)
+{
+  info->type = F0R_PARAM_DOUBLE;
+  switch(param_index)
+  {
+  case BRIGHTNESS:
+    info->name = "Brightness";
+    info->explanation = "The brightness value, as in brightness";
+    break;
+  case CONTRAST:
+    info->name = "Contrast";
+    info->explanation = "The contrast value, as in contrast0r";
+    break;
+  case GAMMA:
+    info->name = "Gamma";
+    info->explanation = "The gamma value, as in gamma (0.25 is neutral)";
+    break;
+  case SATURATION:
+    info->name = "Saturation";
+    info->explanation = "The saturation value, as in saturat0r (0.125 is neutral)";
+    break;
+  case INPUT_BLACK:
+    info->name = "Input black level";
+    info->explanation = "Input black level, as in levels";
+    break;
+  case INPUT_WHITE:
+    info->name = "Input white level";
+    info->explanation = "Input white level, as in levels";
+    break;
+  case LEVELS_GAMMA:
+    info->name = "Levels gamma";
+    info->explanation = "Gamma, as in levels (0.25 is neutral)";
+    break;
+  case OUTPUT_BLACK:
+    info->name = "Black output";
+    info->explanation = "Black output, as in levels";
+    break;
+  case OUTPUT_WHITE:
+    info->name = "White output";
+    info->explanation = "White output, as in levels";
+    break;
+  }
+}
+
+f0r_instance_t f0r_construct(unsigned int width, unsigned int height)
+{
+  pointchain_instance_t* inst = (pointchain_instance_t*)calloc(1, sizeof(*inst));
+  inst->width = width; inst->height = height;
+  /* all stages neutral */
+  inst->params[BRIGHTNESS] = 0.5;
+  inst->params[CONTRAST] = 0.5;
+  inst->params[GAMMA] = 1.0 / MAX_GAMMA;
+  inst->params[SATURATION] = 1.0 / MAX_SATURATION;
+  inst->params[INPUT_BLACK] = 0.0;
+  inst->params[INPUT_WHITE] = 1.0;
+  inst->params[LEVELS_GAMMA] = 0.25;
+  inst->params[OUTPUT_BLACK] = 0.0;
+  inst->params[OUTPUT_WHITE] = 1.0;
+  update_lut(inst);
+  return (f0r_instance_t)inst;
+}
+
+void f0r_destruct(f0r_instance_t instance)
+{
+  free(instance);
+}
+
+void f0r_set_param_value(f0r_instance_t instance,
+                         f0r_param_t param, int param_index)
+{
+  assert(instance);
+  pointchain_instance_t* inst = (pointchain_instance_t*)instance;
+
+  if (param_index < 0 || param_index >= NUM_PARAMS)
+    return;
+  if (*((double*)param) != inst->params[param_index])
+  {
+    inst->params[param_index] = *((double*)param);
+    update_lut(inst);
+  }
+}
+
+void f0r_get_param_value(f0r_instance_t instance,
+                         f0r_param_t param, int param_index)
+{
+  assert(instance);
+  pointchain_instance_t* inst = (pointchain_instance_t*)instance;
+
+  if (param_index >= 0 && param_index < NUM_PARAMS)
+    *((double*)param) = inst->params[param_index];
+}
+
+int f0r_get_capabilities()
+{
+  return F0R_CAP_SLICE_SAFE | F0R_CAP_IN_PLACE;
+}
+
+void f0r_update(f0r_instance_t instance, double time,
+                const uint32_t* inframe, uint32_t* outframe)
+{
+  assert(instance);
+  pointchain_instance_t* inst = (pointchain_instance_t*)instance;
+  f0r_update_slice(instance, time, inframe, 0, 0, outframe, 0, inst->height);
+}
+
+void f0r_update_slice(f0r_instance_t instance, double time,
+                      const uint32_t* inframe1, const uint32_t* inframe2,
+                      const uint32_t* inframe3, uint32_t* outframe,
+                      unsigned int slice_start, unsigned int slice_height)
+{
+  assert(instance);
+  pointchain_instance_t* inst = (pointchain_instance_t*)instance;
+  unsigned int offset = inst->width * slice_start;
+  unsigned int len = inst->width * slice_height;
+
+  if (inst->mixing)
+    f0r_lut_mix_lut_apply(&inst->mix, &inst->lut,
+                          inframe1 + offset, outframe + offset, len);
+  else
+    f0r_lut_apply(&inst->lut, inframe1 + offset, outframe + offset, len);
+}
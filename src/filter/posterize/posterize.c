@@ -27,14 +27,38 @@
 
 #include "frei0r.h"
 #include "frei0r_math.h"
+#include "frei0r_lut.h"
 
 typedef struct posterize_instance
 {
   unsigned int width;
   unsigned int height;
   double levels;
+  int numLevels;
+  f0r_lut_t lut; /* levels table */
 } posterize_instance_t;
 
+static int posterize_map(void* arg, int c, int i)
+{
+  int numLevels = *(int*)arg;
+  return 255 * (numLevels*i / 256) / (numLevels-1);
+}
+
+/* Updates the levels table. */
+void update_lut(posterize_instance_t *inst)
+{
+  // convert input value 0.0-1.0 to int value 2-50
+  double levelsInput = inst->levels * 48.0;
+  levelsInput = CLAMP(levelsInput, 0.0, 48.0) + 2.0;
+  int numLevels = (int)levelsInput;
+
+  if (numLevels != inst->numLevels)
+  {
+    inst->numLevels = numLevels;
+    f0r_lut_compile(&inst->lut, posterize_map, &inst->numLevels, F0R_LUT_RGB);
+  }
+}
+
 int f0r_init()
 {
   return 1;
@@ -74,6 +98,7 @@ f0r_instance_t f0r_construct(unsigned int width, unsigned int height)
 	inst->width = width; 
   inst->height = height;
 	inst->levels = 5.0 / 48.0;// input range 0 - 1 will be interpreted as levels range 2 - 50
+	update_lut(inst);
 	return (f0r_instance_t)inst;
 }
 
@@ -92,6 +117,7 @@ void f0r_set_param_value(f0r_instance_t instance,
   {
   case 0:
     inst->levels = *((double*)param);
+    update_lut(inst);
     break;
   }
 }
@@ -110,43 +136,29 @@ void f0r_get_param_value(f0r_instance_t instance,
   }
 }
 
+int f0r_get_capabilities()
+{
+  return F0R_CAP_SLICE_SAFE | F0R_CAP_IN_PLACE;
+}
+
 void f0r_update(f0r_instance_t instance, double time,
                 const uint32_t* inframe, uint32_t* outframe)
 {
   assert(instance);
   posterize_instance_t* inst = (posterize_instance_t*)instance;
-  unsigned int len = inst->width * inst->height;
-
-  // convert input value 0.0-1.0 to int value 2-50
-  double levelsInput = inst->levels * 48.0;
-  levelsInput = CLAMP(levelsInput, 0.0, 48.0) + 2.0;
-  int numLevels = (int)levelsInput;
+  f0r_update_slice(instance, time, inframe, 0, 0, outframe, 0, inst->height);
+}
 
-  // create levels table
-  unsigned char levels[256];
-  int i;
-  for (i = 0; i < 256; i++)
-  {
-		  levels[i] = 255 * (numLevels*i / 256) / (numLevels-1);
-  }
+void f0r_update_slice(f0r_instance_t instance, double time,
+                      const uint32_t* inframe1, const uint32_t* inframe2,
+                      const uint32_t* inframe3, uint32_t* outframe,
+                      unsigned int slice_start, unsigned int slice_height)
+{
+  assert(instance);
+  posterize_instance_t* inst = (posterize_instance_t*)instance;
+  unsigned int offset = inst->width * slice_start;
+  unsigned int len = inst->width * slice_height;
 
-  unsigned char* dst = (unsigned char*)outframe;
-  const unsigned char* src = (unsigned char*)inframe;
-  unsigned char r,g,b = 0;
-  while (len--)
-  {
-    r = *src++;
-    g = *src++;
-    b = *src++;
-
-    r = levels[r];
-    g = levels[g];
-    b = levels[b];
-
-    *dst++ = r;
-    *dst++ = g;
-    *dst++ = b;
-    *dst++ = *src++;//copy alpha
-  }
+  f0r_lut_apply(&inst->lut, inframe1 + offset, outframe + offset, len);
 }
 
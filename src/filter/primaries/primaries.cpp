@@ -43,6 +43,10 @@ public:
 	~primaries() {
 	}
 
+	virtual int capabilities() {
+		return F0R_CAP_IN_PLACE;
+	}
+
 	virtual void update() {
 		unsigned char mean = 0;
 		
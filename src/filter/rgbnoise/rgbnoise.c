@@ -32,14 +32,14 @@
 static int MY_MAX_RAND = 32767;// I assume RAND_MAX to be at least this big.
 static double gaussian_lookup[32767];
 static int TABLE_INITED = 0;
-static int next_gaussian_index = 0;
-static int last_in_range = 32766;
 
 typedef struct rgbnoise_instance
 {
   unsigned int width;
   unsigned int height;
   double noise;
+  int next_gaussian_index; // the range of the lookup table in use
+  int last_in_range;
 } rgbnoise_instance_t;
 
 
@@ -77,6 +77,8 @@ f0r_instance_t f0r_construct(unsigned int width, unsigned int height)
   inst->width = width; 
   inst->height = height;
   inst->noise = 0.2;
+  inst->next_gaussian_index = 0;
+  inst->last_in_range = 32766;
   return (f0r_instance_t)inst;
 }
 
@@ -133,7 +135,7 @@ static inline double gauss()
   return x;
 }
 
-static void create_new_lookup_range()
+static void create_new_lookup_range(rgbnoise_instance_t* inst)
 {
     int first, last, tmp;
     first = rand() % (MY_MAX_RAND - 1);
@@ -144,26 +146,26 @@ static void create_new_lookup_range()
       last = first;
       first = tmp;
     }
-    next_gaussian_index = first;
-    last_in_range = last;
+    inst->next_gaussian_index = first;
+    inst->last_in_range = last;
 }
 
-static inline double next_gauss()
+static inline double next_gauss(rgbnoise_instance_t* inst)
 {
-  next_gaussian_index++;
-  if (next_gaussian_index >= last_in_range)
+  inst->next_gaussian_index++;
+  if (inst->next_gaussian_index >= inst->last_in_range)
   {
-    create_new_lookup_range(); 
+    create_new_lookup_range(inst); 
   }
-  return gaussian_lookup[next_gaussian_index];
+  return gaussian_lookup[inst->next_gaussian_index];
 }
 
-static inline int addNoise(int sample, double noise)
+static inline int addNoise(rgbnoise_instance_t* inst, int sample, double noise)
 {
   int byteNoise = 0;
   int noiseSample = 0;
 
-  byteNoise = (int) (noise * next_gauss());
+  byteNoise = (int) (noise * next_gauss(inst));
   noiseSample = sample + byteNoise;
   noiseSample = CLAMP(noiseSample, 0, 255);
   return noiseSample;
@@ -197,11 +199,11 @@ void rgb_noise(f0r_instance_t instance, double time,
   while (len--)
   {
     sample = *src++;
-    *dst++ = addNoise(sample, noise);
+    *dst++ = addNoise(inst, sample, noise);
     sample = *src++;
-    *dst++ = addNoise(sample, noise);
+    *dst++ = addNoise(inst, sample, noise);
     sample = *src++;
-    *dst++ = addNoise(sample, noise);
+    *dst++ = addNoise(inst, sample, noise);
     *src++;
     *dst++;
   }
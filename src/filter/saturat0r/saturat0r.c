@@ -22,6 +22,7 @@
 
 #include "frei0r.h"
 #include "frei0r_math.h"
+#include "frei0r_lut.h"
 
 #define MAX_SATURATION 8.0
 
@@ -30,8 +31,30 @@ typedef struct saturat0r_instance
   unsigned int width;
   unsigned int height;
   double saturation; /* the saturation value [0, 1] */
+  f0r_lut_mix_t mix; /* look-up tables */
 } saturat0r_instance_t;
 
+static int32_t saturat0r_mix(void* arg, int c, int k, int v)
+{
+  double saturation = *(double*)arg * MAX_SATURATION;
+  double one_minus_saturation = 1.0-saturation;
+  int wgt[3];
+  wgt[0] = (int)(7471.0  * one_minus_saturation);
+  wgt[1] = (int)(38470.0 * one_minus_saturation);
+  wgt[2] = (int)(19595.0 * one_minus_saturation);
+
+  /* bw + channel*saturation, bw being the weighted sum >> 16 */
+  if (c == k)
+    return v*wgt[k] + (int32_t)(v*saturation) * 65536;
+  return v*wgt[k];
+}
+
+/* Updates the look-up tables. */
+void update_lut(saturat0r_instance_t *inst)
+{
+  f0r_lut_mix_compile(&inst->mix, saturat0r_mix, &inst->saturation, 0);
+}
+
 int f0r_init()
 {
   return 1;
@@ -70,6 +93,7 @@ f0r_instance_t f0r_construct(unsigned int width, unsigned int height)
   saturat0r_instance_t* inst = (saturat0r_instance_t*)calloc(1, sizeof(*inst));
   inst->width = width; inst->height = height;
   inst->saturation=1.0/MAX_SATURATION;
+  update_lut(inst);
   return (f0r_instance_t)inst;
 }
 
@@ -88,7 +112,11 @@ void f0r_set_param_value(f0r_instance_t instance,
   {
   case 0:
     /* saturations */
-    inst->saturation =  *((double*)param);
+    if (*((double*)param) != inst->saturation)
+    {
+      inst->saturation =  *((double*)param);
+      update_lut(inst);
+    }
     break;
   }
 }
@@ -107,57 +135,28 @@ void f0r_get_param_value(f0r_instance_t instance,
   }
 }
 
+int f0r_get_capabilities()
+{
+  return F0R_CAP_SLICE_SAFE | F0R_CAP_IN_PLACE;
+}
+
 void f0r_update(f0r_instance_t instance, double time,
                 const uint32_t* inframe, uint32_t* outframe)
 {
   assert(instance);
   saturat0r_instance_t* inst = (saturat0r_instance_t*)instance;
-  unsigned int len = inst->width * inst->height;
-  double saturation = inst->saturation * MAX_SATURATION;
-  
-  unsigned char* dst = (unsigned char*)outframe;
-  const unsigned char* src = (unsigned char*)inframe;
-
-  double one_minus_saturation = 1.0-saturation;
-  int bwgt = (int)(7471.0  * one_minus_saturation);
-  int gwgt = (int)(38470.0 * one_minus_saturation);
-  int rwgt = (int)(19595.0 * one_minus_saturation);
-
-  int b, g, r, bw;
-
-  if (0 <= saturation && saturation <=1) // optimisation: no clamping needed
-  {
-    while (len--)
-    {
-      b = *src++;
-      g = *src++;
-      r = *src++;
-      
-      bw = (b*bwgt + g*gwgt + r*rwgt) >> 16;
-      
-      *dst++ = (unsigned char) (bw + b*saturation);
-      *dst++ = (unsigned char) (bw + g*saturation);
-      *dst++ = (unsigned char) (bw + r*saturation);
-
-      *dst++ = *src++;  // copy alpha
-    }
-  }
-  else
-  {
-    while (len--)
-    {
-      b = *src++;
-      g = *src++;
-      r = *src++;
+  f0r_update_slice(instance, time, inframe, 0, 0, outframe, 0, inst->height);
+}
 
-      bw = (b*bwgt + g*gwgt + r*rwgt) >> 16;
-      
-      *dst++ = CLAMP0255((int) (bw + b*saturation));
-      *dst++ = CLAMP0255((int) (bw + g*saturation));
-      *dst++ = CLAMP0255((int) (bw + r*saturation));
+void f0r_update_slice(f0r_instance_t instance, double time,
+                      const uint32_t* inframe1, const uint32_t* inframe2,
+                      const uint32_t* inframe3, uint32_t* outframe,
+                      unsigned int slice_start, unsigned int slice_height)
+{
+  assert(instance);
+  saturat0r_instance_t* inst = (saturat0r_instance_t*)instance;
+  unsigned int offset = inst->width * slice_start;
+  unsigned int len = inst->width * slice_height;
 
-      *dst++ = *src++;  // copy alpha
-    }
-  }
+  f0r_lut_mix_apply(&inst->mix, inframe1 + offset, outframe + offset, len);
 }
-
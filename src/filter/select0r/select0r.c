@@ -31,16 +31,11 @@ Copyright (C) 2010  Marko Cebokli    http://lea.hamradio.si/~s57uuu
 //#include <stdio.h>	/* for debug printf only +/
 #include <frei0r.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include <assert.h>
 
-typedef struct
-	{
-	float r;
-	float g;
-	float b;
-	float a;
-	} float_rgba;
+#include "frei0r_cfc.h"
 
 typedef struct
 	{
@@ -671,10 +666,49 @@ float nud1,nud2,nud3;
 int soft;
 int inv;
 int op;
+int flt;	//frames are RGBA_FLOAT
 
 float_rgba *sl;
 } inst;
 
+//-----------------------------------------------------
+//apply alpha, for RGBA_FLOAT frames
+void alpha_float(inst *in, const float_rgba *fin, float_rgba *fout)
+{
+int i;
+float a1,a2;
+
+for (i=0;i<in->h*in->w;i++)
+	{
+	fout[i].r = fin[i].r;
+	fout[i].g = fin[i].g;
+	fout[i].b = fin[i].b;
+	a1 = fin[i].a;
+	a2 = in->sl[i].a;
+	switch (in->op)
+		{
+		case 0:		//write on clear
+			fout[i].a = a2;
+			break;
+		case 1:		//max
+			fout[i].a = (a1>a2) ? a1 : a2;
+			break;
+		case 2:		//min
+			fout[i].a = (a1<a2) ? a1 : a2;
+			break;
+		case 3:		//add
+			fout[i].a = (a1+a2<=1.0) ? a1+a2 : 1.0;
+			break;
+		case 4:		//subtract
+			fout[i].a = (a1>a2) ? a1-a2 : 0.0;
+			break;
+		default:
+			fout[i].a = a1;
+			break;
+		}
+	}
+}
+
 //-----------------------------------------------------
 //stretch [0...1] to parameter range [min...max] linear
 float map_value_forward(double v, float min, float max)
@@ -954,14 +988,10 @@ n.y=in->nud2;
 n.z=in->nud3;
 
 //convert to float
-cin=(uint8_t *)inframe;
-for (i=0;i<in->h*in->w;i++)
-	{
-	in->sl[i].r=f1*(float)*cin++;
-	in->sl[i].g=f1*(float)*cin++;
-	in->sl[i].b=f1*(float)*cin++;
-	cin++;
-	}
+if (in->flt)
+	memcpy(in->sl, inframe, in->w*in->h*sizeof(float_rgba));
+else
+	RGB8_2_float_lin(inframe, in->sl, in->w, in->h, f1, 0.0);
 
 //make the selection
 switch (in->subsp)
@@ -985,6 +1015,11 @@ if (in->inv==1)
 		in->sl[i].a = 1.0 - in->sl[i].a;
 
 //apply alpha
+if (in->flt)
+	{
+	alpha_float(in, (const float_rgba *)inframe, (float_rgba *)outframe);
+	return;
+	}
 cin=(uint8_t *)inframe;
 cout=(uint8_t *)outframe;
 switch (in->op)
@@ -1051,3 +1086,24 @@ switch (in->op)
 }
 
 //**********************************************************
+
+//-----------------------------------------------------
+int f0r_get_capabilities()
+{
+return F0R_CAP_RGBA_FLOAT | F0R_CAP_IN_PLACE;
+}
+
+//-----------------------------------------------------
+int f0r_set_color_model(f0r_instance_t instance, int color_model)
+{
+inst *in;
+
+in=(inst*)instance;
+if (color_model==F0R_COLOR_MODEL_RGBA_FLOAT)
+	in->flt=1;
+else if (color_model==F0R_COLOR_MODEL_RGBA8888)
+	in->flt=0;
+else
+	return 0;
+return 1;
+}
@@ -27,6 +27,7 @@
 #include <math.h>
 #include "frei0r.h"
 #include "frei0r_math.h"
+#include "frei0r_lut.h"
 
 #define SIGMOIDAL_BASE   2
 #define SIGMOIDAL_RANGE 20
@@ -37,63 +38,38 @@ typedef struct sigmoidal_instance
   unsigned int height;
   double brightness;
   double sharpness;
+  f0r_lut_t lut; /* transfer of the lightness */
 } sigmoidal_instance_t;
 
-static inline int gimp_rgb_to_l_int (int red,
-                   int green,
-                   int blue)
+static int sigmoidal_map(void* arg, int c, int luma)
 {
-  int min, max;
-
-  if (red > green)
-    {
-      max = MAX (red,   blue);
-      min = MIN (green, blue);
-    }
-  else
-    {
-      max = MAX (green, blue);
-      min = MIN (red,   blue);
-    }
-
-  return ROUND ((max + min) / 2.0);
+  sigmoidal_instance_t* inst = (sigmoidal_instance_t*)arg;
+  double val;
+
+  //compute sigmoidal transfer
+  val = luma / 255.0;
+  val = 255.0 / (1 + exp (-(SIGMOIDAL_BASE + (inst->sharpness * SIGMOIDAL_RANGE)) * (val - 0.5)));
+  val = val * inst->brightness;
+  return (int) CLAMP (val, 0, 255);
+}
+
+/* Updates the look-up-table. */
+void update_lut(sigmoidal_instance_t *inst)
+{
+  f0r_lut_compile(&inst->lut, sigmoidal_map, inst, F0R_LUT_RGB);
 }
 
 void sigmoidal_transfer(f0r_instance_t instance, double time,
-                const uint32_t* inframe, uint32_t* outframe)
+                const uint32_t* inframe, uint32_t* outframe,
+                unsigned int slice_start, unsigned int slice_height)
 {
   assert(instance);
   sigmoidal_instance_t* inst = (sigmoidal_instance_t*)instance;
-  unsigned int len = inst->width * inst->height;
+  unsigned int offset = inst->width * slice_start;
+  unsigned int len = inst->width * slice_height;
 
-  double brightness = inst->brightness;
-  double sharpness = inst->sharpness;
-
-  const unsigned char* src = (unsigned char*)inframe;
-  unsigned char* dst = (unsigned char*)outframe;
-
-  unsigned char luma, r, g, b;
-  double val;
-  while (len--)
-  {
-    r = *src++;
-    g = *src++;
-    b = *src++;
-
-    //desaturate 
-    luma = (unsigned char) gimp_rgb_to_l_int (r, g, b);
-
-    //compute sigmoidal transfer
-    val = luma / 255.0;
-    val = 255.0 / (1 + exp (-(SIGMOIDAL_BASE + (sharpness * SIGMOIDAL_RANGE)) * (val - 0.5)));
-    val = val * brightness;
-    luma = (unsigned char) CLAMP (val, 0, 255);
-
-    *dst++ = luma;
-    *dst++ = luma;
-    *dst++ = luma;
-    *dst++ = *src++;
-  }
+  //desaturate and look the transfer up
+  f0r_lut_lightness_apply(&inst->lut, inframe + offset, outframe + offset, len);
 }
 
 
@@ -141,6 +117,7 @@ f0r_instance_t f0r_construct(unsigned int width, unsigned int height)
   inst->height = height;
   inst->brightness = 0.75;
   inst->sharpness = 0.85;
+  update_lut(inst);
   return (f0r_instance_t)inst;
 }
 
@@ -162,6 +139,7 @@ void f0r_set_param_value(f0r_instance_t instance,
       inst->sharpness = *((double*)param);
       break;
   }
+  update_lut(inst);
 }
 
 void f0r_get_param_value(f0r_instance_t instance,
@@ -179,9 +157,24 @@ void f0r_get_param_value(f0r_instance_t instance,
   }
 }
 
+int f0r_get_capabilities()
+{
+  return F0R_CAP_SLICE_SAFE | F0R_CAP_IN_PLACE;
+}
+
 void f0r_update(f0r_instance_t instance, double time,
 		const uint32_t* inframe, uint32_t* outframe)
 {
-  sigmoidal_transfer(instance, time, inframe, outframe);
+  sigmoidal_instance_t* inst = (sigmoidal_instance_t*)instance;
+  sigmoidal_transfer(instance, time, inframe, outframe, 0, inst->height);
+}
+
+void f0r_update_slice(f0r_instance_t instance, double time,
+		      const uint32_t* inframe1, const uint32_t* inframe2,
+		      const uint32_t* inframe3, uint32_t* outframe,
+		      unsigned int slice_start, unsigned int slice_height)
+{
+  sigmoidal_transfer(instance, time, inframe1, outframe,
+                     slice_start, slice_height);
 }
 
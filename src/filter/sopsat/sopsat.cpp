@@ -128,6 +128,11 @@ public:
         free(m_lutA);
     }
 
+    virtual int capabilities()
+    {
+        return F0R_CAP_IN_PLACE;
+    }
+
     virtual void update()
     {
         // Rebuild the lookup table in case the prarameters have changed.
@@ -74,8 +74,22 @@ void f0r_get_param_value(f0r_instance_t instance,
   blur_get_param_value(instance, param, param_index);
 }
 
+int f0r_get_capabilities()
+{
+  return F0R_CAP_SLICE_SAFE;
+}
+
 void f0r_update(f0r_instance_t instance, double time,
                 const uint32_t* inframe, uint32_t* outframe)
 {
   blur_update(instance, time, inframe, outframe);
 }
+
+void f0r_update_slice(f0r_instance_t instance, double time,
+                      const uint32_t* inframe1, const uint32_t* inframe2,
+                      const uint32_t* inframe3, uint32_t* outframe,
+                      unsigned int slice_start, unsigned int slice_height)
+{
+  blur_update_slice(instance, time, inframe1, outframe,
+                    slice_start, slice_height);
+}
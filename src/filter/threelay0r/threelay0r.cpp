@@ -51,6 +51,10 @@ private:
 public:
 	threelay0r(unsigned int width, unsigned int height) {}
 
+	virtual int capabilities() {
+		return F0R_CAP_IN_PLACE;
+	}
+
 	virtual void update() {
 		histogram h;
 		
@@ -18,36 +18,31 @@
  */
 
 #include <stdlib.h>
-#include <string.h>
 #include <assert.h>
 
 #include "frei0r.h"
+#include "frei0r_lut.h"
 
 typedef struct threshold0r_instance
 {
   unsigned int width;
   unsigned int height;
   unsigned char threshold; /* the threshold [0, 255] */
-  unsigned char lut[256]; /* look-up table */
+  f0r_lut_t lut; /* look-up table */
 } threshold0r_instance_t;
 
+static int threshold0r_map(void* arg, int c, int i)
+{
+  unsigned char thresh = *(unsigned char*)arg;
+  if (thresh == 0xff)
+    return 0x00;
+  return i < thresh ? 0x00 : 0xff;
+}
+
 /* Updates the look-up-table. */
 void update_lut(threshold0r_instance_t *inst)
 {
-  int i;
-  unsigned char *lut = inst->lut;
-  unsigned char thresh = inst->threshold;
-  if (thresh == 0xff)
-    memset(lut, 0x00, 256*sizeof(unsigned char));
-  else if (thresh == 0x00)
-    memset(lut, 0xff, 256*sizeof(unsigned char));
-  else
-  {
-    for (i=0; i<thresh; ++i)
-      lut[i] = 0x00;
-    for (i=thresh; i<256; ++i)
-      lut[i] = 0xff;
-  }
+  f0r_lut_compile(&inst->lut, threshold0r_map, &inst->threshold, F0R_LUT_RGB);
 }
 
 int f0r_init()
@@ -132,22 +127,29 @@ void f0r_get_param_value(f0r_instance_t instance,
   }
 }
 
+int f0r_get_capabilities()
+{
+  return F0R_CAP_SLICE_SAFE | F0R_CAP_IN_PLACE;
+}
+
 void f0r_update(f0r_instance_t instance, double time,
                 const uint32_t* inframe, uint32_t* outframe)
 {
   assert(instance);
   threshold0r_instance_t* inst = (threshold0r_instance_t*)instance;
-  unsigned int len = inst->width * inst->height;
+  f0r_update_slice(instance, time, inframe, 0, 0, outframe, 0, inst->height);
+}
 
-  unsigned char* lut = inst->lut;
-  unsigned char* dst = (unsigned char*)outframe;
-  const unsigned char* src = (unsigned char*)inframe;
-  while (len--)
-  {
-    *dst++ = lut[*src++];
-    *dst++ = lut[*src++];
-    *dst++ = lut[*src++];
-    *dst++ = *src++; // copy alpha
-  }
+void f0r_update_slice(f0r_instance_t instance, double time,
+                      const uint32_t* inframe1, const uint32_t* inframe2,
+                      const uint32_t* inframe3, uint32_t* outframe,
+                      unsigned int slice_start, unsigned int slice_height)
+{
+  assert(instance);
+  threshold0r_instance_t* inst = (threshold0r_instance_t*)instance;
+  unsigned int offset = inst->width * slice_start;
+  unsigned int len = inst->width * slice_height;
+
+  f0r_lut_apply(&inst->lut, inframe1 + offset, outframe + offset, len);
 }
 
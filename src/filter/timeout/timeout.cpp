@@ -62,6 +62,9 @@ public:
         register_param(m_time, "time", "Current time");
         register_param(m_color, "color", "Indicator colour");
         register_param(m_transparency, "transparency", "Indicator transparency");
+        m_time = 0;
+        m_color.r = m_color.g = m_color.b = 0;
+        m_transparency = 0;
 
         W = std::min(width, height) / 20;
         H = W;
@@ -19,9 +19,11 @@
 
 #include <stdlib.h>
 #include <assert.h>
+#include <math.h>
 
 #include "frei0r.h"
 #include "frei0r_math.h"
+#include "frei0r_lut.h"
 
 typedef struct tint0r_instance
 {
@@ -30,8 +32,33 @@ typedef struct tint0r_instance
   f0r_param_color_t blackColor;
   f0r_param_color_t whiteColor;
   double amount; /* the amount value [0, 1] */
+  f0r_lut_mix_t mix; /* look-up tables */
 } tint0r_instance_t;
 
+/* The 16.16 part of 255 * (comp_amount * color + amount * luma * (maxColor - minColor))
+   which comes from the value v of channel k. */
+static int32_t tint0r_mix(void* arg, int c, int k, int v)
+{
+  static const double weight[3] = { .299, .587, .114 };
+  tint0r_instance_t* inst = (tint0r_instance_t*)arg;
+  float minColor[3] = { inst->blackColor.r, inst->blackColor.g, inst->blackColor.b };
+  float maxColor[3] = { inst->whiteColor.r, inst->whiteColor.g, inst->whiteColor.b };
+  double val = inst->amount * weight[k] * v * (maxColor[c] - minColor[c]);
+  if (c == k)
+    val += (1.0 - inst->amount) * v;
+  return (int32_t)floor(65536.0 * val + 0.5);
+}
+
+/* Updates the look-up tables. */
+void update_lut(tint0r_instance_t *inst)
+{
+  int32_t bias[3];
+  bias[0] = (int32_t)floor(65536.0 * 255.0 * inst->amount * inst->blackColor.r + 0.5);
+  bias[1] = (int32_t)floor(65536.0 * 255.0 * inst->amount * inst->blackColor.g + 0.5);
+  bias[2] = (int32_t)floor(65536.0 * 255.0 * inst->amount * inst->blackColor.b + 0.5);
+  f0r_lut_mix_compile(&inst->mix, tint0r_mix, inst, bias);
+}
+
 int f0r_init()
 {
   return 1;
@@ -86,6 +113,7 @@ f0r_instance_t f0r_construct(unsigned int width, unsigned int height)
   inst->blackColor.r = 0.0;
   inst->blackColor.g = 0.0;
   inst->blackColor.b = 0.0;
+  update_lut(inst);
   return (f0r_instance_t)inst;
 }
 
@@ -115,6 +143,7 @@ void f0r_set_param_value(f0r_instance_t instance,
 	  inst->amount = *((double *)param);
 	  break;
   }
+  update_lut(inst);
 }
 
 void f0r_get_param_value(f0r_instance_t instance,
@@ -137,9 +166,9 @@ void f0r_get_param_value(f0r_instance_t instance,
   }
 }
 
-unsigned char map_color(double amount, double comp_amount, float color, float luma, float minColor, float maxColor) {
-  double val = (comp_amount * color) + amount * (luma * (maxColor - minColor) + minColor);
-  return (unsigned char)(255*CLAMP(val, 0, 1));
+int f0r_get_capabilities()
+{
+  return F0R_CAP_SLICE_SAFE | F0R_CAP_IN_PLACE;
 }
 
 void f0r_update(f0r_instance_t instance, double time,
@@ -147,28 +176,18 @@ void f0r_update(f0r_instance_t instance, double time,
 {
   assert(instance);
   tint0r_instance_t* inst = (tint0r_instance_t*)instance;
-  unsigned int len = inst->width * inst->height;
-  double amount = inst->amount;
-  double comp_amount = 1.0 - inst->amount;
-  
-  unsigned char* dst = (unsigned char*)outframe;
-  const unsigned char* src = (unsigned char*)inframe;
-  float b, g, r;
-  float luma;
-
-  while (len--)
-  {
-	r = *src++ / 255.;
-	g = *src++ / 255.;
-	b = *src++ / 255.;
-	
-	luma = (b * .114 + g * .587 + r * .299);
-	
-	*dst++ = map_color(amount, comp_amount, r, luma, inst->blackColor.r, inst->whiteColor.r);
-	*dst++ = map_color(amount, comp_amount, g, luma, inst->blackColor.g, inst->whiteColor.g);
-	*dst++ = map_color(amount, comp_amount, b, luma, inst->blackColor.b, inst->whiteColor.b);
-
-	*dst++ = *src++;  // copy alpha
-  }
+  f0r_update_slice(instance, time, inframe, 0, 0, outframe, 0, inst->height);
 }
 
+void f0r_update_slice(f0r_instance_t instance, double time,
+                      const uint32_t* inframe1, const uint32_t* inframe2,
+                      const uint32_t* inframe3, uint32_t* outframe,
+                      unsigned int slice_start, unsigned int slice_height)
+{
+  assert(instance);
+  tint0r_instance_t* inst = (tint0r_instance_t*)instance;
+  unsigned int offset = inst->width * slice_start;
+  unsigned int len = inst->width * slice_height;
+
+  f0r_lut_mix_apply(&inst->mix, inframe1 + offset, outframe + offset, len);
+}
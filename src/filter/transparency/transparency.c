@@ -1,4 +1,5 @@
 #include "frei0r.h"
+#include "frei0r_roi.h"
 #include "frei0r_math.h"
 #include <stdlib.h>
 #include <assert.h>
@@ -90,6 +91,11 @@ void f0r_get_param_value(f0r_instance_t instance,
 	}
 }
 
+int f0r_get_capabilities()
+{
+  return F0R_CAP_IN_PLACE | F0R_CAP_ROI;
+}
+
 void f0r_update(f0r_instance_t instance, double time,
 		const uint32_t* inframe, uint32_t* outframe)
 {
@@ -112,3 +118,35 @@ void f0r_update(f0r_instance_t instance, double time,
 	}
 }
 
+void f0r_update_roi(f0r_instance_t instance, double time,
+		    const uint32_t* inframe1, const uint32_t* inframe2,
+		    const uint32_t* inframe3, uint32_t* outframe,
+		    const f0r_rect_t* roi, f0r_rect_t* modified)
+{
+  assert(instance);
+  transparency_instance_t* inst = (transparency_instance_t*)instance;
+  unsigned int w = inst->width;
+  unsigned int x,y;
+  uint8_t alpha  = (uint8_t)( inst->transparency * 255 );
+
+  /* fully opaque leaves every alpha as it is */
+  if (alpha == 255)
+    {
+      *modified = f0r_rect_make(roi->x, roi->y, 0, 0);
+      return;
+    }
+
+  *modified = *roi;
+  for(y=roi->y;y<roi->y+roi->height;++y)
+    {
+      uint32_t* dst = outframe + y*w + roi->x;
+      const uint32_t* src = inframe1 + y*w + roi->x;
+      for(x=roi->width;x>0;--x,++src,++dst)
+	{
+	  uint8_t tmpalpha;
+	  uint8_t* tmpc = (uint8_t*)src;
+	  tmpalpha = MIN(alpha, tmpc[3]);
+	  *dst = (tmpalpha << 24) | (tmpc[2] << 16) | (tmpc[1] << 8) | tmpc[0];
+	}
+    }
+}
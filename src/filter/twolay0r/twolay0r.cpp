@@ -37,6 +37,11 @@ public:
   {
   }
 
+  virtual int capabilities()
+  {
+    return F0R_CAP_IN_PLACE;
+  }
+
   virtual void update()
   {
     histogram h;
@@ -128,6 +128,7 @@ Plasma::Plasma(int wdt, int hgt) {
     }
   
   /* create palette */
+  memset(colors, 0, sizeof(colors));
   for (i = 0; i < 64; ++i)
     {
       colors[i].r = i << 2;
@@ -139,6 +140,8 @@ Plasma::Plasma(int wdt, int hgt) {
       colors[i+192].g = (i << 2) + 1; 
     } 
 
+  pos1 = pos2 = pos3 = pos4 = 0;
+
   speed1 = 1.;
   speed2 = 1.;
   speed3 = 1.;
@@ -33,6 +33,7 @@ struct IsingField {
   char* s;
   int xsize;
   int ysize;
+  uint32_t rnd; /* state of the random numbers of this field */
 };
 
 static void set_bf(uint32_t bf[3], double t, double b, double s);
@@ -45,16 +46,14 @@ static void copy_field(const struct IsingField* f, uint32_t* framebuffer);
 
 #define MY_RAND_MAX UINT32_MAX
 
-static uint32_t rnd_lcg1_xn = 1;
-
-inline static uint32_t rnd_lcg1()
+inline static uint32_t rnd_lcg1(uint32_t* xn)
 {
-  rnd_lcg1_xn *= 3039177861U;
+  *xn *= 3039177861U;
 
-  return rnd_lcg1_xn;
+  return *xn;
 }
 
-#define my_rand() rnd_lcg1()
+#define my_rand() rnd_lcg1(&f->rnd)
 
 
 typedef struct ising0r_instance
@@ -212,6 +211,7 @@ static void init_field(struct IsingField* f, int xsize, int ysize)
 
   f->xsize = xsize;
   f->ysize = ysize;
+  f->rnd = 1;
 
   //  memset(
 
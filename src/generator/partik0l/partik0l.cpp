@@ -263,8 +263,12 @@ void Partik0l::blob_init(int ray) {
   
 
 void Partik0l::blob(int x, int y) {
-  //  if(y>h-blob_size) return;
-  //  if(x>w-blob_size) return;
+  /* keep the whole blob inside the frame, small frames
+     would otherwise be written past their end */
+  if(x < 0) x = 0;
+  else if(x > w-blob_size) x = w-blob_size;
+  if(y < 0) y = 0;
+  else if(y > h-blob_size) y = h-blob_size;
 
   int i, j;
   int stride = (w-blob_size)>>1;
@@ -19,21 +19,17 @@
  */
 
 #include "frei0r.hpp"
-#include "frei0r_math.h"
 
-#define NBYTES 4
-#define ALPHA 3
-
-class addition : public frei0r::mixer2
+class addition : public frei0r::bit_depths<frei0r::mixer2, addition>
 {
 public:
   addition(unsigned int width, unsigned int height)
   {
-    // initialize look-up table
-    for (int i = 0; i < 256; i++)
-      add_lut[i] = i;
-  	for (int i = 256; i <= 510; i++)
-      add_lut[i] = 255;
+  }
+
+  virtual int capabilities()
+  {
+    return bit_depths::capabilities() | F0R_CAP_STRIDE | F0R_CAP_IN_PLACE;
   }
 
   /**
@@ -42,32 +38,27 @@ public:
    * and in2.
    *
    **/
-  void update()
+  template<class P>
+  void update_px()
   {
-    const uint8_t *A = reinterpret_cast<const uint8_t*>(in1);
-    const uint8_t *B = reinterpret_cast<const uint8_t*>(in2);
-    uint8_t *D = reinterpret_cast<uint8_t*>(out);
-    uint32_t sizeCounter = size;
-            
-    uint32_t b;
-  
-    while (sizeCounter--)
-      {
-        for (b = 0; b < ALPHA; b++)
-          D[b] = add_lut[A[b] + B[b]];
-        
-        D[ALPHA] = MIN(A[ALPHA], B[ALPHA]);
-        A += NBYTES;
-        B += NBYTES;
-        D += NBYTES;
-      }
+    parallel_rows(0, height, [this](unsigned int first, unsigned int last)
+                  { update_rows<P>(first, last); });
   }
-  
+
 private:
-  static uint8_t add_lut[511]; // look-up table storing values to do a quick MAX of two values when you know you add two unsigned chars
+  template<class P>
+  void update_rows(unsigned int first, unsigned int last)
+  {
+    blend_rows<P>(first, last,
+                  [](typename P::wide a, typename P::wide b)
+                  -> typename P::wide
+                  {
+                    typename P::wide v = a + b;
+                    return v > P::max ? P::max : v;
+                  });
+  }
 };
 
-uint8_t addition::add_lut[511];
 
 frei0r::construct<addition> plugin("addition",
                                   "Perform an RGB[A] addition operation of the pixel sources.",
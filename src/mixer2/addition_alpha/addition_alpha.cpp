@@ -20,21 +20,18 @@
  */
 
 #include "frei0r.hpp"
-#include "frei0r_math.h"
-
-#define NBYTES 4
-#define ALPHA 3
+#include "frei0r_composite.h"
 
 class addition_alpha : public frei0r::mixer2
 {
 public:
   addition_alpha(unsigned int width, unsigned int height)
   {
-    // initialize look-up table
-    for (int i = 0; i < 256; i++)
-      add_lut[i] = i;
-  	for (int i = 256; i <= 510; i++)
-      add_lut[i] = 255;
+  }
+
+  virtual int capabilities()
+  {
+    return F0R_CAP_IN_PLACE;
   }
 
   /**
@@ -48,31 +45,19 @@ public:
    **/
   void update()
   {
-    const uint8_t *A = reinterpret_cast<const uint8_t*>(in1);
-    const uint8_t *B = reinterpret_cast<const uint8_t*>(in2);
-    uint8_t *D = reinterpret_cast<uint8_t*>(out);
-    uint32_t sizeCounter = size;
-            
-    uint32_t b;
-  
-    while (sizeCounter--)
-      {
-        for (b = 0; b < ALPHA; b++)
-          D[b] = add_lut[A[b] + ((B[b]*B[ALPHA])>>8)];
-        
-        D[ALPHA] = 255;
-        A += NBYTES;
-        B += NBYTES;
-        D += NBYTES;
-      }
+    parallel_rows(0, height, [this](unsigned int first, unsigned int last)
+                  { update_rows(first, last); });
   }
-  
+
 private:
-  static uint8_t add_lut[511]; // look-up table storing values to do a quick MAX of two values when you know you add two unsigned chars
+  void update_rows(unsigned int first, unsigned int last)
+  {
+    f0r_composite_rgba8(F0R_COMPOSITE_ADD, 0,
+                        in1 + first * width, in2 + first * width,
+                        out + first * width, (last - first) * width);
+  }
 };
 
-uint8_t addition_alpha::add_lut[511];
-
 frei0r::construct<addition_alpha> plugin("addition_alpha",
                                   "Perform an RGB[A] addition_alpha operation of the pixel sources.",
                                   "Jean-Sebastien Senecal",
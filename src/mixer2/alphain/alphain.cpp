@@ -18,9 +18,7 @@
  */
 
 #include "frei0r.hpp"
-#include "frei0r_math.h"
-
-#include <algorithm>
+#include "frei0r_composite.h"
 
 class alphain : public frei0r::mixer2
 {
@@ -29,36 +27,24 @@ public:
   {
   }
 
-  void update()
+  virtual int capabilities()
   {
-    uint8_t *dst = reinterpret_cast<uint8_t*>(out);
-    const uint8_t *src1 = reinterpret_cast<const uint8_t*>(in1);
-    const uint8_t *src2 = reinterpret_cast<const uint8_t*>(in2);
-    
-    for (int i=0; i<size; ++i)
-    {
-      uint32_t tmp;
-      uint8_t alpha_src1 = src1[3];
-      uint8_t alpha_dst;
-      uint8_t w1 = src2[3];
+    return F0R_CAP_IN_PLACE;
+  }
 
-      // compute destination alpha
-      alpha_dst = dst[3] = INT_MULT(alpha_src1, w1, tmp);
+  void update()
+  {
+    parallel_rows(0, height, [this](unsigned int first, unsigned int last)
+                  { update_rows(first, last); });
+  }
 
-       // compute destination values
-      if (alpha_dst == 0)
-        for (int b=0; b<3; ++b)
-          dst[b] = 0;
-      else
-        for (int b=0; b<3; ++b)
-          dst[b] = CLAMP0255( (uint32_t)( (uint32_t) (INT_MULT(src1[b], alpha_src1, tmp) * w1) / alpha_dst) );
-      
-      src1 += 4;
-      src2 += 4;
-      dst += 4;
-    }
+private:
+  void update_rows(unsigned int first, unsigned int last)
+  {
+    f0r_composite_rgba8(F0R_COMPOSITE_IN, F0R_COMPOSITE_SKIP_RUNS,
+                        in1 + first * width, in2 + first * width,
+                        out + first * width, (last - first) * width);
   }
-  
 };
 
 
@@ -75,6 +75,11 @@ void f0r_get_param_value(f0r_instance_t instance,
 { /* no params */ }
 
 
+int f0r_get_capabilities()
+{
+  return F0R_CAP_IN_PLACE;
+}
+
 void f0r_update2(f0r_instance_t instance,
 		 double time,
 		 const uint32_t* inframe1,
@@ -29,9 +29,15 @@ class blend : public frei0r::mixer2
 public:
   blend(unsigned int width, unsigned int height)
   {
+  	blend_factor = 0.0;
   	register_param(blend_factor,"blend","blend factor");
   }
 
+  virtual int capabilities()
+  {
+    return F0R_CAP_IN_PLACE;
+  }
+
   /**
    *
    * Perform a blend operation between sources in1 and in2, using
@@ -19,18 +19,20 @@
  */
 
 #include "frei0r.hpp"
-#include "frei0r_math.h"
+#include "frei0r_simd.h"
 
-#define NBYTES 4
-#define ALPHA 3
-
-class burn : public frei0r::mixer2
+class burn : public frei0r::bit_depths<frei0r::mixer2, burn>
 {
 public:
   burn(unsigned int width, unsigned int height)
   {
   }
 
+  virtual int capabilities()
+  {
+    return bit_depths::capabilities() | F0R_CAP_STRIDE | F0R_CAP_IN_PLACE;
+  }
+
   /**
    *
    * Perform an RGB[A] dodge operation between the pixel sources
@@ -39,37 +41,30 @@ public:
    * D = saturation of 255 or depletion of 0, of ((255 - A) * 256) / (B + 1)
    *
    **/
-  void update()
+  template<class P>
+  void update_px()
+  {
+    parallel_rows(0, height, [this](unsigned int first, unsigned int last)
+                  { update_rows(P(), first, last); });
+  }
+
+private:
+  void update_rows(frei0r::rgba8, unsigned int first, unsigned int last)
+  {
+    blend_rows(first, last, f0r_rgba8_burn);
+  }
+
+  template<class P>
+  void update_rows(P, unsigned int first, unsigned int last)
   {
-    const uint8_t *src1 = reinterpret_cast<const uint8_t*>(in1);
-    const uint8_t *src2 = reinterpret_cast<const uint8_t*>(in2);
-    uint8_t *dst = reinterpret_cast<uint8_t*>(out);
-    uint32_t sizeCounter = size;
-            
-    uint32_t b;
-  
-    /* FIXME: Is the burn effect supposed to be dependant on the sign of this
-     * temporary variable? */
-    int tmp;
-  
-    while (sizeCounter--)
-      {
-        for (b = 0; b < ALPHA; b++)
-          {
-            tmp = (255 - src1[b]) << 8;
-            tmp /= src2[b] + 1;
-            dst[b] = (uint8_t) CLAMP0255(255 - tmp);
-          }
-        dst[ALPHA] = MIN(src1[ALPHA], src2[ALPHA]);
-  
-        src1 += NBYTES;
-        src2 += NBYTES;
-        dst += NBYTES;
-      }
+    blend_rows<P>(first, last,
+                  [](typename P::wide a, typename P::wide b)
+                  -> typename P::wide
+                  {
+                    typename P::wide tmp = ((P::max - a) << P::bits) / (b + 1);
+                    return tmp > P::max ? 0 : P::max - tmp;
+                  });
   }
-  
-  
-    
 };
 
 
@@ -19,18 +19,19 @@
  */
 
 #include "frei0r.hpp"
-#include "frei0r_math.h"
 
-#define NBYTES 4
-#define ALPHA 3
-
-class darken : public frei0r::mixer2
+class darken : public frei0r::bit_depths<frei0r::mixer2, darken>
 {
 public:
   darken(unsigned int width, unsigned int height)
   {
   }
 
+  virtual int capabilities()
+  {
+    return bit_depths::capabilities() | F0R_CAP_STRIDE | F0R_CAP_IN_PLACE;
+  }
+
   /**
    *
    * Perform a darken operation between sources in1 and in2, using
@@ -41,34 +42,24 @@ public:
    * D_a = min(A_a, B_a);
    *
    **/
-  void update()
+  template<class P>
+  void update_px()
+  {
+    parallel_rows(0, height, [this](unsigned int first, unsigned int last)
+                  { update_rows<P>(first, last); });
+  }
+
+private:
+  template<class P>
+  void update_rows(unsigned int first, unsigned int last)
   {
-    const uint8_t *src1 = reinterpret_cast<const uint8_t*>(in1);
-    const uint8_t *src2 = reinterpret_cast<const uint8_t*>(in2);
-    uint8_t *dst = reinterpret_cast<uint8_t*>(out);
-    uint32_t sizeCounter = size;
-            
-    uint32_t b;
-    uint8_t s1, s2;
-  
-    while (sizeCounter--)
-      {
-        for (b = 0; b < ALPHA; b++)
-          {
-            s1 = src1[b];
-            s2 = src2[b];
-            dst[b] = MIN(s1,s2);
-          }
-  
-        dst[ALPHA] = MIN(src1[ALPHA], src2[ALPHA]);
-  
-        src1 += NBYTES;
-        src2 += NBYTES;
-        dst += NBYTES;
-      }
+    blend_rows<P>(first, last,
+                  [](typename P::wide a, typename P::wide b)
+                  -> typename P::wide
+                  {
+                    return a < b ? a : b;
+                  });
   }
-  
-    
 };
 
 
@@ -19,59 +19,53 @@
  */
 
 #include "frei0r.hpp"
-#include "frei0r_math.h"
+#include "frei0r_simd.h"
 
-#define NBYTES 4
-#define ALPHA 3
-
-class hardlight : public frei0r::mixer2
+class hardlight : public frei0r::bit_depths<frei0r::mixer2, hardlight>
 {
 public:
   hardlight(unsigned int width, unsigned int height)
   {
   }
 
+  virtual int capabilities()
+  {
+    return bit_depths::capabilities() | F0R_CAP_STRIDE | F0R_CAP_IN_PLACE;
+  }
+
   /**
    *
    * Perform an RGB[A] hardlight operation between the pixel sources
    * in1 and in2.
    *
    **/
-  void update()
+  template<class P>
+  void update_px()
+  {
+    parallel_rows(0, height, [this](unsigned int first, unsigned int last)
+                  { update_rows(P(), first, last); });
+  }
+
+private:
+  void update_rows(frei0r::rgba8, unsigned int first, unsigned int last)
+  {
+    blend_rows(first, last, f0r_rgba8_hardlight);
+  }
+
+  template<class P>
+  void update_rows(P, unsigned int first, unsigned int last)
   {
-    const uint8_t *src1 = reinterpret_cast<const uint8_t*>(in1);
-    const uint8_t *src2 = reinterpret_cast<const uint8_t*>(in2);
-    uint8_t *dst = reinterpret_cast<uint8_t*>(out);
-    uint32_t sizeCounter = size;
-            
-    uint32_t b, tmp;
-  
-    while (sizeCounter--)
-      {
-        for (b = 0; b < ALPHA; b++)
-          {
-            if (src2[b] > 128)
-              {
-                tmp = ((int) 255 - src1[b]) * ((int) 255 - ((src2[b] - 128) << 1));
-                dst[b] = (uint8_t) MAX255 (255 - (tmp >> 8));
-              }
-            else
-              {
-                tmp = (int) src1[b] * ((int) src2[b] << 1);
-                dst[b] = (uint8_t) MAX255 (tmp >> 8);
-              }
-          }
-  
-        dst[ALPHA] = MIN(src1[ALPHA], src2[ALPHA]);
-  
-        src1 += NBYTES;
-        src2 += NBYTES;
-        dst += NBYTES;
-      }
+    blend_rows<P>(first, last,
+                  [](typename P::wide a, typename P::wide b)
+                  -> typename P::wide
+                  {
+                    if (b > P::half)
+                      return P::max - (((P::max - a)
+                                        * (P::max - ((b - P::half) << 1)))
+                                       >> P::bits);
+                    return (a * (b << 1)) >> P::bits;
+                  });
   }
-  
-  
-    
 };
 
 
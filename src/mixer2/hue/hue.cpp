@@ -31,6 +31,11 @@ public:
   {
   }
 
+  virtual int capabilities()
+  {
+    return F0R_CAP_IN_PLACE;
+  }
+
   /**
    *
    * Perform a conversion to hue only of the source in1 using
@@ -38,10 +43,17 @@ public:
    **/
   void update()
   {
-    const uint8_t *src1 = reinterpret_cast<const uint8_t*>(in1);
-    const uint8_t *src2 = reinterpret_cast<const uint8_t*>(in2);
-    uint8_t *dst = reinterpret_cast<uint8_t*>(out);
-    uint32_t sizeCounter = size;
+    parallel_rows(0, height, [this](unsigned int first, unsigned int last)
+                  { update_rows(first, last); });
+  }
+
+private:
+  void update_rows(unsigned int first, unsigned int last)
+  {
+    const uint8_t *src1 = reinterpret_cast<const uint8_t*>(in1 + first * width);
+    const uint8_t *src2 = reinterpret_cast<const uint8_t*>(in2 + first * width);
+    uint8_t *dst = reinterpret_cast<uint8_t*>(out + first * width);
+    uint32_t sizeCounter = (last - first) * width;
     int r1, g1, b1;
 	int r2, g2, b2;
   
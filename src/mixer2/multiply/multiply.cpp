@@ -19,48 +19,49 @@
  */
 
 #include "frei0r.hpp"
-#include "frei0r_math.h"
+#include "frei0r_simd.h"
 
-#define NBYTES 4
-#define ALPHA 3
-
-class multiply : public frei0r::mixer2
+class multiply : public frei0r::bit_depths<frei0r::mixer2, multiply>
 {
 public:
   multiply(unsigned int width, unsigned int height)
   {
   }
 
+  virtual int capabilities()
+  {
+    return bit_depths::capabilities() | F0R_CAP_STRIDE | F0R_CAP_IN_PLACE;
+  }
+
   /**
    *
    * Perform an RGB[A] multiply operation between the pixel sources
    * in1 and in2.
    *
    **/
-  void update()
+  template<class P>
+  void update_px()
   {
-    const uint8_t *src1 = reinterpret_cast<const uint8_t*>(in1);
-    const uint8_t *src2 = reinterpret_cast<const uint8_t*>(in2);
-    uint8_t *dst = reinterpret_cast<uint8_t*>(out);
-    uint32_t sizeCounter = size;
-            
-    uint32_t b, tmp;
-  
-    while (sizeCounter--)
-      {
-        for (b = 0; b < ALPHA; b++)
-          dst[b] = INT_MULT(src1[b], src2[b], tmp);
+    parallel_rows(0, height, [this](unsigned int first, unsigned int last)
+                  { update_rows(P(), first, last); });
+  }
 
-        dst[ALPHA] = MIN(src1[ALPHA], src2[ALPHA]);
+private:
+  void update_rows(frei0r::rgba8, unsigned int first, unsigned int last)
+  {
+    blend_rows(first, last, f0r_rgba8_multiply);
+  }
 
-        src1 += NBYTES;
-        src2 += NBYTES;
-        dst += NBYTES;
-      }
+  template<class P>
+  void update_rows(P, unsigned int first, unsigned int last)
+  {
+    blend_rows<P>(first, last,
+                  [](typename P::wide a, typename P::wide b)
+                  -> typename P::wide
+                  {
+                    return P::mul(a, b);
+                  });
   }
-  
-  
-    
 };
 
 
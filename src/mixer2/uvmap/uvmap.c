@@ -117,6 +117,9 @@ void f0r_update2(f0r_instance_t instance,
 
 			px = lrintf( w * fx );
 			py = lrintf( h * fy );
+			/* 255 maps to the first column or row past the frame */
+			if ( px >= (long)w ) px = w - 1;
+			if ( py >= (long)h ) py = h - 1;
 			if ( tmpc[2] > 128 ) {
 				*dst++ = src[px+w*py];
 			} else {
@@ -26,6 +26,11 @@ public:
     uint8_t fader_pos;
   };
   
+  virtual int capabilities()
+  {
+    return F0R_CAP_IN_PLACE;
+  }
+
   void update()
   {
     std::transform(reinterpret_cast<const uint8_t*>(in1),
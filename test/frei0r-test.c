@@ -0,0 +1,1119 @@
+/* frei0r-test.c
+ * Copyright (C) 2013 the frei0r project
+ *
+ * Runs a frei0r plugin on deterministic input frames and compares the
+ * results with the golden data recorded for it.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/*
+ * Every plugin is run on a set of cases: an input pattern combined with a
+ * parameter set, the defaults or every numeric parameter at 0.2, 0.5 or
+ * 0.8. The input moves by a few pixels from one frame of a case
+ * to the next, so that temporal effects see motion. For each case the
+ * golden file <plugin>.txt stores a hash of the last output frame, and
+ * <plugin>.gz the frame itself. A case passes if the hash is unchanged,
+ * or if at most a few pixels (-x, default 0) have a channel that moved by
+ * more than the tolerance (-e, default 2). Small rounding changes (e.g.
+ * from SIMD code) are accepted while local changes are not.
+ *
+ * Every case is run twice, on output frames filled in the same way, and
+ * fails if the two runs differ. Random numbers are seeded with srand(1)
+ * before each run and time() returns a fixed date, so plugins seeding
+ * from the clock repeat themselves as well.
+ *
+ * Lines "set <name>=<value>" at the top of a golden file set a parameter
+ * in every case, after the parameter set, e.g. to select a mode given by
+ * a string parameter. Golden files named <plugin>-<variant>.txt hold
+ * further variants of the plugin <plugin>.
+ *
+ * With -f the cases run on RGBA_FLOAT frames, for plugins announcing
+ * F0R_CAP_RGBA_FLOAT, and with -w on RGBA64 frames, for plugins
+ * announcing F0R_CAP_RGBA64: the input bytes are converted to that
+ * model and the output back to bytes, and the result is checked against
+ * the golden data of the byte path. With -s the frames get padded rows
+ * and go through f0r_update_stride, for plugins announcing
+ * F0R_CAP_STRIDE; writing to the padding fails the case. With -i the
+ * first input frame is also the output frame, for plugins announcing
+ * F0R_CAP_IN_PLACE. With -o the frames go through f0r_update_roi, for
+ * plugins announcing F0R_CAP_ROI, once for the whole frame and once for
+ * a rectangle in its middle; writing outside the modified rectangle or
+ * a middle differing from that of the whole frame fails the case. With
+ * -y the frames go through f0r_update_history, for filters announcing
+ * F0R_CAP_HISTORY, with the input frames of the earlier frames of the
+ * case as history.
+ *
+ * Golden files are written with -u, keeping their "set" lines:
+ *
+ *   frei0r-test -u [-p test_pat_B.so] plugin.so golden/plugin.txt
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <dlfcn.h>
+#include <zlib.h>
+
+#include "frei0r.h"
+
+#define WIDTH 64
+#define HEIGHT 48
+#define FRAME_BYTES (WIDTH * HEIGHT * 4)
+#define NUM_FRAMES 3
+#define SHIFT_X 3 /* motion of the input from one frame to the next */
+#define SHIFT_Y 2
+#define NOISE_CELL 4
+#define MAX_SETTINGS 8
+
+#define TIMING_WIDTH 640
+#define TIMING_HEIGHT 480
+#define TIMING_FRAMES 10
+
+typedef struct setting
+{
+  char name[64];
+  char value[64];
+} setting_t;
+
+typedef struct plugin
+{
+  void* handle;
+  f0r_plugin_info_t info;
+
+  int (*f0r_init)();
+  void (*f0r_deinit)();
+  void (*f0r_get_plugin_info)(f0r_plugin_info_t*);
+  void (*f0r_get_param_info)(f0r_param_info_t*, int);
+  f0r_instance_t (*f0r_construct)(unsigned int, unsigned int);
+  void (*f0r_destruct)(f0r_instance_t);
+  void (*f0r_set_param_value)(f0r_instance_t, f0r_param_t, int);
+  void (*f0r_update)(f0r_instance_t, double, const uint32_t*, uint32_t*);
+  void (*f0r_update2)(f0r_instance_t, double, const uint32_t*,
+                      const uint32_t*, const uint32_t*, uint32_t*);
+  int (*f0r_get_capabilities)();
+  int (*f0r_set_color_model)(f0r_instance_t, int);
+  void (*f0r_update_stride)(f0r_instance_t, double,
+                            const uint32_t*, unsigned int,
+                            const uint32_t*, unsigned int,
+                            const uint32_t*, unsigned int,
+                            uint32_t*, unsigned int);
+  void (*f0r_update_roi)(f0r_instance_t, double, const uint32_t*,
+                         const uint32_t*, const uint32_t*, uint32_t*,
+                         const f0r_rect_t*, f0r_rect_t*);
+  unsigned int (*f0r_get_history_depth)(f0r_instance_t);
+  void (*f0r_update_history)(f0r_instance_t, double, const uint32_t*,
+                             const uint32_t* const*, const double*,
+                             unsigned int, uint32_t*);
+
+  int color_model; /* of the frames of the cases, -1 for info.color_model */
+  int strided; /* run the frames through f0r_update_stride */
+  int in_place; /* the first input frame is the output frame */
+  int roi; /* run the frames through f0r_update_roi */
+  int history; /* run the frames through f0r_update_history */
+  setting_t settings[MAX_SETTINGS]; /* of the golden file */
+  int num_settings;
+} plugin_t;
+
+typedef struct result
+{
+  char pattern[32];
+  char params[32];
+  int deterministic; /* both runs gave the same frame */
+  unsigned long long hash;
+  unsigned char* frame; /* the last output frame */
+} result_t;
+
+static int load_plugin(plugin_t* p, const char* path)
+{
+  memset(p, 0, sizeof(*p));
+  p->handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+  if (!p->handle)
+    {
+      fprintf(stderr, "%s\n", dlerror());
+      return 0;
+    }
+
+  p->f0r_init = dlsym(p->handle, "f0r_init");
+  p->f0r_deinit = dlsym(p->handle, "f0r_deinit");
+  p->f0r_get_plugin_info = dlsym(p->handle, "f0r_get_plugin_info");
+  p->f0r_get_param_info = dlsym(p->handle, "f0r_get_param_info");
+  p->f0r_construct = dlsym(p->handle, "f0r_construct");
+  p->f0r_destruct = dlsym(p->handle, "f0r_destruct");
+  p->f0r_set_param_value = dlsym(p->handle, "f0r_set_param_value");
+  p->f0r_update = dlsym(p->handle, "f0r_update");
+  p->f0r_update2 = dlsym(p->handle, "f0r_update2");
+  p->f0r_get_capabilities = dlsym(p->handle, "f0r_get_capabilities");
+  p->f0r_set_color_model = dlsym(p->handle, "f0r_set_color_model");
+  p->f0r_update_stride = dlsym(p->handle, "f0r_update_stride");
+  p->f0r_update_roi = dlsym(p->handle, "f0r_update_roi");
+  p->f0r_get_history_depth = dlsym(p->handle, "f0r_get_history_depth");
+  p->f0r_update_history = dlsym(p->handle, "f0r_update_history");
+
+  if (!p->f0r_init || !p->f0r_get_plugin_info || !p->f0r_construct
+      || !p->f0r_destruct || !(p->f0r_update || p->f0r_update2))
+    {
+      fprintf(stderr, "%s is not a frei0r plugin\n", path);
+      return 0;
+    }
+
+  p->f0r_init();
+  p->f0r_get_plugin_info(&p->info);
+  return 1;
+}
+
+/* Sets all numeric parameters to value, a negative value keeps the
+ * defaults. */
+static void set_params(plugin_t* p, f0r_instance_t inst, double value)
+{
+  int i;
+  if (value < 0.0 || !p->f0r_get_param_info || !p->f0r_set_param_value)
+    return;
+
+  for (i = 0; i < p->info.num_params; ++i)
+    {
+      f0r_param_info_t pinfo;
+      f0r_param_color_t color;
+      f0r_param_position_t pos;
+      double d = value;
+
+      memset(&pinfo, 0, sizeof(pinfo));
+      p->f0r_get_param_info(&pinfo, i);
+      switch (pinfo.type)
+        {
+        case F0R_PARAM_BOOL:
+        case F0R_PARAM_DOUBLE:
+          p->f0r_set_param_value(inst, &d, i);
+          break;
+        case F0R_PARAM_COLOR:
+          color.r = color.g = color.b = (float)value;
+          p->f0r_set_param_value(inst, &color, i);
+          break;
+        case F0R_PARAM_POSITION:
+          pos.x = pos.y = value;
+          p->f0r_set_param_value(inst, &pos, i);
+          break;
+        }
+    }
+}
+
+/* Sets the parameters of the "set" lines of the golden file, parsing
+ * colors as "r,g,b" and positions as "x,y". Returns 0 if the plugin has
+ * no parameter of that name. */
+static int apply_settings(plugin_t* p, f0r_instance_t inst)
+{
+  int i, j;
+  for (j = 0; j < p->num_settings; ++j)
+    {
+      setting_t* s = &p->settings[j];
+      f0r_param_info_t pinfo;
+      f0r_param_color_t color = { 0.0f, 0.0f, 0.0f };
+      f0r_param_position_t pos = { 0.0, 0.0 };
+      f0r_param_string str = s->value;
+      double d = atof(s->value);
+
+      memset(&pinfo, 0, sizeof(pinfo));
+      for (i = 0; p->f0r_get_param_info && i < p->info.num_params; ++i)
+        {
+          p->f0r_get_param_info(&pinfo, i);
+          if (pinfo.name && !strcmp(pinfo.name, s->name))
+            break;
+        }
+      if (!p->f0r_get_param_info || !p->f0r_set_param_value
+          || i == p->info.num_params)
+        {
+          fprintf(stderr, "%s has no parameter \"%s\"\n", p->info.name,
+                  s->name);
+          return 0;
+        }
+      switch (pinfo.type)
+        {
+        case F0R_PARAM_BOOL:
+        case F0R_PARAM_DOUBLE:
+          p->f0r_set_param_value(inst, &d, i);
+          break;
+        case F0R_PARAM_COLOR:
+          sscanf(s->value, "%f,%f,%f", &color.r, &color.g, &color.b);
+          p->f0r_set_param_value(inst, &color, i);
+          break;
+        case F0R_PARAM_POSITION:
+          sscanf(s->value, "%lf,%lf", &pos.x, &pos.y);
+          p->f0r_set_param_value(inst, &pos, i);
+          break;
+        case F0R_PARAM_STRING:
+          p->f0r_set_param_value(inst, &str, i);
+          break;
+        }
+    }
+  return 1;
+}
+
+/* Plugins seeding their random numbers from the clock get a fixed date:
+ * the executable exports this time() (see test/CMakeLists.txt), which
+ * the plugins bind to instead of the one of the C library. */
+time_t time(time_t* t)
+{
+  const time_t fixed = 1000000000;
+  if (t)
+    *t = fixed;
+  return fixed;
+}
+
+static void run_frame(plugin_t* p, f0r_instance_t inst, double time,
+                      uint32_t* const* in, uint32_t* out)
+{
+  if (p->info.plugin_type == F0R_PLUGIN_TYPE_SOURCE)
+    {
+      if (p->f0r_update)
+        p->f0r_update(inst, time, 0, out);
+      else
+        p->f0r_update2(inst, time, 0, 0, 0, out);
+    }
+  else if (p->info.plugin_type == F0R_PLUGIN_TYPE_FILTER && p->f0r_update)
+    p->f0r_update(inst, time, in[0], out);
+  else
+    p->f0r_update2(inst, time, in[0], in[1], in[2], out);
+}
+
+/* ------------------------------------------------------------------------
+ * input patterns
+ */
+
+static void fill_gradient(uint32_t* frame, unsigned int w, unsigned int h,
+                          unsigned int seed)
+{
+  unsigned int x, y;
+  unsigned char* px = (unsigned char*)frame;
+  for (y = 0; y < h; ++y)
+    for (x = 0; x < w; ++x, px += 4)
+      {
+        unsigned int xx = seed & 1 ? w - 1 - x : x;
+        px[0] = xx * 255 / (w - 1);
+        px[1] = y * 255 / (h - 1);
+        px[2] = (xx + y) * 255 / (w + h - 2);
+        px[3] = 255 - xx * y * 255 / ((w - 1) * (h - 1));
+      }
+}
+
+/* Random pixels in cells of NOISE_CELL x NOISE_CELL, bigger cells keep
+ * the golden frames of the noise cases smaller. */
+static void fill_noise(uint32_t* frame, unsigned int w, unsigned int h,
+                       unsigned int seed)
+{
+  unsigned int x, y;
+  uint32_t rnd = 2463534242u + seed * 7919;
+  for (y = 0; y < h; ++y)
+    for (x = 0; x < w; ++x)
+      if (y % NOISE_CELL)
+        frame[y * w + x] = frame[(y - 1) * w + x];
+      else if (x % NOISE_CELL)
+        frame[y * w + x] = frame[y * w + x - 1];
+      else
+        {
+          rnd ^= rnd << 13;
+          rnd ^= rnd >> 17;
+          rnd ^= rnd << 5;
+          frame[y * w + x] = rnd;
+        }
+}
+
+/* Renders the default output of a source plugin, e.g. test_pat_B. */
+static int fill_source(const char* path, uint32_t* frame,
+                       unsigned int w, unsigned int h)
+{
+  plugin_t src;
+  f0r_instance_t inst;
+  if (!load_plugin(&src, path)
+      || src.info.plugin_type != F0R_PLUGIN_TYPE_SOURCE)
+    return 0;
+  inst = src.f0r_construct(w, h);
+  if (!inst)
+    return 0;
+  run_frame(&src, inst, 0.0, 0, frame);
+  src.f0r_destruct(inst);
+  if (src.f0r_deinit)
+    src.f0r_deinit();
+  return 1;
+}
+
+/* Copies a frame moved by dx, dy pixels, wrapping around. */
+static void move_frame(const uint32_t* from, uint32_t* to,
+                       unsigned int w, unsigned int h,
+                       unsigned int dx, unsigned int dy)
+{
+  unsigned int x, y;
+  for (y = 0; y < h; ++y)
+    for (x = 0; x < w; ++x)
+      to[(y + dy) % h * w + (x + dx) % w] = from[y * w + x];
+}
+
+/* Fills the three input frames of every frame of a case for a pattern,
+ * the second and third inputs of mixers get a different variant of it.
+ * Frame n shows the pattern of frame 0 moved by n * SHIFT_X, SHIFT_Y. */
+static int fill_inputs(const char* pattern, const char* source_path,
+                       uint32_t* (*in)[3], unsigned int w, unsigned int h)
+{
+  unsigned int i, n;
+  for (i = 0; i < 3; ++i)
+    {
+      if (!strcmp(pattern, "gradient"))
+        fill_gradient(in[0][i], w, h, i);
+      else if (!strcmp(pattern, "noise"))
+        fill_noise(in[0][i], w, h, i);
+      else if (!strcmp(pattern, "bars"))
+        {
+          if (i == 0 && !fill_source(source_path, in[0][i], w, h))
+            return 0;
+          if (i > 0)
+            fill_gradient(in[0][i], w, h, i);
+        }
+      else
+        memset(in[0][i], 0, w * h * 4);
+      for (n = 1; n < NUM_FRAMES; ++n)
+        move_frame(in[0][i], in[n][i], w, h, n * SHIFT_X, n * SHIFT_Y);
+    }
+  return 1;
+}
+
+/* ------------------------------------------------------------------------
+ * cases
+ */
+
+static unsigned long long hash_frame(const uint32_t* frame)
+{
+  unsigned long long hash = 14695981039346656037ull;
+  const unsigned char* px = (const unsigned char*)frame;
+  unsigned int i;
+  for (i = 0; i < FRAME_BYTES; ++i)
+    {
+      hash ^= px[i];
+      hash *= 1099511628211ull;
+    }
+  return hash;
+}
+
+/* Converts a frame of bytes to RGBA_FLOAT or RGBA64. */
+static void from_bytes(const uint32_t* frame, int color_model, void* to)
+{
+  const unsigned char* px = (const unsigned char*)frame;
+  unsigned int i;
+  for (i = 0; i < WIDTH * HEIGHT * 4; ++i)
+    if (color_model == F0R_COLOR_MODEL_RGBA_FLOAT)
+      ((float*)to)[i] = px[i] / 255.0f;
+    else
+      ((uint16_t*)to)[i] = px[i] * 257;
+}
+
+/* Converts a RGBA_FLOAT or RGBA64 frame back to bytes, rounding. */
+static void to_bytes(const void* from, int color_model, uint32_t* frame)
+{
+  unsigned char* px = (unsigned char*)frame;
+  unsigned int i;
+  for (i = 0; i < WIDTH * HEIGHT * 4; ++i)
+    if (color_model == F0R_COLOR_MODEL_RGBA_FLOAT)
+      {
+        float v = ((const float*)from)[i] * 255.0f + 0.5f;
+        px[i] = v <= 0.0f ? 0 : v >= 255.0f ? 255 : (unsigned char)v;
+      }
+    else
+      px[i] = (((const uint16_t*)from)[i] * 255u + 32767) / 65535;
+}
+
+static unsigned int pixel_size(int color_model)
+{
+  return color_model == F0R_COLOR_MODEL_RGBA_FLOAT ? 16
+    : color_model == F0R_COLOR_MODEL_RGBA64 ? 8 : 4;
+}
+
+#define PADDING 48 /* bytes after each row of strided frames */
+#define PAD_BYTE 0xa5
+
+/* Runs a frame through f0r_update_stride on copies of the frames with
+ * padded rows. Returns 0 if the padding of the output was written. */
+static int run_strided_frame(plugin_t* p, f0r_instance_t inst, double time,
+                             uint32_t* const* in, uint32_t* out)
+{
+  unsigned int row = WIDTH * pixel_size(p->color_model);
+  unsigned int stride = row + PADDING;
+  unsigned char* frame[4];
+  const uint32_t* used[3] = { 0, 0, 0 };
+  unsigned char* dst;
+  unsigned int i, y, x;
+  int ok = 1;
+
+  for (i = 0; i < 4; ++i)
+    {
+      frame[i] = malloc(stride * HEIGHT);
+      memset(frame[i], PAD_BYTE, stride * HEIGHT);
+      for (y = 0; y < HEIGHT; ++y)
+        memcpy(frame[i] + y * stride,
+               (const unsigned char*)(i < 3 ? in[i] : out) + y * row, row);
+    }
+  for (i = 0; i < 3; ++i)
+    if (p->info.plugin_type != F0R_PLUGIN_TYPE_SOURCE
+        && (i == 0 || p->info.plugin_type != F0R_PLUGIN_TYPE_FILTER))
+      used[i] = (const uint32_t*)frame[i];
+  dst = p->in_place ? frame[0] : frame[3];
+
+  p->f0r_update_stride(inst, time, used[0], stride, used[1], stride,
+                       used[2], stride, (uint32_t*)dst, stride);
+
+  for (y = 0; y < HEIGHT; ++y)
+    {
+      memcpy((unsigned char*)out + y * row, dst + y * stride, row);
+      for (x = row; x < stride; ++x)
+        ok &= dst[y * stride + x] == PAD_BYTE;
+    }
+  for (i = 0; i < 4; ++i)
+    free(frame[i]);
+  if (!ok)
+    fprintf(stderr, "%s: wrote to the padding of the output rows\n",
+            p->info.name);
+  return ok;
+}
+
+static int in_rect(const f0r_rect_t* r, unsigned int x, unsigned int y)
+{
+  return x >= r->x && x - r->x < r->width && y >= r->y && y - r->y < r->height;
+}
+
+/* Runs a frame through f0r_update_roi, for the whole frame into out and
+ * for a rectangle in its middle into a frame of its own. Pixels outside
+ * the modified rectangle are taken from the first input, as a host
+ * would. Returns 0 if the effect wrote outside the modified rectangle,
+ * announced one outside the region or if the two runs differ. */
+static int run_roi_frame(plugin_t* p, f0r_instance_t inst, double time,
+                         uint32_t* const* in, uint32_t* out)
+{
+  f0r_rect_t roi[2] = { { 0, 0, WIDTH, HEIGHT },
+                        { WIDTH / 4, HEIGHT / 3, WIDTH / 2, HEIGHT / 3 } };
+  uint32_t* part = malloc(WIDTH * HEIGHT * 4);
+  uint32_t pad;
+  unsigned int i, x, y;
+  int ok = 1;
+
+  memset(&pad, PAD_BYTE, sizeof(pad));
+  for (i = 0; i < 2; ++i)
+    {
+      uint32_t* dst = i == 0 ? out : part;
+      f0r_rect_t m;
+      memset(dst, PAD_BYTE, WIDTH * HEIGHT * 4);
+      p->f0r_update_roi(inst, time, in[0], in[1], in[2], dst, &roi[i], &m);
+      if (m.width == 0 || m.height == 0)
+        m.width = m.height = 0;
+      else
+        ok &= in_rect(&roi[i], m.x, m.y)
+          && in_rect(&roi[i], m.x + m.width - 1, m.y + m.height - 1);
+
+      for (y = 0; y < HEIGHT; ++y)
+        for (x = 0; x < WIDTH; ++x)
+          {
+            uint32_t* px = dst + y * WIDTH + x;
+            if (!in_rect(&m, x, y))
+              {
+                ok &= *px == pad;
+                *px = in[0][y * WIDTH + x];
+              }
+            if (i == 1 && in_rect(&roi[i], x, y))
+              ok &= *px == out[y * WIDTH + x];
+          }
+    }
+  free(part);
+  if (!ok)
+    fprintf(stderr, "%s: wrong result for a region of interest\n",
+            p->info.name);
+  return ok;
+}
+
+/* Runs frame n of a case through f0r_update_history, with the first
+ * inputs of the earlier frames as history. */
+static void run_history_frame(plugin_t* p, f0r_instance_t inst,
+                              unsigned int n, uint32_t* (*in)[3],
+                              uint32_t* out)
+{
+  const uint32_t* frames[NUM_FRAMES];
+  double times[NUM_FRAMES];
+  unsigned int depth = p->f0r_get_history_depth(inst);
+  unsigned int i, count = n < depth ? n : depth;
+
+  for (i = 0; i < count; ++i)
+    {
+      frames[i] = in[n - 1 - i][0];
+      times[i] = (n - 1 - i) * 0.04;
+    }
+  p->f0r_update_history(inst, n * 0.04, in[n][0], frames, times, count, out);
+}
+
+/* Runs the frames of a case, packed, strided, by region of interest or
+ * with history. In place the first input is copied to the output
+ * before each frame. */
+static int run_frames(plugin_t* p, f0r_instance_t inst,
+                      uint32_t* (*in)[3], uint32_t* out)
+{
+  unsigned int i;
+  int ok = 1;
+  for (i = 0; i < NUM_FRAMES; ++i)
+    if (p->strided)
+      ok &= run_strided_frame(p, inst, i * 0.04, in[i], out);
+    else if (p->roi)
+      ok &= run_roi_frame(p, inst, i * 0.04, in[i], out);
+    else if (p->history)
+      run_history_frame(p, inst, i, in, out);
+    else if (p->in_place)
+      {
+        uint32_t* in_place[3] = { out, in[i][1], in[i][2] };
+        memcpy(out, in[i][0], WIDTH * HEIGHT * pixel_size(p->color_model));
+        run_frame(p, inst, i * 0.04, in_place, out);
+      }
+    else
+      run_frame(p, inst, i * 0.04, in[i], out);
+  return ok;
+}
+
+/* Runs the frames of a case on frames of another color model, with
+ * the instance switched to it. */
+static int run_model_frames(plugin_t* p, f0r_instance_t inst,
+                            uint32_t* (*in)[3], uint32_t* out)
+{
+  unsigned int size = WIDTH * HEIGHT * pixel_size(p->color_model);
+  uint32_t* min[NUM_FRAMES][3];
+  uint32_t* mout = malloc(size);
+  unsigned int i, n;
+  int ok = p->f0r_set_color_model
+    && p->f0r_set_color_model(inst, p->color_model);
+
+  for (n = 0; n < NUM_FRAMES; ++n)
+    for (i = 0; i < 3; ++i)
+      {
+        min[n][i] = malloc(size);
+        from_bytes(in[n][i], p->color_model, min[n][i]);
+      }
+  memset(mout, 0, size);
+  ok = ok && run_frames(p, inst, min, mout);
+  to_bytes(mout, p->color_model, out);
+
+  for (n = 0; n < NUM_FRAMES; ++n)
+    for (i = 0; i < 3; ++i)
+      free(min[n][i]);
+  free(mout);
+  return ok;
+}
+
+static int run_case(plugin_t* p, uint32_t* (*in)[3], double value,
+                    uint32_t* out)
+{
+  int ok;
+  f0r_instance_t inst;
+
+  srand(1);
+  inst = p->f0r_construct(WIDTH, HEIGHT);
+  if (!inst)
+    return 0;
+  set_params(p, inst, value);
+  if (!apply_settings(p, inst))
+    exit(1);
+  if (p->color_model >= 0)
+    ok = run_model_frames(p, inst, in, out);
+  else
+    ok = run_frames(p, inst, in, out);
+  p->f0r_destruct(inst);
+  return ok;
+}
+
+static const char* patterns[] = { "gradient", "noise", "bars" };
+#define NUM_PATTERNS (sizeof(patterns) / sizeof(patterns[0]))
+
+static const char* param_names[] = { "default", "low", "mid", "high" };
+static const double param_values[] = { -1.0, 0.2, 0.5, 0.8 };
+#define NUM_PARAM_SETS (sizeof(param_values) / sizeof(param_values[0]))
+
+static int run_cases(plugin_t* p, const char* source_path, result_t* results)
+{
+  uint32_t* in[NUM_FRAMES][3];
+  uint32_t* again = malloc(FRAME_BYTES);
+  unsigned int i, f, pt, ps, n = 0;
+
+  for (f = 0; f < NUM_FRAMES; ++f)
+    for (i = 0; i < 3; ++i)
+      in[f][i] = malloc(FRAME_BYTES);
+
+  for (pt = 0; pt < NUM_PATTERNS; ++pt)
+    {
+      const char* pattern = patterns[pt];
+      if (p->info.plugin_type == F0R_PLUGIN_TYPE_SOURCE)
+        pattern = "none";
+      else if (!strcmp(pattern, "bars") && !source_path)
+        continue;
+      if (!fill_inputs(pattern, source_path, in, WIDTH, HEIGHT))
+        {
+          fprintf(stderr, "cannot create the %s pattern\n", pattern);
+          exit(1);
+        }
+
+      for (ps = 0; ps < NUM_PARAM_SETS; ++ps)
+        {
+          result_t* r = &results[n++];
+          uint32_t* out = malloc(FRAME_BYTES);
+          memset(out, 0, FRAME_BYTES);
+          memset(again, 0, FRAME_BYTES);
+          if (!run_case(p, in, param_values[ps], out)
+              || !run_case(p, in, param_values[ps], again))
+            {
+              fprintf(stderr, "%s: cannot construct an instance%s\n",
+                      p->info.name,
+                      p->color_model >= 0 || p->strided || p->in_place
+                      || p->roi || p->history
+                      ? " or it failed on the requested frames" : "");
+              exit(1);
+            }
+          strcpy(r->pattern, pattern);
+          strcpy(r->params, param_names[ps]);
+          r->deterministic = !memcmp(out, again, FRAME_BYTES);
+          r->hash = hash_frame(out);
+          r->frame = (unsigned char*)out;
+        }
+
+      if (p->info.plugin_type == F0R_PLUGIN_TYPE_SOURCE)
+        break;
+    }
+
+  for (f = 0; f < NUM_FRAMES; ++f)
+    for (i = 0; i < 3; ++i)
+      free(in[f][i]);
+  free(again);
+  return n;
+}
+
+/* ------------------------------------------------------------------------
+ * golden files
+ */
+
+/* The frames of golden/<name>.txt are in golden/<name>.gz. */
+static void frames_path(const char* path, char* frames, size_t size)
+{
+  size_t len = strlen(path);
+  if (len > 4 && !strcmp(path + len - 4, ".txt"))
+    len -= 4;
+  snprintf(frames, size, "%.*s.gz", (int)len, path);
+}
+
+/* Frames are stored as the difference of every byte to the same channel
+ * of the pixel on its left, which compresses well for smooth output. */
+static void delta_encode(unsigned char* px)
+{
+  unsigned int x, y, c;
+  for (y = 0; y < HEIGHT; ++y)
+    for (x = WIDTH - 1; x > 0; --x)
+      for (c = 0; c < 4; ++c)
+        px[(y * WIDTH + x) * 4 + c] -= px[(y * WIDTH + x - 1) * 4 + c];
+}
+
+static void delta_decode(unsigned char* px)
+{
+  unsigned int x, y, c;
+  for (y = 0; y < HEIGHT; ++y)
+    for (x = 1; x < WIDTH; ++x)
+      for (c = 0; c < 4; ++c)
+        px[(y * WIDTH + x) * 4 + c] += px[(y * WIDTH + x - 1) * 4 + c];
+}
+
+static int write_golden(const char* path, plugin_t* p,
+                        const result_t* results, int n)
+{
+  char fpath[1024];
+  unsigned char* px = malloc(FRAME_BYTES);
+  gzFile gz;
+  int i;
+  FILE* f = fopen(path, "w");
+  if (!f)
+    {
+      perror(path);
+      return 0;
+    }
+  fprintf(f, "# frei0r golden data for %s: pattern, parameters and hash of\n"
+          "# the %dx%d output, the frames are in the .gz file\n",
+          p->info.name, WIDTH, HEIGHT);
+  for (i = 0; i < p->num_settings; ++i)
+    fprintf(f, "set %s=%s\n", p->settings[i].name, p->settings[i].value);
+  for (i = 0; i < n; ++i)
+    fprintf(f, "%s %s %016llx\n", results[i].pattern, results[i].params,
+            results[i].hash);
+  fclose(f);
+
+  frames_path(path, fpath, sizeof(fpath));
+  gz = gzopen(fpath, "wb9");
+  if (!gz)
+    {
+      perror(fpath);
+      return 0;
+    }
+  for (i = 0; i < n; ++i)
+    {
+      memcpy(px, results[i].frame, FRAME_BYTES);
+      delta_encode(px);
+      gzwrite(gz, px, FRAME_BYTES);
+    }
+  free(px);
+  return gzclose(gz) == Z_OK;
+}
+
+/* Reads the "set" lines of a golden file into p and its cases into
+ * golden, with their frames if the .gz file is there. */
+static int read_golden(const char* path, plugin_t* p, result_t* golden,
+                       int max)
+{
+  char line[256], fpath[1024];
+  gzFile gz;
+  int i, n = 0;
+  FILE* f = fopen(path, "r");
+  if (!f)
+    {
+      perror(path);
+      return -1;
+    }
+  while (n < max && fgets(line, sizeof(line), f))
+    {
+      result_t* g = &golden[n];
+      char hash[32];
+
+      if (line[0] == '#' || line[0] == '\n')
+        continue;
+      if (!strncmp(line, "set ", 4))
+        {
+          setting_t* s = &p->settings[p->num_settings];
+          char* eq = strchr(line + 4, '=');
+          size_t nlen, vlen;
+          if (!eq || p->num_settings == MAX_SETTINGS)
+            break;
+          nlen = eq - (line + 4);
+          vlen = strcspn(eq + 1, "\n");
+          if (nlen >= sizeof(s->name) || vlen >= sizeof(s->value))
+            {
+              fprintf(stderr, "%s: setting too long: %s", path, line);
+              fclose(f);
+              return -1;
+            }
+          memcpy(s->name, line + 4, nlen);
+          s->name[nlen] = 0;
+          memcpy(s->value, eq + 1, vlen);
+          s->value[vlen] = 0;
+          ++p->num_settings;
+          continue;
+        }
+      if (sscanf(line, "%31s %31s %31s", g->pattern, g->params, hash) != 3)
+        break;
+      g->deterministic = 1;
+      g->hash = strtoull(hash, 0, 16);
+      g->frame = 0;
+      ++n;
+    }
+  fclose(f);
+
+  frames_path(path, fpath, sizeof(fpath));
+  gz = gzopen(fpath, "rb");
+  for (i = 0; gz && i < n; ++i)
+    {
+      golden[i].frame = malloc(FRAME_BYTES);
+      if (gzread(gz, golden[i].frame, FRAME_BYTES) != FRAME_BYTES)
+        {
+          free(golden[i].frame);
+          golden[i].frame = 0;
+          break;
+        }
+      delta_decode(golden[i].frame);
+    }
+  if (gz)
+    gzclose(gz);
+  return n;
+}
+
+/* A case passes if its hash is that of the golden frame, or if at most
+ * outliers pixels have a channel differing by more than tolerance. */
+static int compare(const result_t* r, const result_t* g, int tolerance,
+                   int outliers)
+{
+  int i, worst = 0, where = 0, count = 0;
+
+  if (!r->deterministic)
+    {
+      printf("%s/%s: FAILED (not deterministic)\n", r->pattern, r->params);
+      return 0;
+    }
+  if (r->hash == g->hash)
+    {
+      printf("%s/%s: ok (exact)\n", r->pattern, r->params);
+      return 1;
+    }
+  if (!g->frame)
+    {
+      printf("%s/%s: FAILED (hash differs, no golden frame)\n",
+             r->pattern, r->params);
+      return 0;
+    }
+  for (i = 0; i < WIDTH * HEIGHT; ++i)
+    {
+      int c, diff = 0;
+      for (c = 0; c < 4; ++c)
+        {
+          int d = abs(r->frame[i * 4 + c] - g->frame[i * 4 + c]);
+          if (d > diff)
+            diff = d;
+        }
+      if (diff > tolerance)
+        ++count;
+      if (diff > worst)
+        {
+          worst = diff;
+          where = i;
+        }
+    }
+  if (count <= outliers)
+    {
+      printf("%s/%s: ok (largest difference %d, %d pixels above %d)\n",
+             r->pattern, r->params, worst, count, tolerance);
+      return 1;
+    }
+  printf("%s/%s: FAILED (%d pixels differ by more than %d, by %d at %d,%d)\n",
+         r->pattern, r->params, count, tolerance, worst,
+         where % WIDTH, where / WIDTH);
+  return 0;
+}
+
+/* ------------------------------------------------------------------------
+ * timing
+ */
+
+static double measure(plugin_t* p)
+{
+  uint32_t* in[3];
+  uint32_t* out;
+  f0r_instance_t inst = p->f0r_construct(TIMING_WIDTH, TIMING_HEIGHT);
+  struct timespec start, stop;
+  unsigned int i;
+
+  if (!inst)
+    return 0.0;
+
+  out = malloc(TIMING_WIDTH * TIMING_HEIGHT * 4);
+  for (i = 0; i < 3; ++i)
+    {
+      in[i] = malloc(TIMING_WIDTH * TIMING_HEIGHT * 4);
+      fill_gradient(in[i], TIMING_WIDTH, TIMING_HEIGHT, i);
+    }
+
+  run_frame(p, inst, 0.0, in, out);
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (i = 1; i <= TIMING_FRAMES; ++i)
+    run_frame(p, inst, i * 0.04, in, out);
+  clock_gettime(CLOCK_MONOTONIC, &stop);
+  p->f0r_destruct(inst);
+
+  for (i = 0; i < 3; ++i)
+    free(in[i]);
+  free(out);
+
+  return ((stop.tv_sec - start.tv_sec) * 1e9 + (stop.tv_nsec - start.tv_nsec))
+    / ((double)TIMING_WIDTH * TIMING_HEIGHT * TIMING_FRAMES);
+}
+
+/* ------------------------------------------------------------------------
+ */
+
+static void usage()
+{
+  fprintf(stderr,
+          "usage: frei0r-test [options] plugin golden\n"
+          "\n"
+          "  -u          write the golden file instead of checking it\n"
+          "  -e value    accepted difference of a channel (default: 2)\n"
+          "  -x count    accepted number of pixels differing more (default: 0)\n"
+          "  -f          run on RGBA_FLOAT frames\n"
+          "  -w          run on RGBA64 frames\n"
+          "  -s          run on frames with padded rows\n"
+          "  -i          run in place, on the first input frame\n"
+          "  -o          run by region of interest\n"
+          "  -y          run with the history of the input frames\n"
+          "  -p plugin   source plugin rendering the \"bars\" input pattern\n"
+          "  -t file     append the measured ns/pixel to file\n");
+}
+
+int main(int argc, char** argv)
+{
+  const char* source_path = 0;
+  const char* timing_path = 0;
+  int update = 0, color_model = -1, strided = 0, in_place = 0;
+  int roi = 0, history = 0;
+  int tolerance = 2, outliers = 0;
+  result_t results[NUM_PATTERNS * NUM_PARAM_SETS];
+  result_t golden[NUM_PATTERNS * NUM_PARAM_SETS];
+  plugin_t p;
+  FILE* golden_file;
+  int i, j, n, ng = 0, failed = 0;
+  double ns;
+
+  for (i = 1; i < argc && argv[i][0] == '-'; ++i)
+    {
+      if (!strcmp(argv[i], "-u"))
+        update = 1;
+      else if (!strcmp(argv[i], "-e") && i + 1 < argc)
+        tolerance = atoi(argv[++i]);
+      else if (!strcmp(argv[i], "-x") && i + 1 < argc)
+        outliers = atoi(argv[++i]);
+      else if (!strcmp(argv[i], "-f"))
+        color_model = F0R_COLOR_MODEL_RGBA_FLOAT;
+      else if (!strcmp(argv[i], "-w"))
+        color_model = F0R_COLOR_MODEL_RGBA64;
+      else if (!strcmp(argv[i], "-s"))
+        strided = 1;
+      else if (!strcmp(argv[i], "-i"))
+        in_place = 1;
+      else if (!strcmp(argv[i], "-o"))
+        roi = 1;
+      else if (!strcmp(argv[i], "-y"))
+        history = 1;
+      else if (!strcmp(argv[i], "-p") && i + 1 < argc)
+        source_path = argv[++i];
+      else if (!strcmp(argv[i], "-t") && i + 1 < argc)
+        timing_path = argv[++i];
+      else
+        break;
+    }
+  if (argc - i != 2)
+    {
+      usage();
+      return 2;
+    }
+
+  if (!load_plugin(&p, argv[i]))
+    return 1;
+  if (color_model >= 0)
+    {
+      int cap = color_model == F0R_COLOR_MODEL_RGBA_FLOAT
+        ? F0R_CAP_RGBA_FLOAT : F0R_CAP_RGBA64;
+      if (!p.f0r_get_capabilities || !(p.f0r_get_capabilities() & cap))
+        {
+          fprintf(stderr, "%s does not support %s\n", p.info.name,
+                  color_model == F0R_COLOR_MODEL_RGBA_FLOAT
+                  ? "RGBA_FLOAT" : "RGBA64");
+          return 1;
+        }
+    }
+  p.color_model = color_model;
+  if (strided && (!p.f0r_update_stride || !p.f0r_get_capabilities
+                  || !(p.f0r_get_capabilities() & F0R_CAP_STRIDE)))
+    {
+      fprintf(stderr, "%s does not support strides\n", p.info.name);
+      return 1;
+    }
+  p.strided = strided;
+  if (in_place && (!p.f0r_get_capabilities
+                   || !(p.f0r_get_capabilities() & F0R_CAP_IN_PLACE)))
+    {
+      fprintf(stderr, "%s cannot run in place\n", p.info.name);
+      return 1;
+    }
+  p.in_place = in_place;
+  if (roi && (!p.f0r_update_roi || !p.f0r_get_capabilities
+              || !(p.f0r_get_capabilities() & F0R_CAP_ROI)
+              || p.info.plugin_type == F0R_PLUGIN_TYPE_SOURCE
+              || color_model >= 0 || strided || in_place))
+    {
+      fprintf(stderr, "%s cannot run by region of interest%s\n", p.info.name,
+              color_model >= 0 || strided || in_place
+              ? " on the requested frames" : "");
+      return 1;
+    }
+  p.roi = roi;
+  if (history && (!p.f0r_get_history_depth || !p.f0r_update_history
+                  || !p.f0r_get_capabilities
+                  || !(p.f0r_get_capabilities() & F0R_CAP_HISTORY)
+                  || p.info.plugin_type != F0R_PLUGIN_TYPE_FILTER
+                  || color_model >= 0 || strided || in_place || roi))
+    {
+      fprintf(stderr, "%s cannot run with history%s\n", p.info.name,
+              color_model >= 0 || strided || in_place || roi
+              ? " on the requested frames" : "");
+      return 1;
+    }
+  p.history = history;
+
+  /* an update keeps the "set" lines of an existing golden file */
+  golden_file = fopen(argv[i + 1], "r");
+  if (golden_file || !update)
+    {
+      if (golden_file)
+        fclose(golden_file);
+      ng = read_golden(argv[i + 1], &p, golden,
+                       NUM_PATTERNS * NUM_PARAM_SETS);
+      if (ng < 0)
+        return 1;
+    }
+
+  n = run_cases(&p, source_path, results);
+
+  if (update)
+    {
+      for (j = 0; j < n; ++j)
+        if (!results[j].deterministic)
+          {
+            printf("%s/%s: FAILED (not deterministic)\n",
+                   results[j].pattern, results[j].params);
+            failed = 1;
+          }
+      if (!failed && !write_golden(argv[i + 1], &p, results, n))
+        failed = 1;
+    }
+  else
+    {
+      for (j = 0; j < n; ++j)
+        {
+          int k;
+          for (k = 0; k < ng; ++k)
+            if (!strcmp(results[j].pattern, golden[k].pattern)
+                && !strcmp(results[j].params, golden[k].params))
+              break;
+          if (k == ng)
+            {
+              printf("%s/%s: FAILED (no golden data)\n",
+                     results[j].pattern, results[j].params);
+              failed = 1;
+            }
+          else if (!compare(&results[j], &golden[k], tolerance, outliers))
+            failed = 1;
+        }
+
+      ns = measure(&p);
+      printf("timing: %.3f ns/pixel at %dx%d\n", ns, TIMING_WIDTH,
+             TIMING_HEIGHT);
+      if (timing_path)
+        {
+          FILE* f = fopen(timing_path, "a");
+          if (f)
+            {
+              fprintf(f, "%s,%.3f\n", p.info.name, ns);
+              fclose(f);
+            }
+        }
+    }
+
+  for (j = 0; j < n; ++j)
+    free(results[j].frame);
+  for (j = 0; j < ng; ++j)
+    free(golden[j].frame);
+  if (p.f0r_deinit)
+    p.f0r_deinit();
+  return failed;
+}